@@ -12,7 +12,14 @@
 #include <sys/ioctl.h>
 #endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "mrfconfig.h"
+#include "mrfmmio.h"
 
 #define XL_CMD_READ_ARRAY      0xff
 #define XL_CMD_READ_STATUS     0x70
@@ -34,7 +41,9 @@
 #define XL_CRD                 0x12BBE
 
 #define XL_BLOCK_SIZE          0x20000
+#define XL_BUFFER_SIZE         64
 #define XL_MEM_WINDOW          0x01000000
+#define XL_PARTITION_SIZE      (XL_MEM_WINDOW/4)
 
 #ifndef be16_to_cpu
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -64,6 +73,37 @@ static const unsigned char bit_reverse_byte[] =
   0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF, 0x3F, 0xBF, 0x7F, 0xFF
 };
 
+static int XL_verbose = 1;
+
+/* Reverse bits of each byte, eight bytes at a time */
+void XL_bit_reverse(unsigned char *buf, int size)
+{
+  uint64_t x;
+  int i;
+
+  for (i = 0; i + 8 <= size; i += 8)
+    {
+      memcpy(&x, buf + i, 8);
+      x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+      x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+      x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+      memcpy(buf + i, &x, 8);
+    }
+  for (; i < size; i++)
+    buf[i] = bit_reverse_byte[buf[i]];
+}
+
+int XL_is_blank(const unsigned char *buf, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++)
+    if (buf[i] != 0xff)
+      return 0;
+
+  return 1;
+}
+
 
 void XL_initialize(volatile short *flash)
 {
@@ -130,6 +170,54 @@ void XL_dump_block(volatile short *flash, int ba)
     }
 }
 
+int XL_block_unlock_erase(volatile short *flash, int ba)
+{
+  int i;
+  short d;
+
+  /* Unlock Block */
+
+  *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD_BLOCK_UNLOCK);
+  *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD2_BLOCK_UNLOCK);     
+
+  *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD_BLOCK_ERASE);
+  *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD2_BLOCK_ERASE);
+
+  i = 0;
+  do
+    {
+      d = be16_to_cpu(*(flash + (ba >> 1)));
+      i++;
+    }
+  while (!(d & 0x80));
+
+  if (XL_verbose)
+    fprintf(stderr, "Block erase command took %d loops, status %02x\n", i, d);
+
+  if (d & 0x0008)
+    {
+      fprintf(stderr, "Invalid VPP.\n");
+      return -1;
+    }
+  if ((d & 0x0030) == 0x0030)
+    {
+      fprintf(stderr, "Invalid command sequence.\n");
+      return -1;
+    }
+  if ((d & 0x0020) == 0x0020)
+    {
+      fprintf(stderr, "Erase error.\n");
+      return -1;
+    }
+  if ((d & 0x0002) == 0x0002)
+    {
+      fprintf(stderr, "Block Protected.\n");
+      return -1;
+    }
+
+  return 0;
+}
+
 int XL_block_erase(volatile short *flash, int ba)
 {
   int i;
@@ -177,45 +265,7 @@ int XL_block_erase(volatile short *flash, int ba)
   if (i != XL_BLOCK_SIZE)
     {
       fprintf(stderr, "Blank check failed on block %08X, erasing block\n", ba);
-
-      /* Unlock Block */
-
-      *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD_BLOCK_UNLOCK);
-      *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD2_BLOCK_UNLOCK);     
-
-      *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD_BLOCK_ERASE);
-      *(flash + (ba >> 1)) = be16_to_cpu(XL_CMD2_BLOCK_ERASE);
-
-      i = 0;
-      do
-	{
-	  d = be16_to_cpu(*(flash + (ba >> 1)));
-	  i++;
-	}
-      while (!(d & 0x80));
-
-      fprintf(stderr, "Block erase command took %d loops, status %02x\n", i, d);
-
-      if (d & 0x0008)
-	{
-	  fprintf(stderr, "Invalid VPP.\n");
-	  return -1;
-	}
-      if (d & 0x0030 == 0x0030)
-	{
-	  fprintf(stderr, "Invalid command sequence.\n");
-	  return -1;
-	}
-      if (d & 0x0020 == 0x0020)
-	{
-	  fprintf(stderr, "Erase error.\n");
-	  return -1;
-	}
-      if (d & 0x0002 == 0x0002)
-	{
-	  fprintf(stderr, "Block Protected.\n");
-	  return -1;
-	}
+      return XL_block_unlock_erase(flash, ba);
     }
 
   return 0;
@@ -267,19 +317,20 @@ int XL_buffer_program(volatile short *flash, int ba, char *buffer)
     }
   while (!(d & 0x80));
 
-  fprintf(stderr, "Buffer program took %d loops, status %02x\r", i, d);
+  if (XL_verbose)
+    fprintf(stderr, "Buffer program took %d loops, status %02x\r", i, d);
 
   if (d & 0x0008)
     {
       fprintf(stderr, "Invalid VPP.\n");
       return -1;
     }
-  if (d & 0x0010 == 0x0010)
+  if ((d & 0x0010) == 0x0010)
     {
       fprintf(stderr, "Program error.\n");
       return -1;
     }
-  if (d & 0x0002 == 0x0002)
+  if ((d & 0x0002) == 0x0002)
     {
       fprintf(stderr, "Block Protected.\n");
       return -1;
@@ -288,6 +339,97 @@ int XL_buffer_program(volatile short *flash, int ba, char *buffer)
   return 0;
 }
 
+double XL_now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+  Update partition at bka with a bit reversed image of
+  XL_PARTITION_SIZE bytes. Blocks are compared with the flash contents
+  and only blocks that differ are erased and programmed; buffers that
+  are blank in the image are skipped after erase. Each programmed block
+  is read back and its CRC-32 compared with the image.
+*/
+int XL_update(volatile short *flash, int bka, unsigned char *image)
+{
+  unsigned char *cur;
+  int ba, off, nblocks, unchanged = 0, erased = 0, programmed = 0;
+  long written = 0;
+  u32 crc_image, crc_flash;
+  double start, elapsed;
+
+  cur = malloc(XL_BLOCK_SIZE);
+  if (cur == NULL)
+    return -1;
+
+  XL_verbose = 0;
+  nblocks = XL_PARTITION_SIZE / XL_BLOCK_SIZE;
+  start = XL_now();
+  for (ba = 0; ba < XL_PARTITION_SIZE; ba += XL_BLOCK_SIZE)
+    {
+      *(flash + ((bka + ba) >> 1)) = be16_to_cpu(XL_CMD_READ_ARRAY);
+      MrfMmioRead(cur, flash + ((bka + ba) >> 1), XL_BLOCK_SIZE);
+      if (!memcmp(cur, image + ba, XL_BLOCK_SIZE))
+	{
+	  unchanged++;
+	  fprintf(stderr, "Block %08X unchanged        (%d/%d)\n", bka + ba,
+		  ba / XL_BLOCK_SIZE + 1, nblocks);
+	  continue;
+	}
+
+      if (!XL_is_blank(cur, XL_BLOCK_SIZE))
+	{
+	  XL_clear_status_register(flash);
+	  if (XL_block_unlock_erase(flash, bka + ba))
+	    break;
+	  erased++;
+	}
+
+      for (off = 0; off < XL_BLOCK_SIZE; off += XL_BUFFER_SIZE)
+	{
+	  if (XL_is_blank(image + ba + off, XL_BUFFER_SIZE))
+	    continue;
+	  if (XL_buffer_program(flash, bka + ba + off,
+				(char *) image + ba + off))
+	    break;
+	  written += XL_BUFFER_SIZE;
+	}
+      if (off < XL_BLOCK_SIZE)
+	break;
+
+      *(flash + ((bka + ba) >> 1)) = be16_to_cpu(XL_CMD_READ_ARRAY);
+      MrfMmioRead(cur, flash + ((bka + ba) >> 1), XL_BLOCK_SIZE);
+      crc_image = MrfConfigCrc(image + ba, XL_BLOCK_SIZE);
+      crc_flash = MrfConfigCrc(cur, XL_BLOCK_SIZE);
+      if (crc_image != crc_flash)
+	{
+	  fprintf(stderr, "Verify failed on block %08X, CRC %08X, "
+		  "expected %08X\n", bka + ba, crc_flash, crc_image);
+	  break;
+	}
+      programmed++;
+      elapsed = XL_now() - start;
+      fprintf(stderr, "Block %08X programmed, CRC %08X (%d/%d) %.1f kB/s\n",
+	      bka + ba, crc_flash, ba / XL_BLOCK_SIZE + 1, nblocks,
+	      written / 1024.0 / elapsed);
+    }
+  elapsed = XL_now() - start;
+
+  *(flash + (bka >> 1)) = be16_to_cpu(XL_CMD_READ_ARRAY);
+  free(cur);
+  XL_verbose = 1;
+
+  fprintf(stderr, "%d blocks unchanged, %d erased, %d programmed, "
+	  "%ld bytes in %.2f s (%.1f kB/s)\n", unchanged, erased, programmed,
+	  written, elapsed, elapsed > 0.0 ? written / 1024.0 / elapsed : 0.0);
+
+  return (ba < XL_PARTITION_SIZE) ? -1 : 0;
+}
+
 void help(char *cmd)
 {
   fprintf(stderr, "Usage: %s [command] /dev/er3a1\n", cmd);
@@ -295,12 +437,15 @@ void help(char *cmd)
   fprintf(stderr, "-d Dump flash contents to stdio (binary)\n");
   fprintf(stderr, "-e[0-3] Erase partition (0 = fallback image , 3 = primary image)\n");
   fprintf(stderr, "-p[0-3] Program buffer (0 = fallback image , 3 = primary image)\n");
+  fprintf(stderr, "-u[0-3] Update partition from stdin, erase and program changed blocks\n"
+	  "        only and verify (0 = fallback image , 3 = primary image)\n");
 }
 
 int main(int argc, char *argv[])
 {
   short *flash;
   int   fdFlash;
+  int   result = 0;
 
   if (argc < 2 || (argc >= 2 && argv[1][0] != '-'))
     {
@@ -354,7 +499,7 @@ int main(int argc, char *argv[])
     case 'e':
       {
 	int bka, ba;
-	if (argv[1][2] < '0' && argv[1][2] > '3')
+	if (argv[1][2] < '0' || argv[1][2] > '3')
 	  {
 	    help(argv[0]);
 	    break;
@@ -369,7 +514,7 @@ int main(int argc, char *argv[])
 	int bka, ba, d, i;
 	char buffer[64];
 
-	if (argv[1][2] < '0' && argv[1][2] > '3')
+	if (argv[1][2] < '0' || argv[1][2] > '3')
 	  {
 	    help(argv[0]);
 	    break;
@@ -387,10 +532,44 @@ int main(int argc, char *argv[])
 	    if (i || feof(stdin))
 	      break;
 	  }
+	break;
+      }
+    case 'u':
+      {
+	int bka, size;
+	unsigned char *image;
+
+	if (argv[1][2] < '0' || argv[1][2] > '3')
+	  {
+	    help(argv[0]);
+	    break;
+	  }
+	bka = (argv[1][2] - '0') << 22;
+
+	image = malloc(XL_PARTITION_SIZE);
+	if (image == NULL)
+	  {
+	    result = -1;
+	    break;
+	  }
+	memset(image, 0xff, XL_PARTITION_SIZE);
+	size = fread(image, 1, XL_PARTITION_SIZE, stdin);
+	if (getchar() != EOF)
+	  {
+	    fprintf(stderr, "Image larger than partition.\n");
+	    free(image);
+	    result = -1;
+	    break;
+	  }
+	fprintf(stderr, "Image %d bytes\n", size);
+	XL_bit_reverse(image, size);
+	result = XL_update(flash, bka, image);
+	free(image);
+	break;
       }
     }
 
   munmap(flash, XL_MEM_WINDOW);
   close(fdFlash);
-  return 0;
+  return result;
 }
@@ -43,6 +43,8 @@
 #include "egapi.h"
 #include "erapi.h"
 #include "fracdiv.h"
+#include "mrflock.h"
+#include "mrfmmio.h"
 
 /*
 #define DEBUG 1
@@ -105,6 +107,23 @@ int EvgClose(int fd)
   result = munmap(0, EVG_MEM_WINDOW);
   return close(fd);
 }
+
+/**
+Enable/disable thread-safe register access for EVG mapping.
+
+See EvrSetThreadSafe().
+
+@param pEg Pointer to MrfEgRegs structure
+@param enable 0 - disable, 1 - enable
+@return Returns 0 on success, -1 on error.
+*/
+int EvgSetThreadSafe(volatile struct MrfEgRegs *pEg, int enable)
+{
+  if (enable)
+    return MrfLockRegister(pEg, sizeof(struct MrfEgRegs));
+  else
+    return MrfLockUnregister(pEg);
+}
 #else
 int EvgClose(int fd)
 {
@@ -130,10 +149,12 @@ Enable/disable EVG.
 */
 int EvgEnable(volatile struct MrfEgRegs *pEg, int state)
 {
+  MRF_LOCK(pEg->Control);
   if (state)
     pEg->Control |= be32_to_cpu(1 << C_EVG_CTRL_MASTER_ENABLE);
   else
     pEg->Control &= be32_to_cpu(~(1 << C_EVG_CTRL_MASTER_ENABLE));
+  MRF_UNLOCK(pEg->Control);
   
   return EvgGetEnable(pEg);
 }
@@ -156,10 +177,12 @@ Enable/disable EVG as system master.
 */
 int EvgSystemMasterEnable(volatile struct MrfEgRegs *pEg, int state)
 {
+  MRF_LOCK(pEg->Control);
   if (state)
     pEg->Control |= be32_to_cpu(1 << C_EVG_CTRL_DCMASTER_ENABLE);
   else
     pEg->Control &= be32_to_cpu(~(1 << C_EVG_CTRL_DCMASTER_ENABLE));
+  MRF_UNLOCK(pEg->Control);
   
   return EvgGetSystemMasterEnable(pEg);
 }
@@ -182,10 +205,12 @@ Enable/disable EVG delay compensation beacon generator.
 */
 int EvgBeaconEnable(volatile struct MrfEgRegs *pEg, int state)
 {
+  MRF_LOCK(pEg->Control);
   if (state)
     pEg->Control |= be32_to_cpu(1 << C_EVG_CTRL_BEACON_ENABLE);
   else
     pEg->Control &= be32_to_cpu(~(1 << C_EVG_CTRL_BEACON_ENABLE));
+  MRF_UNLOCK(pEg->Control);
   
   return EvgGetBeaconEnable(pEg);
 }
@@ -208,12 +233,14 @@ Enable/disable EVG upstream SFP receiver port.
 */
 int EvgRxEnable(volatile struct MrfEgRegs *pEg, int state)
 {
+  MRF_LOCK(pEg->Control);
   if (!state)
     pEg->Control |= be32_to_cpu((1 << C_EVG_CTRL_RX_DISABLE) |
 				(1 << C_EVG_CTRL_RX_PWRDOWN));
   else
     pEg->Control &= be32_to_cpu(~((1 << C_EVG_CTRL_RX_DISABLE) |
 				  (1 << C_EVG_CTRL_RX_PWRDOWN)));
+  MRF_UNLOCK(pEg->Control);
   
   return EvgRxGetEnable(pEg);
 }
@@ -259,11 +286,13 @@ int EvgSWEventEnable(volatile struct MrfEgRegs *pEg, int state)
     (1 << C_EVG_SWEVENT_CODE_LOW));
   int swe;
 
+  MRF_LOCK(pEg->SWEvent);
   swe = be32_to_cpu(pEg->SWEvent);
   if (state)
     pEg->SWEvent = be32_to_cpu(1 << C_EVG_SWEVENT_ENABLE | (swe & mask));
   else
     pEg->SWEvent = be32_to_cpu(~(1 << C_EVG_SWEVENT_ENABLE) & swe & mask);
+  MRF_UNLOCK(pEg->SWEvent);
   return EvgGetSWEventEnable(pEg);
 }
 
@@ -288,11 +317,13 @@ int EvgSendSWEvent(volatile struct MrfEgRegs *pEg, int code)
     (1 << C_EVG_SWEVENT_CODE_LOW));
   int swcode;
 
+  MRF_LOCK(pEg->SWEvent);
   swcode = be32_to_cpu(pEg->SWEvent);
   swcode &= mask;
   swcode |= (code & EVG_MAX_EVENT_CODE);
 
   pEg->SWEvent = be32_to_cpu(swcode);
+  MRF_UNLOCK(pEg->SWEvent);
 
   return be32_to_cpu(pEg->SWEvent);
 }
@@ -305,10 +336,12 @@ Enable/disable EVG event analyzer.
 */
 int EvgEvanEnable(volatile struct MrfEgRegs *pEg, int state)
 {
+  MRF_LOCK(pEg->EvanControl);
   if (state)
     pEg->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_ENABLE);
   else
     pEg->EvanControl &= be32_to_cpu(~(1 << C_EVG_EVANCTRL_ENABLE));
+  MRF_UNLOCK(pEg->EvanControl);
   
   return EvgEvanGetEnable(pEg);
 }
@@ -331,7 +364,9 @@ void EvgEvanReset(volatile struct MrfEgRegs *pEg)
 {
   struct EvanStruct evan;
 
+  MRF_LOCK(pEg->EvanControl);
   pEg->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_RESET);
+  MRF_UNLOCK(pEg->EvanControl);
   /* Dummy read to clear FIFO */
   EvgEvanGetEvent(pEg, &evan);
 }
@@ -342,7 +377,9 @@ Reset EVG event analyzer time counter.
 */
 void EvgEvanResetCount(volatile struct MrfEgRegs *pEg)
 {
+  MRF_LOCK(pEg->EvanControl);
   pEg->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_COUNTRES);
+  MRF_UNLOCK(pEg->EvanControl);
 }
 
 /**
@@ -353,6 +390,9 @@ Get EVG event analyzer event.
 */
 int EvgEvanGetEvent(volatile struct MrfEgRegs *pEg, struct EvanStruct *evan)
 {
+  int result = -1;
+
+  MRF_LOCK(pEg->EvanCode);
   if (pEg->EvanControl & be32_to_cpu(1 << C_EVG_EVANCTRL_NOTEMPTY))
     {
       /* Reading the event code & dbus data, pops the next item first from the event
@@ -360,9 +400,11 @@ int EvgEvanGetEvent(volatile struct MrfEgRegs *pEg, struct EvanStruct *evan)
       evan->EventCode = be32_to_cpu(pEg->EvanCode);
       evan->TimestampHigh = be32_to_cpu(pEg->EvanTimeH);
       evan->TimestampLow = be32_to_cpu(pEg->EvanTimeL);
-      return 0;
+      result = 0;
     }
-  return -1;
+  MRF_UNLOCK(pEg->EvanCode);
+
+  return result;
 }
 
 /**
@@ -439,7 +481,9 @@ Synchronize EVG multiplexed counters.
 */
 void EvgSyncMxc(volatile struct MrfEgRegs *pEg)
 {
+  MRF_LOCK(pEg->Control);
   pEg->Control |= be32_to_cpu(1 << C_EVG_CTRL_MXC_RESET);
+  MRF_UNLOCK(pEg->Control);
 }
 
 /**
@@ -484,8 +528,10 @@ int EvgSetDBusMap(volatile struct MrfEgRegs *pEg, int dbus, int map)
     return -1;
 
   mask = ~(C_EVG_DBUS_SEL_MASK << (dbus*C_EVG_DBUS_SEL_BITS));
+  MRF_LOCK(pEg->DBusMap);
   pEg->DBusMap &= be32_to_cpu(mask);
   pEg->DBusMap |= be32_to_cpu(map << (dbus*C_EVG_DBUS_SEL_BITS));
+  MRF_UNLOCK(pEg->DBusMap);
 
   return 0;
 }
@@ -567,6 +613,7 @@ int EvgSetACInput(volatile struct MrfEgRegs *pEg, int bypass, int sync, int div,
 {
   unsigned int result;
 
+  MRF_LOCK(pEg->ACControl);
   result = be32_to_cpu(pEg->ACControl);
 
   if (bypass == 0)
@@ -602,6 +649,7 @@ int EvgSetACInput(volatile struct MrfEgRegs *pEg, int bypass, int sync, int div,
     }
 
   pEg->ACControl = be32_to_cpu(result);
+  MRF_UNLOCK(pEg->ACControl);
 
   return 0;
 }
@@ -697,6 +745,7 @@ int EvgSetRFInput(volatile struct MrfEgRegs *pEg, int RFsel, int div)
 {
   int rfdiv;
 
+  MRF_LOCK(pEg->ClockControl);
   rfdiv = be32_to_cpu(pEg->ClockControl);
 
   rfdiv &= ~(C_EVG_CLKCTRL_RFSELMASK);
@@ -710,6 +759,7 @@ int EvgSetRFInput(volatile struct MrfEgRegs *pEg, int RFsel, int div)
     }
     
   pEg->ClockControl = be32_to_cpu(rfdiv);
+  MRF_UNLOCK(pEg->ClockControl);
 
   return 0;
 }
@@ -883,6 +933,7 @@ int EvgSeqRamControl(volatile struct MrfEgRegs *pEg, int ram, int enable, int si
   if (ram < 0 || ram >= EVG_SEQRAMS)
     return -1;
 
+  MRF_LOCK(pEg->SeqRamControl[ram]);
   control = be32_to_cpu(pEg->SeqRamControl[ram]);
 
   if (enable == 0)
@@ -916,6 +967,7 @@ int EvgSeqRamControl(volatile struct MrfEgRegs *pEg, int ram, int enable, int si
     }
 
   pEg->SeqRamControl[ram] = be32_to_cpu(control);
+  MRF_UNLOCK(pEg->SeqRamControl[ram]);
 
   return 0;
 }
@@ -995,7 +1047,9 @@ int EvgSeqRamSWTrig(volatile struct MrfEgRegs *pEg, int ram)
   if (ram < 0 || ram > 1)
     return -1;
 
+  MRF_LOCK(pEg->SeqRamControl[ram]);
   pEg->SeqRamControl[ram] |= be32_to_cpu(1 << C_EVG_SQRC_SWTRIGGER);
+  MRF_UNLOCK(pEg->SeqRamControl[ram]);
   
   return 0;
 }
@@ -1204,11 +1258,13 @@ Show Universal I/O Input Mappings.
 */
 void EvgUnivinDump(volatile struct MrfEgRegs *pEg)
 {
+  u32 maps[EVG_MAX_UNIVIN_MAP];
   int univ;
 
+  MrfMmioRead(maps, pEg->UnivInMap, sizeof(maps));
   for (univ = 0; univ < EVG_MAX_UNIVIN_MAP; univ++)
     {
-      int map = be32_to_cpu(pEg->UnivInMap[univ]); 
+      int map = be32_to_cpu(maps[univ]);
       DEBUG_PRINTF("UnivIn%d Mapped to Trig %08x, DBus %02x, IRQ %d, seqtrig %d, seqmask %02x\n", univ,
 		   (map >> C_EVG_INMAP_TRIG_BASE)
 		   & ((1 << EVG_MAX_TRIGGERS) - 1),
@@ -1372,11 +1428,13 @@ Show Front panel Input Mappings.
 */
 void EvgFPinDump(volatile struct MrfEgRegs *pEg)
 {
+  u32 maps[EVG_MAX_FPIN_MAP];
   int fp;
 
+  MrfMmioRead(maps, pEg->FPInMap, sizeof(maps));
   for (fp = 0; fp < EVG_MAX_FPIN_MAP; fp++)
     {
-      int map = be32_to_cpu(pEg->FPInMap[fp]); 
+      int map = be32_to_cpu(maps[fp]);
       DEBUG_PRINTF("FPIn%d Mapped to Trig %08x, DBus %02x, IRQ %d, seqtrig %d, seqena %d, seqmask %02x\n", fp,
 		   (map >> C_EVG_INMAP_TRIG_BASE)
 		   & ((1 << EVG_MAX_TRIGGERS) - 1),
@@ -1536,11 +1594,13 @@ Show Transition board Input Mappings.
 */
 void EvgTBinDump(volatile struct MrfEgRegs *pEg)
 {
+  u32 maps[EVG_MAX_TBIN_MAP];
   int tb;
 
+  MrfMmioRead(maps, pEg->TBInMap, sizeof(maps));
   for (tb = 0; tb < EVG_MAX_TBIN_MAP; tb++)
     {
-      int map = be32_to_cpu(pEg->TBInMap[tb]); 
+      int map = be32_to_cpu(maps[tb]);
       DEBUG_PRINTF("TBIn%d Mapped to Trig %08x, DBus %02x, IRQ %d, seqtrig %d, seqmask %02x\n", tb,
 		   (map >> C_EVG_INMAP_TRIG_BASE)
 		   & ((1 << EVG_MAX_TRIGGERS) - 1),
@@ -1698,11 +1758,13 @@ Show Backplane Input Mappings.
 */
 void EvgBPinDump(volatile struct MrfEgRegs *pEg)
 {
+  u32 maps[EVG_MAX_BPIN_MAP];
   int bp;
 
+  MrfMmioRead(maps, pEg->BPInMap, sizeof(maps));
   for (bp = 0; bp < EVG_MAX_BPIN_MAP; bp++)
     {
-      int map = be32_to_cpu(pEg->BPInMap[bp]); 
+      int map = be32_to_cpu(maps[bp]);
       DEBUG_PRINTF("BPIn%d Mapped to Trig %08x, DBus %02x, IRQ %d, seqtrig %d, seqmask %02x\n", bp,
 		   (map >> C_EVG_INMAP_TRIG_BASE)
 		   & ((1 << EVG_MAX_TRIGGERS) - 1),
@@ -1730,6 +1792,7 @@ int EvgSetTriggerEvent(volatile struct MrfEgRegs *pEg, int trigger, int code, in
   if (trigger < 0 || trigger >= EVG_TRIGGERS)
     return 0;
 
+  MRF_LOCK(pEg->EventTrigger[trigger]);
   result = be32_to_cpu(pEg->EventTrigger[trigger]);
 					     
   if (code >= 0 && code <= EVG_MAX_EVENT_CODE)
@@ -1744,6 +1807,7 @@ int EvgSetTriggerEvent(volatile struct MrfEgRegs *pEg, int trigger, int code, in
     result |= (1 << C_EVG_EVENTTRIG_ENABLE);
 
   pEg->EventTrigger[trigger] = be32_to_cpu(result);
+  MRF_UNLOCK(pEg->EventTrigger[trigger]);
 
   return 0;
 }
@@ -1781,11 +1845,13 @@ Show Event Triggers.
 */
 void EvgTriggerEventDump(volatile struct MrfEgRegs *pEg)
 {
+  u32 trig[EVG_TRIGGERS];
   int trigger, result;
 
+  MrfMmioRead(trig, pEg->EventTrigger, sizeof(trig));
   for (trigger = 0; trigger < EVG_TRIGGERS; trigger++)
     {
-      result = be32_to_cpu(pEg->EventTrigger[trigger]);
+      result = be32_to_cpu(trig[trigger]);
       printf("Trigger%d code %02x %s\n",
 	     trigger, (result & ((1 << (C_EVG_EVENTTRIG_CODE_HIGH + 1)) -
 				 (1 << C_EVG_EVENTTRIG_CODE_LOW))) >>
@@ -1794,6 +1860,203 @@ void EvgTriggerEventDump(volatile struct MrfEgRegs *pEg)
     }
 }
 
+/** @private */
+static volatile u32 *EvgInMapRegs(volatile struct MrfEgRegs *pEg, int inclass,
+				  int *size)
+{
+  switch (inclass)
+    {
+    case EVG_INMAP_FP:
+      *size = EVG_MAX_FPIN_MAP;
+      return pEg->FPInMap;
+    case EVG_INMAP_UNIV:
+      *size = EVG_MAX_UNIVIN_MAP;
+      return pEg->UnivInMap;
+    case EVG_INMAP_BP:
+      *size = EVG_MAX_BPIN_MAP;
+      return pEg->BPInMap;
+    case EVG_INMAP_TB:
+      *size = EVG_MAX_TBIN_MAP;
+      return pEg->TBInMap;
+    }
+
+  return NULL;
+}
+
+/** @private Number of lowest bit set in field, -1 if none */
+static int EvgInMapBit(u32 map, int base, int bits)
+{
+  int i;
+
+  map = (map >> base) & ((1 << bits) - 1);
+  if (!map)
+    return -1;
+  for (i = 0; !(map & 1); i++)
+    map >>= 1;
+
+  return i;
+}
+
+/**
+Set up input mappings of a range of inputs of one class. The encoding
+is the same as with EvgSetFPinMap(), except that the interrupt mapping
+and a sequence mask cannot be combined as both use bit 24. The
+mappings are control registers and are written with one uncached
+32-bit store each.
+
+@param pEg Pointer to MrfEgRegs structure
+@param inclass EVG_INMAP_FP, EVG_INMAP_UNIV, EVG_INMAP_BP or EVG_INMAP_TB
+@param first Number of first input
+@param map Mappings of inputs first to first + n - 1
+@param n Number of inputs
+@return Returns number of inputs written, -1 on error. Nothing is
+written if a mapping is out of range.
+*/
+int EvgSetInMapTable(volatile struct MrfEgRegs *pEg, int inclass, int first,
+		     const struct EvgInMapStruct *map, int n)
+{
+  volatile u32 *regs;
+  u32 buf[EVG_MAX_TBIN_MAP];
+  int size, i, m;
+
+  regs = EvgInMapRegs(pEg, inclass, &size);
+  if (regs == NULL || first < 0 || n < 0 || first + n > size)
+    return -1;
+
+  for (i = 0; i < n; i++)
+    {
+      /* Sequence RAM trigger bits follow the EVG_TRIGGERS trigger bits */
+      if (map[i].trig >= EVG_TRIGGERS || map[i].dbus >= EVG_DBUS_BITS ||
+	  map[i].seqtrig >= EVG_MAX_SEQRAMS || map[i].seqena >= EVG_MAX_SEQRAMS ||
+	  (map[i].irq && map[i].mask > 0))
+	return -1;
+
+      m = 0;
+      if (map[i].trig >= 0)
+	m |= (1 << (C_EVG_INMAP_TRIG_BASE + map[i].trig));
+      if (map[i].dbus >= 0)
+	m |= (1 << (C_EVG_INMAP_DBUS_BASE + map[i].dbus));
+      if (map[i].irq)
+	m |= (1 << (C_EVG_INMAP_IRQ));
+      if (map[i].seqtrig >= 0)
+	m |= (1 << (C_EVG_INMAP_SEQTRIG_BASE + map[i].seqtrig));
+      if (map[i].seqena >= 0)
+	m |= (1 << (C_EVG_INMAP_SEQENA_BASE + map[i].seqena));
+      if (map[i].mask >= 0)
+	m |= ((map[i].mask & 0x00ff) << C_EVG_INMAP_SEQMASK);
+      buf[i] = be32_to_cpu(m);
+    }
+
+  for (i = 0; i < n; i++)
+    regs[first + i] = buf[i];
+
+  return n;
+}
+
+/**
+Get input mappings of a range of inputs of one class with one block
+read. Bit 24 is decoded only as part of the sequence mask, irq is
+always 0.
+
+@param pEg Pointer to MrfEgRegs structure
+@param inclass EVG_INMAP_FP, EVG_INMAP_UNIV, EVG_INMAP_BP or EVG_INMAP_TB
+@param first Number of first input
+@param map Returns mappings of inputs first to first + n - 1
+@param n Number of inputs
+@return Returns number of inputs read, -1 on error.
+*/
+int EvgGetInMapTable(volatile struct MrfEgRegs *pEg, int inclass, int first,
+		     struct EvgInMapStruct *map, int n)
+{
+  volatile u32 *regs;
+  u32 buf[EVG_MAX_TBIN_MAP], m;
+  int size, i;
+
+  regs = EvgInMapRegs(pEg, inclass, &size);
+  if (regs == NULL || first < 0 || n < 0 || first + n > size)
+    return -1;
+
+  MrfMmioRead(buf, &regs[first], n * sizeof(u32));
+
+  for (i = 0; i < n; i++)
+    {
+      m = be32_to_cpu(buf[i]);
+      map[i].trig = EvgInMapBit(m, C_EVG_INMAP_TRIG_BASE, EVG_TRIGGERS);
+      map[i].dbus = EvgInMapBit(m, C_EVG_INMAP_DBUS_BASE, EVG_DBUS_BITS);
+      map[i].irq = 0;
+      map[i].seqtrig = EvgInMapBit(m, C_EVG_INMAP_SEQTRIG_BASE,
+				   EVG_MAX_SEQRAMS);
+      map[i].seqena = EvgInMapBit(m, C_EVG_INMAP_SEQENA_BASE,
+				  EVG_MAX_SEQRAMS);
+      map[i].mask = (m >> C_EVG_INMAP_SEQMASK) & 0x00ff;
+    }
+
+  return n;
+}
+
+/**
+Set up a range of Event Triggers with one uncached 32-bit store each.
+
+@param pEg Pointer to MrfEgRegs structure
+@param first Number of first Event Trigger
+@param trig Event codes and enables of triggers first to first + n - 1
+@param n Number of triggers
+@return Returns number of triggers written, -1 on error.
+*/
+int EvgSetTriggerEventTable(volatile struct MrfEgRegs *pEg, int first,
+			    const struct EvgTrigEventStruct *trig, int n)
+{
+  u32 buf[EVG_MAX_TRIGGERS];
+  int i;
+
+  if (first < 0 || n < 0 || first + n > EVG_TRIGGERS)
+    return -1;
+
+  for (i = 0; i < n; i++)
+    {
+      if (trig[i].code < 0 || trig[i].code > EVG_MAX_EVENT_CODE)
+	return -1;
+      buf[i] = be32_to_cpu((trig[i].code << C_EVG_EVENTTRIG_CODE_LOW) |
+			   (trig[i].enable ? 1 << C_EVG_EVENTTRIG_ENABLE : 0));
+    }
+
+  for (i = 0; i < n; i++)
+    pEg->EventTrigger[first + i] = buf[i];
+
+  return n;
+}
+
+/**
+Get a range of Event Triggers with one block read.
+
+@param pEg Pointer to MrfEgRegs structure
+@param first Number of first Event Trigger
+@param trig Returns event codes and enables of triggers first to
+first + n - 1
+@param n Number of triggers
+@return Returns number of triggers read, -1 on error.
+*/
+int EvgGetTriggerEventTable(volatile struct MrfEgRegs *pEg, int first,
+			    struct EvgTrigEventStruct *trig, int n)
+{
+  u32 buf[EVG_MAX_TRIGGERS], t;
+  int i;
+
+  if (first < 0 || n < 0 || first + n > EVG_TRIGGERS)
+    return -1;
+
+  MrfMmioRead(buf, &pEg->EventTrigger[first], n * sizeof(u32));
+
+  for (i = 0; i < n; i++)
+    {
+      t = be32_to_cpu(buf[i]);
+      trig[i].code = (t >> C_EVG_EVENTTRIG_CODE_LOW) & EVG_MAX_EVENT_CODE;
+      trig[i].enable = (t >> C_EVG_EVENTTRIG_ENABLE) & 1;
+    }
+
+  return n;
+}
+
 /**
 Set up output mapping for Universal Output.
 
@@ -2003,9 +2266,9 @@ int EvgSendDBuf(volatile struct MrfEgRegs *pEg, char *dbuf, int size)
     return -1;
 
 #ifdef __linux__
-  memcpy((void *) &pEg->Databuf[0], (void *) dbuf, size);
+  MrfMmioWrite(&pEg->Databuf[0], dbuf, size);
 #else
-  memcpy((void *) &pEg->Databuf[0], (void *) dbuf, size);
+  MrfMmioWrite(&pEg->Databuf[0], dbuf, size);
   /* {
    int i;
    int *p = (int *) dbuf;
@@ -2057,9 +2320,9 @@ int EvgSendSegBuf(volatile struct MrfEgRegs *pEg, char *dbuf, int segment, int s
     return -1;
 
 #ifdef LINUX
-  memcpy((void *) &pEg->Segbuf[segment*4], (void *) dbuf, size);
+  MrfMmioWrite(&pEg->Segbuf[segment*4], dbuf, size);
 #else
-  memcpy((void *) &pEg->Segbuf[segment*4], (void *) dbuf, size);
+  MrfMmioWrite(&pEg->Segbuf[segment*4], dbuf, size);
   /* {
    int i;
    int *p = (int *) dbuf;
@@ -2187,9 +2450,12 @@ Enable interrupts for EVG.
 */
 int EvgIrqEnable(volatile struct MrfEgRegs *pEg, int mask)
 {
-  int control = be32_to_cpu(pEg->IrqEnable) & EVG_IRQ_PCICORE_ENABLE;
+  int control;
 
+  MRF_LOCK(pEg->IrqEnable);
+  control = be32_to_cpu(pEg->IrqEnable) & EVG_IRQ_PCICORE_ENABLE;
   pEg->IrqEnable = be32_to_cpu(mask | control);
+  MRF_UNLOCK(pEg->IrqEnable);
   return be32_to_cpu(pEg->IrqEnable);
 }
 
@@ -2241,10 +2507,12 @@ Enable/disable Timstamp generator.
 */
 int EvgTimestampEnable(volatile struct MrfEgRegs *pEg, int enable)
 {
+  MRF_LOCK(pEg->TimestampCtrl);
   if (enable)
     pEg->TimestampCtrl |= be32_to_cpu(1 << C_EVG_TSCTRL_ENABLE);
   else
     pEg->TimestampCtrl &= be32_to_cpu(~(1 << C_EVG_TSCTRL_ENABLE));
+  MRF_UNLOCK(pEg->TimestampCtrl);
     
   return EvgGetTimestampEnable(pEg);
 }
@@ -2265,11 +2533,16 @@ Load new seconds value into timestamp generator.
 
 @param pEg Pointer to MrfEgRegs structure
 @param timestamp New seconds value
+@return Returns 0.
 */
 int EvgTimestampLoad(volatile struct MrfEgRegs *pEg, int timestamp)
 {
+  MRF_LOCK(pEg->TimestampCtrl);
   pEg->TimestampValue = be32_to_cpu(timestamp);
   pEg->TimestampCtrl |= be32_to_cpu(1 << C_EVG_TSCTRL_LOAD);
+  MRF_UNLOCK(pEg->TimestampCtrl);
+
+  return 0;
 }
 
 /**
@@ -79,6 +79,21 @@ struct MXCStruct {
   u32 Prescaler;
 };
 
+/* Decoded input mapping, -1 for no mapping */
+struct EvgInMapStruct {
+  int trig;                /* Event trigger */
+  int dbus;                /* Distributed bus bit */
+  int irq;                 /* 1 = external interrupt, not with mask */
+  int seqtrig;             /* Sequence RAM trigger */
+  int seqena;              /* Sequence RAM enable */
+  int mask;                /* Sequence mask field, 0 none */
+};
+
+struct EvgTrigEventStruct {
+  int code;
+  int enable;
+};
+
 struct MrfEgRegs {
   u32  Status;                              /* 0000: Status Register */
   u32  Control;                             /* 0004: Main Control Register */
@@ -150,10 +165,12 @@ struct MrfEgRegs {
 #define C_EVG_CTRL_MASTER_ENABLE    31
 #define C_EVG_CTRL_RX_DISABLE       30
 #define C_EVG_CTRL_RX_PWRDOWN       29
+#define C_EVG_CTRL_LE_SWAPPED       25  /* LE_MODE seen byte-swapped */
 #define C_EVG_CTRL_MXC_RESET        24
 #define C_EVG_CTRL_BEACON_ENABLE    23
 #define C_EVG_CTRL_DCMASTER_ENABLE  22
 #define C_EVG_CTRL_SEQRAM_ALT       16
+#define C_EVG_CTRL_LE_MODE          1
 /* -- Interrupt Flag/Enable Register bit mappings */
 #define C_EVG_IRQ_MASTER_ENABLE  31
 #define C_EVG_IRQ_PCICORE_ENABLE 30
@@ -282,6 +299,11 @@ struct MrfEgRegs {
 #define C_EVG_INMAP_DBUS_BASE      16
 #define C_EVG_INMAP_IRQ            24
 #define C_EVG_INMAP_SEQMASK        24
+/* -- Input classes of input mapping tables */
+#define EVG_INMAP_FP               0
+#define EVG_INMAP_UNIV             1
+#define EVG_INMAP_BP               2
+#define EVG_INMAP_TB               3
 /* -- Multiplexed Counter Mapping Bits */
 #define C_EVG_MXC_READ             31
 #define C_EVG_MXCMAP_TRIG_BASE     0
@@ -304,6 +326,7 @@ struct MrfEgRegs {
 /* Function prototypes */
 int EvgOpen(struct MrfEgRegs **pEg, char *device_name);
 int EvgClose(int fd);
+int EvgSetThreadSafe(volatile struct MrfEgRegs *pEg, int enable);
 u32 EvgFWVersion(volatile struct MrfEgRegs *pEg);
 int EvgEnable(volatile struct MrfEgRegs *pEg, int state);
 int EvgGetEnable(volatile struct MrfEgRegs *pEg);
@@ -379,6 +402,14 @@ int EvgSetTriggerEvent(volatile struct MrfEgRegs *pEg, int trigger, int code, in
 int EvgGetTriggerEventCode(volatile struct MrfEgRegs *pEg, int trigger);
 int EvgGetTriggerEventEnable(volatile struct MrfEgRegs *pEg, int trigger);
 void EvgTriggerEventDump(volatile struct MrfEgRegs *pEg);
+int EvgSetInMapTable(volatile struct MrfEgRegs *pEg, int inclass, int first,
+		     const struct EvgInMapStruct *map, int n);
+int EvgGetInMapTable(volatile struct MrfEgRegs *pEg, int inclass, int first,
+		     struct EvgInMapStruct *map, int n);
+int EvgSetTriggerEventTable(volatile struct MrfEgRegs *pEg, int first,
+			    const struct EvgTrigEventStruct *trig, int n);
+int EvgGetTriggerEventTable(volatile struct MrfEgRegs *pEg, int first,
+			    struct EvgTrigEventStruct *trig, int n);
 int EvgSetUnivOutMap(volatile struct MrfEgRegs *pEg, int output, int map);
 int EvgGetUnivOutMap(volatile struct MrfEgRegs *pEg, int output);
 int EvgSetFPOutMap(volatile struct MrfEgRegs *pEg, int output, int map);
@@ -42,6 +42,8 @@
 
 #include "erapi.h"
 #include "fracdiv.h"
+#include "mrflock.h"
+#include "mrfmmio.h"
 
 /*
 #define DEBUG 1
@@ -86,43 +88,68 @@ Opens evr device and mmaps the register map into user space.
 */
 int EvrOpen(struct MrfErRegs **pEr, char *device_name)
 {
-  int fd;
-  char *subdev;
-  int offset = 0;
+  int size;
+
+  return EvrOpenSize(pEr, device_name, &size);
+}
 
-  subdev = strstr(device_name, ".evrd");
+/**
+Opens evr device like EvrOpen() and returns the size of the register
+map that could be mapped, which depends on the board.
+@param pEr Pointer to pointer of memory mapped MrfErRegs structure.
+@param device_name Name of device e.g. /dev/era3 or /dev/ega3.evrd
+@param size Returns size of register map at *pEr in bytes.
+@return Returns file descriptor of opened file, -1 on error.
+*/
+int EvrOpenSize(struct MrfErRegs **pEr, char *device_name, int *size)
+{
+  static const int windows[] = {EVR_CPCI300TG_MEM_WINDOW, EVR_MEM_WINDOW,
+				EVR_CPCI230_MEM_WINDOW};
+  int fd = -1;
+  char name[256], *subdev;
+  int i, offset = 0;
+
+  /* Cut sub-device suffix from a copy, the caller's name stays as is */
+  if (strlen(device_name) >= sizeof(name))
+    return -1;
+  strcpy(name, device_name);
+  subdev = strstr(name, ".evrd");
   if (subdev != NULL)
     {
-      *subdev = 0; /* cut device name */
+      *subdev = 0;
       offset = 0x20000;
     }
   else
     {
-      subdev = strstr(device_name, ".evru");
+      subdev = strstr(name, ".evru");
       if (subdev != NULL)
 	{
-	  *subdev = 0; /* cut device name */
+	  *subdev = 0;
 	  offset = 0x30000;
 	}
     } 
 
-  fd = EvrOpenWindow(pEr, device_name, EVR_CPCI300TG_MEM_WINDOW);
+  for (i = 0; i < 3 && fd == -1; i++)
+    {
+      fd = EvrOpenWindow(pEr, name, windows[i]);
+      *size = windows[i] - offset;
+    }
   if (fd == -1)
+    return -1;
+
+  /* Sub-device beyond a small window */
+  if (*size <= 0)
     {
-      fd = EvrOpenWindow(pEr, device_name, EVR_MEM_WINDOW);
-      if (fd == -1)
-	{
-	  fd = EvrOpenWindow(pEr, device_name, EVR_CPCI230_MEM_WINDOW);
-	}
+      munmap(*pEr, windows[i - 1]);
+      close(fd);
+      return -1;
     }
 
   *pEr = (struct MrfErRegs *) ((void *) (*pEr) + offset); 
   
-  if (fd != -1)
-    {
-      /* Put device in BE mode */
-      (*pEr)->Control = ((*pEr)->Control) & ~0x02000002;
-    }
+  /* Put device in BE mode */
+  (*pEr)->Control = ((*pEr)->Control) &
+    ~((1 << C_EVR_CTRL_LE_SWAPPED) | (1 << C_EVR_CTRL_LE_MODE));
 
   return fd;
 }
@@ -152,6 +179,11 @@ int EvrOpen(struct MrfErRegs **pEg, char *device_name)
 {
   return 0;
 }
+
+int EvrOpenSize(struct MrfErRegs **pEr, char *device_name, int *size)
+{
+  return -1;
+}
 #endif
 
 #ifdef __unix__
@@ -184,6 +216,26 @@ int EvrTgClose(int fd)
   return EvrCloseWindow(fd, EVR_CPCI300TG_MEM_WINDOW);
 }
 
+/**
+Enable/disable thread-safe register access for EVR mapping.
+
+When enabled, read-modify-write sequences on EVR registers are
+protected by per-register locks so that one mapping can be shared by
+e.g. a FIFO servicing thread and a configuration thread.
+Enable before sharing the mapping between threads.
+
+@param pEr Pointer to MrfErRegs structure
+@param enable 0 - disable, 1 - enable
+@return Returns 0 on success, -1 on error.
+*/
+int EvrSetThreadSafe(volatile struct MrfErRegs *pEr, int enable)
+{
+  if (enable)
+    return MrfLockRegister(pEr, sizeof(struct MrfErRegs));
+  else
+    return MrfLockUnregister(pEr);
+}
+
 #else
 int EvrClose(int fd)
 {
@@ -209,10 +261,12 @@ Enable/disable EVR.
 */
 int EvrEnable(volatile struct MrfErRegs *pEr, int state)
 {
+  MRF_LOCK(pEr->Control);
   if (state)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_MASTER_ENABLE);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_MASTER_ENABLE));
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetEnable(pEr);
 }
@@ -228,10 +282,12 @@ When the EVR is not in delay compensation mode the FIFO depth is adjusted direct
 */
 int EvrDCEnable(volatile struct MrfErRegs *pEr, int state)
 {
+  MRF_LOCK(pEr->Control);
   if (state)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_DC_ENABLE);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_DC_ENABLE));
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetDCEnable(pEr);
 }
@@ -245,10 +301,12 @@ Control output enable for external I/O box IFB-300.
 */
 int EvrOutputEnable(volatile struct MrfErRegs *pEr, int state)
 {
+  MRF_LOCK(pEr->Control);
   if (state)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_OUTEN);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_OUTEN));
+  MRF_UNLOCK(pEr->Control);
 
   return EvrGetEnable(pEr);
 }
@@ -436,6 +494,7 @@ int EvrMapRamEnable(volatile struct MrfErRegs *pEr, int ram, int enable)
   if (ram < 0 || ram > 1)
     return -1;
 
+  MRF_LOCK(pEr->Control);
   result = be32_to_cpu(pEr->Control);
   result &= ~((1 << C_EVR_CTRL_MAP_RAM_ENABLE) | (1 << C_EVR_CTRL_MAP_RAM_SELECT));
   if (ram == 1)
@@ -443,6 +502,7 @@ int EvrMapRamEnable(volatile struct MrfErRegs *pEr, int ram, int enable)
   if (enable == 1)
     result |= (1 << C_EVR_CTRL_MAP_RAM_ENABLE);
   pEr->Control = be32_to_cpu(result);
+  MRF_UNLOCK(pEr->Control);
 
   return result;
 }
@@ -471,12 +531,18 @@ int EvrSetPulseMap(volatile struct MrfErRegs *pEr, int ram, int code, int trig,
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].PulseTrigger);
   if (trig >= 0 && trig < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseTrigger |= be32_to_cpu(1 << trig);
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseTrigger);
+  MRF_LOCK(pEr->MapRam[ram][code].PulseSet);
   if (set >= 0 && set < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseSet |= be32_to_cpu(1 << set);
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseSet);
+  MRF_LOCK(pEr->MapRam[ram][code].PulseClear);
   if (clear >= 0 && clear < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseClear |= be32_to_cpu(1 << clear);
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseClear);
 
   return 0;
 }
@@ -501,10 +567,12 @@ int EvrSetForwardEvent(volatile struct MrfErRegs *pEr, int ram, int code, int en
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_FORWARD_EVENT));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_FORWARD_EVENT);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -517,10 +585,12 @@ Enable/disable event forwarding.
 */
 int EvrEnableEventForwarding(volatile struct MrfErRegs *pEr, int enable)
 {
+  MRF_LOCK(pEr->Control);
   if (enable)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_EVENT_FWD_ENA);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_EVENT_FWD_ENA));
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetEventForwarding(pEr);
 }
@@ -554,10 +624,12 @@ int EvrSetLedEvent(volatile struct MrfErRegs *pEr, int ram, int code, int enable
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_LED_EVENT));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_LED_EVENT);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -580,10 +652,12 @@ int EvrSetFIFOEvent(volatile struct MrfErRegs *pEr, int ram, int code, int enabl
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_SAVE_EVENT));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_SAVE_EVENT);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -606,10 +680,12 @@ int EvrSetLatchEvent(volatile struct MrfErRegs *pEr, int ram, int code, int enab
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_LATCH_TIMESTAMP));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_LATCH_TIMESTAMP);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -632,10 +708,12 @@ int EvrSetLogEvent(volatile struct MrfErRegs *pEr, int ram, int code, int enable
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_LOG_EVENT));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_LOG_EVENT);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -658,10 +736,12 @@ int EvrSetLogStopEvent(volatile struct MrfErRegs *pEr, int ram, int code, int en
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].IntEvent);
   if (!enable)
     pEr->MapRam[ram][code].IntEvent &= be32_to_cpu(~(1 << C_EVR_MAP_STOP_LOG));
   if (enable)
     pEr->MapRam[ram][code].IntEvent |= be32_to_cpu(1 << C_EVR_MAP_STOP_LOG);
+  MRF_UNLOCK(pEr->MapRam[ram][code].IntEvent);
     
   return 0;
 }
@@ -675,9 +755,11 @@ int EvrClearFIFO(volatile struct MrfErRegs *pEr)
 {
   int ctrl;
 
+  MRF_LOCK(pEr->Control);
   ctrl = be32_to_cpu(pEr->Control);
   ctrl |= (1 << C_EVR_CTRL_RESET_EVENTFIFO);
   pEr->Control = be32_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->Control);
 
   return be32_to_cpu(pEr->Control);
 }
@@ -693,16 +775,21 @@ int EvrGetFIFOEvent(volatile struct MrfErRegs *pEr, struct FIFOEvent *fe)
 {
   int stat;
 
+  MRF_LOCK(pEr->FIFOEvent);
   stat = be32_to_cpu(pEr->IrqFlag);
   if (stat & (1 << C_EVR_IRQFLAG_EVENT))
     {
+      /* Reading event code pops entry, keep the three reads together */
       fe->EventCode = be32_to_cpu(pEr->FIFOEvent);
       fe->TimestampHigh = be32_to_cpu(pEr->FIFOSeconds);
       fe->TimestampLow = be32_to_cpu(pEr->FIFOTimestamp);
-      return 0;
+      stat = 0;
     }
   else
-    return -1;
+    stat = -1;
+  MRF_UNLOCK(pEr->FIFOEvent);
+
+  return stat;
 }
 
 /**
@@ -713,10 +800,12 @@ Enable/disable event log.
 */
 int EvrEnableLog(volatile struct MrfErRegs *pEr, int enable)
 {
+  MRF_LOCK(pEr->Control);
   if (enable)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_LOG_ENABLE);
   else
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_LOG_DISABLE);
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetLogState(pEr);
 }
@@ -774,10 +863,12 @@ Enable "stop log" events.
 */
 int EvrEnableLogStopEvent(volatile struct MrfErRegs *pEr, int enable)
 {
+  MRF_LOCK(pEr->Control);
   if (enable)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_LOG_STOP_EV_EN);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_LOG_STOP_EV_EN));
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetLogStopEvent(pEr);
 }
@@ -826,9 +917,11 @@ int EvrClearLog(volatile struct MrfErRegs *pEr)
 {
   int ctrl;
 
+  MRF_LOCK(pEr->Control);
   ctrl = be32_to_cpu(pEr->Control);
   ctrl |= (1 << C_EVR_CTRL_LOG_RESET);
   pEr->Control = be32_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->Control);
 
   return be32_to_cpu(pEr->Control);
 }
@@ -878,12 +971,18 @@ int EvrClearPulseMap(volatile struct MrfErRegs *pEr, int ram, int code, int trig
   if (code <= 0 || code > EVR_MAX_EVENT_CODE)
     return -1;
 
+  MRF_LOCK(pEr->MapRam[ram][code].PulseTrigger);
   if (trig >= 0 && trig < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseTrigger &= be32_to_cpu(~(1 << trig));
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseTrigger);
+  MRF_LOCK(pEr->MapRam[ram][code].PulseSet);
   if (set >= 0 && set < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseSet &= be32_to_cpu(~(1 << set));
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseSet);
+  MRF_LOCK(pEr->MapRam[ram][code].PulseClear);
   if (clear >= 0 && clear < EVR_MAX_PULSES)
     pEr->MapRam[ram][code].PulseClear &= be32_to_cpu(~(1 << clear));
+  MRF_UNLOCK(pEr->MapRam[ram][code].PulseClear);
 
   return 0;
 }
@@ -1007,6 +1106,7 @@ int EvrSetPulseProperties(volatile struct MrfErRegs *pEr, int pulse, int polarit
   if (pulse < 0 || pulse >= EVR_MAX_PULSES)
     return -1;
 
+  MRF_LOCK(pEr->Pulse[pulse].Control);
   result = be32_to_cpu(pEr->Pulse[pulse].Control);
 
   /* 0 clears, 1 sets, others don't change */
@@ -1040,6 +1140,7 @@ int EvrSetPulseProperties(volatile struct MrfErRegs *pEr, int pulse, int polarit
 #endif
 
   pEr->Pulse[pulse].Control = be32_to_cpu(result);
+  MRF_UNLOCK(pEr->Pulse[pulse].Control);
 
   return 0;
 }
@@ -1069,6 +1170,7 @@ int EvrSetPulseMask(volatile struct MrfErRegs *pEr, int pulse, int mask, int ena
   if (pulse < 0 || pulse >= EVR_MAX_PULSES)
     return -1;
 
+  MRF_LOCK(pEr->Pulse[pulse].Control);
   result = be32_to_cpu(pEr->Pulse[pulse].Control);
 
   result &= 0x0000ffff;
@@ -1076,6 +1178,7 @@ int EvrSetPulseMask(volatile struct MrfErRegs *pEr, int pulse, int mask, int ena
   result |= ((enable & 0x00ff) << 20);
 
   pEr->Pulse[pulse].Control = be32_to_cpu(result);
+  MRF_UNLOCK(pEr->Pulse[pulse].Control);
 
   return 0;  
 }
@@ -1425,9 +1528,12 @@ Enable interrupts for EVR.
 */
 int EvrIrqEnable(volatile struct MrfErRegs *pEr, int mask)
 {
-  int control = be32_to_cpu(pEr->IrqEnable) & EVR_IRQ_PCICORE_ENABLE;
+  int control;
 
+  MRF_LOCK(pEr->IrqEnable);
+  control = be32_to_cpu(pEr->IrqEnable) & EVR_IRQ_PCICORE_ENABLE;
   pEr->IrqEnable = be32_to_cpu(mask | control);
+  MRF_UNLOCK(pEr->IrqEnable);
   return be32_to_cpu(pEr->IrqEnable);
 }
 
@@ -1582,10 +1688,12 @@ int EvrUnivDlyEnable(volatile struct MrfErRegs *pEr, int dlymod, int enable)
 	    EVR_UNIV_DLY_LCLK | EVR_UNIV_DLY_DIS) << 8) |
 	   ((EVR_UNIV_DLY_DIN | EVR_UNIV_DLY_SCLK |
 	    EVR_UNIV_DLY_LCLK | EVR_UNIV_DLY_DIS) << 12)));
+  MRF_LOCK(pEr->GPIOOut);
   gpio = be32_to_cpu(pEr->GPIOOut) & ~(EVR_UNIV_DLY_DIS << sh);
   if (!enable)
     gpio |= (EVR_UNIV_DLY_DIS << sh);
   pEr->GPIOOut = be32_to_cpu(gpio);
+  MRF_UNLOCK(pEr->GPIOOut);
 
   return 0;
 }
@@ -1627,6 +1735,7 @@ int EvrUnivDlySetDelay(volatile struct MrfErRegs *pEr, int dlymod, int dly0, int
   sclk = EVR_UNIV_DLY_SCLK << sh;
   lclk = EVR_UNIV_DLY_LCLK << sh;
 
+  MRF_LOCK(pEr->GPIOOut);
   gpio = be32_to_cpu(pEr->GPIOOut) & ~((EVR_UNIV_DLY_DIN | EVR_UNIV_DLY_SCLK |
 					EVR_UNIV_DLY_LCLK) | 
 				      ((EVR_UNIV_DLY_DIN | EVR_UNIV_DLY_SCLK |
@@ -1693,6 +1802,7 @@ int EvrUnivDlySetDelay(volatile struct MrfErRegs *pEr, int dlymod, int dly0, int
 
   pEr->GPIOOut = be32_to_cpu(gpio | lclk);
   pEr->GPIOOut = be32_to_cpu(gpio);
+  MRF_UNLOCK(pEr->GPIOOut);
 
   return 0;
 }
@@ -1781,10 +1891,12 @@ buffer is received.
 */
 int EvrReceiveDBuf(volatile struct MrfErRegs *pEr, int enable)
 {
+  MRF_LOCK(pEr->DataBufControl);
   if (enable)
     pEr->DataBufControl |= be32_to_cpu(1 << C_EVR_DATABUF_LOAD);
   else
     pEr->DataBufControl |= be32_to_cpu(1 << C_EVR_DATABUF_STOP);
+  MRF_UNLOCK(pEr->DataBufControl);
 
   return EvrGetDBufStatus(pEr);
 }
@@ -1815,9 +1927,9 @@ int EvrGetDBuf(volatile struct MrfErRegs *pEr, char *dbuf, int size)
     return -1;
 
 #ifdef __unix__
-  memcpy((void *) dbuf, (void *) &pEr->Databuf[0], rxsize);
+  MrfMmioRead(dbuf, &pEr->Databuf[0], rxsize);
 #else
-  memcpy((void *) dbuf, (void *) &pEr->Databuf[0], rxsize);
+  MrfMmioRead(dbuf, &pEr->Databuf[0], rxsize);
   /*  {
     int i;
     int *p = (int *) dbuf;
@@ -1944,9 +2056,9 @@ int EvrGetSegBuf(volatile struct MrfErRegs *pEr, char *dbuf, int segment)
     {
 
 #ifdef __unix__
-      memcpy((void *) dbuf, (void *) (&pEr->SegBuf[segment * 4]), rxsize);
+      MrfMmioRead(dbuf, &pEr->SegBuf[segment * 4], rxsize);
 #else
-      memcpy((void *) dbuf, (void *) (&pEr->SegBuf[segment * 4]), rxsize);
+      MrfMmioRead(dbuf, &pEr->SegBuf[segment * 4], rxsize);
 #endif
     }
 
@@ -2037,12 +2149,14 @@ int EvrSetTimestampDBus(volatile struct MrfErRegs *pEr, int enable)
 {
   int ctrl;
 
+  MRF_LOCK(pEr->Control);
   ctrl = be32_to_cpu(pEr->Control);
   if (enable)
     ctrl |= (1 << C_EVR_CTRL_TS_CLOCK_DBUS);
   else
     ctrl &= ~(1 << C_EVR_CTRL_TS_CLOCK_DBUS);
   pEr->Control = be32_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->Control);
 
   return be32_to_cpu(pEr->Control);  
 }
@@ -2090,10 +2204,12 @@ Set up prescaler polarity.
 */
 int EvrSetPrescalerPolarity(volatile struct MrfErRegs *pEr, int polarity)
 {
+  MRF_LOCK(pEr->Control);
   if (polarity)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_PRESC_POLARITY);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_PRESC_POLARITY));
+  MRF_UNLOCK(pEr->Control);
   
   return be32_to_cpu(pEr->Control & (1 << C_EVR_CTRL_PRESC_POLARITY));
 }
@@ -2149,6 +2265,7 @@ int EvrSetExtEvent(volatile struct MrfErRegs *pEr, int input, int code, int edge
   if (input < 0 || input > EVR_MAX_EXTIN_MAP)
     return -1;
 
+  MRF_LOCK(pEr->ExtinMap[input]);
   fpctrl = be32_to_cpu(pEr->ExtinMap[input]);
   if (code >= 0 && code <= EVR_MAX_EVENT_CODE)
     {
@@ -2164,6 +2281,7 @@ int EvrSetExtEvent(volatile struct MrfErRegs *pEr, int input, int code, int edge
     fpctrl |= (1 << C_EVR_EXTIN_EXTLEV_ENABLE);
 
   pEr->ExtinMap[input] = be32_to_cpu(fpctrl);
+  MRF_UNLOCK(pEr->ExtinMap[input]);
   if (pEr->ExtinMap[input] == be32_to_cpu(fpctrl))
     return 0;
   return -1;
@@ -2206,6 +2324,7 @@ int EvrSetBackEvent(volatile struct MrfErRegs *pEr, int input, int code, int edg
   if (input < 0 || input > EVR_MAX_EXTIN_MAP)
     return -1;
 
+  MRF_LOCK(pEr->ExtinMap[input]);
   fpctrl = be32_to_cpu(pEr->ExtinMap[input]);
   if (code >= 0 && code <= EVR_MAX_EVENT_CODE)
     {
@@ -2221,6 +2340,7 @@ int EvrSetBackEvent(volatile struct MrfErRegs *pEr, int input, int code, int edg
     fpctrl |= (1 << C_EVR_EXTIN_BACKLEV_ENABLE);
 
   pEr->ExtinMap[input] = be32_to_cpu(fpctrl);
+  MRF_UNLOCK(pEr->ExtinMap[input]);
   if (pEr->ExtinMap[input] == be32_to_cpu(fpctrl))
     return 0;
   return -1;
@@ -2240,12 +2360,14 @@ int EvrSetExtEdgeSensitivity(volatile struct MrfErRegs *pEr, int input, int edge
   if (input < 0 || input > EVR_MAX_EXTIN_MAP)
     return -1;
 
+  MRF_LOCK(pEr->ExtinMap[input]);
   fpctrl = be32_to_cpu(pEr->ExtinMap[input]);
   fpctrl &= ~(1 << C_EVR_EXTIN_EXT_EDGE);
   if (edge)
     fpctrl |= (1 << C_EVR_EXTIN_EXT_EDGE);
 
   pEr->ExtinMap[input] = be32_to_cpu(fpctrl);
+  MRF_UNLOCK(pEr->ExtinMap[input]);
   if (pEr->ExtinMap[input] == be32_to_cpu(fpctrl))
     return 0;
   return -1;
@@ -2265,12 +2387,14 @@ int EvrSetExtLevelSensitivity(volatile struct MrfErRegs *pEr, int input, int lev
   if (input < 0 || input > EVR_MAX_EXTIN_MAP)
     return -1;
 
+  MRF_LOCK(pEr->ExtinMap[input]);
   fpctrl = be32_to_cpu(pEr->ExtinMap[input]);
   fpctrl &= ~(1 << C_EVR_EXTIN_EXTLEV_ACT);
   if (level)
     fpctrl |= (1 << C_EVR_EXTIN_EXTLEV_ACT);
 
   pEr->ExtinMap[input] = be32_to_cpu(fpctrl);
+  MRF_UNLOCK(pEr->ExtinMap[input]);
   if (pEr->ExtinMap[input] == be32_to_cpu(fpctrl))
     return 0;
   return -1;
@@ -2318,11 +2442,13 @@ int EvrSetBackDBus(volatile struct MrfErRegs *pEr, int input, int dbus)
   if (dbus < 0 || dbus > 255)
     return -1;
 
+  MRF_LOCK(pEr->ExtinMap[input]);
   fpctrl = be32_to_cpu(pEr->ExtinMap[input]);
   fpctrl &= ~(255 << C_EVR_EXTIN_BACKDBUS_BASE);
   fpctrl |= dbus << C_EVR_EXTIN_BACKDBUS_BASE;
 
   pEr->ExtinMap[input] = be32_to_cpu(fpctrl);
+  MRF_UNLOCK(pEr->ExtinMap[input]);
   if (pEr->ExtinMap[input] == be32_to_cpu(fpctrl))
     return 0;
   return -1;
@@ -2373,9 +2499,9 @@ int EvrSendTxDBuf(volatile struct MrfErRegs *pEr, char *dbuf, int size)
     return -1;
 
 #ifdef __unix__
-  memcpy((void *) &pEr->TxDatabuf[0], (void *) dbuf, size);
+  MrfMmioWrite(&pEr->TxDatabuf[0], dbuf, size);
 #else
-  memcpy((void *) &pEr->TxDatabuf[0], (void *) dbuf, size);
+  MrfMmioWrite(&pEr->TxDatabuf[0], dbuf, size);
 #endif
 
   /* Enable and set size */
@@ -2432,9 +2558,9 @@ int EvrSendTxSegBuf(volatile struct MrfErRegs *pEr, char *dbuf, int segment, int
     return -1;
 
 #ifdef __unix__
-  memcpy((void *) &pEr->TxSegBuf[segment*4], (void *) dbuf, size);
+  MrfMmioWrite(&pEr->TxSegBuf[segment*4], dbuf, size);
 #else
-  memcpy((void *) &pEr->TxSegBuf[segment*4], (void *) dbuf, size);
+  MrfMmioWrite(&pEr->TxSegBuf[segment*4], dbuf, size);
 #endif
 
   /* Enable and set size */
@@ -2527,6 +2653,7 @@ int EvrCMLEnable(volatile struct MrfErRegs *pEr, int channel, int state)
   if (channel < 0 || channel >= EVR_MAX_CML_OUTPUTS)
     return -1;
 
+  MRF_LOCK(pEr->CML[channel].Control);
   ctrl = be16_to_cpu(pEr->CML[channel].Control);
   if (state)
     {
@@ -2541,6 +2668,7 @@ int EvrCMLEnable(volatile struct MrfErRegs *pEr, int channel, int state)
 
 
   pEr->CML[channel].Control = be16_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->CML[channel].Control);
   return be16_to_cpu(pEr->CML[channel].Control & (1 << C_EVR_CMLCTRL_ENABLE));
 }
 
@@ -2563,6 +2691,7 @@ int EvrSetCMLMode(volatile struct MrfErRegs *pEr, int channel, int mode)
   if (channel < 0 || channel >= EVR_MAX_CML_OUTPUTS)
     return -1;
 
+  MRF_LOCK(pEr->CML[channel].Control);
   ctrl = be16_to_cpu(pEr->CML[channel].Control);
   ctrl &= ~(C_EVR_CMLCTRL_MODE_RXPOLARITY | C_EVR_CMLCTRL_MODE_TXPOLARITY |
 	    C_EVR_CMLCTRL_MODE_GUNTX200 | C_EVR_CMLCTRL_MODE_GUNTX300 |
@@ -2570,6 +2699,7 @@ int EvrSetCMLMode(volatile struct MrfErRegs *pEr, int channel, int mode)
   ctrl |= mode;
 
   pEr->CML[channel].Control = be16_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->CML[channel].Control);
   return be16_to_cpu(pEr->CML[channel].Control);
 }
 
@@ -2609,10 +2739,12 @@ Enable/disable GUN-TX hardware inhibit input (UNIVIN0).
 */
 int EvrSetGunTxInhibitOverride(volatile struct MrfErRegs *pEr, int override)
 {
+  MRF_LOCK(pEr->Control);
   if (override)
     pEr->Control |= be32_to_cpu(1 << C_EVR_CTRL_GUNTX_INH_OVRDE);
   else
     pEr->Control &= be32_to_cpu(~(1 << C_EVR_CTRL_GUNTX_INH_OVRDE));
+  MRF_UNLOCK(pEr->Control);
   
   return EvrGetGunTxInhibitOverride(pEr);
 }
@@ -2627,6 +2759,7 @@ int EvrSetIntClkMode(volatile struct MrfErRegs *pEr, int enable)
 {
   int ctrl;
 
+  MRF_LOCK(pEr->ClockControl);
   ctrl = be32_to_cpu(pEr->ClockControl);
   if (enable)
     ctrl |= (1 << C_EVR_CLKCTRL_INT_CLK_MODE);
@@ -2634,6 +2767,7 @@ int EvrSetIntClkMode(volatile struct MrfErRegs *pEr, int enable)
     ctrl &= ~(1 << C_EVR_CLKCTRL_INT_CLK_MODE);
   
   pEr->ClockControl = be32_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->ClockControl);
   return (be32_to_cpu(pEr->ClockControl) & (1 << C_EVR_CLKCTRL_INT_CLK_MODE));
 }
 
@@ -2728,11 +2862,13 @@ int EvrSWEventEnable(volatile struct MrfErRegs *pEr, int state)
     (1 << C_EVR_SWEVENT_CODE_LOW));
   int swe;
 
+  MRF_LOCK(pEr->SWEvent);
   swe = be32_to_cpu(pEr->SWEvent);
   if (state)
     pEr->SWEvent = be32_to_cpu(1 << C_EVR_SWEVENT_ENABLE | (swe & mask));
   else
     pEr->SWEvent = be32_to_cpu(~(1 << C_EVR_SWEVENT_ENABLE) & swe & mask);
+  MRF_UNLOCK(pEr->SWEvent);
   return EvrGetSWEventEnable(pEr);
 }
 
@@ -2760,11 +2896,13 @@ int EvrSendSWEvent(volatile struct MrfErRegs *pEr, int code)
     (1 << C_EVR_SWEVENT_CODE_LOW));
   int swcode;
 
+  MRF_LOCK(pEr->SWEvent);
   swcode = be32_to_cpu(pEr->SWEvent);
   swcode &= mask;
   swcode |= (code & EVR_MAX_EVENT_CODE);
 
   pEr->SWEvent = be32_to_cpu(swcode);
+  MRF_UNLOCK(pEr->SWEvent);
 
   return be32_to_cpu(pEr->SWEvent);
 }
@@ -2890,6 +3028,7 @@ int EvrSeqRamControl(volatile struct MrfErRegs *pEr, int ram, int enable, int si
   if (ram < 0 || ram >= EVR_SEQRAMS)
     return -1;
 
+  MRF_LOCK(pEr->SeqRamControl[ram]);
   control = be32_to_cpu(pEr->SeqRamControl[ram]);
 
   if (enable == 0)
@@ -2917,6 +3056,7 @@ int EvrSeqRamControl(volatile struct MrfErRegs *pEr, int ram, int enable, int si
     }
 
   pEr->SeqRamControl[ram] = be32_to_cpu(control);
+  MRF_UNLOCK(pEr->SeqRamControl[ram]);
 
   return 0;
 }
@@ -2932,7 +3072,9 @@ int EvrSeqRamSWTrig(volatile struct MrfErRegs *pEr, int ram)
   if (ram < 0 || ram > 1)
     return -1;
 
+  MRF_LOCK(pEr->SeqRamControl[ram]);
   pEr->SeqRamControl[ram] |= be32_to_cpu(1 << C_EVR_SQRC_SWTRIGGER);
+  MRF_UNLOCK(pEr->SeqRamControl[ram]);
   
   return 0;
 }
@@ -221,6 +221,7 @@ struct MrfErRegs {
 #define C_EVR_CTRL_TXLOOPBACK       29
 #define C_EVR_CTRL_RXLOOPBACK       28
 #define C_EVR_CTRL_OUTEN            27
+#define C_EVR_CTRL_LE_SWAPPED       25  /* LE_MODE seen byte-swapped */
 #define C_EVR_CTRL_GUNTX_INH_OVRDE  24
 #define C_EVR_CTRL_DC_ENABLE        22
 #define C_EVR_CTRL_PRESC_POLARITY   15
@@ -234,6 +235,7 @@ struct MrfErRegs {
 #define C_EVR_CTRL_LOG_DISABLE      5
 #define C_EVR_CTRL_LOG_STOP_EV_EN   4
 #define C_EVR_CTRL_RESET_EVENTFIFO  3
+#define C_EVR_CTRL_LE_MODE          1
 /* -- Status Register bit mappings */
 #define C_EVR_STATUS_DBUS_HIGH      31
 #define C_EVR_STATUS_LEGACY_VIO     16
@@ -389,11 +391,13 @@ struct MrfErRegs {
 
 /* Function prototypes */
 int EvrOpen(struct MrfErRegs **pEr, char *device_name);
+int EvrOpenSize(struct MrfErRegs **pEr, char *device_name, int *size);
 int EvrTgOpen(struct MrfErRegs **pEr, char *device_name);
 int EvrOpenWindow(struct MrfErRegs **pEr, char *device_name, int mem_window);
 int EvrClose(int fd);
 int EvrTgClose(int fd);
 int EvrCloseWindow(int fd, int mem_window);
+int EvrSetThreadSafe(volatile struct MrfErRegs *pEr, int enable);
 u32 EvrFWVersion(volatile struct MrfErRegs *pEr);
 int EvrEnable(volatile struct MrfErRegs *pEr, int state);
 int EvrDCEnable(volatile struct MrfErRegs *pEr, int state);
@@ -0,0 +1,110 @@
+/*
+  evan_decode.c -- Micro-Research Event Generator
+                   Event analyzer capture file decoder
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Prints the events of a capture file written by evan_monitor or
+  EvanCapStart() as text. Event 0x7e (heartbeat) is left out unless -a
+  is given, -c selects a single event code. The event clock for the
+  conversion of timestamps to seconds is taken from the file header or
+  given with -f in MHz.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "egapi.h"
+#include "evancap.h"
+
+#define DECODE_RECORDS 4096
+
+int main(int argc, char *argv[])
+{
+  struct EvanCapHeader hdr;
+  static struct EvanCapRecord rec[DECODE_RECORDS];
+  unsigned long long ts;
+  double clock_hz = 0.0;
+  int fd, n, i, opt, all = 0, only = -1;
+  time_t sec;
+  char when[64];
+
+  while ((opt = getopt(argc, argv, "ac:f:")) != -1)
+    switch (opt)
+      {
+      case 'a':
+	all = 1;
+	break;
+      case 'c':
+	only = strtol(optarg, NULL, 0);
+	break;
+      case 'f':
+	clock_hz = atof(optarg) * 1e6;
+	break;
+      default:
+	argc = 0;
+      }
+
+  if (optind >= argc)
+    {
+      printf("Usage: %s [-a] [-c code] [-f clock MHz] capture-file\n",
+	     argv[0]);
+      return -1;
+    }
+
+  fd = EvanCapOpenFile(argv[optind], &hdr);
+  if (fd < 0)
+    {
+      printf("Could not open %s, errno %d\n", argv[optind], errno);
+      return errno;
+    }
+  if (clock_hz == 0.0)
+    clock_hz = hdr.clock_hz;
+
+  while ((n = EvanCapReadRecords(fd, rec, DECODE_RECORDS)) > 0)
+    for (i = 0; i < n; i++)
+      {
+	if (EVANCAP_REC_TYPE(rec[i].flags) == EVANCAP_REC_INDEX)
+	  {
+	    if (!(rec[i].flags & EVANCAP_FLAG_START))
+	      continue;
+	    sec = rec[i].a;
+	    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S",
+		     localtime(&sec));
+	    printf("# Capture started %s.%09u\n", when, rec[i].b);
+	    continue;
+	  }
+
+	if (rec[i].flags & EVANCAP_FLAG_OVERFLOW)
+	  printf("# Event analyzer FIFO overflow\n");
+	if (rec[i].flags & EVANCAP_FLAG_DROPPED)
+	  printf("# Events dropped, capture buffer full\n");
+	if (!all && (rec[i].code & 0x00ff) == 0x7e)
+	  continue;
+	if (only >= 0 && (rec[i].code & 0x00ff) != only)
+	  continue;
+
+	ts = ((unsigned long long) rec[i].a << 32) + rec[i].b;
+	if (clock_hz > 0.0)
+	  printf("Timestamp %08x%08x, %16.9f, event %02x, dbus %02x\n",
+		 rec[i].a, rec[i].b, ts / clock_hz, rec[i].code & 0x00ff,
+		 (rec[i].code >> 8) & 0x00ff);
+	else
+	  printf("Timestamp %08x%08x, event %02x, dbus %02x\n",
+		 rec[i].a, rec[i].b, rec[i].code & 0x00ff,
+		 (rec[i].code >> 8) & 0x00ff);
+      }
+
+  close(fd);
+
+  return n < 0 ? -1 : 0;
+}
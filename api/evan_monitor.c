@@ -1,35 +1,60 @@
 /*
-  apitest.c -- Micro-Research Event Generator
-               Application Programming Interface Test Application
+  evan_monitor.c -- Micro-Research Event Generator
+                    Event analyzer capture and rate monitor
 
   Author: Jukka Pietarinen (MRF)
   Date:   05.12.2006
 
 */
 
+/*
+  Captures the event analyzer into a binary file (evancap.h) and prints
+  the total event rate and the busiest event codes once a second until
+  interrupted. Decode the file with evan_decode.
+ */
+
 #include <stdint.h>
 #include <errno.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <endian.h>
+#include <byteswap.h>
 #include "egcpci.h"
 #include "egapi.h"
+#include "evancap.h"
 
-#define EVG_RF_FREQ 499.654E6L
-#define EVG_RF_DIVIDER 4.0L
+#define EVG_RF_FREQ 499.654E6
+#define EVG_RF_DIVIDER 4.0
+#define MONITOR_TOP_CODES 8
+
+static volatile int stop;
+
+static void monitor_stop(int sig)
+{
+  stop = 1;
+}
 
 int main(int argc, char *argv[])
 {
   struct MrfEgRegs *pEg;
-  struct EvanStruct evan;
+  struct EvanCap   cap;
+  double           rate[EVANCAP_CODES], total, clock_hz;
   int              fdEg;
-  int              i;
+  int              i, j, best, shown[EVANCAP_CODES];
 
-  if (argc < 2)
+  if (argc < 3)
     {
-      printf("Usage: %s /dev/era3\n", argv[0]);
+      printf("Usage: %s /dev/ega3 <capture file> [clock MHz]\n", argv[0]);
       return -1;
     }
 
+  clock_hz = EVG_RF_FREQ / EVG_RF_DIVIDER;
+  if (argc > 3)
+    clock_hz = atof(argv[3]) * 1e6;
+
   fdEg = EvgOpen(&pEg, argv[1]);
   if (fdEg < 0)
     {
@@ -37,28 +62,46 @@ int main(int argc, char *argv[])
       return errno;
     }
 
-  EvgEvanReset(pEg);
-  EvgEvanResetCount(pEg);
-  EvgEvanEnable(pEg, 1);
-  while (1)
+  if (EvanCapInit(&cap, pEg, argv[2], 0, (u32) clock_hz) ||
+      EvanCapStart(&cap))
     {
-      while (!EvgEvanGetEvent(pEg, &evan))
-	{
-	  unsigned long long ts;
-	  long double sec;
+      printf("Could not start capture to %s, errno %d\n", argv[2], errno);
+      EvgClose(fdEg);
+      return -1;
+    }
 
-	  ts = ((long long) evan.TimestampHigh << 32) +
-	    (long long) evan.TimestampLow;
-	  sec = ts / (EVG_RF_FREQ/EVG_RF_DIVIDER);
-	  if ((evan.EventCode & 0x0ff) != 0x7e)
-	    printf("Timestamp %08x%08x, %16.9Lf, event %02x, dbus %02x\n",
-		   evan.TimestampHigh, evan.TimestampLow, sec, 
-		   evan.EventCode & 0x00ff, evan.EventCode >> 8);
+  signal(SIGINT, monitor_stop);
+  signal(SIGTERM, monitor_stop);
+  while (!stop)
+    {
+      sleep(1);
+      if (EvanCapRates(&cap, rate, &total))
+	continue;
+      printf("%10.0f ev/s, %llu events, %llu overflows, %llu dropped, "
+	     "%llu written:", total, cap.events, cap.overflows, cap.dropped,
+	     cap.written);
+      /* Busiest codes first */
+      for (i = 0; i < EVANCAP_CODES; i++)
+	shown[i] = 0;
+      for (j = 0; j < MONITOR_TOP_CODES; j++)
+	{
+	  best = -1;
+	  for (i = 0; i < EVANCAP_CODES; i++)
+	    if (!shown[i] && rate[i] > 0.0 && (best < 0 || rate[i] > rate[best]))
+	      best = i;
+	  if (best < 0)
+	    break;
+	  shown[best] = 1;
+	  printf(" %02x:%.0f", best, rate[best]);
 	}
-      /* Sleep for a while if there are no events in the event analyzer fifo */
-      usleep(10000);
+      printf("\n");
+      fflush(stdout);
     }
 
-  EvgEvanEnable(pEg, 0);
+  if (EvanCapStop(&cap))
+    printf("Writing %s failed, errno %d\n", argv[2], cap.error);
+  EvanCapClose(&cap);
   EvgClose(fdEg);
+
+  return 0;
 }
@@ -0,0 +1,573 @@
+/**
+@file evancap.c
+@brief Capture of the Micro-Research Event Generator event analyzer
+       FIFO into binary files.
+
+The capture thread reads the event analyzer registers directly and
+stores them unconverted; the registers are big-endian, which is the
+byte order of the file. Only the per-code counters need the event code
+in host byte order. Text output is left to the offline decoder
+(evan_decode).
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "egapi.h"
+#include "mrflock.h"
+#include "evancap.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/* Events read with the register lock held */
+#define EVANCAP_BATCH     64
+
+/** @private */
+static double EvanCapNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** @private */
+static int EvanCapPut(struct EvanCap *cap, int *head, u32 a, u32 b, u32 code,
+		      u32 flags)
+{
+  struct EvanCapRecord *rec;
+  int next = (*head + 1) & (cap->size - 1);
+
+  if (next == cap->tail)
+    return -1;
+  rec = &cap->ring[*head];
+  rec->a = a;
+  rec->b = b;
+  rec->code = code;
+  rec->flags = flags;
+  *head = next;
+
+  return 0;
+}
+
+/** @private */
+static void EvanCapIndex(struct EvanCap *cap, int *head,
+			 unsigned long long session, u32 flags)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_REALTIME, &t);
+  EvanCapPut(cap, head, be32_to_cpu((u32) t.tv_sec),
+	     be32_to_cpu((u32) t.tv_nsec), be32_to_cpu((u32) session),
+	     be32_to_cpu((EVANCAP_REC_INDEX << 24) | flags));
+}
+
+/**
+@private
+Read a batch of events from the analyzer into the ring and publish
+them to the writer.
+
+@return Returns number of events read, 0 if the FIFO is empty.
+*/
+static int EvanCapDrain(struct EvanCap *cap)
+{
+  volatile struct MrfEgRegs *pEg = cap->pEg;
+  u32 ctrl, code, th, tl;
+  int head = cap->head, n;
+
+  ctrl = pEg->EvanControl;
+  if (ctrl & be32_to_cpu(1 << C_EVG_EVANCTRL_OVERFLOW))
+    {
+      cap->overflows++;
+      cap->flags |= EVANCAP_FLAG_OVERFLOW;
+      /* Write back only enable, bit 3 reads not empty but writes reset */
+      MRF_LOCK(pEg->EvanControl);
+      pEg->EvanControl = (pEg->EvanControl &
+			  be32_to_cpu(1 << C_EVG_EVANCTRL_ENABLE)) |
+	be32_to_cpu(1 << C_EVG_EVANCTRL_CLROVERFLOW);
+      MRF_UNLOCK(pEg->EvanControl);
+    }
+
+  if (!(ctrl & be32_to_cpu(1 << C_EVG_EVANCTRL_NOTEMPTY)))
+    return 0;
+
+  MRF_LOCK(pEg->EvanCode);
+  n = 0;
+  do
+    {
+      /* Reading the code pops the next item from the FIFO */
+      code = pEg->EvanCode;
+      th = pEg->EvanTimeH;
+      tl = pEg->EvanTimeL;
+      cap->events++;
+      cap->count[be32_to_cpu(code) & (EVANCAP_CODES - 1)]++;
+      if (cap->session && !(cap->session % EVANCAP_INDEX_INTERVAL))
+	EvanCapIndex(cap, &head, cap->session, 0);
+      cap->session++;
+      if (EvanCapPut(cap, &head, th, tl, code, be32_to_cpu(cap->flags)))
+	{
+	  cap->dropped++;
+	  cap->flags |= EVANCAP_FLAG_DROPPED;
+	}
+      else
+	cap->flags = 0;
+    }
+  while (++n < EVANCAP_BATCH &&
+	 (pEg->EvanControl & be32_to_cpu(1 << C_EVG_EVANCTRL_NOTEMPTY)));
+  MRF_UNLOCK(pEg->EvanCode);
+
+  __sync_synchronize();
+  cap->head = head;
+
+  return n;
+}
+
+/**
+@private
+Write the contiguous part of the ring to the capture file.
+
+@return Returns number of records taken from the ring, 0 if empty.
+*/
+static int EvanCapFlush(struct EvanCap *cap)
+{
+  int head, tail, n;
+  ssize_t len;
+  char *p;
+
+  head = cap->head;
+  __sync_synchronize();
+  tail = cap->tail;
+  if (head == tail)
+    return 0;
+
+  n = ((head > tail) ? head : cap->size) - tail;
+  p = (char *) &cap->ring[tail];
+  len = n * sizeof(struct EvanCapRecord);
+  while (len > 0)
+    {
+      ssize_t w = write(cap->fd, p, len);
+
+      if (w < 0 && errno == EINTR)
+	continue;
+      if (w <= 0)
+	{
+	  /* Records are lost, the capture must not stall */
+	  cap->error = errno;
+	  break;
+	}
+      p += w;
+      len -= w;
+    }
+  if (len <= 0)
+    cap->written += n;
+
+  __sync_synchronize();
+  cap->tail = (tail + n) & (cap->size - 1);
+
+  return n;
+}
+
+/** @private */
+static void EvanCapBegin(struct EvanCap *cap)
+{
+  int head = cap->head;
+
+  cap->session = 0;
+  cap->flags = 0;
+  EvanCapIndex(cap, &head, 0, EVANCAP_FLAG_START);
+  __sync_synchronize();
+  cap->head = head;
+}
+
+/** @private */
+static void *EvanCapCaptureThread(void *arg)
+{
+  struct EvanCap *cap = (struct EvanCap *) arg;
+  struct timespec nap;
+  double idle = 0.0;
+  int sleep_us = 0;
+
+  EvanCapBegin(cap);
+
+  for (;;)
+    {
+      if (EvanCapDrain(cap))
+	{
+	  idle = 0.0;
+	  continue;
+	}
+      if (cap->stop)
+	break;
+      if (idle == 0.0)
+	{
+	  idle = EvanCapNow();
+	  sleep_us = 0;
+	  continue;
+	}
+      if (EvanCapNow() - idle < cap->spin_us * 1e-6)
+	continue;
+      sleep_us = sleep_us ? sleep_us * 2 : 10;
+      if (sleep_us > cap->sleep_us)
+	sleep_us = cap->sleep_us;
+      nap.tv_sec = 0;
+      nap.tv_nsec = sleep_us * 1000;
+      nanosleep(&nap, NULL);
+    }
+
+  return NULL;
+}
+
+/** @private */
+static void *EvanCapWriterThread(void *arg)
+{
+  struct EvanCap *cap = (struct EvanCap *) arg;
+  int done;
+
+  for (;;)
+    {
+      done = (cap->stop > 1);
+      if (EvanCapFlush(cap))
+	continue;
+      if (done)
+	break;
+      usleep(1000);
+    }
+
+  return NULL;
+}
+
+/**
+Prepare event analyzer capture into file. A new file gets a header,
+an existing capture file is appended to.
+
+@param cap Capture state
+@param pEg Pointer to MrfEgRegs structure
+@param filename Capture file
+@param records Ring buffer size in records, rounded up to a power of 2,
+0 for EVANCAP_DEFAULT_RECORDS
+@param clock_hz Event clock frequency for the decoder, 0 if not known
+@return Returns 0 on success, -1 on error.
+*/
+int EvanCapInit(struct EvanCap *cap, volatile struct MrfEgRegs *pEg,
+		const char *filename, int records, u32 clock_hz)
+{
+  struct EvanCapHeader hdr;
+  struct stat st;
+
+  memset(cap, 0, sizeof(struct EvanCap));
+  cap->pEg = pEg;
+  cap->spin_us = 100;
+  cap->sleep_us = 1000;
+
+  if (records <= 0)
+    records = EVANCAP_DEFAULT_RECORDS;
+  for (cap->size = 1024; cap->size < records; cap->size *= 2)
+    ;
+
+  cap->fd = open(filename, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (cap->fd == -1)
+    return -1;
+  if (fstat(cap->fd, &st))
+    goto fail;
+  if (st.st_size)
+    {
+      if (pread(cap->fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+	  be32_to_cpu(hdr.magic) != EVANCAP_MAGIC ||
+	  be16_to_cpu(hdr.version) != EVANCAP_VERSION ||
+	  be16_to_cpu(hdr.record_size) != sizeof(struct EvanCapRecord))
+	{
+	  errno = EINVAL;
+	  goto fail;
+	}
+      /* Drop a record cut short when the previous capture was killed */
+      if ((st.st_size - sizeof(hdr)) % sizeof(struct EvanCapRecord) &&
+	  ftruncate(cap->fd, st.st_size - (st.st_size - sizeof(hdr)) %
+		    sizeof(struct EvanCapRecord)))
+	goto fail;
+    }
+  else
+    {
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.magic = be32_to_cpu(EVANCAP_MAGIC);
+      hdr.version = be16_to_cpu(EVANCAP_VERSION);
+      hdr.record_size = be16_to_cpu(sizeof(struct EvanCapRecord));
+      hdr.index_interval = be32_to_cpu(EVANCAP_INDEX_INTERVAL);
+      hdr.clock_hz = be32_to_cpu(clock_hz);
+      if (write(cap->fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+	goto fail;
+    }
+
+  cap->ring = malloc(cap->size * sizeof(struct EvanCapRecord));
+  if (cap->ring == NULL)
+    goto fail;
+  /* Touch the ring now rather than in the capture loop */
+  memset(cap->ring, 0, cap->size * sizeof(struct EvanCapRecord));
+
+  return 0;
+
+ fail:
+  close(cap->fd);
+  cap->fd = -1;
+  return -1;
+}
+
+/** @private */
+static int EvanCapReset(struct EvanCap *cap)
+{
+  if (cap->running)
+    return -1;
+
+  cap->head = cap->tail = 0;
+  cap->stop = 0;
+  memcpy(cap->last_count, (void *) cap->count, sizeof(cap->last_count));
+  cap->last_events = cap->events;
+  cap->last_time = EvanCapNow();
+
+  EvgEvanEnable(cap->pEg, 0);
+  EvgEvanReset(cap->pEg);
+  EvgEvanResetCount(cap->pEg);
+  EvgEvanEnable(cap->pEg, 1);
+
+  return 0;
+}
+
+/**
+Reset and enable event analyzer and start capture threads.
+
+@param cap Capture state
+@return Returns 0 on success, -1 on error.
+*/
+int EvanCapStart(struct EvanCap *cap)
+{
+  if (EvanCapReset(cap))
+    return -1;
+
+  if (pthread_create(&cap->writer, NULL, EvanCapWriterThread, cap))
+    return -1;
+  if (pthread_create(&cap->capture, NULL, EvanCapCaptureThread, cap))
+    {
+      cap->stop = 2;
+      pthread_join(cap->writer, NULL);
+      return -1;
+    }
+  cap->running = 1;
+
+  return 0;
+}
+
+/**
+Reset and enable event analyzer without starting threads. The caller
+drains the FIFO with EvanCapPoll(), e.g. on the simulator, which
+allows no threads.
+
+@param cap Capture state
+@return Returns 0 on success, -1 on error.
+*/
+int EvanCapStartPolled(struct EvanCap *cap)
+{
+  if (EvanCapReset(cap))
+    return -1;
+
+  EvanCapBegin(cap);
+  cap->running = EVANCAP_POLLED;
+
+  return 0;
+}
+
+/**
+Read the events waiting in the analyzer FIFO and write them to the
+capture file in the calling thread. Reading stops when the FIFO is
+empty or half the ring has been filled.
+
+@param cap Capture state started with EvanCapStartPolled()
+@return Returns number of events read, -1 if not polled or a file
+write failed.
+*/
+int EvanCapPoll(struct EvanCap *cap)
+{
+  int n, total = 0;
+
+  if (cap->running != EVANCAP_POLLED)
+    return -1;
+
+  while (total < cap->size / 2 && (n = EvanCapDrain(cap)) > 0)
+    total += n;
+  while (EvanCapFlush(cap))
+    ;
+
+  return cap->error ? -1 : total;
+}
+
+/**
+Disable event analyzer, store the events left in the FIFO and wait
+until everything has been written.
+
+@param cap Capture state
+@return Returns 0 on success, -1 if a file write failed.
+*/
+int EvanCapStop(struct EvanCap *cap)
+{
+  if (!cap->running)
+    return -1;
+
+  EvgEvanEnable(cap->pEg, 0);
+  if (cap->running == EVANCAP_POLLED)
+    {
+      while (EvanCapPoll(cap) > 0)
+	;
+      cap->running = 0;
+      return cap->error ? -1 : 0;
+    }
+  cap->stop = 1;
+  pthread_join(cap->capture, NULL);
+  cap->stop = 2;
+  pthread_join(cap->writer, NULL);
+  cap->running = 0;
+
+  return cap->error ? -1 : 0;
+}
+
+/**
+Stop capture if running and release resources.
+
+@param cap Capture state
+*/
+void EvanCapClose(struct EvanCap *cap)
+{
+  if (cap->running)
+    EvanCapStop(cap);
+  free(cap->ring);
+  cap->ring = NULL;
+  if (cap->fd != -1)
+    close(cap->fd);
+  cap->fd = -1;
+}
+
+/**
+Get event rates since previous call, or since start of capture.
+
+@param cap Capture state
+@param rate Array of EVANCAP_CODES rates in events/s, may be NULL
+@param total Returns rate of all events in events/s, may be NULL
+@return Returns 0 on success, -1 if no time has passed.
+*/
+int EvanCapRates(struct EvanCap *cap, double *rate, double *total)
+{
+  unsigned long long count, events = cap->events;
+  double now = EvanCapNow(), dt;
+  int i;
+
+  dt = now - cap->last_time;
+  if (dt <= 0.0)
+    return -1;
+
+  for (i = 0; i < EVANCAP_CODES; i++)
+    {
+      count = cap->count[i];
+      if (rate)
+	rate[i] = (count - cap->last_count[i]) / dt;
+      cap->last_count[i] = count;
+    }
+  if (total)
+    *total = (events - cap->last_events) / dt;
+  cap->last_events = events;
+  cap->last_time = now;
+
+  return 0;
+}
+
+/**
+Open capture file for reading.
+
+@param filename Capture file
+@param hdr Returns file header in host byte order
+@return Returns file descriptor positioned at the first record, -1 on
+error.
+*/
+int EvanCapOpenFile(const char *filename, struct EvanCapHeader *hdr)
+{
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if (fd == -1)
+    return -1;
+  if (read(fd, hdr, sizeof(struct EvanCapHeader)) !=
+      sizeof(struct EvanCapHeader))
+    {
+      close(fd);
+      return -1;
+    }
+
+  hdr->magic = be32_to_cpu(hdr->magic);
+  hdr->version = be16_to_cpu(hdr->version);
+  hdr->record_size = be16_to_cpu(hdr->record_size);
+  hdr->index_interval = be32_to_cpu(hdr->index_interval);
+  hdr->clock_hz = be32_to_cpu(hdr->clock_hz);
+  if (hdr->magic != EVANCAP_MAGIC || hdr->version != EVANCAP_VERSION ||
+      hdr->record_size != sizeof(struct EvanCapRecord))
+    {
+      close(fd);
+      errno = EINVAL;
+      return -1;
+    }
+
+  return fd;
+}
+
+/**
+Read records from capture file.
+
+@param fd File descriptor returned by EvanCapOpenFile()
+@param rec Returns records in host byte order
+@param n Maximum number of records
+@return Returns number of records read, 0 at end of file, -1 on error.
+*/
+int EvanCapReadRecords(int fd, struct EvanCapRecord *rec, int n)
+{
+  ssize_t len, got = 0;
+  int i;
+
+  len = n * sizeof(struct EvanCapRecord);
+  while (got < len)
+    {
+      ssize_t r = read(fd, (char *) rec + got, len - got);
+
+      if (r < 0 && errno == EINTR)
+	continue;
+      if (r < 0)
+	return -1;
+      if (r == 0)
+	break;
+      got += r;
+    }
+
+  /* A record cut short by a capture still being written is read again
+     by the next call */
+  n = got / sizeof(struct EvanCapRecord);
+  if (got % sizeof(struct EvanCapRecord))
+    lseek(fd, -(off_t) (got % sizeof(struct EvanCapRecord)), SEEK_CUR);
+  for (i = 0; i < n; i++)
+    {
+      rec[i].a = be32_to_cpu(rec[i].a);
+      rec[i].b = be32_to_cpu(rec[i].b);
+      rec[i].code = be32_to_cpu(rec[i].code);
+      rec[i].flags = be32_to_cpu(rec[i].flags);
+    }
+
+  return n;
+}
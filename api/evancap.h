@@ -0,0 +1,105 @@
+/*
+  evancap.h -- Capture of the Micro-Research Event Generator
+               event analyzer FIFO into binary files
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include pthread.h and egapi.h before this file.
+
+  A capture thread drains the event analyzer FIFO in a tight loop into
+  a ring buffer, spinning for a while when the FIFO is empty and then
+  sleeping with increasing intervals. A writer thread appends the ring
+  contents to the capture file. If the ring is full, events are
+  dropped and counted rather than stalling the capture thread.
+
+  EvanCapStartPolled() starts no threads; the caller drains the FIFO
+  with EvanCapPoll() instead, as needed on the simulator.
+
+  File format, all fields big-endian:
+
+    struct EvanCapHeader                 once at start of file
+    struct EvanCapRecord ...             events and index records
+
+  An index record starts every capture session and is inserted after
+  every EVANCAP_INDEX_INTERVAL events. It holds the host time and the
+  number of events of the session so far and lets the decoder relate
+  event analyzer timestamps to wall clock time. Records are fixed size,
+  so any offset header + n * record size is a record boundary.
+ */
+
+#define EVANCAP_MAGIC            0x4556414e    /* "EVAN" */
+#define EVANCAP_VERSION          1
+#define EVANCAP_INDEX_INTERVAL   4096
+#define EVANCAP_DEFAULT_RECORDS  (1 << 20)
+#define EVANCAP_CODES            256
+#define EVANCAP_POLLED           2       /* running: EvanCapPoll() */
+
+/* Record types, bits 31-24 of flags */
+#define EVANCAP_REC_EVENT        0
+#define EVANCAP_REC_INDEX        1
+#define EVANCAP_REC_TYPE(flags)  ((flags) >> 24)
+
+/* Flag bits */
+#define EVANCAP_FLAG_OVERFLOW    0x00000001    /* FIFO overflowed before */
+#define EVANCAP_FLAG_DROPPED     0x00000002    /* Ring full, events lost */
+#define EVANCAP_FLAG_START       0x00000004    /* Index: session start */
+
+struct EvanCapHeader {
+  u32 magic;
+  u16 version;
+  u16 record_size;
+  u32 index_interval;
+  u32 clock_hz;                   /* Event clock, 0 if unknown */
+  u32 reserved[4];
+};
+
+struct EvanCapRecord {
+  u32 a;                          /* Event: timestamp high, index: sec */
+  u32 b;                          /* Event: timestamp low, index: nsec */
+  u32 code;                       /* Event: dbus << 8 | code,
+				     index: events in session */
+  u32 flags;
+};
+
+struct EvanCap {
+  volatile struct MrfEgRegs *pEg;
+  int                   fd;       /* Capture file */
+  struct EvanCapRecord *ring;
+  int                   size;     /* Ring size in records, power of 2 */
+  volatile int          head;     /* Written by capture thread */
+  volatile int          tail;     /* Written by writer thread */
+  volatile int          stop;
+  int                   spin_us;  /* Busy poll time after last event */
+  int                   sleep_us; /* Longest sleep when idle */
+  pthread_t             capture;
+  pthread_t             writer;
+  int                   running;  /* 1 threads, EVANCAP_POLLED */
+  int                   error;    /* errno of last failed file write */
+  /* Live counters, written by capture thread only */
+  volatile unsigned long long events;
+  volatile unsigned long long overflows;
+  volatile unsigned long long dropped;
+  volatile unsigned long long count[EVANCAP_CODES];
+  unsigned long long    session;  /* Events in session */
+  u32                   flags;    /* Flags for next event record */
+  /* Records in file, written by writer thread */
+  volatile unsigned long long written;
+  /* State of EvanCapRates() */
+  unsigned long long    last_count[EVANCAP_CODES];
+  unsigned long long    last_events;
+  double                last_time;
+};
+
+int EvanCapInit(struct EvanCap *cap, volatile struct MrfEgRegs *pEg,
+		const char *filename, int records, u32 clock_hz);
+int EvanCapStart(struct EvanCap *cap);
+int EvanCapStartPolled(struct EvanCap *cap);
+int EvanCapPoll(struct EvanCap *cap);
+int EvanCapStop(struct EvanCap *cap);
+void EvanCapClose(struct EvanCap *cap);
+int EvanCapRates(struct EvanCap *cap, double *rate, double *total);
+int EvanCapOpenFile(const char *filename, struct EvanCapHeader *hdr);
+int EvanCapReadRecords(int fd, struct EvanCapRecord *rec, int n);
@@ -0,0 +1,222 @@
+/*
+  evg_seqsim.c -- Micro-Research Event Generator
+                  Sequence RAM simulator and validator
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Simulates sequence RAM execution (seqsim.h) of a sequence file or of
+  the current setup of an Event Generator and reports problems. The
+  exit status is 1 if problems were found, so the tool can be run on
+  schedules in automated tests.
+
+  Sequence file, one statement per line, '#' starts a comment, times in
+  event clock cycles:
+
+    ram     <ram> <enable> <single> <recycle> <trigsel> <mask> [repeat]
+    event   <ram> <pos> <timestamp> <code> [mask]
+    mxc     <mxc> <prescaler>
+    ac      <period>
+    swtrig  <0|1> <time>
+    source  <period> <phase> <code>
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "egapi.h"
+#include "seqsim.h"
+
+static int print_event(const struct SeqSimEvent *ev, void *arg)
+{
+  if (ev->source >= SEQSIM_SRC_PERIODIC)
+    printf("%20llu src%-2d %02x", ev->time,
+	   ev->source - SEQSIM_SRC_PERIODIC, ev->code);
+  else
+    printf("%20llu ram%-2d %02x", ev->time, ev->source, ev->code);
+  if (ev->flags & SEQSIM_EV_END)
+    printf(" end");
+  if (ev->flags & SEQSIM_EV_COLLISION)
+    printf(" COLLISION");
+  printf("\n");
+
+  return 0;
+}
+
+static int read_sequence(struct SeqSim *sim, const char *filename)
+{
+  FILE *fp;
+  char line[256], *p;
+  unsigned long long a[7];
+  int n, lineno = 0, result = 0;
+
+  fp = fopen(filename, "r");
+  if (fp == NULL)
+    {
+      printf("Could not open %s, errno %d\n", filename, errno);
+      return -1;
+    }
+
+  while (fgets(line, sizeof(line), fp))
+    {
+      lineno++;
+      if ((p = strchr(line, '#')))
+	*p = 0;
+      memset(a, 0, sizeof(a));
+      if (!strncmp(line, "ram", 3))
+	{
+	  n = sscanf(line + 3, "%lli %lli %lli %lli %lli %lli %lli", &a[0],
+		     &a[1], &a[2], &a[3], &a[4], &a[5], &a[6]);
+	  if (n < 6 || a[0] >= EVG_SEQRAMS)
+	    n = -1;
+	  else
+	    {
+	      sim->ram[a[0]].enable = a[1];
+	      sim->ram[a[0]].single = a[2];
+	      sim->ram[a[0]].recycle = a[3];
+	      sim->ram[a[0]].trigsel = a[4];
+	      sim->ram[a[0]].mask = a[5] & 0x00ff;
+	      sim->ram[a[0]].repeat = a[6];
+	    }
+	}
+      else if (!strncmp(line, "event", 5))
+	{
+	  n = sscanf(line + 5, "%lli %lli %lli %lli %lli", &a[0], &a[1],
+		     &a[2], &a[3], &a[4]);
+	  if (n < 4 || SeqSimSetEvent(sim, a[0], a[1], a[2], a[3], a[4]))
+	    n = -1;
+	}
+      else if (!strncmp(line, "mxc", 3))
+	{
+	  n = sscanf(line + 3, "%lli %lli", &a[0], &a[1]);
+	  if (n < 2 || a[0] >= EVG_MAX_MXCS)
+	    n = -1;
+	  else
+	    sim->prescaler[a[0]] = a[1];
+	}
+      else if (!strncmp(line, "ac", 2))
+	{
+	  n = sscanf(line + 2, "%lli", &a[0]);
+	  sim->ac_period = a[0];
+	}
+      else if (!strncmp(line, "swtrig", 6))
+	{
+	  n = sscanf(line + 6, "%lli %lli", &a[0], &a[1]);
+	  if (n < 2 || a[0] > 1)
+	    n = -1;
+	  else
+	    {
+	      sim->swtrig[a[0]] = a[1];
+	      sim->swtrig_set[a[0]] = 1;
+	    }
+	}
+      else if (!strncmp(line, "source", 6))
+	{
+	  n = sscanf(line + 6, "%lli %lli %lli", &a[0], &a[1], &a[2]);
+	  if (n < 3 || SeqSimAddSource(sim, a[0], a[1], a[2]) < 0)
+	    n = -1;
+	}
+      else if (strspn(line, " \t\r\n") == strlen(line))
+	continue;
+      else
+	n = -1;
+
+      if (n < 1)
+	{
+	  printf("%s:%d: invalid statement\n", filename, lineno);
+	  result = -1;
+	}
+    }
+  fclose(fp);
+
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  static struct SeqSim sim;
+  struct SeqSimReport report;
+  struct MrfEgRegs *pEg;
+  struct timespec start, end;
+  unsigned long long cycles = 1, until = 0;
+  double s;
+  char *device = NULL;
+  int fdEg, opt, print = 0, ram, errors;
+
+  while ((opt = getopt(argc, argv, "n:t:pd:")) != -1)
+    switch (opt)
+      {
+      case 'n':
+	cycles = strtoull(optarg, NULL, 0);
+	break;
+      case 't':
+	until = strtoull(optarg, NULL, 0);
+	break;
+      case 'p':
+	print = 1;
+	break;
+      case 'd':
+	device = optarg;
+	break;
+      default:
+	argc = 0;
+      }
+
+  if ((optind >= argc && !device) || (!cycles && !until))
+    {
+      printf("Usage: %s [-n cycles] [-t until] [-p] -d /dev/ega3 | "
+	     "sequence-file\n", argv[0]);
+      printf("  -n cycles    Sequences to run per RAM (1), 0 no limit\n");
+      printf("  -t until     Stop at event clock cycle, 0 no limit (0)\n");
+      printf("  -p           Print event timeline\n");
+      printf("  -d device    Simulate setup of Event Generator\n");
+      return -1;
+    }
+
+  SeqSimInit(&sim);
+  if (device)
+    {
+      fdEg = EvgOpen(&pEg, device);
+      if (fdEg < 0)
+	{
+	  printf("EvgOpen returned %d, errno %d\n", fdEg, errno);
+	  return errno;
+	}
+      SeqSimLoad(&sim, pEg);
+      EvgClose(fdEg);
+    }
+  else if (read_sequence(&sim, argv[optind]))
+    return -1;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  errors = SeqSimRun(&sim, cycles, until, print ? print_event : NULL, NULL,
+		     &report);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  s = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    {
+      printf("RAM %d: %llu sequences", ram, report.cycles[ram]);
+      if (report.non_monotonic[ram] >= 0)
+	printf(", timestamp not increasing at position %d",
+	       report.non_monotonic[ram]);
+      if (report.missing_end[ram])
+	printf(", no end of sequence code 0x%02x", SEQSIM_END_CODE);
+      printf("\n");
+    }
+  printf("%llu events until %llu, %llu collisions, %llu lost triggers, "
+	 "%llu masked\n", report.events, report.end_time, report.collisions,
+	 report.lost_triggers, report.masked);
+  if (s > 0.0)
+    printf("Simulated %.1f Mevents/s\n", report.events / s * 1e-6);
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+/*
+  evg_timestamp.c -- Micro-Research Event Generator
+                     Timestamp generator seconds service
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Loads the seconds value of the host clock into the timestamp
+  generator before every second boundary and verifies it (evgts.h).
+  Prints every alarm and a status line once a minute until
+  interrupted.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "egapi.h"
+#include "rtmode.h"
+#include "evgts.h"
+
+static volatile int stop;
+
+static void service_stop(int sig)
+{
+  stop = 1;
+}
+
+static void service_alarm(struct EvgTs *ts, int reason, void *arg)
+{
+  switch (reason)
+    {
+    case EVGTS_ALARM_MARGIN:
+      printf("Seconds %u loaded only %ld us before boundary\n",
+	     ts->last_seconds, ts->last_margin_ns / 1000);
+      break;
+    case EVGTS_ALARM_MISSED:
+      printf("Seconds %u loaded %ld us after boundary\n",
+	     ts->last_seconds, -ts->last_margin_ns / 1000);
+      break;
+    case EVGTS_ALARM_VERIFY:
+      printf("Seconds %u not taken over, timestamp generator at %u\n",
+	     ts->last_seconds, EvgTimestampGet(ts->pEg));
+      break;
+    }
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+  struct MrfEgRegs *pEg;
+  struct EvgTs      ts;
+  struct RtMode     rt;
+  int               fdEg, opt, ticks = 0;
+
+  EvgTsInit(&ts, NULL, 0);
+  RtModeDefaults(&rt);
+  while ((opt = getopt(argc, argv, "o:l:a:c:p:")) != -1)
+    switch (opt)
+      {
+      case 'o':
+	ts.offset = atoi(optarg);
+	break;
+      case 'l':
+	ts.lead_ns = atol(optarg) * 1000;
+	break;
+      case 'a':
+	ts.alarm_ns = atol(optarg) * 1000;
+	break;
+      case 'c':
+	rt.cpu = atoi(optarg);
+	ts.rt = &rt;
+	break;
+      case 'p':
+	rt.priority = atoi(optarg);
+	ts.rt = &rt;
+	break;
+      default:
+	argc = 0;
+      }
+
+  if (optind >= argc)
+    {
+      printf("Usage: %s [-o offset] [-l lead us] [-a alarm us] [-c cpu] "
+	     "[-p priority] /dev/ega3\n", argv[0]);
+      printf("  -o offset    Seconds added to host time, e.g. TAI - UTC\n");
+      printf("  -l lead      Load before second boundary (%ld us)\n",
+	     EVGTS_DEFAULT_LEAD_NS / 1000);
+      printf("  -a alarm     Alarm when loaded closer to boundary (%ld us)\n",
+	     EVGTS_DEFAULT_ALARM_NS / 1000);
+      printf("  -c cpu       Pin service thread to CPU, realtime mode\n");
+      printf("  -p priority  Run service thread SCHED_FIFO\n");
+      return -1;
+    }
+
+  fdEg = EvgOpen(&pEg, argv[optind]);
+  if (fdEg < 0)
+    {
+      printf("EvgOpen returned %d, errno %d\n", fdEg, errno);
+      return errno;
+    }
+
+  ts.pEg = pEg;
+  ts.alarm = service_alarm;
+  EvgTimestampEnable(pEg, 1);
+  if (EvgTsStart(&ts))
+    {
+      printf("Could not start service, check lead and alarm times\n");
+      EvgClose(fdEg);
+      return -1;
+    }
+
+  signal(SIGINT, service_stop);
+  signal(SIGTERM, service_stop);
+  while (!stop)
+    {
+      sleep(1);
+      if (++ticks % 60)
+	continue;
+      printf("Seconds %u, %llu loads, %llu missed, %llu margin alarms, "
+	     "%llu verify errors, min margin %ld us, max late %ld us\n",
+	     ts.last_seconds, ts.loads, ts.missed, ts.margin_alarms,
+	     ts.verify_errors, ts.min_margin_ns / 1000, ts.max_late_ns / 1000);
+      fflush(stdout);
+    }
+
+  EvgTsStop(&ts);
+  EvgClose(fdEg);
+
+  return 0;
+}
@@ -0,0 +1,190 @@
+/**
+@file evgts.c
+@brief Micro-Research Event Generator timestamp generator seconds
+       service.
+
+Keeps the seconds value distributed by the Event Generator in step
+with the host clock, see evgts.h.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "egapi.h"
+#include "rtmode.h"
+#include "evgts.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define EVGTS_NS 1000000000LL
+
+/**
+Initialize service with default timing.
+
+@param ts Service
+@param pEg Pointer to MrfEgRegs structure
+@param offset Seconds added to host time
+*/
+void EvgTsInit(struct EvgTs *ts, volatile struct MrfEgRegs *pEg, int offset)
+{
+  memset(ts, 0, sizeof(struct EvgTs));
+  ts->pEg = pEg;
+  ts->lead_ns = EVGTS_DEFAULT_LEAD_NS;
+  ts->alarm_ns = EVGTS_DEFAULT_ALARM_NS;
+  ts->verify_ns = EVGTS_DEFAULT_VERIFY_NS;
+  ts->offset = offset;
+  ts->min_margin_ns = EVGTS_NS;
+}
+
+/** @private */
+static long long EvgTsNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_REALTIME, &t);
+  return t.tv_sec * EVGTS_NS + t.tv_nsec;
+}
+
+/** @private */
+static void EvgTsSleepUntil(long long ns)
+{
+  struct timespec t;
+
+  t.tv_sec = ns / EVGTS_NS;
+  t.tv_nsec = ns % EVGTS_NS;
+  while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &t, NULL) == EINTR)
+    ;
+}
+
+/** @private */
+static void EvgTsAlarmRaise(struct EvgTs *ts, int reason)
+{
+#ifdef DEBUG
+  DEBUG_PRINTF("EvgTs: alarm %d, seconds %u, margin %ld ns\n", reason,
+	       ts->last_seconds, ts->last_margin_ns);
+#endif
+  if (ts->alarm)
+    ts->alarm(ts, reason, ts->arg);
+}
+
+/**
+Load and verify the seconds value for the next second boundary. Waits
+until lead_ns before the boundary; if that time has passed and less
+than alarm_ns is left, the following boundary is used.
+
+@param ts Service
+@return Returns 0 on success or the alarm reason.
+*/
+int EvgTsStep(struct EvgTs *ts)
+{
+  long long now, boundary, wake, margin;
+  unsigned int seconds;
+
+  now = EvgTsNow();
+  boundary = (now / EVGTS_NS + 1) * EVGTS_NS;
+  if (boundary - now < ts->alarm_ns)
+    boundary += EVGTS_NS;
+  wake = boundary - ts->lead_ns;
+  if (wake > now)
+    {
+      EvgTsSleepUntil(wake);
+      now = EvgTsNow();
+      if (now - wake > ts->max_late_ns)
+	ts->max_late_ns = now - wake;
+    }
+
+  seconds = boundary / EVGTS_NS + ts->offset;
+  EvgTimestampLoad(ts->pEg, seconds);
+  /* Read back to make sure the posted writes have reached the board */
+  EvgTimestampGet(ts->pEg);
+  margin = boundary - EvgTsNow();
+
+  ts->last_seconds = seconds;
+  ts->last_margin_ns = margin;
+  if (margin < ts->min_margin_ns)
+    ts->min_margin_ns = margin;
+  if (margin <= 0)
+    {
+      ts->missed++;
+      EvgTsAlarmRaise(ts, EVGTS_ALARM_MISSED);
+      return EVGTS_ALARM_MISSED;
+    }
+  ts->loads++;
+  if (margin < ts->alarm_ns)
+    {
+      ts->margin_alarms++;
+      EvgTsAlarmRaise(ts, EVGTS_ALARM_MARGIN);
+    }
+
+  EvgTsSleepUntil(boundary + ts->verify_ns);
+  if ((unsigned int) EvgTimestampGet(ts->pEg) != seconds)
+    {
+      ts->verify_errors++;
+      EvgTsAlarmRaise(ts, EVGTS_ALARM_VERIFY);
+      return EVGTS_ALARM_VERIFY;
+    }
+
+  return margin < ts->alarm_ns ? EVGTS_ALARM_MARGIN : 0;
+}
+
+/** @private */
+static void *EvgTsThread(void *arg)
+{
+  struct EvgTs *ts = (struct EvgTs *) arg;
+
+  if (ts->rt)
+    RtModeEnter(ts->rt);
+
+  while (!ts->stop)
+    EvgTsStep(ts);
+
+  return NULL;
+}
+
+/**
+Start service thread.
+
+@param ts Service
+@return Returns 0 on success, -1 on error.
+*/
+int EvgTsStart(struct EvgTs *ts)
+{
+  if (ts->running || ts->lead_ns <= 0 || ts->lead_ns >= EVGTS_NS ||
+      ts->alarm_ns > ts->lead_ns || ts->verify_ns < 0 ||
+      ts->verify_ns >= EVGTS_NS - ts->lead_ns)
+    return -1;
+
+  ts->stop = 0;
+  if (pthread_create(&ts->thread, NULL, EvgTsThread, ts))
+    return -1;
+  ts->running = 1;
+
+  return 0;
+}
+
+/**
+Stop service thread. Returns after the current second has been
+verified, which takes up to about one second.
+
+@param ts Service
+*/
+void EvgTsStop(struct EvgTs *ts)
+{
+  if (!ts->running)
+    return;
+
+  ts->stop = 1;
+  pthread_join(ts->thread, NULL);
+  ts->running = 0;
+}
@@ -0,0 +1,67 @@
+/*
+  evgts.h -- Micro-Research Event Generator
+             Timestamp generator seconds service
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include pthread.h and egapi.h before this file.
+
+  The timestamp generator distributes a seconds value that the Event
+  Receivers take over at the next pulse per second. The service keeps
+  it in step with the host clock, which should itself be disciplined
+  to the same PPS source, e.g. by NTP or PTP. Shortly before each
+  second boundary of the host clock it loads the seconds value of the
+  coming second (plus an offset, e.g. TAI - UTC) with
+  EvgTimestampLoad() and after the boundary it verifies the value with
+  EvgTimestampGet().
+
+  The margin is the time from the completed load to the second
+  boundary. A margin below alarm_ns, a load after the boundary and a
+  failed verification are counted and reported through the alarm
+  callback, which is called from the service thread.
+ */
+
+#define EVGTS_DEFAULT_LEAD_NS    200000000L   /* Load 200 ms early */
+#define EVGTS_DEFAULT_ALARM_NS    50000000L
+#define EVGTS_DEFAULT_VERIFY_NS  100000000L   /* Verify 100 ms late */
+
+/* Alarm reasons */
+#define EVGTS_ALARM_MARGIN       1   /* Load close to boundary */
+#define EVGTS_ALARM_MISSED       2   /* Load after boundary */
+#define EVGTS_ALARM_VERIFY       3   /* Value read back differs */
+
+struct RtMode;
+struct EvgTs;
+
+typedef void (*EvgTsAlarm)(struct EvgTs *ts, int reason, void *arg);
+
+struct EvgTs {
+  volatile struct MrfEgRegs *pEg;
+  long                 lead_ns;
+  long                 alarm_ns;
+  long                 verify_ns;
+  int                  offset;      /* Added to host seconds */
+  EvgTsAlarm           alarm;
+  void                *arg;
+  struct RtMode       *rt;          /* Service thread settings or NULL */
+  pthread_t            thread;
+  volatile int         stop;
+  int                  running;
+  /* Statistics, written by service thread */
+  volatile unsigned long long loads;
+  volatile unsigned long long missed;
+  volatile unsigned long long margin_alarms;
+  volatile unsigned long long verify_errors;
+  volatile unsigned int  last_seconds;
+  volatile long          last_margin_ns;
+  volatile long          min_margin_ns;
+  volatile long          max_late_ns;  /* Largest wake-up lateness */
+};
+
+void EvgTsInit(struct EvgTs *ts, volatile struct MrfEgRegs *pEg, int offset);
+int EvgTsStep(struct EvgTs *ts);
+int EvgTsStart(struct EvgTs *ts);
+void EvgTsStop(struct EvgTs *ts);
@@ -0,0 +1,507 @@
+/**
+@file evloop.c
+@brief Event loop for Micro-Research Event Receiver and Event Generator
+       interrupts.
+
+The classic EvrIrqAssignHandler()/EvgIrqAssignHandler() install one
+process wide SIGIO handler, so with several boards in one process it is
+not possible to tell which board raised the interrupt and all the work
+has to be done in signal context. The event loop registers each device
+file descriptor with epoll and dispatches per device and per interrupt
+flag bit in normal thread context.
+
+Drivers without poll() support are handled by switching the device to
+FASYNC notification with a realtime signal (F_SETSIG). The signal carries
+the originating file descriptor and is received synchronously through a
+signalfd that is part of the same epoll set. The signal has to be blocked
+in every thread of the process, so call EvLoopInit() before creating
+threads.
+
+For every wake-up the interrupt flags are read once, the handlers for
+the flags that have a handler assigned are called in bit order, the
+handled flags are cleared and the interrupt is re-armed with
+EvrIrqHandled()/EvgIrqHandled().
+
+@date 19.10.2026
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "evloop.h"
+#include "irqstat.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/* epoll user data tags for the internal descriptors */
+#define EVLOOP_TAG_SIGFD  0x10000
+#define EVLOOP_TAG_STOPFD 0x10001
+
+/**
+Initialize event loop using the default notification signal
+SIGRTMIN + EVLOOP_DEFAULT_SIGNAL.
+
+@param loop Pointer to EvLoop structure
+@return Returns 0 on success, -1 on error.
+*/
+int EvLoopInit(struct EvLoop *loop)
+{
+  return EvLoopInitSignal(loop, SIGRTMIN + EVLOOP_DEFAULT_SIGNAL);
+}
+
+/**
+Initialize event loop.
+
+@param loop Pointer to EvLoop structure
+@param signo Realtime signal used for devices without poll() support.
+The signal and SIGIO (sent on realtime signal queue overflow) are
+blocked in the calling thread.
+@return Returns 0 on success, -1 on error.
+*/
+int EvLoopInitSignal(struct EvLoop *loop, int signo)
+{
+  struct epoll_event ev;
+  sigset_t set;
+  int i;
+
+  memset(loop, 0, sizeof(struct EvLoop));
+  for (i = 0; i < EVLOOP_MAX_DEVICES; i++)
+    loop->dev[i].fd = -1;
+  loop->signo = signo;
+  loop->sigfd = -1;
+  loop->stopfd = -1;
+
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epfd < 0)
+    return -1;
+
+  sigemptyset(&set);
+  sigaddset(&set, signo);
+  sigaddset(&set, SIGIO);
+  if (sigprocmask(SIG_BLOCK, &set, NULL))
+    goto err;
+
+  loop->sigfd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (loop->sigfd < 0)
+    goto err;
+  ev.events = EPOLLIN;
+  ev.data.u64 = EVLOOP_TAG_SIGFD;
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->sigfd, &ev))
+    goto err;
+
+  loop->stopfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (loop->stopfd < 0)
+    goto err;
+  ev.events = EPOLLIN;
+  ev.data.u64 = EVLOOP_TAG_STOPFD;
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->stopfd, &ev))
+    goto err;
+
+  return 0;
+
+ err:
+  EvLoopClose(loop);
+  return -1;
+}
+
+/** @private */
+static int EvLoopAdd(struct EvLoop *loop, int type, volatile void *pRegs,
+		     int fd)
+{
+  struct EvLoopDevice *d;
+  struct epoll_event ev;
+  int oflags;
+  int dev;
+
+  for (dev = 0; dev < EVLOOP_MAX_DEVICES; dev++)
+    if (loop->dev[dev].fd < 0)
+      break;
+  if (dev == EVLOOP_MAX_DEVICES)
+    return -1;
+
+  d = &loop->dev[dev];
+  memset(d, 0, sizeof(struct EvLoopDevice));
+  d->type = type;
+  d->pRegs = pRegs;
+  d->fd = fd;
+
+  ev.events = EPOLLIN | EPOLLPRI;
+  ev.data.u64 = dev;
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) == 0)
+    d->notify = EVLOOP_NOTIFY_POLL;
+  else if (errno == EPERM)
+    {
+      /* Driver does not implement poll(), use a queued signal that
+	 identifies the descriptor */
+      if (fcntl(fd, F_SETSIG, loop->signo) ||
+	  fcntl(fd, F_SETOWN, getpid()))
+	{
+	  d->fd = -1;
+	  return -1;
+	}
+      oflags = fcntl(fd, F_GETFL);
+      fcntl(fd, F_SETFL, oflags | FASYNC);
+      d->notify = EVLOOP_NOTIFY_SIG;
+    }
+  else
+    {
+      d->fd = -1;
+      return -1;
+    }
+
+#ifdef DEBUG
+  DEBUG_PRINTF("EvLoopAdd: dev %d fd %d notify %d\n", dev, fd, d->notify);
+#endif
+
+  /* Enable interrupt */
+  if (type == EVLOOP_DEV_EVR)
+    EvrIrqHandled(fd);
+  else
+    EvgIrqHandled(fd);
+
+  return dev;
+}
+
+/**
+Add Event Receiver to event loop.
+
+@param loop Pointer to EvLoop structure
+@param pEr Pointer to MrfErRegs structure
+@param fd File descriptor of EVR device opened
+@return Returns device index on success, -1 on error.
+*/
+int EvLoopAddEvr(struct EvLoop *loop, volatile struct MrfErRegs *pEr, int fd)
+{
+  return EvLoopAdd(loop, EVLOOP_DEV_EVR, pEr, fd);
+}
+
+/**
+Add Event Generator to event loop.
+
+@param loop Pointer to EvLoop structure
+@param pEg Pointer to MrfEgRegs structure
+@param fd File descriptor of EVG device opened
+@return Returns device index on success, -1 on error.
+*/
+int EvLoopAddEvg(struct EvLoop *loop, volatile struct MrfEgRegs *pEg, int fd)
+{
+  return EvLoopAdd(loop, EVLOOP_DEV_EVG, pEg, fd);
+}
+
+/**
+Remove device from event loop. Interrupt handlers are not called for
+the device after this.
+
+@param loop Pointer to EvLoop structure
+@param dev Device index returned by EvLoopAddEvr() or EvLoopAddEvg()
+@return Returns 0 on success, -1 on error.
+*/
+int EvLoopRemove(struct EvLoop *loop, int dev)
+{
+  struct EvLoopDevice *d;
+  int oflags;
+
+  if (dev < 0 || dev >= EVLOOP_MAX_DEVICES || loop->dev[dev].fd < 0)
+    return -1;
+
+  d = &loop->dev[dev];
+  if (d->notify == EVLOOP_NOTIFY_POLL)
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, d->fd, NULL);
+  else
+    {
+      oflags = fcntl(d->fd, F_GETFL);
+      fcntl(d->fd, F_SETFL, oflags & ~FASYNC);
+    }
+  d->fd = -1;
+  d->mask = 0;
+
+  return 0;
+}
+
+/**
+Assign handler for interrupt flag.
+
+@param loop Pointer to EvLoop structure
+@param dev Device index
+@param flag Interrupt flag bit number, e.g. C_EVR_IRQFLAG_EVENT for EVR or
+C_EVG_IRQFLAG_RXVIO for EVG.
+@param handler Function called with device index, flag bit number and
+argument when the flag is set, NULL to remove handler.
+@param arg Argument passed to handler
+@return Returns 0 on success, -1 on error.
+
+The interrupts themselves are enabled with EvrIrqEnable() or
+EvgIrqEnable(). Flags that are enabled but have no handler assigned are
+not cleared by the event loop.
+*/
+int EvLoopSetHandler(struct EvLoop *loop, int dev, int flag,
+		     EvLoopHandler handler, void *arg)
+{
+  struct EvLoopDevice *d;
+
+  if (dev < 0 || dev >= EVLOOP_MAX_DEVICES || loop->dev[dev].fd < 0)
+    return -1;
+  if (flag < 0 || flag >= EVLOOP_IRQ_BITS)
+    return -1;
+
+  d = &loop->dev[dev];
+  d->handler[flag] = handler;
+  d->arg[flag] = arg;
+  if (handler)
+    d->mask |= (1U << flag);
+  else
+    d->mask &= ~(1U << flag);
+
+  return 0;
+}
+
+/**
+Collect interrupt latency and coalescing statistics for device.
+
+@param loop Pointer to EvLoop structure
+@param dev Device index
+@param st Pointer to initialized IrqStat structure, NULL to stop
+collecting statistics.
+@return Returns 0 on success, -1 on error.
+*/
+int EvLoopSetStats(struct EvLoop *loop, int dev, struct IrqStat *st)
+{
+  if (dev < 0 || dev >= EVLOOP_MAX_DEVICES || loop->dev[dev].fd < 0)
+    return -1;
+
+  loop->dev[dev].stats = st;
+
+  return 0;
+}
+
+/**
+Handle interrupt of one device: read interrupt flags once, call
+handlers, clear handled flags and re-arm interrupt.
+
+@param loop Pointer to EvLoop structure
+@param dev Device index
+@return Returns number of handlers called, -1 on error.
+*/
+int EvLoopDispatch(struct EvLoop *loop, int dev)
+{
+  struct EvLoopDevice *d;
+  struct IrqStat *st;
+  volatile struct MrfErRegs *pEr;
+  volatile struct MrfEgRegs *pEg;
+  u32 flags, handled;
+  int bit, calls = 0;
+
+  if (dev < 0 || dev >= EVLOOP_MAX_DEVICES || loop->dev[dev].fd < 0)
+    return -1;
+
+  d = &loop->dev[dev];
+  d->wakeups++;
+  /* Statistics are collected only when set with EvLoopSetStats() */
+  st = d->stats;
+  pEr = (volatile struct MrfErRegs *) d->pRegs;
+  pEg = (volatile struct MrfEgRegs *) d->pRegs;
+
+  if (d->type == EVLOOP_DEV_EVR)
+    flags = st ? IrqStatEvrGetIrqFlags(st, pEr) : EvrGetIrqFlags(pEr);
+  else
+    flags = st ? IrqStatEvgGetIrqFlags(st, pEg) : EvgGetIrqFlags(pEg);
+
+  handled = flags & d->mask;
+  for (bit = 0; bit < EVLOOP_IRQ_BITS; bit++)
+    if (handled & (1U << bit))
+      {
+	/* Handler may remove itself */
+	if (d->handler[bit])
+	  {
+	    if (st)
+	      IrqStatHandlerStart(st, bit);
+	    d->handler[bit](dev, bit, d->arg[bit]);
+	    if (st)
+	      IrqStatHandlerEnd(st, bit);
+	    calls++;
+	  }
+      }
+  d->dispatched += calls;
+
+#ifdef DEBUG
+  DEBUG_PRINTF("EvLoopDispatch: dev %d flags %08x handled %08x\n",
+	       dev, flags, handled);
+#endif
+
+  if (d->fd < 0)
+    return calls;
+
+  if (d->type == EVLOOP_DEV_EVR)
+    {
+      if (handled)
+	{
+	  if (st)
+	    IrqStatEvrClearIrqFlags(st, pEr, handled);
+	  else
+	    EvrClearIrqFlags(pEr, handled);
+	}
+      if (st)
+	IrqStatEvrIrqHandled(st, d->fd);
+      else
+	EvrIrqHandled(d->fd);
+    }
+  else
+    {
+      if (handled)
+	{
+	  if (st)
+	    IrqStatEvgClearIrqFlags(st, pEg, handled);
+	  else
+	    EvgClearIrqFlags(pEg, handled);
+	}
+      if (st)
+	IrqStatEvgIrqHandled(st, d->fd);
+      else
+	EvgIrqHandled(d->fd);
+    }
+
+  return calls;
+}
+
+/** @private */
+static int EvLoopReadSignals(struct EvLoop *loop)
+{
+  struct signalfd_siginfo si[16];
+  ssize_t n;
+  int i, dev, calls = 0;
+
+  while ((n = read(loop->sigfd, si, sizeof(si))) > 0)
+    {
+      for (i = 0; i < (int) (n / sizeof(struct signalfd_siginfo)); i++)
+	{
+	  if (si[i].ssi_signo == SIGIO)
+	    {
+	      /* Realtime signal queue overflowed, we do not know which
+		 devices fired so check all of them */
+	      for (dev = 0; dev < EVLOOP_MAX_DEVICES; dev++)
+		if (loop->dev[dev].fd >= 0 &&
+		    loop->dev[dev].notify == EVLOOP_NOTIFY_SIG)
+		  calls += EvLoopDispatch(loop, dev);
+	      continue;
+	    }
+	  for (dev = 0; dev < EVLOOP_MAX_DEVICES; dev++)
+	    if (loop->dev[dev].fd == si[i].ssi_fd &&
+		loop->dev[dev].notify == EVLOOP_NOTIFY_SIG)
+	      {
+		calls += EvLoopDispatch(loop, dev);
+		break;
+	      }
+	}
+    }
+
+  return calls;
+}
+
+/**
+Wait for interrupts and dispatch them.
+
+@param loop Pointer to EvLoop structure
+@param timeout_ms Timeout in milliseconds, -1 waits forever.
+@return Returns number of handlers called, -1 on error or when the loop
+was stopped with EvLoopStop().
+*/
+int EvLoopRunOnce(struct EvLoop *loop, int timeout_ms)
+{
+  struct epoll_event ev[EVLOOP_MAX_DEVICES + 2];
+  uint64_t cnt;
+  int n, i, calls = 0;
+
+  n = epoll_wait(loop->epfd, ev, EVLOOP_MAX_DEVICES + 2, timeout_ms);
+  if (n < 0)
+    return (errno == EINTR) ? 0 : -1;
+
+  for (i = 0; i < n; i++)
+    {
+      switch (ev[i].data.u64)
+	{
+	case EVLOOP_TAG_SIGFD:
+	  calls += EvLoopReadSignals(loop);
+	  break;
+	case EVLOOP_TAG_STOPFD:
+	  read(loop->stopfd, &cnt, sizeof(cnt));
+	  break;
+	default:
+	  calls += EvLoopDispatch(loop, (int) ev[i].data.u64);
+	}
+    }
+
+  if (loop->stop)
+    return -1;
+
+  return calls;
+}
+
+/**
+Dispatch interrupts until EvLoopStop() is called.
+
+@param loop Pointer to EvLoop structure
+@return Returns 0 when stopped, -1 on error.
+*/
+int EvLoopRun(struct EvLoop *loop)
+{
+  while (!loop->stop)
+    if (EvLoopRunOnce(loop, -1) < 0 && !loop->stop)
+      return -1;
+
+  loop->stop = 0;
+  return 0;
+}
+
+/**
+Stop event loop. May be called from a handler or from another thread.
+
+@param loop Pointer to EvLoop structure
+*/
+void EvLoopStop(struct EvLoop *loop)
+{
+  uint64_t one = 1;
+
+  loop->stop = 1;
+  write(loop->stopfd, &one, sizeof(one));
+}
+
+/**
+Remove all devices and release event loop resources. The device
+file descriptors are not closed.
+
+@param loop Pointer to EvLoop structure
+*/
+void EvLoopClose(struct EvLoop *loop)
+{
+  int dev;
+
+  for (dev = 0; dev < EVLOOP_MAX_DEVICES; dev++)
+    if (loop->dev[dev].fd >= 0)
+      EvLoopRemove(loop, dev);
+
+  if (loop->stopfd >= 0)
+    close(loop->stopfd);
+  if (loop->sigfd >= 0)
+    close(loop->sigfd);
+  if (loop->epfd >= 0)
+    close(loop->epfd);
+  loop->stopfd = loop->sigfd = loop->epfd = -1;
+}
@@ -0,0 +1,67 @@
+/*
+  evloop.h -- Event loop for Micro-Research Event Receiver and
+              Event Generator interrupts
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+ */
+
+struct MrfErRegs;
+struct MrfEgRegs;
+struct IrqStat;
+
+#define EVLOOP_MAX_DEVICES  16
+#define EVLOOP_IRQ_BITS     32
+
+/* Device types */
+#define EVLOOP_DEV_EVR      0
+#define EVLOOP_DEV_EVG      1
+
+/* Notification modes */
+#define EVLOOP_NOTIFY_POLL  0   /* driver supports poll(), fd in epoll set */
+#define EVLOOP_NOTIFY_SIG   1   /* FASYNC realtime signal through signalfd */
+
+/* Default realtime signal offset from SIGRTMIN used for FASYNC devices */
+#define EVLOOP_DEFAULT_SIGNAL 4
+
+typedef void (*EvLoopHandler)(int dev, int flag, void *arg);
+
+struct EvLoopDevice {
+  int           type;                   /* EVLOOP_DEV_EVR / EVLOOP_DEV_EVG */
+  volatile void *pRegs;                 /* MrfErRegs or MrfEgRegs */
+  int           fd;
+  int           notify;                 /* EVLOOP_NOTIFY_* */
+  u32           mask;                   /* Flags with a handler assigned */
+  EvLoopHandler handler[EVLOOP_IRQ_BITS];
+  void          *arg[EVLOOP_IRQ_BITS];
+  u32           wakeups;
+  u32           dispatched;
+  struct IrqStat *stats;                /* Optional statistics, irqstat.h */
+};
+
+struct EvLoop {
+  int           epfd;
+  int           sigfd;
+  int           stopfd;
+  int           signo;
+  volatile int  stop;
+  struct EvLoopDevice dev[EVLOOP_MAX_DEVICES];
+};
+
+int EvLoopInit(struct EvLoop *loop);
+int EvLoopInitSignal(struct EvLoop *loop, int signo);
+int EvLoopAddEvr(struct EvLoop *loop, volatile struct MrfErRegs *pEr, int fd);
+int EvLoopAddEvg(struct EvLoop *loop, volatile struct MrfEgRegs *pEg, int fd);
+int EvLoopRemove(struct EvLoop *loop, int dev);
+int EvLoopSetHandler(struct EvLoop *loop, int dev, int flag,
+		     EvLoopHandler handler, void *arg);
+int EvLoopSetStats(struct EvLoop *loop, int dev, struct IrqStat *st);
+int EvLoopDispatch(struct EvLoop *loop, int dev);
+int EvLoopRunOnce(struct EvLoop *loop, int timeout_ms);
+int EvLoopRun(struct EvLoop *loop);
+void EvLoopStop(struct EvLoop *loop);
+void EvLoopClose(struct EvLoop *loop);
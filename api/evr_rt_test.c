@@ -0,0 +1,83 @@
+/*
+  evr_rt_test.c -- Micro-Research Event Receiver
+  Realtime servicing loop jitter self-test
+
+  Date:   19.10.2026
+
+*/
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "erapi.h"
+#include "fracdiv.h"
+#include "rtmode.h"
+
+int main(int argc, char *argv[])
+{
+  struct MrfErRegs *pEr;
+  struct RtMode    rt;
+  struct RtJitter  res;
+  int              fdEr;
+  int              window;
+  int              period_us = 1000;
+  int              loops = 10000;
+  double           tick_ns;
+
+  if (argc < 2)
+    {
+      printf("Usage: %s /dev/era3 [cpu] [priority] [period_us] [loops] [tick_ns]\n", argv[0]);
+      printf("Runs a periodic loop in realtime mode and measures its period\n");
+      printf("against the EVR timestamp counter. tick_ns defaults to the\n");
+      printf("event clock period from the fractional synthesizer setting.\n");
+      return -1;
+    }
+
+  fdEr = EvrOpenSize(&pEr, argv[1], &window);
+  if (fdEr < 0)
+    {
+      printf("Could not open %s, errno %d\n", argv[1], errno);
+      return errno;
+    }
+
+  RtModeDefaults(&rt);
+  if (argc > 2)
+    rt.cpu = atoi(argv[2]);
+  if (argc > 3)
+    rt.priority = atoi(argv[3]);
+  if (argc > 4)
+    period_us = atoi(argv[4]);
+  if (argc > 5)
+    loops = atoi(argv[5]);
+  if (argc > 6)
+    tick_ns = atof(argv[6]);
+  else
+    tick_ns = 1000.0 / cw_to_freq(EvrGetFracDiv(pEr));
+
+  if (RtModeEnter(&rt))
+    printf("Warning: could not apply all realtime settings, errno %d\n",
+	   errno);
+  RtPrefaultWindow(pEr, window);
+
+  if (EvrRtJitterTest(pEr, tick_ns, period_us, loops, &res))
+    {
+      printf("Invalid parameters\n");
+      EvrClose(fdEr);
+      return -1;
+    }
+
+  printf("Loops %d, period %.0f ns, tick %.4f ns\n", res.loops,
+	 res.period_ns, tick_ns);
+  printf("Measured period min %.0f avg %.0f max %.0f ns\n",
+	 res.min_ns, res.avg_ns, res.max_ns);
+  printf("Jitter %.0f ns, max wake-up lateness %.0f ns, overruns %d\n",
+	 res.jitter_ns, res.late_max_ns, res.overruns);
+
+  EvrClose(fdEr);
+
+  return 0;
+}
@@ -0,0 +1,1014 @@
+/**
+@file evsim.c
+@brief Simulated Micro-Research Event Receiver and Event Generator for
+       testing and benchmarking the API without hardware.
+
+EvrSimOpen() and EvgSimOpen() return a file descriptor and a register
+pointer like EvrOpen() and EvgOpen(). The registers are backed by
+memory and all accesses go through the trap handler in mmiotrap.c, so
+the API functions run unmodified. Every register access is accounted a
+configurable modeled latency; the trap itself takes far longer, use
+MmioTrapGetTime() to get the modeled duration of a piece of code.
+
+As all trapped windows belong to one thread, the simulated devices can
+only be used by the thread that opened them, while no other threads
+exist. Modules that run threads of their own are used through their
+single-threaded path, see mmiotrap.c.
+
+The model implements the register semantics the API depends on:
+
+- Event FIFO: reading FIFOEvent pops the next event and updates
+  FIFOSeconds and FIFOTimestamp. The EVENT and FIFOFULL interrupt flags
+  follow the FIFO state.
+- IrqFlag, SegRXReg and SegOVReg are write-one-to-clear.
+- Control strobes: event FIFO reset, log reset/enable/disable,
+  timestamp latch and reset are executed and read back as zero.
+- Event log: mapped events with the log bit are stored in the Log ring
+  and LogStatus is updated; the stop log bit stops logging.
+- Data buffer: LOAD arms reception, EvrSimReceiveDBuf() completes it
+  and sets RXREADY and the size. Segmented buffers set the segment
+  receive and overflow flags. Transmit triggers complete immediately.
+- SWEvent: writing a code with ENABLE set reads back PENDING on the
+  next read and until EVSIM_SWEVENT_NS have passed.
+- Seconds and timestamp counters run from the host clock at UsecDiv
+  MHz.
+- Sequence RAM enable/disable strobes and the EVG event analyzer FIFO.
+
+Received events are injected with EvrSimInjectEvent() and go through the
+selected mapping RAM. Everything else behaves like plain memory.
+
+Only x86_64 Linux is supported, see mmiotrap.c.
+
+@date 19.10.2026
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "mmiotrap.h"
+#include "evsim.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define EVSIM_EVR_WINDOW  0x00010000
+
+struct EvSimEvr {
+  struct MmioWindow w;
+  struct FIFOEvent  fifo[EVSIM_FIFO_DEPTH];
+  int               head;
+  int               count;
+  int               dbuf;         /* DataBufControl status bits */
+  struct timespec   epoch;        /* Timestamp counter reset */
+  struct timespec   swevent;      /* SWEvent pending until */
+  int               swseen;       /* Pending SWEvent reads */
+};
+
+struct EvSimEvg {
+  struct MmioWindow w;
+  struct EvanStruct fifo[EVSIM_EVAN_DEPTH];
+  int               head;
+  int               count;
+  int               overflow;
+  struct timespec   swevent;
+  int               swseen;
+};
+
+struct EvSimDevice {
+  int               fd;
+  volatile char    *base;
+  char             *shadow;
+  int               size;
+  int               evrs;
+  struct EvSimEvr   evr[2];
+  struct EvSimEvg  *evg;
+  struct MmioWindow fct;
+};
+
+static struct EvSimDevice *EvSimDev[EVSIM_MAX_DEVICES];
+static pthread_mutex_t EvSimTable = PTHREAD_MUTEX_INITIALIZER;
+
+/** @private */
+static long long EvSimNs(struct timespec *t0)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - t0->tv_sec) * 1000000000LL +
+    (now.tv_nsec - t0->tv_nsec);
+}
+
+/** @private */
+static u32 EvSimOld(const char *old, int offset, int o)
+{
+  u32 v;
+
+  memcpy(&v, old + o - offset, sizeof(v));
+  return be32_to_cpu(v);
+}
+
+/** @private */
+static void EvSimSWEventRead(volatile u32 *reg, struct timespec *pending,
+			     int *seen)
+{
+  u32 v = be32_to_cpu(*reg);
+
+  /* The first read after the write always sees the event pending */
+  if ((v & (1 << C_EVR_SWEVENT_PENDING)) && (*seen)++ &&
+      EvSimNs(pending) >= 0)
+    *reg = be32_to_cpu(v & ~(1 << C_EVR_SWEVENT_PENDING));
+}
+
+/** @private */
+static void EvSimSWEventWrite(volatile u32 *reg, u32 v,
+			      struct timespec *pending, int *seen)
+{
+  v &= ~(1 << C_EVR_SWEVENT_PENDING);
+  if (v & (1 << C_EVR_SWEVENT_ENABLE))
+    {
+      *seen = 0;
+      clock_gettime(CLOCK_MONOTONIC, pending);
+      pending->tv_nsec += EVSIM_SWEVENT_NS;
+      if (pending->tv_nsec >= 1000000000L)
+	{
+	  pending->tv_nsec -= 1000000000L;
+	  pending->tv_sec++;
+	}
+      v |= (1 << C_EVR_SWEVENT_PENDING);
+    }
+  *reg = be32_to_cpu(v);
+}
+
+/**
+@private
+Transmit buffer control, EVR TxDataBufControl/TxSegBufControl and EVG
+DataBufControl/SegBufControl have the same layout. The trigger strobe
+completes the transfer at once.
+*/
+static u32 EvSimTxControl(u32 v, u32 old)
+{
+  u32 status = (1 << C_EVR_TXDATABUF_COMPLETE) |
+    (1 << C_EVR_TXDATABUF_RUNNING);
+
+  if (v & (1 << C_EVR_TXDATABUF_TRIGGER))
+    return (v & ~(status | (1 << C_EVR_TXDATABUF_TRIGGER))) |
+      (1 << C_EVR_TXDATABUF_COMPLETE);
+
+  return (v & ~status) | (old & status);
+}
+
+/**
+@private
+Sequence RAM control, same layout on EVR and EVG.
+*/
+static u32 EvSimSeqRamControl(u32 v, u32 old)
+{
+  u32 strobes = (1 << C_EVR_SQRC_ENABLE) | (1 << C_EVR_SQRC_DISABLE) |
+    (1 << C_EVR_SQRC_RESET) | (1 << C_EVR_SQRC_SWTRIGGER);
+  u32 status = (1 << C_EVR_SQRC_ENABLED) | (1 << C_EVR_SQRC_RUNNING);
+  u32 stored = (v & ~(strobes | status)) | (old & status);
+
+  if (v & (1 << C_EVR_SQRC_ENABLE))
+    stored |= (1 << C_EVR_SQRC_ENABLED);
+  if (v & (1 << C_EVR_SQRC_DISABLE))
+    stored &= ~((1 << C_EVR_SQRC_ENABLED) | (1 << C_EVR_SQRC_RUNNING));
+
+  return stored;
+}
+
+/** @private */
+static void EvSimEvrCounters(struct EvSimEvr *s, u32 *sec, u32 *ts)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  long long ns = EvSimNs(&s->epoch);
+  u32 usecdiv = be32_to_cpu(r->UsecDiv) & 0xffff;
+
+  if (!usecdiv)
+    usecdiv = 125;
+  *sec = ns / 1000000000LL;
+  *ts = (ns % 1000000000LL) * usecdiv / 1000;
+}
+
+/** @private */
+static void EvSimEvrLatch(struct EvSimEvr *s)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  u32 sec, ts;
+
+  EvSimEvrCounters(s, &sec, &ts);
+  r->SecondsLatch = be32_to_cpu(sec);
+  r->TimestampLatch = be32_to_cpu(ts);
+}
+
+/**
+@private
+Update level sensitive FIFO interrupt flags.
+*/
+static void EvSimEvrFIFOFlags(struct EvSimEvr *s)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  u32 flags = be32_to_cpu(r->IrqFlag);
+
+  if (s->count)
+    flags |= (1 << C_EVR_IRQFLAG_EVENT);
+  else
+    flags &= ~(1 << C_EVR_IRQFLAG_EVENT);
+  if (s->count == EVSIM_FIFO_DEPTH)
+    flags |= (1 << C_EVR_IRQFLAG_FIFOFULL);
+  r->IrqFlag = be32_to_cpu(flags);
+}
+
+/** @private */
+static void EvSimEvrPop(struct EvSimEvr *s)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  struct FIFOEvent *fe;
+
+  if (!s->count)
+    return;
+
+  fe = &s->fifo[s->head];
+  r->FIFOSeconds = be32_to_cpu(fe->TimestampHigh);
+  r->FIFOTimestamp = be32_to_cpu(fe->TimestampLow);
+  r->FIFOEvent = be32_to_cpu(fe->EventCode);
+  s->head = (s->head + 1) % EVSIM_FIFO_DEPTH;
+  s->count--;
+  EvSimEvrFIFOFlags(s);
+}
+
+/** @private */
+static void EvSimEvrLog(struct EvSimEvr *s, int code, u32 sec, u32 ts)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  int ls = be32_to_cpu(r->LogStatus);
+  int pos, wrap = 0;
+
+  if (be32_to_cpu(r->Status) & (1 << C_EVR_STATUS_LOG_STOPPED))
+    return;
+
+  if (ls < 0)
+    {
+      wrap = 1;
+      pos = ls & (EVR_LOG_SIZE - 1);
+    }
+  else
+    pos = ls;
+
+  r->Log[pos].TimestampHigh = be32_to_cpu(sec);
+  r->Log[pos].TimestampLow = be32_to_cpu(ts);
+  r->Log[pos].EventCode = be32_to_cpu(code);
+
+  if (++pos == EVR_LOG_SIZE)
+    {
+      pos = 0;
+      wrap = 1;
+    }
+  r->LogStatus = be32_to_cpu(wrap ? (0x80000000 | pos) : pos);
+}
+
+/**
+@private
+Receive event, model lock held.
+*/
+static void EvSimEvrEvent(struct EvSimEvr *s, int code, int seconds,
+			  int timestamp)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  u32 ctrl, ie, sec, ts;
+  int ram, tail;
+
+  EvSimEvrCounters(s, &sec, &ts);
+  if (seconds >= 0)
+    {
+      sec = seconds;
+      ts = timestamp;
+    }
+
+  r->EventCounters[code] = be32_to_cpu(be32_to_cpu(r->EventCounters[code])
+				       + 1);
+
+  ctrl = be32_to_cpu(r->Control);
+  if (!(ctrl & (1 << C_EVR_CTRL_MAP_RAM_ENABLE)))
+    return;
+  ram = (ctrl >> C_EVR_CTRL_MAP_RAM_SELECT) & 1;
+  ie = be32_to_cpu(r->MapRam[ram][code].IntEvent);
+
+  if (ie & (1 << C_EVR_MAP_TIMESTAMP_RESET))
+    clock_gettime(CLOCK_MONOTONIC, &s->epoch);
+  if (ie & (1 << C_EVR_MAP_LATCH_TIMESTAMP))
+    EvSimEvrLatch(s);
+  if (ie & (1 << C_EVR_MAP_SAVE_EVENT))
+    {
+      if (s->count < EVSIM_FIFO_DEPTH)
+	{
+	  tail = (s->head + s->count) % EVSIM_FIFO_DEPTH;
+	  s->fifo[tail].TimestampHigh = sec;
+	  s->fifo[tail].TimestampLow = ts;
+	  s->fifo[tail].EventCode = code;
+	  s->count++;
+	}
+      EvSimEvrFIFOFlags(s);
+    }
+  if (ie & (1 << C_EVR_MAP_LOG_EVENT))
+    EvSimEvrLog(s, code, sec, ts);
+  if ((ie & (1 << C_EVR_MAP_STOP_LOG)) &&
+      (ctrl & (1 << C_EVR_CTRL_LOG_STOP_EV_EN)))
+    r->Status |= be32_to_cpu(1 << C_EVR_STATUS_LOG_STOPPED);
+}
+
+/** @private */
+static void EvSimEvrRead(struct MmioWindow *w, int offset, int size)
+{
+  struct EvSimEvr *s = (struct EvSimEvr *) w->arg;
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) w->shadow;
+  u32 sec, ts;
+  int o;
+
+  for (o = offset & ~3; o < offset + size; o += 4)
+    switch (o)
+      {
+      case offsetof(struct MrfErRegs, SecondsCounter):
+      case offsetof(struct MrfErRegs, TimestampEventCounter):
+	EvSimEvrCounters(s, &sec, &ts);
+	r->SecondsCounter = be32_to_cpu(sec);
+	r->TimestampEventCounter = be32_to_cpu(ts);
+	break;
+      case offsetof(struct MrfErRegs, FIFOEvent):
+	EvSimEvrPop(s);
+	break;
+      case offsetof(struct MrfErRegs, SWEvent):
+	EvSimSWEventRead(&r->SWEvent, &s->swevent, &s->swseen);
+	break;
+      }
+}
+
+/** @private */
+static u32 EvSimEvrControl(struct EvSimEvr *s, u32 v)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) s->w.shadow;
+  u32 strobes = (1 << C_EVR_CTRL_RESET_TIMESTAMP) |
+    (1 << C_EVR_CTRL_LATCH_TIMESTAMP) | (1 << C_EVR_CTRL_LOG_RESET) |
+    (1 << C_EVR_CTRL_LOG_ENABLE) | (1 << C_EVR_CTRL_LOG_DISABLE) |
+    (1 << C_EVR_CTRL_RESET_EVENTFIFO);
+
+  if (v & (1 << C_EVR_CTRL_RESET_EVENTFIFO))
+    {
+      s->count = 0;
+      r->IrqFlag &= be32_to_cpu(~(1 << C_EVR_IRQFLAG_FIFOFULL));
+      EvSimEvrFIFOFlags(s);
+    }
+  if (v & (1 << C_EVR_CTRL_LOG_RESET))
+    r->LogStatus = 0;
+  if (v & (1 << C_EVR_CTRL_LOG_ENABLE))
+    r->Status &= be32_to_cpu(~(1 << C_EVR_STATUS_LOG_STOPPED));
+  if (v & (1 << C_EVR_CTRL_LOG_DISABLE))
+    r->Status |= be32_to_cpu(1 << C_EVR_STATUS_LOG_STOPPED);
+  if (v & (1 << C_EVR_CTRL_RESET_TIMESTAMP))
+    clock_gettime(CLOCK_MONOTONIC, &s->epoch);
+  if (v & (1 << C_EVR_CTRL_LATCH_TIMESTAMP))
+    EvSimEvrLatch(s);
+
+  return v & ~strobes;
+}
+
+/**
+@private
+Data buffer receive control. LOAD and STOP share their bit positions
+with the RECEIVING and RXREADY status bits, so a read-modify-write of
+the register may write both strobes; that toggles the receiver.
+*/
+static u32 EvSimEvrDBufControl(struct EvSimEvr *s, u32 v)
+{
+  u32 load = (1 << C_EVR_DATABUF_LOAD), stop = (1 << C_EVR_DATABUF_STOP);
+  u32 status = load | stop | (1 << C_EVR_DATABUF_CHECKSUM) |
+    ((1 << (C_EVR_DATABUF_SIZEHIGH + 1)) - (1 << C_EVR_DATABUF_SIZELOW));
+
+  if ((v & load) && (v & stop))
+    v &= (s->dbuf & (1 << C_EVR_DATABUF_RECEIVING)) ? ~load : ~stop;
+  if (v & load)
+    s->dbuf = (1 << C_EVR_DATABUF_RECEIVING);
+  else if (v & stop)
+    s->dbuf &= ~(1 << C_EVR_DATABUF_RECEIVING);
+
+  return (v & ~status) | s->dbuf;
+}
+
+/** @private */
+static void EvSimEvrWrite(struct MmioWindow *w, int offset, int size,
+			  const char *old)
+{
+  struct EvSimEvr *s = (struct EvSimEvr *) w->arg;
+  volatile u32 *reg;
+  u32 v, o32;
+  int o;
+
+  for (o = (offset + 3) & ~3; o + 4 <= offset + size; o += 4)
+    {
+      reg = (volatile u32 *) (w->shadow + o);
+      v = be32_to_cpu(*reg);
+      o32 = EvSimOld(old, offset, o);
+
+      if (o >= offsetof(struct MrfErRegs, SegRXReg[0]) &&
+	  o < offsetof(struct MrfErRegs, SegBuf[0]))
+	{
+	  *reg = be32_to_cpu(o32 & ~v);
+	  continue;
+	}
+      if (o >= offsetof(struct MrfErRegs, SeqRamControl[0]) &&
+	  o < offsetof(struct MrfErRegs, SeqRamControl[EVR_MAX_SEQRAMS]))
+	{
+	  *reg = be32_to_cpu(EvSimSeqRamControl(v, o32));
+	  continue;
+	}
+
+      switch (o)
+	{
+	case offsetof(struct MrfErRegs, Status):
+	case offsetof(struct MrfErRegs, FPGAVersion):
+	case offsetof(struct MrfErRegs, SecondsCounter):
+	case offsetof(struct MrfErRegs, TimestampEventCounter):
+	case offsetof(struct MrfErRegs, SecondsLatch):
+	case offsetof(struct MrfErRegs, TimestampLatch):
+	case offsetof(struct MrfErRegs, FIFOSeconds):
+	case offsetof(struct MrfErRegs, FIFOTimestamp):
+	case offsetof(struct MrfErRegs, FIFOEvent):
+	case offsetof(struct MrfErRegs, LogStatus):
+	  *reg = be32_to_cpu(o32);
+	  break;
+	case offsetof(struct MrfErRegs, Control):
+	  *reg = be32_to_cpu(EvSimEvrControl(s, v));
+	  break;
+	case offsetof(struct MrfErRegs, IrqFlag):
+	  *reg = be32_to_cpu(o32 & ~v);
+	  EvSimEvrFIFOFlags(s);
+	  break;
+	case offsetof(struct MrfErRegs, SWEvent):
+	  EvSimSWEventWrite(reg, v, &s->swevent, &s->swseen);
+	  break;
+	case offsetof(struct MrfErRegs, DataBufControl):
+	  *reg = be32_to_cpu(EvSimEvrDBufControl(s, v));
+	  break;
+	case offsetof(struct MrfErRegs, TxDataBufControl):
+	case offsetof(struct MrfErRegs, TxSegBufControl):
+	  *reg = be32_to_cpu(EvSimTxControl(v, o32));
+	  break;
+	}
+    }
+}
+
+/** @private */
+static void EvSimEvgPop(struct EvSimEvg *s)
+{
+  volatile struct MrfEgRegs *r = (volatile struct MrfEgRegs *) s->w.shadow;
+  struct EvanStruct *ev;
+
+  if (s->count)
+    {
+      ev = &s->fifo[s->head];
+      r->EvanCode = be32_to_cpu(ev->EventCode);
+      r->EvanTimeH = be32_to_cpu(ev->TimestampHigh);
+      r->EvanTimeL = be32_to_cpu(ev->TimestampLow);
+      s->head = (s->head + 1) % EVSIM_EVAN_DEPTH;
+      s->count--;
+    }
+  if (s->count)
+    r->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_NOTEMPTY);
+  else
+    r->EvanControl &= be32_to_cpu(~(1 << C_EVG_EVANCTRL_NOTEMPTY));
+}
+
+/** @private */
+static void EvSimEvgRead(struct MmioWindow *w, int offset, int size)
+{
+  struct EvSimEvg *s = (struct EvSimEvg *) w->arg;
+  volatile struct MrfEgRegs *r = (volatile struct MrfEgRegs *) w->shadow;
+  int o;
+
+  for (o = offset & ~3; o < offset + size; o += 4)
+    switch (o)
+      {
+      case offsetof(struct MrfEgRegs, EvanCode):
+	EvSimEvgPop(s);
+	break;
+      case offsetof(struct MrfEgRegs, SWEvent):
+	EvSimSWEventRead(&r->SWEvent, &s->swevent, &s->swseen);
+	break;
+      }
+}
+
+/** @private */
+static void EvSimEvgWrite(struct MmioWindow *w, int offset, int size,
+			  const char *old)
+{
+  struct EvSimEvg *s = (struct EvSimEvg *) w->arg;
+  volatile u32 *reg;
+  u32 v, o32;
+  int o;
+
+  for (o = (offset + 3) & ~3; o + 4 <= offset + size; o += 4)
+    {
+      reg = (volatile u32 *) (w->shadow + o);
+      v = be32_to_cpu(*reg);
+      o32 = EvSimOld(old, offset, o);
+
+      if (o >= offsetof(struct MrfEgRegs, SeqRamControl[0]) &&
+	  o < offsetof(struct MrfEgRegs, SeqRamControl[EVG_MAX_SEQRAMS]))
+	{
+	  *reg = be32_to_cpu(EvSimSeqRamControl(v, o32));
+	  continue;
+	}
+
+      switch (o)
+	{
+	case offsetof(struct MrfEgRegs, Status):
+	case offsetof(struct MrfEgRegs, FPGAVersion):
+	case offsetof(struct MrfEgRegs, EvanCode):
+	case offsetof(struct MrfEgRegs, EvanTimeH):
+	case offsetof(struct MrfEgRegs, EvanTimeL):
+	  *reg = be32_to_cpu(o32);
+	  break;
+	case offsetof(struct MrfEgRegs, Control):
+	  *reg = be32_to_cpu(v & ~(1 << C_EVG_CTRL_MXC_RESET));
+	  break;
+	case offsetof(struct MrfEgRegs, IrqFlag):
+	  *reg = be32_to_cpu(o32 & ~v);
+	  break;
+	case offsetof(struct MrfEgRegs, SWEvent):
+	  EvSimSWEventWrite(reg, v, &s->swevent, &s->swseen);
+	  break;
+	case offsetof(struct MrfEgRegs, DataBufControl):
+	case offsetof(struct MrfEgRegs, SegBufControl):
+	  *reg = be32_to_cpu(EvSimTxControl(v, o32));
+	  break;
+	case offsetof(struct MrfEgRegs, TimestampCtrl):
+	  *reg = be32_to_cpu(v & ~(1 << C_EVG_TSCTRL_LOAD));
+	  break;
+	case offsetof(struct MrfEgRegs, EvanControl):
+	  /* Reset and clear overflow strobes share bits with status */
+	  if (v & (1 << C_EVG_EVANCTRL_RESET))
+	    {
+	      s->count = 0;
+	      s->overflow = 0;
+	    }
+	  if (v & (1 << C_EVG_EVANCTRL_CLROVERFLOW))
+	    s->overflow = 0;
+	  v &= (1 << C_EVG_EVANCTRL_ENABLE);
+	  if (s->count)
+	    v |= (1 << C_EVG_EVANCTRL_NOTEMPTY);
+	  if (s->overflow)
+	    v |= (1 << C_EVG_EVANCTRL_OVERFLOW);
+	  *reg = be32_to_cpu(v);
+	  break;
+	}
+    }
+}
+
+/** @private */
+static void EvSimEvrInit(struct EvSimEvr *s, volatile char *base,
+			 char *shadow, int size)
+{
+  volatile struct MrfErRegs *r = (volatile struct MrfErRegs *) shadow;
+
+  memset(s, 0, sizeof(struct EvSimEvr));
+  s->w.base = base;
+  s->w.shadow = shadow;
+  s->w.size = size;
+  s->w.read_ns = EVSIM_DEFAULT_READ_NS;
+  s->w.write_ns = EVSIM_DEFAULT_WRITE_NS;
+  s->w.read = EvSimEvrRead;
+  s->w.write = EvSimEvrWrite;
+  s->w.arg = s;
+  clock_gettime(CLOCK_MONOTONIC, &s->epoch);
+
+  r->FPGAVersion = be32_to_cpu(EVSIM_FPGAVERSION_EVR);
+  r->UsecDiv = be32_to_cpu(125);
+  r->TxDataBufControl = be32_to_cpu(1 << C_EVR_TXDATABUF_COMPLETE);
+  r->TxSegBufControl = be32_to_cpu(1 << C_EVR_TXDATABUF_COMPLETE);
+}
+
+/** @private */
+static void EvSimClose(struct EvSimDevice *dev)
+{
+  int i;
+
+  for (i = 0; i < dev->evrs; i++)
+    MmioTrapUnregister(&dev->evr[i].w);
+  if (dev->evg)
+    {
+      MmioTrapUnregister(&dev->evg->w);
+      MmioTrapUnregister(&dev->fct);
+      free(dev->evg);
+    }
+  if (dev->base != MAP_FAILED)
+    munmap((void *) dev->base, dev->size);
+  if (dev->shadow != MAP_FAILED)
+    munmap(dev->shadow, dev->size);
+  if (dev->fd >= 0)
+    close(dev->fd);
+  free(dev);
+}
+
+/** @private */
+static struct EvSimDevice *EvSimCreate(char *name, int size)
+{
+  struct EvSimDevice *dev;
+  int i;
+
+  dev = calloc(1, sizeof(struct EvSimDevice));
+  if (!dev)
+    return NULL;
+  dev->size = size;
+  dev->base = MAP_FAILED;
+  dev->shadow = MAP_FAILED;
+
+  dev->fd = memfd_create(name, MFD_CLOEXEC);
+  if (dev->fd < 0 || ftruncate(dev->fd, size))
+    {
+      EvSimClose(dev);
+      return NULL;
+    }
+  dev->base = (volatile char *) mmap(0, size, PROT_READ | PROT_WRITE,
+				     MAP_SHARED, dev->fd, 0);
+  dev->shadow = (char *) mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			      dev->fd, 0);
+  if (dev->base == MAP_FAILED || dev->shadow == MAP_FAILED)
+    {
+      EvSimClose(dev);
+      return NULL;
+    }
+
+  pthread_mutex_lock(&EvSimTable);
+  for (i = 0; i < EVSIM_MAX_DEVICES; i++)
+    if (!EvSimDev[i])
+      {
+	EvSimDev[i] = dev;
+	break;
+      }
+  pthread_mutex_unlock(&EvSimTable);
+  if (i == EVSIM_MAX_DEVICES)
+    {
+      EvSimClose(dev);
+      errno = ENFILE;
+      return NULL;
+    }
+
+  return dev;
+}
+
+/** @private */
+static struct EvSimDevice *EvSimFind(int fd)
+{
+  int i;
+
+  for (i = 0; i < EVSIM_MAX_DEVICES; i++)
+    if (EvSimDev[i] && EvSimDev[i]->fd == fd)
+      return EvSimDev[i];
+
+  return NULL;
+}
+
+/** @private */
+static int EvSimRemove(int fd)
+{
+  struct EvSimDevice *dev = NULL;
+  int i;
+
+  pthread_mutex_lock(&EvSimTable);
+  for (i = 0; i < EVSIM_MAX_DEVICES; i++)
+    if (EvSimDev[i] && EvSimDev[i]->fd == fd)
+      {
+	dev = EvSimDev[i];
+	EvSimDev[i] = NULL;
+	break;
+      }
+  pthread_mutex_unlock(&EvSimTable);
+
+  if (!dev)
+    return -1;
+  EvSimClose(dev);
+
+  return 0;
+}
+
+/**
+Open simulated Event Receiver.
+
+@param pEr Pointer to MrfErRegs pointer, set to point to simulated
+registers
+@param name Name of simulated device, only used for debugging
+@return Returns file descriptor of simulated device, -1 on error.
+*/
+int EvrSimOpen(struct MrfErRegs **pEr, char *name)
+{
+  struct EvSimDevice *dev;
+
+  dev = EvSimCreate(name, EVR_CPCI300TG_MEM_WINDOW);
+  if (!dev)
+    return -1;
+
+  EvSimEvrInit(&dev->evr[0], dev->base, dev->shadow, dev->size);
+  dev->evrs = 1;
+  if (MmioTrapRegister(&dev->evr[0].w))
+    {
+      dev->evrs = 0;
+      EvSimRemove(dev->fd);
+      return -1;
+    }
+
+#ifdef DEBUG
+  DEBUG_PRINTF("EvrSimOpen: %s fd %d regs %p\n", name, dev->fd, dev->base);
+#endif
+
+  *pEr = (struct MrfErRegs *) dev->base;
+  return dev->fd;
+}
+
+/**
+Close simulated Event Receiver.
+
+@param fd File descriptor returned by EvrSimOpen()
+@return Returns 0 on success, -1 on error.
+*/
+int EvrSimClose(int fd)
+{
+  return EvSimRemove(fd);
+}
+
+/**
+Open simulated Event Generator. The downstream and upstream Event
+Receivers of an Event Master at offsets 0x20000 and 0x30000 are
+simulated too, the fan-out registers are plain memory.
+
+@param pEg Pointer to MrfEgRegs pointer, set to point to simulated
+registers
+@param name Name of simulated device, only used for debugging
+@return Returns file descriptor of simulated device, -1 on error.
+*/
+int EvgSimOpen(struct MrfEgRegs **pEg, char *name)
+{
+  struct EvSimDevice *dev;
+  struct EvSimEvg *s;
+  volatile struct MrfEgRegs *r;
+  int i, err;
+
+  dev = EvSimCreate(name, EVG_MEM_WINDOW);
+  if (!dev)
+    return -1;
+
+  s = calloc(1, sizeof(struct EvSimEvg));
+  if (!s)
+    {
+      EvSimRemove(dev->fd);
+      return -1;
+    }
+  dev->evg = s;
+  s->w.base = dev->base;
+  s->w.shadow = dev->shadow;
+  s->w.size = EVSIM_EVR_WINDOW;
+  s->w.read_ns = EVSIM_DEFAULT_READ_NS;
+  s->w.write_ns = EVSIM_DEFAULT_WRITE_NS;
+  s->w.read = EvSimEvgRead;
+  s->w.write = EvSimEvgWrite;
+  s->w.arg = s;
+  r = (volatile struct MrfEgRegs *) dev->shadow;
+  r->FPGAVersion = be32_to_cpu(EVSIM_FPGAVERSION_EVG);
+  r->UsecDiv = be32_to_cpu(125);
+  r->DataBufControl = be32_to_cpu(1 << C_EVG_DATABUF_COMPLETE);
+  r->SegBufControl = be32_to_cpu(1 << C_EVG_DATABUF_COMPLETE);
+
+  dev->fct = s->w;
+  dev->fct.base += offsetof(struct MrfEgRegs, Fct);
+  dev->fct.shadow += offsetof(struct MrfEgRegs, Fct);
+  dev->fct.read = NULL;
+  dev->fct.write = NULL;
+  dev->fct.arg = NULL;
+
+  EvSimEvrInit(&dev->evr[0], dev->base + offsetof(struct MrfEgRegs, EvrD),
+	       dev->shadow + offsetof(struct MrfEgRegs, EvrD),
+	       EVSIM_EVR_WINDOW);
+  EvSimEvrInit(&dev->evr[1], dev->base + offsetof(struct MrfEgRegs, EvrU),
+	       dev->shadow + offsetof(struct MrfEgRegs, EvrU),
+	       EVSIM_EVR_WINDOW);
+
+  err = MmioTrapRegister(&s->w);
+  if (!err)
+    err = MmioTrapRegister(&dev->fct);
+  for (i = 0; i < 2 && !err; i++)
+    {
+      err = MmioTrapRegister(&dev->evr[i].w);
+      if (!err)
+	dev->evrs++;
+    }
+  if (err)
+    {
+      EvSimRemove(dev->fd);
+      return -1;
+    }
+
+  *pEg = (struct MrfEgRegs *) dev->base;
+  return dev->fd;
+}
+
+/**
+Close simulated Event Generator.
+
+@param fd File descriptor returned by EvgSimOpen()
+@return Returns 0 on success, -1 on error.
+*/
+int EvgSimClose(int fd)
+{
+  return EvSimRemove(fd);
+}
+
+/**
+Set modeled duration of simulated register accesses, see
+MmioTrapGetTime().
+
+@param fd File descriptor of simulated device
+@param read_ns Duration of register read in ns
+@param write_ns Duration of register write in ns
+@return Returns 0 on success, -1 on error.
+*/
+int EvSimSetLatency(int fd, int read_ns, int write_ns)
+{
+  struct EvSimDevice *dev = EvSimFind(fd);
+  int i;
+
+  if (!dev || read_ns < 0 || write_ns < 0)
+    return -1;
+
+  MmioTrapLock();
+  for (i = 0; i < dev->evrs; i++)
+    {
+      dev->evr[i].w.read_ns = read_ns;
+      dev->evr[i].w.write_ns = write_ns;
+    }
+  if (dev->evg)
+    {
+      dev->evg->w.read_ns = dev->fct.read_ns = read_ns;
+      dev->evg->w.write_ns = dev->fct.write_ns = write_ns;
+    }
+  MmioTrapUnlock();
+
+  return 0;
+}
+
+/**
+Inject received event into simulated Event Receiver. The event is
+handled according to the enabled mapping RAM. For a simulated Event
+Generator the event goes to the downstream Event Receiver.
+
+@param fd File descriptor of simulated device
+@param code Event code 0 to 255
+@param seconds Seconds part of timestamp, -1 to use counters
+@param timestamp Timestamp counter value
+@return Returns 0 on success, -1 on error.
+*/
+int EvrSimInjectEvent(int fd, int code, int seconds, int timestamp)
+{
+  struct EvSimDevice *dev = EvSimFind(fd);
+
+  if (!dev || !dev->evrs || code < 0 || code > EVR_MAX_EVENT_CODE)
+    return -1;
+
+  MmioTrapLock();
+  EvSimEvrEvent(&dev->evr[0], code, seconds, timestamp);
+  MmioTrapUnlock();
+
+  return 0;
+}
+
+/**
+Complete data buffer reception in simulated Event Receiver.
+
+@param fd File descriptor of simulated device
+@param dbuf Received data
+@param size Size of data in bytes, multiple of four
+@return Returns size on success, -1 if reception is not enabled or on
+error.
+*/
+int EvrSimReceiveDBuf(int fd, char *dbuf, int size)
+{
+  struct EvSimDevice *dev = EvSimFind(fd);
+  struct EvSimEvr *s;
+  volatile struct MrfErRegs *r;
+  u32 mask = (1 << (C_EVR_DATABUF_SIZEHIGH + 1)) - 1;
+  int result = -1;
+
+  if (!dev || !dev->evrs || size & 3 || size < 4 || size > EVR_MAX_BUFFER)
+    return -1;
+
+  s = &dev->evr[0];
+  r = (volatile struct MrfErRegs *) s->w.shadow;
+  MmioTrapLock();
+  if (s->dbuf & (1 << C_EVR_DATABUF_RECEIVING))
+    {
+      memcpy((void *) &r->Databuf[0], dbuf, size);
+      s->dbuf = (1 << C_EVR_DATABUF_RXREADY) | (size & mask);
+      r->DataBufControl = be32_to_cpu((be32_to_cpu(r->DataBufControl) &
+				       ~0xffff) | (1 << C_EVR_DATABUF_MODE) |
+				      s->dbuf);
+      r->IrqFlag |= be32_to_cpu(1 << C_EVR_IRQFLAG_DATABUF);
+      result = size;
+    }
+  MmioTrapUnlock();
+
+  return result;
+}
+
+/**
+Receive segmented data buffer in simulated Event Receiver.
+
+@param fd File descriptor of simulated device
+@param segment First segment 0 to 255
+@param dbuf Received data
+@param size Size of data in bytes
+@return Returns size on success, -1 on error.
+*/
+int EvrSimReceiveSegBuf(int fd, int segment, char *dbuf, int size)
+{
+  struct EvSimDevice *dev = EvSimFind(fd);
+  volatile struct MrfErRegs *r;
+  u32 bit;
+
+  if (!dev || !dev->evrs || segment < 0 || segment > 255 || size < 0 ||
+      size > EVR_MAX_BUFFER || segment * 16 + size > sizeof(r->SegBuf))
+    return -1;
+
+  r = (volatile struct MrfErRegs *) dev->evr[0].w.shadow;
+  bit = 0x80000000 >> (segment % 32);
+  MmioTrapLock();
+  memcpy((void *) &r->SegBuf[segment * 4], dbuf, size);
+  r->SegBufSize[segment] = be32_to_cpu(size);
+  if (be32_to_cpu(r->SegRXReg[segment / 32]) & bit)
+    r->SegOVReg[segment / 32] |= be32_to_cpu(bit);
+  r->SegRXReg[segment / 32] |= be32_to_cpu(bit);
+  r->IrqFlag |= be32_to_cpu(1 << C_EVR_IRQFLAG_SEGBUF);
+  MmioTrapUnlock();
+
+  return size;
+}
+
+/**
+Inject event into event analyzer of simulated Event Generator.
+
+@param fd File descriptor of simulated device
+@param code Event code
+@param dbus Distributed bus bits
+@param timeh Timestamp high word
+@param timel Timestamp low word
+@return Returns 0 on success, -1 if analyzer disabled, full or on
+error.
+*/
+int EvgSimInjectEvan(int fd, int code, int dbus, u32 timeh, u32 timel)
+{
+  struct EvSimDevice *dev = EvSimFind(fd);
+  struct EvSimEvg *s;
+  volatile struct MrfEgRegs *r;
+  int tail, result = -1;
+
+  if (!dev || !dev->evg)
+    return -1;
+
+  s = dev->evg;
+  r = (volatile struct MrfEgRegs *) s->w.shadow;
+  MmioTrapLock();
+  if (r->EvanControl & be32_to_cpu(1 << C_EVG_EVANCTRL_ENABLE))
+    {
+      if (s->count < EVSIM_EVAN_DEPTH)
+	{
+	  tail = (s->head + s->count) % EVSIM_EVAN_DEPTH;
+	  s->fifo[tail].EventCode = (code & 0xff) | ((dbus & 0xff) << 8);
+	  s->fifo[tail].TimestampHigh = timeh;
+	  s->fifo[tail].TimestampLow = timel;
+	  s->count++;
+	  r->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_NOTEMPTY);
+	  result = 0;
+	}
+      else
+	{
+	  s->overflow = 1;
+	  r->EvanControl |= be32_to_cpu(1 << C_EVG_EVANCTRL_OVERFLOW);
+	}
+    }
+  MmioTrapUnlock();
+
+  return result;
+}
@@ -0,0 +1,38 @@
+/*
+  evsim.h -- Simulated Micro-Research Event Receiver and
+             Event Generator for testing without hardware
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+
+  Simulated devices are opened while the process has one thread and are
+  only accessed by that thread, see mmiotrap.h. Register accesses are
+  not delayed; the latency set with EvSimSetLatency() is accounted as
+  modeled time, see MmioTrapGetTime().
+ */
+
+struct MrfErRegs;
+struct MrfEgRegs;
+
+#define EVSIM_MAX_DEVICES       8
+#define EVSIM_FIFO_DEPTH        511
+#define EVSIM_EVAN_DEPTH        511
+#define EVSIM_DEFAULT_READ_NS   1000
+#define EVSIM_DEFAULT_WRITE_NS  100
+#define EVSIM_SWEVENT_NS        1000
+#define EVSIM_FPGAVERSION_EVR   0x11000207
+#define EVSIM_FPGAVERSION_EVG   0x21000207
+
+int EvrSimOpen(struct MrfErRegs **pEr, char *name);
+int EvrSimClose(int fd);
+int EvgSimOpen(struct MrfEgRegs **pEg, char *name);
+int EvgSimClose(int fd);
+int EvSimSetLatency(int fd, int read_ns, int write_ns);
+int EvrSimInjectEvent(int fd, int code, int seconds, int timestamp);
+int EvrSimReceiveDBuf(int fd, char *dbuf, int size);
+int EvrSimReceiveSegBuf(int fd, int segment, char *dbuf, int size);
+int EvgSimInjectEvan(int fd, int code, int dbus, u32 timeh, u32 timel);
@@ -0,0 +1,363 @@
+/**
+@file fcttopo.c
+@brief Distribution topology and delay compensation scanner for
+       Micro-Research Fan-Out/Concentrators and Event Receivers.
+
+Builds the timing distribution tree from topology IDs and computes the
+delay from the root to every node, see fcttopo.h.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "erapi.h"
+#include "fctapi.h"
+#include "mrfmmio.h"
+#include "fcttopo.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/** @private */
+static double FctTopoNs(const struct FctTopo *topo, double dc)
+{
+  return dc / (topo->reffreq * 65.536);
+}
+
+/** @private */
+static struct FctTopoNode *FctTopoAdd(struct FctTopo *topo, int type,
+				      const char *name)
+{
+  struct FctTopoNode *node;
+
+  if (topo->n >= FCTTOPO_MAX_NODES)
+    return NULL;
+
+  node = &topo->node[topo->n++];
+  memset(node, 0, sizeof(struct FctTopoNode));
+  node->type = type;
+  node->parent = -1;
+  if (name)
+    strncpy(node->name, name, FCTTOPO_NAME_LEN - 1);
+  else
+    snprintf(node->name, FCTTOPO_NAME_LEN, "%s%d",
+	     type == FCTTOPO_FCT ? "fct" : "evr", topo->n - 1);
+
+  return node;
+}
+
+/**
+Initialize empty topology.
+
+@param topo Topology
+@param reffreq Event clock frequency in MHz
+*/
+void FctTopoInit(struct FctTopo *topo, double reffreq)
+{
+  memset(topo, 0, sizeof(struct FctTopo));
+  topo->reffreq = reffreq;
+}
+
+/**
+Add Fan-Out/Concentrator to topology. The registers are read by
+FctTopoScan().
+
+@param topo Topology
+@param pFct Pointer to MrfFctRegs structure
+@param name Name shown in dump, NULL for default
+@return Returns node index, -1 if topology is full.
+*/
+int FctTopoAddFct(struct FctTopo *topo, volatile struct MrfFctRegs *pFct,
+		  const char *name)
+{
+  struct FctTopoNode *node;
+
+  node = FctTopoAdd(topo, FCTTOPO_FCT, name);
+  if (node == NULL)
+    return -1;
+  node->pFct = pFct;
+
+  return topo->n - 1;
+}
+
+/**
+Add Event Receiver to topology. The registers are read by
+FctTopoScan().
+
+@param topo Topology
+@param pEr Pointer to MrfErRegs structure
+@param name Name shown in dump, NULL for default
+@return Returns node index, -1 if topology is full.
+*/
+int FctTopoAddEvr(struct FctTopo *topo, volatile struct MrfErRegs *pEr,
+		  const char *name)
+{
+  struct FctTopoNode *node;
+
+  node = FctTopoAdd(topo, FCTTOPO_EVR, name);
+  if (node == NULL)
+    return -1;
+  node->pEr = pEr;
+
+  return topo->n - 1;
+}
+
+/** @private */
+static void FctTopoReadFctDC(struct FctTopoNode *node)
+{
+  node->up_dc = be32_to_cpu(node->pFct->UpDCValue);
+  node->fifo_dc = be32_to_cpu(node->pFct->FIFODCValue);
+  node->int_dc = be32_to_cpu(node->pFct->IntDCValue);
+}
+
+/** @private */
+static void FctTopoReadEvrDC(struct FctTopoNode *node)
+{
+  node->dc_path = EvrGetDCPathValue(node->pEr);
+  node->dc_int = EvrGetDCIntDelay(node->pEr);
+}
+
+/** @private Link nodes by topology ID and set depths */
+static void FctTopoLink(struct FctTopo *topo)
+{
+  struct FctTopoNode *node;
+  int i, j, p, depth;
+
+  for (i = 0; i < topo->n; i++)
+    {
+      node = &topo->node[i];
+      node->parent = -1;
+      node->port = 0;
+      /* Internal Event Receiver of an EVM */
+      if (node->type == FCTTOPO_EVR)
+	for (j = 0; j < topo->n; j++)
+	  if (topo->node[j].type == FCTTOPO_FCT &&
+	      topo->node[j].id == node->id)
+	    {
+	      node->parent = j;
+	      break;
+	    }
+      if (node->parent >= 0 || !FCTTOPO_PORT(node->id))
+	continue;
+      for (j = 0; j < topo->n; j++)
+	if (j != i && topo->node[j].type == FCTTOPO_FCT &&
+	    topo->node[j].id == FCTTOPO_PARENT_ID(node->id))
+	  {
+	    node->parent = j;
+	    node->port = FCTTOPO_PORT(node->id);
+	    break;
+	  }
+    }
+
+  /* Walk to root, a loop from bogus IDs ends at the node count */
+  for (i = 0; i < topo->n; i++)
+    {
+      depth = 0;
+      for (p = topo->node[i].parent; p >= 0 && depth < topo->n;
+	   p = topo->node[p].parent)
+	depth++;
+      topo->node[i].depth = depth;
+    }
+}
+
+/** @private Compute delays from root, parents before children */
+static void FctTopoCompute(struct FctTopo *topo)
+{
+  struct FctTopoNode *node, *parent;
+  double dc;
+  int i, depth, maxdepth = 0;
+
+  for (i = 0; i < topo->n; i++)
+    if (topo->node[i].depth > maxdepth)
+      maxdepth = topo->node[i].depth;
+
+  for (depth = 0; depth <= maxdepth; depth++)
+    for (i = 0; i < topo->n; i++)
+      {
+	node = &topo->node[i];
+	if (node->depth != depth)
+	  continue;
+	if (node->type == FCTTOPO_EVR)
+	  node->evr_ns = FctTopoNs(topo, node->dc_path);
+	if (node->parent < 0 || depth >= topo->n)
+	  {
+	    node->delay_ns = 0.0;
+	    /* Parent not scanned unless the ID names a root */
+	    node->valid = (node->parent < 0 && !FCTTOPO_PORT(node->id));
+	    continue;
+	  }
+	parent = &topo->node[node->parent];
+	node->valid = parent->valid;
+	dc = 0.0;
+	if (node->port)
+	  {
+	    if (!parent->port_status[node->port - 1])
+	      node->valid = 0;
+	    dc = parent->int_dc + parent->port_dc[node->port - 1] / 2.0;
+	  }
+	node->delay_ns = parent->delay_ns + FctTopoNs(topo, dc);
+      }
+}
+
+/**
+Read all nodes, build tree and compute delays.
+
+@param topo Topology
+@return Returns number of nodes.
+*/
+int FctTopoScan(struct FctTopo *topo)
+{
+  struct FctTopoNode *node;
+  u32 buf[FCTTOPO_PORTS];
+  int i, j;
+
+  for (i = 0; i < topo->n; i++)
+    {
+      node = &topo->node[i];
+      if (node->type == FCTTOPO_FCT)
+	{
+	  node->status = be32_to_cpu(node->pFct->Status);
+	  node->id = be32_to_cpu(node->pFct->TopologyID);
+	  FctTopoReadFctDC(node);
+	  MrfMmioRead(buf, node->pFct->PortDCValue, sizeof(buf));
+	  for (j = 0; j < FCTTOPO_PORTS; j++)
+	    node->port_dc[j] = be32_to_cpu(buf[j]);
+	  MrfMmioRead(buf, node->pFct->PortDCStatus, sizeof(buf));
+	  for (j = 0; j < FCTTOPO_PORTS; j++)
+	    node->port_status[j] = be32_to_cpu(buf[j]);
+	}
+      else
+	{
+	  node->id = EvrGetTopologyID(node->pEr);
+	  node->dc_status = EvrGetDCStatus(node->pEr);
+	  FctTopoReadEvrDC(node);
+	}
+    }
+
+  FctTopoLink(topo);
+  FctTopoCompute(topo);
+
+  return topo->n;
+}
+
+/**
+Refresh topology after FctTopoScan(). Reads the status registers and
+topology IDs of all nodes and the delay values only of ports and nodes
+whose status or ID changed. The tree is linked again only if an ID
+changed.
+
+@param topo Topology
+@return Returns number of ports and nodes read again, 0 if nothing
+changed.
+*/
+int FctTopoRefresh(struct FctTopo *topo)
+{
+  struct FctTopoNode *node;
+  u32 buf[FCTTOPO_PORTS];
+  u32 status, id, mask, dc_status;
+  int i, j, changed = 0, relink = 0;
+
+  for (i = 0; i < topo->n; i++)
+    {
+      node = &topo->node[i];
+      if (node->type == FCTTOPO_FCT)
+	{
+	  status = be32_to_cpu(node->pFct->Status);
+	  id = be32_to_cpu(node->pFct->TopologyID);
+	  MrfMmioRead(buf, node->pFct->PortDCStatus, sizeof(buf));
+	  if (status != node->status || id != node->id)
+	    {
+	      FctTopoReadFctDC(node);
+	      changed++;
+	    }
+	  for (j = 0; j < FCTTOPO_PORTS; j++)
+	    {
+	      buf[j] = be32_to_cpu(buf[j]);
+	      mask = 0;
+	      if (j < FCTTOPO_STATUS_PORTS)
+		mask = (1 << (C_FCT_STATUS_LINK1 + j)) |
+		  (1 << (C_FCT_STATUS_VIO1 + j));
+	      if (buf[j] == node->port_status[j] &&
+		  !((status ^ node->status) & mask))
+		continue;
+	      node->port_status[j] = buf[j];
+	      node->port_dc[j] = be32_to_cpu(node->pFct->PortDCValue[j]);
+	      topo->port_rereads++;
+	      changed++;
+	    }
+	  node->status = status;
+	}
+      else
+	{
+	  id = EvrGetTopologyID(node->pEr);
+	  dc_status = EvrGetDCStatus(node->pEr);
+	  if (dc_status != node->dc_status || id != node->id)
+	    {
+	      node->dc_status = dc_status;
+	      FctTopoReadEvrDC(node);
+	      changed++;
+	    }
+	}
+      if (id != node->id)
+	{
+	  node->id = id;
+	  relink = 1;
+	}
+    }
+
+#ifdef DEBUG
+  DEBUG_PRINTF("FctTopoRefresh: %d changed, relink %d\n", changed, relink);
+#endif
+  if (relink)
+    FctTopoLink(topo);
+  if (changed)
+    FctTopoCompute(topo);
+
+  return changed;
+}
+
+/** @private */
+static void FctTopoDumpNode(struct FctTopo *topo, int i)
+{
+  struct FctTopoNode *node = &topo->node[i];
+  int j;
+
+  printf("%*s", 2 * node->depth, "");
+  if (node->port)
+    printf("[%d] ", node->port);
+  printf("%s ID %08x", node->name, node->id);
+  if (node->valid)
+    printf(" delay %3.6f ns", node->delay_ns);
+  else
+    printf(" delay not valid");
+  if (node->type == FCTTOPO_EVR)
+    printf(" EVR DC %3.6f ns status %d", node->evr_ns, node->dc_status);
+  printf("\n");
+
+  /* Children of a bogus loop are not visited */
+  for (j = 0; j < topo->n; j++)
+    if (topo->node[j].parent == i &&
+	topo->node[j].depth == node->depth + 1)
+      FctTopoDumpNode(topo, j);
+}
+
+/**
+Print distribution tree with delays.
+
+@param topo Topology
+*/
+void FctTopoDump(struct FctTopo *topo)
+{
+  int i;
+
+  for (i = 0; i < topo->n; i++)
+    if (topo->node[i].parent < 0)
+      FctTopoDumpNode(topo, i);
+}
@@ -0,0 +1,86 @@
+/*
+  fcttopo.h -- Micro-Research Event System distribution topology and
+               delay compensation scanner
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and fctapi.h before this file.
+
+  The scanner reads the Fan-Out/Concentrators and Event Receivers
+  added to it, builds the distribution tree from their topology IDs and
+  computes the delay from the root of the tree to every node.
+
+  Every fan-out level shifts the topology ID of its upstream node by
+  four bits and adds the number of its port (1 to 15), so the parent of
+  a node is ID >> 4 and the port it is connected to ID & 0xf. Event
+  Receivers with the same ID as a Fan-Out/Concentrator are the
+  internal Event Receivers of that EVM.
+
+  Delays are in delay compensation units of 1/65536 event clock cycles
+  and converted to ns with the reference frequency. A node connected
+  to port p of a Fan-Out/Concentrator is delayed from it by its
+  internal datapath delay (IntDCValue) and half the loop delay of the
+  port (PortDCValue[p-1]). The delay an Event Receiver measures itself
+  (EvrGetDCPathValue()) is kept beside the computed one for comparison.
+
+  FctTopoRefresh() reads only the status registers and re-reads the
+  delay values of ports and Event Receivers whose status or topology ID
+  changed.
+ */
+
+#define FCTTOPO_MAX_NODES    64
+#define FCTTOPO_NAME_LEN     32
+#define FCTTOPO_PORTS        16
+#define FCTTOPO_STATUS_PORTS 12     /* Ports with LINK and VIO bits */
+
+#define FCTTOPO_FCT          0
+#define FCTTOPO_EVR          1
+
+#define FCTTOPO_PARENT_ID(id) ((id) >> 4)
+#define FCTTOPO_PORT(id)      ((id) & 0x0f)
+
+struct FctTopoNode {
+  int                         type;
+  char                        name[FCTTOPO_NAME_LEN];
+  volatile struct MrfFctRegs *pFct;
+  volatile struct MrfErRegs  *pEr;
+  u32                         id;
+  int                         parent;   /* Node index, -1 for root */
+  int                         port;     /* Port of parent, 0 internal */
+  int                         depth;
+  int                         valid;    /* Path to root known, all
+						   ports on it have DC */
+  /* Fan-Out/Concentrator */
+  u32                         status;
+  u32                         up_dc;
+  u32                         fifo_dc;
+  u32                         int_dc;
+  u32                         port_dc[FCTTOPO_PORTS];
+  u32                         port_status[FCTTOPO_PORTS];
+  /* Event Receiver */
+  u32                         dc_status;
+  u32                         dc_path;
+  u32                         dc_int;   /* Internal, see EvrGetDCDelay() */
+  /* Results */
+  double                      delay_ns; /* Computed from root */
+  double                      evr_ns;   /* Measured by Event Receiver */
+};
+
+struct FctTopo {
+  double             reffreq;           /* Event clock in MHz */
+  int                n;
+  struct FctTopoNode node[FCTTOPO_MAX_NODES];
+  unsigned long long port_rereads;      /* Ports read again on change */
+};
+
+void FctTopoInit(struct FctTopo *topo, double reffreq);
+int FctTopoAddFct(struct FctTopo *topo, volatile struct MrfFctRegs *pFct,
+		  const char *name);
+int FctTopoAddEvr(struct FctTopo *topo, volatile struct MrfErRegs *pEr,
+		  const char *name);
+int FctTopoScan(struct FctTopo *topo);
+int FctTopoRefresh(struct FctTopo *topo);
+void FctTopoDump(struct FctTopo *topo);
@@ -0,0 +1,374 @@
+/**
+@file irqstat.c
+@brief Interrupt latency and coalescing statistics for Micro-Research
+       Event Receiver and Event Generator interrupt handling.
+
+The IrqStat functions wrap the interrupt handling path
+EvrGetIrqFlags()/EvrClearIrqFlags()/EvrIrqHandled() and the EVG
+equivalents. Reading the flags marks the wake-up: the wake-up is
+timestamped with CLOCK_MONOTONIC and with the timestamp counter of an
+EVR used as time base, and the number of flags seen set is recorded to
+measure interrupt coalescing. IrqStatHandlerStart()/IrqStatHandlerEnd()
+measure per flag latency from wake-up to handler and handler run time,
+re-arming the interrupt closes the service time of the wake-up.
+
+Latency from the hardware event to the wake-up is recorded with
+IrqStatRecordHwTime() using the seconds and timestamp latched by the
+hardware, e.g. the FIFO entry returned by EvrGetFIFOEvent().
+
+Statistics are updated by the servicing thread only. Other threads read
+a consistent copy with IrqStatSnapshot().
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "irqstat.h"
+
+/** @private */
+static unsigned long long IrqStatNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** @private */
+static void IrqStatHistAdd(struct IrqStatHist *h, unsigned long long ns)
+{
+  int b = 0;
+
+  while (ns >> b && b < IRQSTAT_BUCKETS - 1)
+    b++;
+  h->bucket[b]++;
+  if (!h->count || ns < h->min)
+    h->min = ns;
+  if (ns > h->max)
+    h->max = ns;
+  h->sum += ns;
+  h->count++;
+}
+
+/** @private */
+static void IrqStatBegin(struct IrqStat *st)
+{
+  st->seq++;
+  __sync_synchronize();
+}
+
+/** @private */
+static void IrqStatCommit(struct IrqStat *st)
+{
+  __sync_synchronize();
+  st->seq++;
+}
+
+/**
+Initialize statistics.
+
+@param st Pointer to IrqStat structure
+*/
+void IrqStatInit(struct IrqStat *st)
+{
+  memset(st, 0, sizeof(struct IrqStat));
+}
+
+/**
+Select Event Receiver whose timestamp counter is used to timestamp
+wake-ups.
+
+@param st Pointer to IrqStat structure
+@param pEr Pointer to MrfErRegs structure, NULL to disable hardware
+timestamping.
+@param tick_ns Timestamp counter period in ns, e.g. 1000.0/124.9135 when
+the counter runs on the event clock.
+*/
+void IrqStatSetTimebase(struct IrqStat *st, volatile struct MrfErRegs *pEr,
+			double tick_ns)
+{
+  st->pTb = pEr;
+  st->tick_ns = tick_ns;
+}
+
+/**
+Clear all statistics. Time base setting is retained.
+
+@param st Pointer to IrqStat structure
+*/
+void IrqStatReset(struct IrqStat *st)
+{
+  IrqStatBegin(st);
+  memset(&st->s, 0, sizeof(struct IrqStatSnapshot));
+  IrqStatCommit(st);
+}
+
+/** @private */
+static void IrqStatWakeup(struct IrqStat *st, u32 flags)
+{
+  u32 sec;
+  int bit, n = 0;
+
+  st->wake_ns = IrqStatNow();
+  if (st->pTb)
+    {
+      /* Make sure seconds and counter belong together */
+      do
+	{
+	  sec = be32_to_cpu(st->pTb->SecondsCounter);
+	  st->wake_ts = be32_to_cpu(st->pTb->TimestampEventCounter);
+	  st->wake_sec = be32_to_cpu(st->pTb->SecondsCounter);
+	}
+      while (sec != st->wake_sec);
+    }
+
+  IrqStatBegin(st);
+  st->s.wakeups++;
+  for (bit = 0; bit < IRQSTAT_FLAGS; bit++)
+    if (flags & (1U << bit))
+      {
+	st->s.flagcount[bit]++;
+	n++;
+      }
+  st->s.coalesce[n]++;
+  if (!n)
+    st->s.spurious++;
+  IrqStatCommit(st);
+}
+
+/**
+Read EVR interrupt flags and record wake-up.
+
+@param st Pointer to IrqStat structure
+@param pEr Pointer to MrfErRegs structure
+@return Returns interrupt flags, see EvrGetIrqFlags().
+*/
+int IrqStatEvrGetIrqFlags(struct IrqStat *st, volatile struct MrfErRegs *pEr)
+{
+  int flags = EvrGetIrqFlags(pEr);
+
+  IrqStatWakeup(st, flags);
+  return flags;
+}
+
+/**
+Clear EVR interrupt flags.
+
+@param st Pointer to IrqStat structure
+@param pEr Pointer to MrfErRegs structure
+@param mask Flags to clear
+@return Returns interrupt flags after clearing, see EvrClearIrqFlags().
+*/
+int IrqStatEvrClearIrqFlags(struct IrqStat *st,
+			    volatile struct MrfErRegs *pEr, int mask)
+{
+  return EvrClearIrqFlags(pEr, mask);
+}
+
+/** @private */
+static void IrqStatRearm(struct IrqStat *st)
+{
+  unsigned long long now = IrqStatNow();
+
+  IrqStatBegin(st);
+  IrqStatHistAdd(&st->s.service, now - st->wake_ns);
+  IrqStatCommit(st);
+}
+
+/**
+Re-arm EVR interrupt and record service time of wake-up.
+
+@param st Pointer to IrqStat structure
+@param fd File descriptor of EVR device opened.
+*/
+void IrqStatEvrIrqHandled(struct IrqStat *st, int fd)
+{
+  EvrIrqHandled(fd);
+  IrqStatRearm(st);
+}
+
+/**
+Read EVG interrupt flags and record wake-up.
+
+@param st Pointer to IrqStat structure
+@param pEg Pointer to MrfEgRegs structure
+@return Returns interrupt flags, see EvgGetIrqFlags().
+*/
+int IrqStatEvgGetIrqFlags(struct IrqStat *st, volatile struct MrfEgRegs *pEg)
+{
+  int flags = EvgGetIrqFlags(pEg);
+
+  IrqStatWakeup(st, flags);
+  return flags;
+}
+
+/**
+Clear EVG interrupt flags.
+
+@param st Pointer to IrqStat structure
+@param pEg Pointer to MrfEgRegs structure
+@param mask Flags to clear
+@return Returns interrupt flags after clearing, see EvgClearIrqFlags().
+*/
+int IrqStatEvgClearIrqFlags(struct IrqStat *st,
+			    volatile struct MrfEgRegs *pEg, int mask)
+{
+  return EvgClearIrqFlags(pEg, mask);
+}
+
+/**
+Re-arm EVG interrupt and record service time of wake-up.
+
+@param st Pointer to IrqStat structure
+@param fd File descriptor of EVG device opened.
+*/
+void IrqStatEvgIrqHandled(struct IrqStat *st, int fd)
+{
+  EvgIrqHandled(fd);
+  IrqStatRearm(st);
+}
+
+/**
+Mark start of handler for flag. Records latency from wake-up.
+
+@param st Pointer to IrqStat structure
+@param flag Interrupt flag bit number
+*/
+void IrqStatHandlerStart(struct IrqStat *st, int flag)
+{
+  st->hstart_ns = IrqStatNow();
+  if (flag < 0 || flag >= IRQSTAT_FLAGS)
+    return;
+
+  IrqStatBegin(st);
+  IrqStatHistAdd(&st->s.flag[flag].latency, st->hstart_ns - st->wake_ns);
+  IrqStatCommit(st);
+}
+
+/**
+Mark end of handler for flag. Records handler run time.
+
+@param st Pointer to IrqStat structure
+@param flag Interrupt flag bit number
+*/
+void IrqStatHandlerEnd(struct IrqStat *st, int flag)
+{
+  unsigned long long now = IrqStatNow();
+
+  if (flag < 0 || flag >= IRQSTAT_FLAGS)
+    return;
+
+  IrqStatBegin(st);
+  IrqStatHistAdd(&st->s.flag[flag].duration, now - st->hstart_ns);
+  IrqStatCommit(st);
+}
+
+/**
+Record latency from hardware event to wake-up. Requires a time base set
+with IrqStatSetTimebase().
+
+@param st Pointer to IrqStat structure
+@param flag Interrupt flag bit number
+@param seconds Seconds value latched by hardware, e.g. FIFOEvent
+TimestampHigh
+@param timestamp Timestamp counter value latched by hardware, e.g.
+FIFOEvent TimestampLow
+
+The timestamp counter is assumed to be reset on every seconds
+boundary.
+*/
+void IrqStatRecordHwTime(struct IrqStat *st, int flag, u32 seconds,
+			 u32 timestamp)
+{
+  double ticks;
+
+  if (!st->pTb || st->tick_ns <= 0.0 || flag < 0 || flag >= IRQSTAT_FLAGS)
+    return;
+
+  ticks = (double) st->wake_ts - (double) timestamp;
+  if (st->wake_sec != seconds)
+    ticks += ((double) st->wake_sec - (double) seconds) * 1.0E9 / st->tick_ns;
+  if (ticks < 0)
+    return;
+
+  IrqStatBegin(st);
+  IrqStatHistAdd(&st->s.flag[flag].hwlatency,
+		 (unsigned long long) (ticks * st->tick_ns));
+  IrqStatCommit(st);
+}
+
+/**
+Take consistent copy of statistics. May be called from any thread.
+
+@param st Pointer to IrqStat structure
+@param snap Pointer to snapshot structure to fill in
+*/
+void IrqStatSnapshot(struct IrqStat *st, struct IrqStatSnapshot *snap)
+{
+  u32 seq;
+
+  do
+    {
+      while ((seq = st->seq) & 1)
+	;
+      __sync_synchronize();
+      memcpy(snap, &st->s, sizeof(struct IrqStatSnapshot));
+      __sync_synchronize();
+    }
+  while (seq != st->seq);
+}
+
+/** @private */
+static void IrqStatDumpHist(FILE *fp, const char *name, int flag,
+			    struct IrqStatHist *h)
+{
+  int b;
+
+  if (!h->count)
+    return;
+
+  fprintf(fp, "%s %d count %u min %llu avg %llu max %llu buckets",
+	  name, flag, h->count, h->min, h->sum / h->count, h->max);
+  for (b = 0; b < IRQSTAT_BUCKETS; b++)
+    fprintf(fp, " %u", h->bucket[b]);
+  fprintf(fp, "\n");
+}
+
+/**
+Write snapshot as text, one line per histogram. Times are in ns,
+bucket n counts samples below 2^n ns.
+
+@param snap Pointer to snapshot
+@param fp Output stream
+*/
+void IrqStatDump(struct IrqStatSnapshot *snap, FILE *fp)
+{
+  int i;
+
+  fprintf(fp, "wakeups %u spurious %u\n", snap->wakeups, snap->spurious);
+  fprintf(fp, "coalesce");
+  for (i = 0; i <= IRQSTAT_FLAGS; i++)
+    fprintf(fp, " %u", snap->coalesce[i]);
+  fprintf(fp, "\n");
+  IrqStatDumpHist(fp, "service", -1, &snap->service);
+  for (i = 0; i < IRQSTAT_FLAGS; i++)
+    {
+      if (!snap->flagcount[i])
+	continue;
+      fprintf(fp, "flag %d count %u\n", i, snap->flagcount[i]);
+      IrqStatDumpHist(fp, "latency", i, &snap->flag[i].latency);
+      IrqStatDumpHist(fp, "hwlatency", i, &snap->flag[i].hwlatency);
+      IrqStatDumpHist(fp, "duration", i, &snap->flag[i].duration);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+  irqstat.h -- Interrupt latency and coalescing statistics for
+               Micro-Research Event Receiver and Event Generator
+               interrupt handling
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+ */
+
+struct MrfErRegs;
+struct MrfEgRegs;
+
+#define IRQSTAT_FLAGS    32     /* Interrupt flag bits */
+#define IRQSTAT_BUCKETS  32     /* log2 histogram buckets */
+
+/*
+  Histogram bucket n counts samples in range [2^(n-1), 2^n - 1] ns,
+  bucket 0 counts zero samples and the last bucket everything above.
+ */
+struct IrqStatHist {
+  u32 count;
+  u32 bucket[IRQSTAT_BUCKETS];
+  unsigned long long sum;
+  unsigned long long min;
+  unsigned long long max;
+};
+
+struct IrqStatFlag {
+  struct IrqStatHist latency;     /* Wake-up to handler start */
+  struct IrqStatHist hwlatency;   /* Hardware timestamp to wake-up */
+  struct IrqStatHist duration;    /* Handler run time */
+};
+
+struct IrqStatSnapshot {
+  u32 wakeups;
+  u32 spurious;                   /* Wake-ups with no flags set */
+  u32 flagcount[IRQSTAT_FLAGS];   /* Times each flag was seen set */
+  u32 coalesce[IRQSTAT_FLAGS + 1];/* Histogram of flags per wake-up */
+  struct IrqStatHist service;     /* Wake-up to interrupt re-arm */
+  struct IrqStatFlag flag[IRQSTAT_FLAGS];
+};
+
+struct IrqStat {
+  volatile u32 seq;               /* Odd while an update is in progress */
+  volatile struct MrfErRegs *pTb; /* EVR used as time base or NULL */
+  double tick_ns;                 /* Time base event clock period */
+  unsigned long long wake_ns;     /* CLOCK_MONOTONIC at wake-up */
+  u32 wake_sec;                   /* Time base seconds at wake-up */
+  u32 wake_ts;                    /* Time base counter at wake-up */
+  unsigned long long hstart_ns;   /* Current handler start */
+  struct IrqStatSnapshot s;
+};
+
+void IrqStatInit(struct IrqStat *st);
+void IrqStatSetTimebase(struct IrqStat *st, volatile struct MrfErRegs *pEr,
+			double tick_ns);
+void IrqStatReset(struct IrqStat *st);
+int IrqStatEvrGetIrqFlags(struct IrqStat *st, volatile struct MrfErRegs *pEr);
+int IrqStatEvrClearIrqFlags(struct IrqStat *st,
+			    volatile struct MrfErRegs *pEr, int mask);
+void IrqStatEvrIrqHandled(struct IrqStat *st, int fd);
+int IrqStatEvgGetIrqFlags(struct IrqStat *st, volatile struct MrfEgRegs *pEg);
+int IrqStatEvgClearIrqFlags(struct IrqStat *st,
+			    volatile struct MrfEgRegs *pEg, int mask);
+void IrqStatEvgIrqHandled(struct IrqStat *st, int fd);
+void IrqStatHandlerStart(struct IrqStat *st, int flag);
+void IrqStatHandlerEnd(struct IrqStat *st, int flag);
+void IrqStatRecordHwTime(struct IrqStat *st, int flag, u32 seconds,
+			 u32 timestamp);
+void IrqStatSnapshot(struct IrqStat *st, struct IrqStatSnapshot *snap);
+void IrqStatDump(struct IrqStatSnapshot *snap, FILE *fp);
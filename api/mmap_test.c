@@ -16,6 +16,7 @@
 #include "egcpci.h"
 #include "egapi.h"
 #include "erapi.h"
+#include "mrfmmio.h"
 
 #define DEVICE "/dev/mrfevr3"
 
@@ -243,8 +244,8 @@ int main(int argc, char *argv[])
 		    
 		    do
 		      {
-			memcpy((void *) dst, (void *) &pEvr->Databuf[0], 32);
-			memcpy((void *) &pEvr->Databuf[0], (void *) dst, 32);
+			MrfMmioRead(dst, &pEvr->Databuf[0], 32);
+			MrfMmioWrite(&pEvr->Databuf[0], dst, 32);
 		      }
 		    while(1);
 		  }
@@ -254,7 +255,7 @@ int main(int argc, char *argv[])
 		    char dst[1024];
 		    
 		    pEvr->PCIIrqEnable = be32_to_cpu(EVR_IRQ_PCICORE_ENABLE | 0x80000000);
-		    memcpy((void *) dst, (void *) &pEvr->Databuf[0], 1024);
+		    MrfMmioRead(dst, &pEvr->Databuf[0], 1024);
 		  }
 		  break;
 		case 'y':
@@ -262,7 +263,7 @@ int main(int argc, char *argv[])
 		    char src[1024];
 		    
 		    pEvr->PCIIrqEnable = be32_to_cpu(EVR_IRQ_PCICORE_ENABLE | 0x80000000);
-		    memcpy((void *) &pEvr->Databuf[0], (void *) src, 1024);
+		    MrfMmioWrite(&pEvr->Databuf[0], src, 1024);
 		  }
 		  break;
 		case '0':
@@ -0,0 +1,491 @@
+/**
+@file mmiotrace.c
+@brief Register access accounting and tracing for the Micro-Research
+       Event System API.
+
+Counts the register reads and writes issued by every API function,
+their size and the wall time of the function, and optionally writes
+every access to a binary trace file.
+
+Register accesses are seen through the trap handler in mmiotrap.c. The
+windows of simulated devices are trapped already; a real device mapping
+is trapped with MmioTraceAttach(). Accesses are attributed to functions
+with the -finstrument-functions entry and exit hooks, enabled by
+building the API with
+
+  make MMIO_TRACE=1
+
+which defines MRF_MMIO_TRACE. Counts include the accesses of called
+functions. Trapping costs microseconds per access, so the wall times
+of a traced real device are only comparable with each other; the
+access counts are exact.
+
+@date 19.10.2026
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "erapi.h"
+#include "mmiotrap.h"
+#include "mmiotrace.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define MMIOTRACE_BUFFER  4096
+#define MMIOTRACE_NONE    0xffff
+
+#define MMIOTRACE_NOINST __attribute__((no_instrument_function))
+
+static struct MmioTraceFunction MmioTraceFn[MMIOTRACE_MAX_FUNCTIONS];
+static struct MmioTraceFunction MmioTraceOther;
+static pthread_mutex_t MmioTraceTable = PTHREAD_MUTEX_INITIALIZER;
+static volatile int MmioTraceActive = 0;
+static struct timespec MmioTraceStartTime;
+
+static struct MmioWindow *MmioTraceWindow[MMIOTRAP_MAX_WINDOWS];
+
+/* Binary trace, written with the trap lock held */
+static int MmioTraceFd = -1;
+static struct MmioTraceRecord MmioTraceBuf[MMIOTRACE_BUFFER];
+static int MmioTraceCount = 0;
+
+/* Call stack of the instrumented functions of this thread */
+static __thread struct {
+  int depth;
+  struct {
+    void           *fn;
+    int             index;        /* -1 if entered while not tracing */
+    struct timespec start;
+    unsigned long   reads, writes, rbytes, wbytes;
+    long long       access_ns;
+  } frame[MMIOTRACE_MAX_DEPTH];
+  unsigned long reads, writes, rbytes, wbytes;
+  long long access_ns;
+} MmioTraceThread;
+
+/** @private */
+static MMIOTRACE_NOINST void MmioTraceFlush(void)
+{
+  if (MmioTraceFd >= 0 && MmioTraceCount)
+    write(MmioTraceFd, MmioTraceBuf,
+	  MmioTraceCount * sizeof(struct MmioTraceRecord));
+  MmioTraceCount = 0;
+}
+
+/**
+@private
+Accounting hook, called by the trap handler in signal context with the
+trap lock held.
+*/
+static MMIOTRACE_NOINST void MmioTraceAccount(struct MmioWindow *w,
+					      volatile char *addr, int size,
+					      int write, long long ns)
+{
+  struct MmioTraceRecord *rec;
+  struct timespec now;
+  int depth = MmioTraceThread.depth;
+
+  if (write)
+    {
+      MmioTraceThread.writes++;
+      MmioTraceThread.wbytes += size;
+    }
+  else
+    {
+      MmioTraceThread.reads++;
+      MmioTraceThread.rbytes += size;
+    }
+  MmioTraceThread.access_ns += ns;
+
+  if (!depth || depth > MMIOTRACE_MAX_DEPTH)
+    {
+      if (write)
+	{
+	  __sync_fetch_and_add(&MmioTraceOther.writes, 1);
+	  __sync_fetch_and_add(&MmioTraceOther.wbytes, size);
+	}
+      else
+	{
+	  __sync_fetch_and_add(&MmioTraceOther.reads, 1);
+	  __sync_fetch_and_add(&MmioTraceOther.rbytes, size);
+	}
+      __sync_fetch_and_add(&MmioTraceOther.access_ns, ns);
+    }
+
+  if (MmioTraceFd < 0)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  rec = &MmioTraceBuf[MmioTraceCount];
+  rec->time_ns = (now.tv_sec - MmioTraceStartTime.tv_sec) * 1000000000LL +
+    (now.tv_nsec - MmioTraceStartTime.tv_nsec);
+  rec->addr = (uintptr_t) addr;
+  rec->value = 0;
+  if (w->shadow && size <= (int) sizeof(rec->value))
+    memcpy(&rec->value, w->shadow + (addr - w->base), size);
+  rec->function = MMIOTRACE_NONE;
+  if (depth && depth <= MMIOTRACE_MAX_DEPTH &&
+      MmioTraceThread.frame[depth - 1].index >= 0)
+    rec->function = MmioTraceThread.frame[depth - 1].index;
+  rec->size = size;
+  rec->write = write;
+  if (++MmioTraceCount == MMIOTRACE_BUFFER)
+    MmioTraceFlush();
+}
+
+#ifdef MRF_MMIO_TRACE
+/** @private */
+static MMIOTRACE_NOINST int MmioTraceLookup(void *fn)
+{
+  unsigned int h = ((uintptr_t) fn >> 2) * 0x9E3779B1u;
+  int i, n;
+
+  pthread_mutex_lock(&MmioTraceTable);
+  for (n = 0; n < MMIOTRACE_MAX_FUNCTIONS; n++)
+    {
+      i = (h + n) % MMIOTRACE_MAX_FUNCTIONS;
+      if (MmioTraceFn[i].fn == fn)
+	break;
+      if (!MmioTraceFn[i].fn)
+	{
+	  MmioTraceFn[i].fn = fn;
+	  break;
+	}
+    }
+  pthread_mutex_unlock(&MmioTraceTable);
+
+  return (n < MMIOTRACE_MAX_FUNCTIONS) ? i : -1;
+}
+
+/** @private */
+MMIOTRACE_NOINST void __cyg_profile_func_enter(void *fn, void *site)
+{
+  int depth = MmioTraceThread.depth++;
+
+  if (depth >= MMIOTRACE_MAX_DEPTH)
+    return;
+
+  MmioTraceThread.frame[depth].fn = fn;
+  MmioTraceThread.frame[depth].index = -1;
+  if (!MmioTraceActive)
+    return;
+
+  MmioTraceThread.frame[depth].index = MmioTraceLookup(fn);
+  MmioTraceThread.frame[depth].reads = MmioTraceThread.reads;
+  MmioTraceThread.frame[depth].writes = MmioTraceThread.writes;
+  MmioTraceThread.frame[depth].rbytes = MmioTraceThread.rbytes;
+  MmioTraceThread.frame[depth].wbytes = MmioTraceThread.wbytes;
+  MmioTraceThread.frame[depth].access_ns = MmioTraceThread.access_ns;
+  clock_gettime(CLOCK_MONOTONIC, &MmioTraceThread.frame[depth].start);
+}
+
+/** @private */
+MMIOTRACE_NOINST void __cyg_profile_func_exit(void *fn, void *site)
+{
+  struct MmioTraceFunction *f;
+  struct timespec now;
+  int depth;
+
+  if (MmioTraceThread.depth <= 0)
+    return;
+  depth = --MmioTraceThread.depth;
+  if (depth >= MMIOTRACE_MAX_DEPTH ||
+      MmioTraceThread.frame[depth].index < 0 || !MmioTraceActive)
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  f = &MmioTraceFn[MmioTraceThread.frame[depth].index];
+  __sync_fetch_and_add(&f->calls, 1);
+  __sync_fetch_and_add(&f->reads, MmioTraceThread.reads -
+		       MmioTraceThread.frame[depth].reads);
+  __sync_fetch_and_add(&f->writes, MmioTraceThread.writes -
+		       MmioTraceThread.frame[depth].writes);
+  __sync_fetch_and_add(&f->rbytes, MmioTraceThread.rbytes -
+		       MmioTraceThread.frame[depth].rbytes);
+  __sync_fetch_and_add(&f->wbytes, MmioTraceThread.wbytes -
+		       MmioTraceThread.frame[depth].wbytes);
+  __sync_fetch_and_add(&f->access_ns, MmioTraceThread.access_ns -
+		       MmioTraceThread.frame[depth].access_ns);
+  __sync_fetch_and_add(&f->ns, (now.tv_sec -
+				MmioTraceThread.frame[depth].start.tv_sec) *
+		       1000000000LL + (now.tv_nsec -
+				       MmioTraceThread.frame[depth].start.tv_nsec));
+}
+#endif
+
+/**
+Trap register accesses to a real device mapping to count them. Not
+needed for simulated devices.
+
+@param regs Start of register window, e.g. pEr
+@param size Size of register window
+@return Returns 0 on success, -1 on error.
+*/
+int MmioTraceAttach(volatile void *regs, int size)
+{
+  struct MmioWindow *w;
+  int i;
+
+  for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+    if (!MmioTraceWindow[i])
+      break;
+  if (i == MMIOTRAP_MAX_WINDOWS)
+    return -1;
+
+  w = calloc(1, sizeof(struct MmioWindow));
+  if (!w)
+    return -1;
+  w->base = (volatile char *) regs;
+  w->size = size;
+  if (MmioTrapRegister(w))
+    {
+      free(w);
+      return -1;
+    }
+  MmioTraceWindow[i] = w;
+
+  return 0;
+}
+
+/**
+Stop trapping register accesses to device mapping.
+
+@param regs Start of register window passed to MmioTraceAttach()
+@return Returns 0 on success, -1 on error.
+*/
+int MmioTraceDetach(volatile void *regs)
+{
+  int i;
+
+  for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+    if (MmioTraceWindow[i] && MmioTraceWindow[i]->base == regs)
+      {
+	MmioTrapUnregister(MmioTraceWindow[i]);
+	free(MmioTraceWindow[i]);
+	MmioTraceWindow[i] = NULL;
+	return 0;
+      }
+
+  return -1;
+}
+
+/**
+Start accounting. Functions entered before the start are not counted.
+*/
+void MmioTraceStart(void)
+{
+  clock_gettime(CLOCK_MONOTONIC, &MmioTraceStartTime);
+  MmioTrapSetAccount(MmioTraceAccount);
+  MmioTraceActive = 1;
+}
+
+/**
+Stop accounting.
+*/
+void MmioTraceStop(void)
+{
+  MmioTraceActive = 0;
+  MmioTrapSetAccount(NULL);
+}
+
+/**
+Clear all counters.
+*/
+void MmioTraceReset(void)
+{
+  int i;
+
+  pthread_mutex_lock(&MmioTraceTable);
+  for (i = 0; i < MMIOTRACE_MAX_FUNCTIONS; i++)
+    if (MmioTraceFn[i].fn)
+      {
+	MmioTraceFn[i].calls = 0;
+	MmioTraceFn[i].reads = MmioTraceFn[i].writes = 0;
+	MmioTraceFn[i].rbytes = MmioTraceFn[i].wbytes = 0;
+	MmioTraceFn[i].ns = MmioTraceFn[i].access_ns = 0;
+      }
+  memset(&MmioTraceOther, 0, sizeof(MmioTraceOther));
+  pthread_mutex_unlock(&MmioTraceTable);
+}
+
+/**
+Write every register access to binary trace file.
+
+@param filename Name of trace file
+@return Returns 0 on success, -1 on error.
+*/
+int MmioTraceOpen(char *filename)
+{
+  struct MmioTraceHeader hdr;
+  int fd;
+
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return -1;
+
+  hdr.magic = MMIOTRACE_MAGIC;
+  hdr.version = MMIOTRACE_VERSION;
+  hdr.record_size = sizeof(struct MmioTraceRecord);
+  hdr.reserved = 0;
+  if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+    {
+      close(fd);
+      return -1;
+    }
+
+  MmioTrapLock();
+  MmioTraceCount = 0;
+  MmioTraceFd = fd;
+  MmioTrapUnlock();
+
+  return 0;
+}
+
+/**
+Close binary trace file. The names of the functions referenced by the
+records are appended after a record with size zero.
+
+@return Returns 0 on success, -1 on error.
+*/
+int MmioTraceClose(void)
+{
+  struct MmioTraceRecord end;
+  struct MmioTraceName name;
+  int fd, i, result = 0;
+
+  MmioTrapLock();
+  MmioTraceFlush();
+  fd = MmioTraceFd;
+  MmioTraceFd = -1;
+  MmioTrapUnlock();
+  if (fd < 0)
+    return -1;
+
+  memset(&end, 0, sizeof(end));
+  end.function = MMIOTRACE_NONE;
+  if (write(fd, &end, sizeof(end)) != sizeof(end))
+    result = -1;
+  for (i = 0; i < MMIOTRACE_MAX_FUNCTIONS && !result; i++)
+    if (MmioTraceFn[i].fn)
+      {
+	memset(&name, 0, sizeof(name));
+	name.index = i;
+	MmioTraceName(MmioTraceFn[i].fn, name.name, sizeof(name.name));
+	if (write(fd, &name, sizeof(name)) != sizeof(name))
+	  result = -1;
+      }
+
+  if (close(fd))
+    result = -1;
+
+  return result;
+}
+
+/**
+Get copy of function counters.
+
+@param tab Table to fill in
+@param max Size of table
+@return Returns number of functions copied.
+*/
+int MmioTraceGetFunctions(struct MmioTraceFunction *tab, int max)
+{
+  int i, n = 0;
+
+  pthread_mutex_lock(&MmioTraceTable);
+  for (i = 0; i < MMIOTRACE_MAX_FUNCTIONS && n < max; i++)
+    if (MmioTraceFn[i].fn)
+      tab[n++] = MmioTraceFn[i];
+  pthread_mutex_unlock(&MmioTraceTable);
+
+  return n;
+}
+
+/**
+Get name of function. Functions of the executable are only found when
+it is linked with -rdynamic.
+
+@param fn Function address
+@param buf Buffer for name
+@param size Size of buffer
+@return Returns buf.
+*/
+const char *MmioTraceName(void *fn, char *buf, int size)
+{
+  Dl_info info;
+
+  if (dladdr(fn, &info) && info.dli_sname)
+    snprintf(buf, size, "%s", info.dli_sname);
+  else
+    snprintf(buf, size, "%p", fn);
+
+  return buf;
+}
+
+/** @private */
+static int MmioTraceCompare(const void *a, const void *b)
+{
+  const struct MmioTraceFunction *fa = (const struct MmioTraceFunction *) a;
+  const struct MmioTraceFunction *fb = (const struct MmioTraceFunction *) b;
+
+  if (fa->reads != fb->reads)
+    return (fa->reads < fb->reads) ? 1 : -1;
+  if (fa->writes != fb->writes)
+    return (fa->writes < fb->writes) ? 1 : -1;
+  return 0;
+}
+
+/**
+Print summary table of called functions ordered by number of reads.
+Per call values are averages.
+
+@param fp Output stream
+*/
+void MmioTraceDump(FILE *fp)
+{
+  struct MmioTraceFunction *tab;
+  char name[MMIOTRACE_NAME_SIZE];
+  int i, n;
+
+  tab = malloc(sizeof(struct MmioTraceFunction) * MMIOTRACE_MAX_FUNCTIONS);
+  if (!tab)
+    return;
+  n = MmioTraceGetFunctions(tab, MMIOTRACE_MAX_FUNCTIONS);
+  qsort(tab, n, sizeof(struct MmioTraceFunction), MmioTraceCompare);
+
+  fprintf(fp, "%-32s %8s %8s %8s %8s %8s %10s %10s\n", "Function", "Calls",
+	  "Reads", "Writes", "Rd/call", "Wr/call", "ns/call", "MMIO ns");
+  for (i = 0; i < n; i++)
+    {
+      if (!tab[i].calls)
+	continue;
+      fprintf(fp, "%-32s %8lu %8lu %8lu %8.1f %8.1f %10.0f %10.0f\n",
+	      MmioTraceName(tab[i].fn, name, sizeof(name)), tab[i].calls,
+	      tab[i].reads, tab[i].writes,
+	      (double) tab[i].reads / tab[i].calls,
+	      (double) tab[i].writes / tab[i].calls,
+	      (double) tab[i].ns / tab[i].calls,
+	      (double) tab[i].access_ns / tab[i].calls);
+    }
+  if (MmioTraceOther.reads || MmioTraceOther.writes)
+    fprintf(fp, "%-32s %8s %8lu %8lu\n", "(not instrumented)", "",
+	    MmioTraceOther.reads, MmioTraceOther.writes);
+
+  free(tab);
+}
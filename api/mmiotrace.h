@@ -0,0 +1,64 @@
+/*
+  mmiotrace.h -- Register access accounting and tracing for the
+                 Micro-Research Event System API
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h before this file.
+
+  Build the API with "make MMIO_TRACE=1" to attribute register accesses
+  to the API function issuing them.
+ */
+
+#define MMIOTRACE_MAX_FUNCTIONS  1024
+#define MMIOTRACE_MAX_DEPTH      64
+#define MMIOTRACE_MAGIC          0x4d524654    /* "MRFT" */
+#define MMIOTRACE_VERSION        1
+#define MMIOTRACE_NAME_SIZE      64
+
+struct MmioTraceFunction {
+  void              *fn;
+  unsigned long      calls;
+  unsigned long      reads;       /* Including called functions */
+  unsigned long      writes;
+  unsigned long      rbytes;
+  unsigned long      wbytes;
+  long long          ns;          /* Wall time including called functions */
+  long long          access_ns;   /* Time spent in register accesses */
+};
+
+/* Binary trace file: header, records, function name table */
+struct MmioTraceHeader {
+  u32 magic;
+  u32 version;
+  u32 record_size;
+  u32 reserved;
+};
+
+struct MmioTraceRecord {
+  unsigned long long time_ns;     /* From MmioTraceStart() */
+  unsigned long long addr;        /* Register address */
+  u32                value;       /* Value, simulated devices only */
+  unsigned short     function;    /* Index in name table, 0xffff none */
+  unsigned char      size;
+  unsigned char      write;
+};
+
+struct MmioTraceName {
+  u32  index;
+  char name[MMIOTRACE_NAME_SIZE];
+};
+
+int MmioTraceAttach(volatile void *regs, int size);
+int MmioTraceDetach(volatile void *regs);
+void MmioTraceStart(void);
+void MmioTraceStop(void);
+void MmioTraceReset(void);
+int MmioTraceOpen(char *filename);
+int MmioTraceClose(void);
+int MmioTraceGetFunctions(struct MmioTraceFunction *tab, int max);
+const char *MmioTraceName(void *fn, char *buf, int size);
+void MmioTraceDump(FILE *fp);
@@ -0,0 +1,652 @@
+/**
+@file mmiotrap.c
+@brief Trap and emulate memory mapped register accesses of simulated
+       Micro-Research Event System devices.
+
+The API functions access the device registers with plain loads and
+stores through the memory mapped window. To run them unmodified against
+a software model, the window is mapped without access rights. A load or
+store faults; the SIGSEGV handler decodes the size of the access from
+the faulting instruction and calls the read hook of the model, which
+updates the registers about to be read in the shadow mapping. The page
+is then made accessible, the trap flag is set and the instruction is
+restarted. After the single step the SIGTRAP handler calls the write
+hook with the old contents of the bytes stored, which lets the model
+implement write-one-to-clear registers and strobe bits, and removes the
+access rights again.
+
+A trapped access costs about 20 microseconds, far more than the bus
+latency of a real device, so accesses are not stretched. Instead the
+window read_ns/write_ns are added up as modeled time and the time spent
+in the trap handler is measured. The cost of the fault and the signal
+delivery before the handler runs is calibrated once when the first
+window is registered, as the median of single accesses, and added per
+access. The modeled duration of a piece of code is its elapsed time
+minus the trap time plus the modeled time, see MmioTrapGetTime(). The
+jitter of the trap path, around a microsecond per access, remains in
+the result.
+
+A window without a shadow and hooks traps accesses to a real device
+mapping; the access is executed on the device and only reported to the
+accounting hook, see mmiotrace.c.
+
+Trapping is single-threaded. While an instruction is stepped its page
+is accessible to the whole process, so an access of another thread in
+that time would bypass the model. Windows can therefore only be
+registered while the process has one thread, and all registered windows
+belong to that thread; an access from any other thread is passed on to
+the previous SIGSEGV handler, which normally terminates the process.
+Threads that do not touch the windows may be started afterwards. The
+stepping thread holds a spin lock which is also taken by the model when
+it is updated from outside, e.g. when an event is injected.
+
+Modules that access registers from threads of their own can therefore
+not use trapped windows in that mode; they offer a path that runs in
+the calling thread instead: EvanCapPoll(), MrfDevRun() with threads -1,
+EvgTsStep() and EvLoopRunOnce().
+
+Only x86_64 Linux is supported.
+
+@date 19.10.2026
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/syscall.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mmiotrap.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#define MMIOTRAP_TF        0x100
+#define MMIOTRAP_MAX_STEP  4
+#define MMIOTRAP_CALIBRATE 64
+
+static struct MmioWindow *volatile MmioTrapWindow[MMIOTRAP_MAX_WINDOWS];
+static struct sigaction MmioTrapOldSegv, MmioTrapOldTrap;
+static int MmioTrapInstalled = 0;
+static long MmioTrapPageSize;
+static volatile int MmioTrapSpin = 0;
+static volatile MmioAccountHook MmioTrapAccount = NULL;
+static volatile pid_t MmioTrapOwner = 0;  /* Thread of all windows */
+static struct MmioTrapTime MmioTrapTotal;
+static long long MmioTrapEntryNs = -1;    /* Fault and signal delivery */
+
+/* Accesses of the instruction being stepped by this thread */
+static __thread struct {
+  int               count;
+  struct timespec   start;
+  int               ns;
+  struct {
+    struct MmioWindow *w;
+    volatile char   *addr;
+    char            *page;
+    int              offset;
+    int              size;
+    int              write;
+    char             old[MMIOTRAP_MAX_ACCESS];
+  } acc[MMIOTRAP_MAX_STEP];
+} MmioStep;
+
+/**
+Take model lock. Use when the model state is changed outside of a trap.
+*/
+void MmioTrapLock(void)
+{
+  while (__sync_lock_test_and_set(&MmioTrapSpin, 1))
+    sched_yield();
+}
+
+/**
+Release model lock.
+*/
+void MmioTrapUnlock(void)
+{
+  __sync_lock_release(&MmioTrapSpin);
+}
+
+/**
+Set function called after every trapped access, e.g. to count accesses.
+The hook runs in signal context.
+
+@param hook Accounting function, NULL to disable
+*/
+void MmioTrapSetAccount(MmioAccountHook hook)
+{
+  MmioTrapAccount = hook;
+}
+
+/** @private */
+static pid_t MmioTrapTid(void)
+{
+  return (pid_t) syscall(SYS_gettid);
+}
+
+/** @private Number of threads in process, -1 if unknown */
+static int MmioTrapThreads(void)
+{
+  char line[128];
+  FILE *fp;
+  int n = -1;
+
+  fp = fopen("/proc/self/status", "r");
+  if (fp == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), fp))
+    if (sscanf(line, "Threads: %d", &n) == 1)
+      break;
+  fclose(fp);
+
+  return n;
+}
+
+/** @private */
+static struct MmioWindow *MmioTrapFind(volatile char *addr)
+{
+  struct MmioWindow *w;
+  int i;
+
+  for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+    {
+      w = MmioTrapWindow[i];
+      if (w && addr >= w->base && addr < w->base + w->size)
+	return w;
+    }
+
+  return NULL;
+}
+
+/**
+@private
+Decode memory operand size of instruction. Covers the moves, ALU
+operations and SSE/AVX loads and stores compilers and the C library
+use; anything else is taken as a 32-bit access.
+*/
+static int MmioTrapDecode(const unsigned char *p, int *rmw)
+{
+  int opsize = 0, rexw = 0, rep = 0;
+  int word, op, op2, reg;
+
+  *rmw = 0;
+  for (;; p++)
+    {
+      if (*p == 0x66)
+	opsize = 1;
+      else if (*p == 0xF2 || *p == 0xF3)
+	rep = *p;
+      else if (*p == 0xF0 || *p == 0x2E || *p == 0x36 || *p == 0x3E ||
+	       *p == 0x26 || *p == 0x64 || *p == 0x65 || *p == 0x67)
+	;
+      else
+	break;
+    }
+  if ((*p & 0xF0) == 0x40)
+    rexw = *p++ & 0x08;
+  word = rexw ? 8 : (opsize ? 2 : 4);
+
+  op = *p++;
+  /* VEX: vmovd/vmovq or 128/256-bit vector */
+  if (op == 0xC5 || op == 0xC4)
+    {
+      op2 = (op == 0xC5) ? p[1] : p[2];
+      if (op2 == 0x6E || op2 == 0x7E)
+	return ((op == 0xC4 && (p[1] & 0x80)) || opsize) ? 8 : 4;
+      if (op2 == 0xD6)
+	return 8;
+      return (((op == 0xC5) ? p[0] : p[1]) & 0x04) ? 32 : 16;
+    }
+  /* EVEX: vector length in L'L */
+  if (op == 0x62)
+    return 16 << ((p[2] >> 5) & 3);
+
+  if (op == 0x0F)
+    {
+      op2 = *p;
+      switch (op2)
+	{
+	case 0xB6:
+	case 0xBE:
+	  return 1;
+	case 0xB7:
+	case 0xBF:
+	  return 2;
+	case 0x10:
+	case 0x11:
+	  return (rep == 0xF3) ? 4 : ((rep == 0xF2) ? 8 : 16);
+	case 0x12:
+	case 0x13:
+	case 0x16:
+	case 0x17:
+	case 0xD6:
+	  return 8;
+	case 0x6E:
+	case 0x7E:
+	  return (rep == 0xF3 || rexw) ? 8 : 4;
+	case 0x28:
+	case 0x29:
+	case 0x2B:
+	case 0x6F:
+	case 0x7F:
+	case 0xE7:
+	  return 16;
+	case 0xB0:
+	case 0xC0:
+	  *rmw = 1;
+	  return 1;
+	case 0xB1:
+	case 0xC1:
+	case 0xAB:
+	case 0xB3:
+	case 0xBB:
+	  *rmw = 1;
+	  return word;
+	case 0xC3:
+	  return word;
+	default:
+	  return 4;
+	}
+    }
+
+  reg = (*p >> 3) & 7;
+  switch (op)
+    {
+    case 0x88:
+    case 0x8A:
+    case 0xC6:
+    case 0xA4:
+    case 0xAA:
+    case 0xAC:
+    case 0x84:
+      return 1;
+    case 0x89:
+    case 0x8B:
+    case 0xC7:
+    case 0xA5:
+    case 0xAB:
+    case 0xAD:
+    case 0x85:
+      return word;
+    case 0x80:
+    case 0x82:
+    case 0x86:
+    case 0xFE:
+    case 0xD0:
+    case 0xD2:
+      *rmw = 1;
+      return 1;
+    case 0x81:
+    case 0x83:
+    case 0x87:
+    case 0xFF:
+    case 0xD1:
+    case 0xD3:
+      *rmw = 1;
+      return word;
+    case 0xF6:
+      *rmw = (reg == 2 || reg == 3);
+      return 1;
+    case 0xF7:
+      *rmw = (reg == 2 || reg == 3);
+      return word;
+    }
+
+  /* ALU operations 00-3F with memory destination or source */
+  if (op < 0x40 && (op & 7) < 4)
+    {
+      *rmw = !(op & 2);
+      return (op & 1) ? word : 1;
+    }
+
+  return 4;
+}
+
+/** @private */
+static void MmioTrapChain(struct sigaction *old, int sig, siginfo_t *si,
+			  void *ctx)
+{
+  if (old->sa_flags & SA_SIGINFO)
+    {
+      if (old->sa_sigaction)
+	old->sa_sigaction(sig, si, ctx);
+    }
+  else if (old->sa_handler == SIG_DFL)
+    {
+      signal(sig, SIG_DFL);
+      raise(sig);
+    }
+  else if (old->sa_handler != SIG_IGN)
+    old->sa_handler(sig);
+}
+
+/**
+Get accumulated time of trapped accesses. The modeled duration of code
+accessing the windows is its elapsed time - trap_ns + model_ns, taking
+the difference of two readings around it.
+
+@param t Returns number of accesses, time spent in the trap handler
+and the sum of the modeled access durations
+*/
+void MmioTrapGetTime(struct MmioTrapTime *t)
+{
+  MmioTrapLock();
+  *t = MmioTrapTotal;
+  MmioTrapUnlock();
+}
+
+/** @private */
+static void MmioTrapSegv(int sig, siginfo_t *si, void *ctx)
+{
+  ucontext_t *uc = (ucontext_t *) ctx;
+  volatile char *addr = (volatile char *) si->si_addr;
+  struct MmioWindow *w;
+  int saved_errno = errno;
+  int write, rmw, size, offset, n;
+
+  w = MmioTrapFind(addr);
+  /* Another thread must not open the page while it is stepped */
+  if (!w || MmioStep.count >= MMIOTRAP_MAX_STEP ||
+      MmioTrapTid() != MmioTrapOwner)
+    {
+      MmioTrapChain(&MmioTrapOldSegv, sig, si, ctx);
+      return;
+    }
+
+  if (!MmioStep.count)
+    {
+      MmioTrapLock();
+      clock_gettime(CLOCK_MONOTONIC, &MmioStep.start);
+      MmioStep.ns = 0;
+    }
+
+  write = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+  size = MmioTrapDecode((const unsigned char *) uc->uc_mcontext.gregs[REG_RIP],
+			&rmw);
+  offset = addr - w->base;
+  if (size > MMIOTRAP_MAX_ACCESS)
+    size = MMIOTRAP_MAX_ACCESS;
+  if (offset + size > w->size)
+    size = w->size - offset;
+
+  n = MmioStep.count++;
+  MmioStep.acc[n].w = w;
+  MmioStep.acc[n].addr = addr;
+  MmioStep.acc[n].page = (char *) ((uintptr_t) addr &
+				   ~(uintptr_t) (MmioTrapPageSize - 1));
+  MmioStep.acc[n].offset = offset;
+  MmioStep.acc[n].size = size;
+  MmioStep.acc[n].write = write;
+
+  if ((!write || rmw) && w->read)
+    w->read(w, offset, size);
+  if (write && w->shadow)
+    memcpy(MmioStep.acc[n].old, w->shadow + offset, size);
+  MmioStep.ns += write ? w->write_ns : w->read_ns;
+
+  mprotect(MmioStep.acc[n].page, MmioTrapPageSize, PROT_READ | PROT_WRITE);
+  uc->uc_mcontext.gregs[REG_EFL] |= MMIOTRAP_TF;
+
+  errno = saved_errno;
+}
+
+/** @private */
+static void MmioTrapStep(int sig, siginfo_t *si, void *ctx)
+{
+  ucontext_t *uc = (ucontext_t *) ctx;
+  int saved_errno = errno;
+  MmioAccountHook hook;
+  struct timespec now;
+  long long ns;
+  int i;
+
+  if (!MmioStep.count)
+    {
+      MmioTrapChain(&MmioTrapOldTrap, sig, si, ctx);
+      return;
+    }
+
+  for (i = 0; i < MmioStep.count; i++)
+    {
+      mprotect(MmioStep.acc[i].page, MmioTrapPageSize, PROT_NONE);
+      if (MmioStep.acc[i].write && MmioStep.acc[i].w->write)
+	MmioStep.acc[i].w->write(MmioStep.acc[i].w, MmioStep.acc[i].offset,
+				 MmioStep.acc[i].size, MmioStep.acc[i].old);
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = (now.tv_sec - MmioStep.start.tv_sec) * 1000000000LL +
+    (now.tv_nsec - MmioStep.start.tv_nsec);
+  MmioTrapTotal.accesses += MmioStep.count;
+  MmioTrapTotal.trap_ns += ns + MmioStep.count * MmioTrapEntryNs;
+  MmioTrapTotal.model_ns += MmioStep.ns;
+
+  hook = MmioTrapAccount;
+  if (hook)
+    {
+      for (i = 0; i < MmioStep.count; i++)
+	hook(MmioStep.acc[i].w, MmioStep.acc[i].addr, MmioStep.acc[i].size,
+	     MmioStep.acc[i].write, ns);
+    }
+
+  MmioStep.count = 0;
+  uc->uc_mcontext.gregs[REG_EFL] &= ~MMIOTRAP_TF;
+  MmioTrapUnlock();
+
+  errno = saved_errno;
+}
+
+/** @private */
+static int MmioTrapCompare(const void *a, const void *b)
+{
+  long long la = *(const long long *) a, lb = *(const long long *) b;
+
+  return (la > lb) - (la < lb);
+}
+
+/**
+@private
+Measure the part of a trapped access spent outside the handlers with a
+window of its own, median of single accesses. The accesses are not
+counted.
+*/
+static void MmioTrapCalibrate(void)
+{
+  struct MmioWindow w;
+  struct MmioTrapTime t0, t1, total;
+  struct timespec start, end;
+  MmioAccountHook hook;
+  volatile char *p;
+  long long ns[MMIOTRAP_CALIBRATE];
+  int i;
+
+  MmioTrapEntryNs = 0;
+  p = (volatile char *) mmap(0, MmioTrapPageSize, PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return;
+
+  memset(&w, 0, sizeof(w));
+  w.base = p;
+  w.size = MmioTrapPageSize;
+  hook = MmioTrapAccount;
+  MmioTrapAccount = NULL;
+  MmioTrapGetTime(&total);
+  if (!MmioTrapRegister(&w))
+    {
+      for (i = 0; i < MMIOTRAP_CALIBRATE; i++)
+	{
+	  MmioTrapGetTime(&t0);
+	  clock_gettime(CLOCK_MONOTONIC, &start);
+	  (void) p[0];
+	  clock_gettime(CLOCK_MONOTONIC, &end);
+	  MmioTrapGetTime(&t1);
+	  ns[i] = (end.tv_sec - start.tv_sec) * 1000000000LL +
+	    (end.tv_nsec - start.tv_nsec) - (t1.trap_ns - t0.trap_ns);
+	}
+      MmioTrapUnregister(&w);
+
+      qsort(ns, MMIOTRAP_CALIBRATE, sizeof(long long), MmioTrapCompare);
+      MmioTrapLock();
+      MmioTrapTotal = total;
+      if (ns[MMIOTRAP_CALIBRATE / 2] > 0)
+	MmioTrapEntryNs = ns[MMIOTRAP_CALIBRATE / 2];
+      MmioTrapUnlock();
+    }
+  MmioTrapAccount = hook;
+  munmap((void *) p, MmioTrapPageSize);
+
+#ifdef DEBUG
+  DEBUG_PRINTF("MmioTrapCalibrate: %lld ns outside handler\n",
+	       MmioTrapEntryNs);
+#endif
+}
+
+/**
+Start trapping accesses to register window. The caller maps the window
+and its shadow. Only the calling thread may access the window, see
+above.
+
+@param w Pointer to window structure, must stay valid until
+MmioTrapUnregister()
+@return Returns 0 on success, -1 on error, errno EBUSY if the process
+has more than one thread or windows are registered by another thread.
+*/
+int MmioTrapRegister(struct MmioWindow *w)
+{
+  struct sigaction sa;
+  pid_t tid = MmioTrapTid();
+  int i, result = -1;
+
+  if (MmioTrapThreads() != 1)
+    {
+      errno = EBUSY;
+      return -1;
+    }
+
+  MmioTrapLock();
+  if (MmioTrapOwner && MmioTrapOwner != tid)
+    {
+      MmioTrapUnlock();
+      errno = EBUSY;
+      return -1;
+    }
+
+  if (!MmioTrapInstalled)
+    {
+      MmioTrapPageSize = sysconf(_SC_PAGESIZE);
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_sigaction = MmioTrapSegv;
+      sa.sa_flags = SA_SIGINFO | SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+      if (!sigaction(SIGSEGV, &sa, &MmioTrapOldSegv))
+	{
+	  sa.sa_sigaction = MmioTrapStep;
+	  if (!sigaction(SIGTRAP, &sa, &MmioTrapOldTrap))
+	    MmioTrapInstalled = 1;
+	  else
+	    sigaction(SIGSEGV, &MmioTrapOldSegv, NULL);
+	}
+    }
+
+  if (MmioTrapInstalled && !(w->size & (MmioTrapPageSize - 1)))
+    for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+      if (!MmioTrapWindow[i])
+	{
+	  if (!mprotect((void *) w->base, w->size, PROT_NONE))
+	    {
+	      MmioTrapWindow[i] = w;
+	      MmioTrapOwner = tid;
+	      result = 0;
+	    }
+	  break;
+	}
+  MmioTrapUnlock();
+
+#ifdef DEBUG
+  DEBUG_PRINTF("MmioTrapRegister: window %p size %08x returned %d\n",
+	       w->base, w->size, result);
+#endif
+
+  if (!result && MmioTrapEntryNs < 0)
+    MmioTrapCalibrate();
+
+  return result;
+}
+
+/**
+Stop trapping accesses to register window. The window is left
+accessible.
+
+@param w Pointer to window structure
+@return Returns 0 on success, -1 if window was not registered.
+*/
+int MmioTrapUnregister(struct MmioWindow *w)
+{
+  int i, result = -1;
+
+  MmioTrapLock();
+  for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+    if (MmioTrapWindow[i] == w)
+      {
+	MmioTrapWindow[i] = NULL;
+	mprotect((void *) w->base, w->size, PROT_READ | PROT_WRITE);
+	result = 0;
+	break;
+      }
+  for (i = 0; i < MMIOTRAP_MAX_WINDOWS; i++)
+    if (MmioTrapWindow[i])
+      break;
+  if (i == MMIOTRAP_MAX_WINDOWS)
+    MmioTrapOwner = 0;
+  MmioTrapUnlock();
+
+  return result;
+}
+
+#else
+
+void MmioTrapLock(void)
+{
+}
+
+void MmioTrapUnlock(void)
+{
+}
+
+void MmioTrapSetAccount(MmioAccountHook hook)
+{
+}
+
+void MmioTrapGetTime(struct MmioTrapTime *t)
+{
+  memset(t, 0, sizeof(struct MmioTrapTime));
+}
+
+int MmioTrapRegister(struct MmioWindow *w)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+int MmioTrapUnregister(struct MmioWindow *w)
+{
+  return -1;
+}
+
+#endif
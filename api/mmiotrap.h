@@ -0,0 +1,64 @@
+/*
+  mmiotrap.h -- Trap and emulate memory mapped register accesses
+                of simulated Micro-Research Event System devices
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  A register window is a memory mapping with all access removed. Every
+  load or store to the window faults, the access is decoded and passed
+  to the device model before (reads) or after (writes) it is executed.
+  The model works on an unprotected alias of the same memory, the
+  shadow. Only supported on x86_64 Linux.
+
+  Windows are registered by and belong to one thread, while the
+  process has no other threads. Accesses from other threads are fatal,
+  modules with threads of their own have a path running in the calling
+  thread for use with trapped windows, see mmiotrap.c.
+
+  A trap costs about 20 us, so read_ns and write_ns do not stretch the
+  accesses. They are added up as modeled time beside the measured trap
+  time, see MmioTrapGetTime().
+ */
+
+#define MMIOTRAP_MAX_WINDOWS  16
+#define MMIOTRAP_MAX_ACCESS   64
+
+struct MmioWindow;
+
+/* Called before a load, the model updates the shadow registers read */
+typedef void (*MmioReadHook)(struct MmioWindow *w, int offset, int size);
+/* Called after a store with the previous contents of the bytes written */
+typedef void (*MmioWriteHook)(struct MmioWindow *w, int offset, int size,
+			      const char *old);
+
+/* Called after every access with the time the instruction took */
+typedef void (*MmioAccountHook)(struct MmioWindow *w, volatile char *addr,
+				int size, int write, long long ns);
+
+struct MmioWindow {
+  volatile char *base;            /* Protected mapping used by the API */
+  char          *shadow;          /* Unprotected alias used by model,
+				     NULL for device mappings */
+  int            size;            /* Window size, multiple of page size */
+  int            read_ns;         /* Modeled duration of a load */
+  int            write_ns;        /* Modeled duration of a store */
+  MmioReadHook   read;
+  MmioWriteHook  write;
+  void          *arg;             /* Model state */
+};
+
+struct MmioTrapTime {
+  long long      accesses;
+  long long      trap_ns;         /* Time spent in trap handler */
+  long long      model_ns;        /* Sum of read_ns and write_ns */
+};
+
+int MmioTrapRegister(struct MmioWindow *w);
+int MmioTrapUnregister(struct MmioWindow *w);
+void MmioTrapLock(void);
+void MmioTrapUnlock(void);
+void MmioTrapSetAccount(MmioAccountHook hook);
+void MmioTrapGetTime(struct MmioTrapTime *t);
@@ -0,0 +1,550 @@
+/*
+  mrfbench.c -- Micro-Research Event Receiver
+  Application Programming Interface microbenchmarks
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Measures the API hot paths against a real device, the simulated
+  Event Receiver (evsim.c) or a plain memory image of the registers.
+  Every case is calibrated to run batches of about the target time,
+  run for a number of warm-up batches and then timed for a number of
+  repetitions. The results are ns per operation percentiles over the
+  repetitions and the register reads and writes per operation, counted
+  with the trap handler in a separate pass.
+
+  The memory image has no register semantics, e.g. the FIFO is always
+  empty; it shows the CPU cost of the API code. On the simulated device
+  every register access traps, which takes far longer than a PCIe
+  access; the time spent in the trap handler is subtracted and the
+  access latency set with -l added instead, the trap time is reported
+  separately. On a real device the FIFO and buffer cases measure
+  whatever state the device is in.
+
+  The mmiord and mmiowr cases copy the whole data buffer with device
+  accesses of the width in the case name, throughput in MB/s is 2048000
+  divided by ns per operation. With -W the bulk areas of a device are
+  mapped write-combining first, then mmiowr measures the uncached and
+  dbuftx the write-combining stores.
+
+  Most cases write configuration registers, the mapping RAM or the
+  sequence RAM. On a real device only the read-only cases run unless
+  -D is given; the configuration is then saved with EvrConfigSave()
+  before the first case and restored at the end. Event FIFO, log and
+  data buffer contents are not restored.
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "erapi.h"
+#include "egapi.h"
+#include "fracdiv.h"
+#include "mmiotrap.h"
+#include "evsim.h"
+#include "mmiotrace.h"
+#include "mrfwc.h"
+#include "mrfmmio.h"
+#include "mrfconfig.h"
+
+#define BENCH_MODE_DEVICE  0
+#define BENCH_MODE_SIM     1
+#define BENCH_MODE_MEM     2
+
+#define BENCH_MAX_REPS     1000
+#define BENCH_COUNT_OPS    16
+#define BENCH_LOG_EVENTS   64
+
+struct Bench {
+  int                 mode;
+  char               *target;
+  struct MrfErRegs   *pEr;
+  int                 fd;
+  int                 size;       /* Size of register window */
+  int                 arg;        /* Parameter of current case */
+  char                buf[EVR_MAX_BUFFER];
+  volatile int        sink;
+};
+
+struct BenchCase {
+  char  *name;
+  int    max_ops;                 /* Largest batch, 0 no limit */
+  int  (*init)(struct Bench *b);  /* Returns -1 if not supported */
+  void (*prep)(struct Bench *b, int ops);
+  void (*op)(struct Bench *b, int i);
+  int    arg;                     /* Case parameter, e.g. access width */
+  int    modify;                  /* Changes device state */
+};
+
+static volatile unsigned long BenchReads, BenchWrites;
+
+static void BenchAccount(struct MmioWindow *w, volatile char *addr, int size,
+			 int write, long long ns)
+{
+  if (write)
+    BenchWrites++;
+  else
+    BenchReads++;
+}
+
+static int BenchOpenInit(struct Bench *b)
+{
+  return (b->mode == BENCH_MODE_MEM) ? -1 : 0;
+}
+
+static void BenchOpen(struct Bench *b, int i)
+{
+  struct MrfErRegs *pEr;
+  int fd;
+
+  if (b->mode == BENCH_MODE_SIM)
+    {
+      fd = EvrSimOpen(&pEr, "mrfbench");
+      EvrSimClose(fd);
+      return;
+    }
+
+  fd = EvrOpenWindow(&pEr, b->target, EVR_MEM_WINDOW);
+  if (fd >= 0)
+    {
+      munmap(pEr, EVR_MEM_WINDOW);
+      close(fd);
+    }
+}
+
+static void BenchGet(struct Bench *b, int i)
+{
+  b->sink = EvrGetIrqFlags(b->pEr);
+}
+
+static void BenchSet(struct Bench *b, int i)
+{
+  EvrSetPrescaler(b->pEr, 0, 1000 + (i & 1));
+}
+
+static void BenchMapRam(struct Bench *b, int i)
+{
+  EvrSetPulseMap(b->pEr, 1, 1 + i % EVR_MAX_EVENT_CODE, i & 15, -1, -1);
+}
+
+static int BenchFIFOInit(struct Bench *b)
+{
+  EvrSetFIFOEvent(b->pEr, 0, 0x10, 1);
+  EvrSetLogEvent(b->pEr, 0, 0x10, 1);
+  EvrMapRamEnable(b->pEr, 0, 1);
+  return 0;
+}
+
+static void BenchFIFOPrep(struct Bench *b, int ops)
+{
+  int i;
+
+  if (b->mode == BENCH_MODE_SIM)
+    for (i = 0; i < ops; i++)
+      EvrSimInjectEvent(b->fd, 0x10, -1, 0);
+}
+
+static void BenchFIFO(struct Bench *b, int i)
+{
+  struct FIFOEvent fe;
+
+  b->sink = EvrGetFIFOEvent(b->pEr, &fe);
+}
+
+static int BenchLogInit(struct Bench *b)
+{
+  int i;
+
+  BenchFIFOInit(b);
+  EvrClearLog(b->pEr);
+  EvrEnableLog(b->pEr, 1);
+  if (b->mode == BENCH_MODE_SIM)
+    for (i = 0; i < BENCH_LOG_EVENTS; i++)
+      EvrSimInjectEvent(b->fd, 0x10, -1, 0);
+  if (b->mode == BENCH_MODE_MEM)
+    b->pEr->LogStatus = be32_to_cpu(BENCH_LOG_EVENTS);
+  return 0;
+}
+
+static void BenchLog(struct Bench *b, int i)
+{
+  struct FIFOEvent fe;
+  int pos, n;
+
+  fe.EventCode = 0;
+  pos = EvrGetLogStart(b->pEr);
+  for (n = EvrGetLogEntries(b->pEr); n > 0; n--)
+    {
+      fe.TimestampHigh = be32_to_cpu(b->pEr->Log[pos].TimestampHigh);
+      fe.TimestampLow = be32_to_cpu(b->pEr->Log[pos].TimestampLow);
+      fe.EventCode = be32_to_cpu(b->pEr->Log[pos].EventCode);
+      pos = (pos + 1) & (EVR_LOG_SIZE - 1);
+    }
+  b->sink = fe.EventCode;
+}
+
+static int BenchDBufInit(struct Bench *b)
+{
+  memset(b->buf, 0x5a, sizeof(b->buf));
+  EvrSetDBufMode(b->pEr, 1);
+  EvrSetTxDBufMode(b->pEr, 1);
+  EvrReceiveDBuf(b->pEr, 1);
+  if (b->mode == BENCH_MODE_SIM)
+    EvrSimReceiveDBuf(b->fd, b->buf, EVR_MAX_BUFFER - 4);
+  if (b->mode == BENCH_MODE_MEM)
+    {
+      b->pEr->DataBufControl = be32_to_cpu((1 << C_EVR_DATABUF_MODE) |
+					   (1 << C_EVR_DATABUF_RXREADY) |
+					   (EVR_MAX_BUFFER - 4));
+      b->pEr->TxDataBufControl |= be32_to_cpu(1 << C_EVR_TXDATABUF_COMPLETE);
+    }
+  return 0;
+}
+
+static void BenchDBufRx(struct Bench *b, int i)
+{
+  b->sink = EvrGetDBuf(b->pEr, b->buf, EVR_MAX_BUFFER);
+}
+
+static void BenchDBufTx(struct Bench *b, int i)
+{
+  b->sink = EvrSendTxDBuf(b->pEr, b->buf, EVR_MAX_BUFFER);
+}
+
+static void BenchSegScan(struct Bench *b, int i)
+{
+  int seg, n = 0;
+
+  for (seg = 0; seg <= 255; seg++)
+    n += EvrGetSegRx(b->pEr, seg);
+  b->sink = n;
+}
+
+static void BenchSeqRam(struct Bench *b, int i)
+{
+  EvrSetSeqRamEvent(b->pEr, 0, i & (EVR_MAX_SEQRAMEV - 1), i, i & 0x7f);
+}
+
+static int BenchMmioInit(struct Bench *b)
+{
+  memset(b->buf, 0x5a, sizeof(b->buf));
+  return MrfMmioWidthSupported(b->arg) ? 0 : -1;
+}
+
+static void BenchMmioRd(struct Bench *b, int i)
+{
+  MrfMmioCopyIn(b->buf, &b->pEr->Databuf[0], EVR_MAX_BUFFER, b->arg);
+}
+
+static void BenchMmioWr(struct Bench *b, int i)
+{
+  MrfMmioCopyOut(&b->pEr->TxDatabuf[0], b->buf, EVR_MAX_BUFFER, b->arg);
+}
+
+static void BenchFreqToCw(struct Bench *b, int i)
+{
+  b->sink = freq_to_cw(124.916 + (i & 7) * 0.001);
+}
+
+static struct BenchCase BenchCases[] = {
+  {"open", 0, BenchOpenInit, NULL, BenchOpen, 0, 0},
+  {"get", 0, NULL, NULL, BenchGet, 0, 0},
+  {"set", 0, NULL, NULL, BenchSet, 0, 1},
+  {"mapram", 0, NULL, NULL, BenchMapRam, 0, 1},
+  {"fifo", EVSIM_FIFO_DEPTH, BenchFIFOInit, BenchFIFOPrep, BenchFIFO, 0, 1},
+  {"log", 0, BenchLogInit, NULL, BenchLog, 0, 1},
+  {"dbufrx", 0, BenchDBufInit, NULL, BenchDBufRx, 0, 1},
+  {"dbuftx", 0, BenchDBufInit, NULL, BenchDBufTx, 0, 1},
+  {"segscan", 0, NULL, NULL, BenchSegScan, 0, 0},
+  {"seqram", 0, NULL, NULL, BenchSeqRam, 0, 1},
+  {"mmiord4", 0, BenchMmioInit, NULL, BenchMmioRd, 4, 0},
+  {"mmiord8", 0, BenchMmioInit, NULL, BenchMmioRd, 8, 0},
+  {"mmiord16", 0, BenchMmioInit, NULL, BenchMmioRd, 16, 0},
+  {"mmiord32", 0, BenchMmioInit, NULL, BenchMmioRd, 32, 0},
+  {"mmiowr4", 0, BenchMmioInit, NULL, BenchMmioWr, 4, 1},
+  {"mmiowr8", 0, BenchMmioInit, NULL, BenchMmioWr, 8, 1},
+  {"mmiowr16", 0, BenchMmioInit, NULL, BenchMmioWr, 16, 1},
+  {"mmiowr32", 0, BenchMmioInit, NULL, BenchMmioWr, 32, 1},
+  {"freq_to_cw", 0, NULL, NULL, BenchFreqToCw, 0, 0},
+  {NULL, 0, NULL, NULL, NULL, 0, 0}
+};
+
+/* Returns modeled time of batch in ns, trap handler time in *trap */
+static long long BenchBatch(struct Bench *b, struct BenchCase *c, int ops,
+			    long long *trap)
+{
+  struct MmioTrapTime t0, t1;
+  struct timespec start, end;
+  long long ns;
+  int i;
+
+  if (c->prep)
+    c->prep(b, ops);
+  MmioTrapGetTime(&t0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < ops; i++)
+    c->op(b, i);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  MmioTrapGetTime(&t1);
+
+  ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+    (end.tv_nsec - start.tv_nsec);
+  if (trap)
+    *trap = 0;
+  if (b->mode != BENCH_MODE_SIM)
+    return ns;
+  if (trap)
+    *trap = t1.trap_ns - t0.trap_ns;
+  return ns - (t1.trap_ns - t0.trap_ns) + (t1.model_ns - t0.model_ns);
+}
+
+static void BenchCount(struct Bench *b, struct BenchCase *c, double *reads,
+		       double *writes)
+{
+  int attached = 0;
+
+  if (b->mode != BENCH_MODE_SIM)
+    attached = !MmioTraceAttach(b->pEr, b->size);
+  if (b->mode != BENCH_MODE_SIM && !attached)
+    {
+      *reads = *writes = -1.0;
+      return;
+    }
+
+  if (c->prep)
+    c->prep(b, BENCH_COUNT_OPS);
+  BenchReads = BenchWrites = 0;
+  MmioTrapSetAccount(BenchAccount);
+  BenchBatch(b, c, BENCH_COUNT_OPS, NULL);
+  MmioTrapSetAccount(NULL);
+  *reads = (double) BenchReads / BENCH_COUNT_OPS;
+  *writes = (double) BenchWrites / BENCH_COUNT_OPS;
+
+  if (attached)
+    MmioTraceDetach(b->pEr);
+}
+
+static int BenchCompare(const void *a, const void *b)
+{
+  double da = *(const double *) a, db = *(const double *) b;
+
+  return (da > db) - (da < db);
+}
+
+static double BenchPercentile(double *s, int n, double q)
+{
+  return s[(int) (q * (n - 1) + 0.5)];
+}
+
+int main(int argc, char *argv[])
+{
+  struct Bench     b;
+  struct BenchCase *c;
+  double           sample[BENCH_MAX_REPS];
+  double           sum, trap_sum, reads, writes;
+  long long        target_ns = 20000000LL, ns, trap;
+  int              reps = 31, warmup = 3, read_ns = -1, write_ns = -1;
+  int              wc = 0, destructive = 0, saved = -1;
+  char            *config = NULL;
+  int              i, ops, opt;
+  char            *format = "text", *only = NULL;
+  char            *modes[] = {"device", "sim", "mem"};
+  time_t           now = time(NULL);
+
+  while ((opt = getopt(argc, argv, "r:w:t:f:c:l:WD")) != -1)
+    switch (opt)
+      {
+      case 'r':
+	reps = atoi(optarg);
+	break;
+      case 'w':
+	warmup = atoi(optarg);
+	break;
+      case 't':
+	target_ns = atoi(optarg) * 1000000LL;
+	break;
+      case 'f':
+	format = optarg;
+	break;
+      case 'c':
+	only = optarg;
+	break;
+      case 'l':
+	sscanf(optarg, "%d,%d", &read_ns, &write_ns);
+	break;
+      case 'W':
+	wc = 1;
+	break;
+      case 'D':
+	destructive = 1;
+	break;
+      default:
+	argc = 0;
+      }
+
+  if (optind >= argc || reps < 1 || reps > BENCH_MAX_REPS)
+    {
+      printf("Usage: %s [options] /dev/era3|sim|mem\n", argv[0]);
+      printf("  -r reps      Timed repetitions (31)\n");
+      printf("  -w warmup    Warm-up repetitions (3)\n");
+      printf("  -t ms        Target time per repetition (20)\n");
+      printf("  -f format    text, csv or json (JSON lines)\n");
+      printf("  -c case      Run only one case\n");
+      printf("  -l rd,wr     Modeled register access latency in ns\n");
+      printf("  -W           Map bulk areas of device write-combining\n");
+      printf("  -D           Run cases that change device state, restore\n"
+	     "               configuration afterwards\n");
+      printf("Cases:");
+      for (c = BenchCases; c->name; c++)
+	printf(" %s", c->name);
+      printf("\n");
+      return -1;
+    }
+
+  memset(&b, 0, sizeof(b));
+  b.target = argv[optind];
+  if (!strcmp(b.target, "sim"))
+    {
+      b.mode = BENCH_MODE_SIM;
+      b.fd = EvrSimOpen(&b.pEr, "mrfbench");
+      if (b.fd >= 0 && read_ns >= 0)
+	EvSimSetLatency(b.fd, read_ns, write_ns >= 0 ? write_ns : 0);
+    }
+  else if (!strcmp(b.target, "mem"))
+    {
+      b.mode = BENCH_MODE_MEM;
+      b.size = sizeof(struct MrfErRegs);
+      b.pEr = mmap(0, b.size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      b.fd = (b.pEr == MAP_FAILED) ? -1 : 0;
+    }
+  else
+    {
+      b.mode = BENCH_MODE_DEVICE;
+      b.fd = EvrOpenSize(&b.pEr, b.target, &b.size);
+      if (b.fd >= 0 && wc && EvrWcOpen(b.pEr, b.fd) < 0)
+	printf("Could not map %s write-combining\n", b.target);
+    }
+  if (b.fd < 0)
+    {
+      printf("Could not open %s, errno %d\n", b.target, errno);
+      return errno;
+    }
+
+  if (b.mode == BENCH_MODE_DEVICE && destructive)
+    {
+      config = malloc(EvrConfigImageSize());
+      if (config)
+	saved = EvrConfigSave(b.pEr, config, EvrConfigImageSize());
+      if (saved < 0)
+	{
+	  printf("Could not save configuration of %s\n", b.target);
+	  free(config);
+	  EvrClose(b.fd);
+	  return -1;
+	}
+    }
+
+  if (!strcmp(format, "csv"))
+    printf("case,target,ops,reps,ns_min,ns_p50,ns_p90,ns_p99,ns_max,"
+	   "ns_mean,reads_per_op,writes_per_op,trap_ns_per_op\n");
+  else if (strcmp(format, "json"))
+    printf("%-10s %7s %10s %10s %10s %10s %10s %10s %7s %7s %10s\n",
+	   "Case", "Ops", "min ns", "p50 ns", "p90 ns", "p99 ns", "max ns",
+	   "mean ns", "Rd/op", "Wr/op", "Trap/op");
+
+  for (c = BenchCases; c->name; c++)
+    {
+      if (only && strcmp(only, c->name))
+	continue;
+      if (c->modify && b.mode == BENCH_MODE_DEVICE && !destructive)
+	{
+	  if (only)
+	    printf("Case %s changes device state, use -D\n", c->name);
+	  continue;
+	}
+      b.arg = c->arg;
+      if (c->init && c->init(&b))
+	continue;
+
+      /* Calibrate batch size */
+      for (ops = 1; ; ops *= 2)
+	{
+	  if (c->max_ops && ops * 2 > c->max_ops)
+	    break;
+	  if (BenchBatch(&b, c, ops, &trap) + trap >= target_ns)
+	    break;
+	}
+
+      for (i = 0; i < warmup; i++)
+	BenchBatch(&b, c, ops, NULL);
+      sum = trap_sum = 0.0;
+      for (i = 0; i < reps; i++)
+	{
+	  ns = BenchBatch(&b, c, ops, &trap);
+	  sample[i] = (double) ns / ops;
+	  sum += sample[i];
+	  trap_sum += (double) trap / ops;
+	}
+      qsort(sample, reps, sizeof(double), BenchCompare);
+
+      BenchCount(&b, c, &reads, &writes);
+
+      if (!strcmp(format, "csv"))
+	printf("%s,%s,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%.1f\n",
+	       c->name, modes[b.mode], ops, reps, sample[0],
+	       BenchPercentile(sample, reps, 0.5),
+	       BenchPercentile(sample, reps, 0.9),
+	       BenchPercentile(sample, reps, 0.99), sample[reps - 1],
+	       sum / reps, reads, writes, trap_sum / reps);
+      else if (!strcmp(format, "json"))
+	printf("{\"case\":\"%s\",\"target\":\"%s\",\"time\":%ld,\"ops\":%d,"
+	       "\"reps\":%d,\"ns_min\":%.1f,\"ns_p50\":%.1f,\"ns_p90\":%.1f,"
+	       "\"ns_p99\":%.1f,\"ns_max\":%.1f,\"ns_mean\":%.1f,"
+	       "\"reads_per_op\":%.2f,\"writes_per_op\":%.2f,"
+	       "\"trap_ns_per_op\":%.1f}\n",
+	       c->name, modes[b.mode], (long) now, ops, reps, sample[0],
+	       BenchPercentile(sample, reps, 0.5),
+	       BenchPercentile(sample, reps, 0.9),
+	       BenchPercentile(sample, reps, 0.99), sample[reps - 1],
+	       sum / reps, reads, writes, trap_sum / reps);
+      else
+	printf("%-10s %7d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %7.2f "
+	       "%7.2f %10.1f\n", c->name, ops, sample[0],
+	       BenchPercentile(sample, reps, 0.5),
+	       BenchPercentile(sample, reps, 0.9),
+	       BenchPercentile(sample, reps, 0.99), sample[reps - 1],
+	       sum / reps, reads, writes, trap_sum / reps);
+      fflush(stdout);
+    }
+
+  if (b.mode == BENCH_MODE_SIM)
+    EvrSimClose(b.fd);
+  else if (b.mode == BENCH_MODE_MEM)
+    munmap(b.pEr, b.size);
+  else
+    {
+      if (config)
+	{
+	  if (EvrConfigRestore(b.pEr, config, saved) < 0)
+	    printf("Could not restore configuration of %s\n", b.target);
+	  free(config);
+	}
+      if (wc)
+	MrfWcClose(b.pEr);
+      EvrClose(b.fd);
+    }
+
+  return 0;
+}
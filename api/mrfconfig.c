@@ -0,0 +1,877 @@
+/**
+@file mrfconfig.c
+@brief Binary configuration images of Micro-Research Event System
+       devices.
+
+EvrConfigSave() captures the configurable state of an Event Receiver
+into a compact, versioned image: Control, IrqEnable, clock settings,
+prescalers, distributed bus triggers, pulse generators, all output
+maps, input maps, CML outputs, both mapping RAMs and the sequence RAM.
+Runs of zero registers are not stored.
+
+EvrConfigRestore() writes the image back in address order with 32-bit
+stores, registers not stored in the image are written with zero, so
+the result is independent of the previous state. Outputs, mapping RAM
+and interrupts are disabled while the maps are written; Control and
+IrqEnable get their final values last. The PCI core interrupt enable is
+left to the kernel driver and neither restored nor verified.
+
+A configuration state object keeps a desired register image of an
+Event Receiver or Event Generator, changed with the usual API setters
+on the image returned by EvrConfigDesired() or EvgConfigDesired(), and
+the image last written to the device. MrfConfigStateApply() writes only
+the registers that differ, in address order, and optionally reads them
+back in one pass to verify.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+
+#include <stdio.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "mrflock.h"
+#include "mrfconfig.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define MRFCONFIG_FIELD_SIZE(type, field) sizeof(((struct type *) 0)->field)
+
+/* Control bits that are strobes or select little endian mode */
+#define EVRCONFIG_CTRL_VOLATILE ((1 << C_EVR_CTRL_RESET_TIMESTAMP) | \
+				 (1 << C_EVR_CTRL_LATCH_TIMESTAMP) | \
+				 (1 << C_EVR_CTRL_LOG_RESET) | \
+				 (1 << C_EVR_CTRL_LOG_ENABLE) | \
+				 (1 << C_EVR_CTRL_LOG_DISABLE) | \
+				 (1 << C_EVR_CTRL_RESET_EVENTFIFO) | \
+				 (1 << C_EVR_CTRL_LE_SWAPPED) | \
+				 (1 << C_EVR_CTRL_LE_MODE))
+
+/* Control bits cleared while the configuration is written */
+#define EVRCONFIG_CTRL_ENABLES ((1 << C_EVR_CTRL_MASTER_ENABLE) | \
+				(1 << C_EVR_CTRL_EVENT_FWD_ENA) | \
+				(1 << C_EVR_CTRL_OUTEN) | \
+				(1 << C_EVR_CTRL_MAP_RAM_ENABLE))
+
+static const struct MrfConfigRegion EvrConfigRegions[] = {
+  {offsetof(struct MrfErRegs, Control), 4, "Control"},
+  {offsetof(struct MrfErRegs, IrqEnable), 4, "IrqEnable"},
+  {offsetof(struct MrfErRegs, UsecDiv), 4, "UsecDiv"},
+  {offsetof(struct MrfErRegs, FracDiv), 4, "FracDiv"},
+  {offsetof(struct MrfErRegs, dc_target), 4, "dc_target"},
+  {offsetof(struct MrfErRegs, Prescaler),
+   offsetof(struct MrfErRegs, Resv0x160) -
+   offsetof(struct MrfErRegs, Prescaler), "Prescaler"},
+  {offsetof(struct MrfErRegs, DBusTrig),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, DBusTrig), "DBusTrig"},
+  {offsetof(struct MrfErRegs, Pulse),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, Pulse), "Pulse"},
+  {offsetof(struct MrfErRegs, FPOutMap),
+   offsetof(struct MrfErRegs, ExtinMap) -
+   offsetof(struct MrfErRegs, FPOutMap), "OutMap"},
+  {offsetof(struct MrfErRegs, ExtinMap),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, ExtinMap), "ExtinMap"},
+  {offsetof(struct MrfErRegs, CML),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, CML), "CML"},
+  {offsetof(struct MrfErRegs, MapRam),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, MapRam), "MapRam"},
+  {offsetof(struct MrfErRegs, SeqRam),
+   MRFCONFIG_FIELD_SIZE(MrfErRegs, SeqRam), "SeqRam"},
+  {0, 0, NULL}
+};
+
+/* EVG Control strobes and little endian mode bits */
+#define EVGCONFIG_CTRL_VOLATILE ((1 << C_EVG_CTRL_MXC_RESET) | \
+				 (1 << C_EVG_CTRL_LE_SWAPPED) | \
+				 (1 << C_EVG_CTRL_LE_MODE))
+
+/* EVG ClockControl status bits and DCM strobes */
+#define EVGCONFIG_CLKCTRL_VOLATILE ((1U << C_EVG_CLKCTRL_PLLL) | \
+				    (1 << C_EVG_CLKCTRL_PHTOGG) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_RUN) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_INITD) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_PSDONE) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_STOPPED) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_LOCKED) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_PSDONE) | \
+				    (1 << C_EVG_CLKCTRL_CGLOCK) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_PSDEC) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_PSINC) | \
+				    (1 << C_EVG_CLKCTRL_RECDCM_RESET) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_PSDEC) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_PSINC) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_SRUN) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_SRES) | \
+				    (1 << C_EVG_CLKCTRL_EVDCM_RES))
+
+/* EVG SeqRamControl status bits and strobes, the enable state is not
+   kept, use EvgSeqRamControl() after applying */
+#define EVGCONFIG_SQRC_VOLATILE ((1U << C_EVG_SQRC_RUNNING) | \
+				 (1 << C_EVG_SQRC_ENABLED) | \
+				 (1 << C_EVG_SQRC_SWTRIGGER) | \
+				 (1 << C_EVG_SQRC_RESET) | \
+				 (1 << C_EVG_SQRC_DISABLE) | \
+				 (1 << C_EVG_SQRC_ENABLE))
+
+static const struct MrfConfigRegion EvgConfigRegions[] = {
+  {offsetof(struct MrfEgRegs, Control), 4, "Control"},
+  {offsetof(struct MrfEgRegs, IrqEnable), 12, "IrqEnable"},
+  {offsetof(struct MrfEgRegs, DBusMap), 8, "DBusMap"},
+  {offsetof(struct MrfEgRegs, UsecDiv), 8, "UsecDiv"},
+  {offsetof(struct MrfEgRegs, SeqRamControl),
+   MRFCONFIG_FIELD_SIZE(MrfEgRegs, SeqRamControl), "SeqRamControl"},
+  {offsetof(struct MrfEgRegs, FracDiv), 4, "FracDiv"},
+  {offsetof(struct MrfEgRegs, EventTrigger),
+   MRFCONFIG_FIELD_SIZE(MrfEgRegs, EventTrigger), "EventTrigger"},
+  {offsetof(struct MrfEgRegs, SeqRamRepeatLow),
+   offsetof(struct MrfEgRegs, Resv0x01C0to0x03FC) -
+   offsetof(struct MrfEgRegs, SeqRamRepeatLow), "SeqRamRepeat"},
+  {offsetof(struct MrfEgRegs, FPOutMap),
+   offsetof(struct MrfEgRegs, Resv0x0580) -
+   offsetof(struct MrfEgRegs, FPOutMap), "OutMap"},
+  {offsetof(struct MrfEgRegs, TBInMap),
+   MRFCONFIG_FIELD_SIZE(MrfEgRegs, TBInMap), "TBInMap"},
+  {offsetof(struct MrfEgRegs, SeqRam),
+   MRFCONFIG_FIELD_SIZE(MrfEgRegs, SeqRam), "SeqRam"},
+  {0, 0, NULL}
+};
+
+static u32 MrfConfigCrcTable[256];
+static int MrfConfigCrcInit = 0;
+
+/**
+Compute CRC-32 (IEEE 802.3).
+
+@param data Data
+@param size Size of data in bytes
+@return Returns CRC.
+*/
+u32 MrfConfigCrc(const void *data, int size)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  u32 c;
+  int i, k;
+
+  if (!MrfConfigCrcInit)
+    {
+      for (i = 0; i < 256; i++)
+	{
+	  c = i;
+	  for (k = 0; k < 8; k++)
+	    c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+	  MrfConfigCrcTable[i] = c;
+	}
+      MrfConfigCrcInit = 1;
+    }
+
+  c = 0xffffffff;
+  for (i = 0; i < size; i++)
+    c = MrfConfigCrcTable[(c ^ p[i]) & 0xff] ^ (c >> 8);
+
+  return c ^ 0xffffffff;
+}
+
+/** @private */
+static u32 MrfConfigGet(const char *p)
+{
+  u32 v;
+
+  memcpy(&v, p, sizeof(v));
+  return be32_to_cpu(v);
+}
+
+/** @private */
+static void MrfConfigPut(char *p, u32 v)
+{
+  v = be32_to_cpu(v);
+  memcpy(p, &v, sizeof(v));
+}
+
+/**
+Check image header and CRC.
+
+@param image Configuration image
+@param size Size of image buffer
+@param type Expected device type, e.g. MRFCONFIG_TYPE_EVR
+@return Returns 0 if image is valid, -1 otherwise.
+*/
+int MrfConfigCheck(const void *image, int size, int type)
+{
+  const struct MrfConfigHeader *hdr = (const struct MrfConfigHeader *) image;
+  int isize;
+
+  if (size < sizeof(struct MrfConfigHeader))
+    return -1;
+  isize = be32_to_cpu(hdr->size);
+  if (be32_to_cpu(hdr->magic) != MRFCONFIG_MAGIC ||
+      be16_to_cpu(hdr->version) != MRFCONFIG_VERSION ||
+      be16_to_cpu(hdr->type) != type ||
+      isize < sizeof(struct MrfConfigHeader) || isize > size)
+    return -1;
+  if (MrfConfigCrc((const char *) image + sizeof(struct MrfConfigHeader),
+		   isize - sizeof(struct MrfConfigHeader))
+      != be32_to_cpu(hdr->crc))
+    return -1;
+
+  return 0;
+}
+
+/** @private */
+static int MrfConfigImageSize(const struct MrfConfigRegion *reg)
+{
+  int size = sizeof(struct MrfConfigHeader);
+
+  /* A chunk header is only spent on a run of more than two words */
+  for (; reg->size; reg++)
+    size += reg->size + 8;
+
+  return size;
+}
+
+/** @private */
+static int MrfConfigSave(volatile void *regs,
+			 const struct MrfConfigRegion *reg, int type,
+			 void *image, int size)
+{
+  struct MrfConfigHeader *hdr = (struct MrfConfigHeader *) image;
+  char *p = (char *) image + sizeof(struct MrfConfigHeader);
+  char *end = (char *) image + size;
+  volatile u32 *src;
+  u32 *tmp;
+  int chunks = 0, nw, w, start, last, max = 0;
+  const struct MrfConfigRegion *r;
+
+  if (size < sizeof(struct MrfConfigHeader))
+    return -1;
+  for (r = reg; r->size; r++)
+    if (r->size > max)
+      max = r->size;
+  tmp = malloc(max);
+  if (!tmp)
+    return -1;
+
+  for (r = reg; r->size; r++)
+    {
+      src = (volatile u32 *) ((volatile char *) regs + r->offset);
+      nw = r->size / 4;
+      for (w = 0; w < nw; w++)
+	tmp[w] = src[w];
+
+      w = 0;
+      while (w < nw)
+	{
+	  while (w < nw && !tmp[w])
+	    w++;
+	  if (w == nw)
+	    break;
+	  /* Chunk ends at region end or at a run of three zero words */
+	  start = last = w;
+	  while (w < nw && w - last < 3)
+	    {
+	      if (tmp[w])
+		last = w;
+	      w++;
+	    }
+	  if (p + 8 + (last - start + 1) * 4 > end)
+	    {
+	      free(tmp);
+	      return -1;
+	    }
+	  MrfConfigPut(p, r->offset + start * 4);
+	  MrfConfigPut(p + 4, last - start + 1);
+	  memcpy(p + 8, &tmp[start], (last - start + 1) * 4);
+	  p += 8 + (last - start + 1) * 4;
+	  chunks++;
+	  w = last + 1;
+	}
+    }
+  free(tmp);
+
+  hdr->magic = be32_to_cpu(MRFCONFIG_MAGIC);
+  hdr->version = be16_to_cpu(MRFCONFIG_VERSION);
+  hdr->type = be16_to_cpu(type);
+  hdr->size = be32_to_cpu(p - (char *) image);
+  hdr->chunks = be32_to_cpu(chunks);
+  hdr->crc = be32_to_cpu(MrfConfigCrc((char *) image +
+				      sizeof(struct MrfConfigHeader),
+				      p - (char *) image -
+				      sizeof(struct MrfConfigHeader)));
+
+  return p - (char *) image;
+}
+
+/**
+@private
+Check that chunks are in address order and each lies within a region.
+*/
+static int MrfConfigCheckChunks(const struct MrfConfigRegion *reg,
+				const void *image)
+{
+  const struct MrfConfigHeader *hdr = (const struct MrfConfigHeader *) image;
+  const char *p = (const char *) image + sizeof(struct MrfConfigHeader);
+  const char *end = (const char *) image + be32_to_cpu(hdr->size);
+  int chunks = be32_to_cpu(hdr->chunks);
+  u32 offset, words, prev = 0;
+  const struct MrfConfigRegion *r;
+
+  for (; chunks > 0; chunks--)
+    {
+      if (p + 8 > end)
+	return -1;
+      offset = MrfConfigGet(p);
+      words = MrfConfigGet(p + 4);
+      if (offset < prev || (offset & 3) || !words ||
+	  words > (end - p - 8) / 4)
+	return -1;
+      for (r = reg; r->size; r++)
+	if (offset >= r->offset && offset + words * 4 <= r->offset + r->size)
+	  break;
+      if (!r->size)
+	return -1;
+      prev = offset + words * 4;
+      p += 8 + words * 4;
+    }
+
+  return 0;
+}
+
+/**
+@private
+Look up register value in image, registers not stored are zero.
+*/
+static u32 MrfConfigLookup(const void *image, int offset)
+{
+  const struct MrfConfigHeader *hdr = (const struct MrfConfigHeader *) image;
+  const char *p = (const char *) image + sizeof(struct MrfConfigHeader);
+  int chunks = be32_to_cpu(hdr->chunks);
+  u32 start, words;
+
+  for (; chunks > 0; chunks--)
+    {
+      start = MrfConfigGet(p);
+      words = MrfConfigGet(p + 4);
+      if (offset >= start && offset < start + words * 4)
+	return MrfConfigGet(p + 8 + offset - start);
+      p += 8 + words * 4;
+    }
+
+  return 0;
+}
+
+/**
+@private
+Write or compare all regions in address order. Registers at offsets in
+skip are left alone.
+@return Returns number of registers differing when comparing.
+*/
+static int MrfConfigApply(volatile void *regs,
+			  const struct MrfConfigRegion *reg,
+			  const void *image, const int *skip, int compare)
+{
+  const struct MrfConfigHeader *hdr = (const struct MrfConfigHeader *) image;
+  const char *p = (const char *) image + sizeof(struct MrfConfigHeader);
+  int chunks = be32_to_cpu(hdr->chunks);
+  volatile u32 *dst;
+  u32 v, next, words = 0;
+  int pos, end, i, diff = 0;
+  const u32 *data = NULL;
+  u32 raw;
+
+  next = chunks ? MrfConfigGet(p) : 0xffffffff;
+  for (; reg->size; reg++)
+    {
+      end = reg->offset + reg->size;
+      for (pos = reg->offset; pos < end; pos += 4)
+	{
+	  if (pos == next)
+	    {
+	      words = MrfConfigGet(p + 4);
+	      data = (const u32 *) (p + 8);
+	      p += 8 + words * 4;
+	      next = (--chunks > 0) ? MrfConfigGet(p) : 0xffffffff;
+	    }
+	  if (words)
+	    {
+	      memcpy(&raw, data++, sizeof(raw));
+	      words--;
+	    }
+	  else
+	    raw = 0;
+
+	  for (i = 0; skip[i] >= 0; i++)
+	    if (skip[i] == pos)
+	      break;
+	  if (skip[i] >= 0)
+	    continue;
+
+	  dst = (volatile u32 *) ((volatile char *) regs + pos);
+	  if (compare)
+	    {
+	      v = *dst;
+	      if (v != raw)
+		diff++;
+	    }
+	  else
+	    *dst = raw;
+	}
+    }
+
+  return diff;
+}
+
+/**
+Get size of buffer large enough for any Event Receiver configuration
+image.
+
+@return Returns size in bytes.
+*/
+int EvrConfigImageSize(void)
+{
+  return MrfConfigImageSize(EvrConfigRegions);
+}
+
+/**
+Save Event Receiver configuration into image.
+
+@param pEr Pointer to MrfErRegs structure
+@param image Buffer for image
+@param size Size of buffer, EvrConfigImageSize() is always sufficient
+@return Returns size of image, -1 if buffer too small.
+*/
+int EvrConfigSave(volatile struct MrfErRegs *pEr, void *image, int size)
+{
+  return MrfConfigSave(pEr, EvrConfigRegions, MRFCONFIG_TYPE_EVR, image,
+		       size);
+}
+
+/**
+Restore Event Receiver configuration from image. The image is checked
+completely before the first register is written.
+
+@param pEr Pointer to MrfErRegs structure
+@param image Image saved with EvrConfigSave()
+@param size Size of image buffer
+@return Returns 0 on success, -1 on invalid image.
+*/
+int EvrConfigRestore(volatile struct MrfErRegs *pEr, const void *image,
+		     int size)
+{
+  int skip[] = {offsetof(struct MrfErRegs, Control),
+		offsetof(struct MrfErRegs, IrqEnable), -1};
+  u32 ctrl, irqen, pci;
+
+  if (MrfConfigCheck(image, size, MRFCONFIG_TYPE_EVR) ||
+      MrfConfigCheckChunks(EvrConfigRegions, image))
+    return -1;
+
+  ctrl = MrfConfigLookup(image, offsetof(struct MrfErRegs, Control));
+  ctrl &= ~EVRCONFIG_CTRL_VOLATILE;
+  irqen = MrfConfigLookup(image, offsetof(struct MrfErRegs, IrqEnable));
+  irqen &= ~EVR_IRQ_PCICORE_ENABLE;
+
+  MRF_LOCK(pEr->Control);
+  pEr->Control = be32_to_cpu(ctrl & ~EVRCONFIG_CTRL_ENABLES);
+  /* The PCI core interrupt enable belongs to the kernel driver */
+  pci = be32_to_cpu(pEr->IrqEnable) & EVR_IRQ_PCICORE_ENABLE;
+  pEr->IrqEnable = be32_to_cpu(pci);
+  MrfConfigApply(pEr, EvrConfigRegions, image, skip, 0);
+  pEr->IrqEnable = be32_to_cpu(irqen | pci);
+  pEr->Control = be32_to_cpu(ctrl);
+  MRF_UNLOCK(pEr->Control);
+
+  return 0;
+}
+
+/**
+Compare Event Receiver configuration with image.
+
+@param pEr Pointer to MrfErRegs structure
+@param image Image saved with EvrConfigSave()
+@param size Size of image buffer
+@return Returns number of registers differing, -1 on invalid image.
+*/
+int EvrConfigVerify(volatile struct MrfErRegs *pEr, const void *image,
+		    int size)
+{
+  int skip[] = {offsetof(struct MrfErRegs, Control),
+		offsetof(struct MrfErRegs, IrqEnable), -1};
+  u32 ctrl, irqen;
+  int diff;
+
+  if (MrfConfigCheck(image, size, MRFCONFIG_TYPE_EVR) ||
+      MrfConfigCheckChunks(EvrConfigRegions, image))
+    return -1;
+
+  diff = MrfConfigApply(pEr, EvrConfigRegions, image, skip, 1);
+  ctrl = MrfConfigLookup(image, offsetof(struct MrfErRegs, Control));
+  if ((be32_to_cpu(pEr->Control) ^ ctrl) & ~EVRCONFIG_CTRL_VOLATILE)
+    diff++;
+  irqen = MrfConfigLookup(image, offsetof(struct MrfErRegs, IrqEnable));
+  if ((be32_to_cpu(pEr->IrqEnable) ^ irqen) & ~EVR_IRQ_PCICORE_ENABLE)
+    diff++;
+
+#ifdef DEBUG
+  DEBUG_PRINTF("EvrConfigVerify: %d registers differ\n", diff);
+#endif
+
+  return diff;
+}
+
+/**
+@private
+Bits of a register owned by the kernel driver, in register byte order.
+They are carried over from the device when the register is written.
+*/
+static u32 MrfConfigKeep(int type, int offset)
+{
+  if (type == MRFCONFIG_TYPE_EVR &&
+      offset == offsetof(struct MrfErRegs, IrqEnable))
+    return be32_to_cpu(EVR_IRQ_PCICORE_ENABLE);
+  if (type == MRFCONFIG_TYPE_EVG &&
+      offset == offsetof(struct MrfEgRegs, IrqEnable))
+    return be32_to_cpu(EVG_IRQ_PCICORE_ENABLE);
+
+  return 0;
+}
+
+/**
+@private
+Bits of a register that must not be written back, in register byte
+order.
+*/
+static u32 MrfConfigVolatile(int type, int offset)
+{
+  u32 keep = MrfConfigKeep(type, offset);
+
+  if (keep)
+    return keep;
+  if (type == MRFCONFIG_TYPE_EVR &&
+      offset == offsetof(struct MrfErRegs, Control))
+    return be32_to_cpu(EVRCONFIG_CTRL_VOLATILE);
+  if (type == MRFCONFIG_TYPE_EVG &&
+      offset == offsetof(struct MrfEgRegs, Control))
+    return be32_to_cpu(EVGCONFIG_CTRL_VOLATILE);
+  if (type == MRFCONFIG_TYPE_EVG &&
+      offset == offsetof(struct MrfEgRegs, ClockControl))
+    return be32_to_cpu(EVGCONFIG_CLKCTRL_VOLATILE);
+  if (type == MRFCONFIG_TYPE_EVG &&
+      offset >= offsetof(struct MrfEgRegs, SeqRamControl) &&
+      offset < offsetof(struct MrfEgRegs, FracDiv))
+    return be32_to_cpu(EVGCONFIG_SQRC_VOLATILE);
+  /* Multiplexed counter state */
+  if (type == MRFCONFIG_TYPE_EVG &&
+      offset >= offsetof(struct MrfEgRegs, MXC) &&
+      offset < offsetof(struct MrfEgRegs, Resv0x01C0to0x03FC) &&
+      !((offset - offsetof(struct MrfEgRegs, MXC)) % sizeof(struct MXCStruct)))
+    return be32_to_cpu(1 << C_EVG_MXC_READ);
+
+  return 0;
+}
+
+/**
+@private
+The images cover the whole register map so that any API setter can be
+used on the desired image.
+*/
+static struct MrfConfigState *MrfConfigStateCreate(int type,
+						   const struct MrfConfigRegion *reg,
+						   int size)
+{
+  struct MrfConfigState *s;
+  const struct MrfConfigRegion *r;
+
+  for (r = reg; r->size; r++)
+    if (r->offset + r->size > size)
+      return NULL;
+
+  s = calloc(1, sizeof(struct MrfConfigState));
+  if (!s)
+    return NULL;
+  s->type = type;
+  s->regions = reg;
+  s->size = size;
+  s->desired = calloc(1, s->size);
+  s->applied = calloc(1, s->size);
+  if (!s->desired || !s->applied)
+    {
+      MrfConfigStateFree(s);
+      return NULL;
+    }
+
+  return s;
+}
+
+/**
+Create Event Receiver configuration state. The desired configuration
+is all zero and the device state is unknown until
+MrfConfigStateLoad() or the first MrfConfigStateApply().
+
+@return Returns pointer to state, NULL on error.
+*/
+struct MrfConfigState *EvrConfigStateCreate(void)
+{
+  return MrfConfigStateCreate(MRFCONFIG_TYPE_EVR, EvrConfigRegions,
+			      sizeof(struct MrfErRegs));
+}
+
+/**
+Create Event Generator configuration state.
+
+@return Returns pointer to state, NULL on error.
+*/
+struct MrfConfigState *EvgConfigStateCreate(void)
+{
+  return MrfConfigStateCreate(MRFCONFIG_TYPE_EVG, EvgConfigRegions,
+			      sizeof(struct MrfEgRegs));
+}
+
+/**
+Free configuration state.
+
+@param s Pointer to state
+*/
+void MrfConfigStateFree(struct MrfConfigState *s)
+{
+  free(s->desired);
+  free(s->applied);
+  free(s);
+}
+
+/**
+Get desired Event Receiver configuration. The image has the size of
+the whole register map, only its configuration registers are used;
+pass it to the API setters, e.g.
+EvrSetPulseParams(EvrConfigDesired(s), 0, 1, 100, 10).
+
+@param s Pointer to Event Receiver state
+@return Returns pointer to register image, NULL if not an EVR state.
+*/
+struct MrfErRegs *EvrConfigDesired(struct MrfConfigState *s)
+{
+  if (s->type != MRFCONFIG_TYPE_EVR)
+    return NULL;
+  return (struct MrfErRegs *) s->desired;
+}
+
+/**
+Get desired Event Generator configuration.
+
+@param s Pointer to Event Generator state
+@return Returns pointer to register image, NULL if not an EVG state.
+*/
+struct MrfEgRegs *EvgConfigDesired(struct MrfConfigState *s)
+{
+  if (s->type != MRFCONFIG_TYPE_EVG)
+    return NULL;
+  return (struct MrfEgRegs *) s->desired;
+}
+
+/**
+Read configuration of device into both the desired and the applied
+image.
+
+@param s Pointer to state
+@param regs Pointer to device registers, pEr or pEg
+@return Returns 0.
+*/
+int MrfConfigStateLoad(struct MrfConfigState *s, volatile void *regs)
+{
+  const struct MrfConfigRegion *r;
+  volatile u32 *src;
+  u32 *desired, *applied;
+  int w;
+
+  for (r = s->regions; r->size; r++)
+    {
+      src = (volatile u32 *) ((volatile char *) regs + r->offset);
+      desired = (u32 *) (s->desired + r->offset);
+      applied = (u32 *) (s->applied + r->offset);
+      for (w = 0; w < r->size / 4; w++)
+	desired[w] = applied[w] = src[w];
+    }
+  s->valid = 1;
+
+  return 0;
+}
+
+/**
+Forget the applied configuration, the next apply writes all registers.
+
+@param s Pointer to state
+*/
+void MrfConfigStateInvalidate(struct MrfConfigState *s)
+{
+  s->valid = 0;
+}
+
+/**
+Get the largest number of register writes an apply may need.
+
+@param s Pointer to state
+@return Returns number of configuration registers.
+*/
+int MrfConfigStateWords(struct MrfConfigState *s)
+{
+  const struct MrfConfigRegion *r;
+  int words = 0;
+
+  for (r = s->regions; r->size; r++)
+    words += r->size / 4;
+
+  return words;
+}
+
+/**
+Compute register writes that take the device from the applied to the
+desired configuration. The state is not changed. Bits owned by the
+kernel driver, e.g. the PCI core interrupt enable, are zero in the
+writes; MrfConfigStateApply() takes them over from the device.
+
+@param s Pointer to state
+@param w Table for writes in address order
+@param max Size of table, MrfConfigStateWords() is always sufficient
+@return Returns number of writes, -1 if table too small.
+*/
+int MrfConfigStateDiff(struct MrfConfigState *s, struct MrfConfigWrite *w,
+		       int max)
+{
+  const struct MrfConfigRegion *r;
+  u32 *desired, *applied, mask;
+  int i, n = 0;
+
+  for (r = s->regions; r->size; r++)
+    {
+      desired = (u32 *) (s->desired + r->offset);
+      applied = (u32 *) (s->applied + r->offset);
+      for (i = 0; i < r->size / 4; i++)
+	{
+	  mask = ~MrfConfigVolatile(s->type, r->offset + i * 4);
+	  if (s->valid && !((desired[i] ^ applied[i]) & mask))
+	    continue;
+	  if (n == max)
+	    return -1;
+	  w[n].offset = r->offset + i * 4;
+	  w[n].value = desired[i] & mask;
+	  n++;
+	}
+    }
+
+  return n;
+}
+
+/**
+Record writes as applied. Writes outside the register image or not
+aligned to a register are ignored.
+
+@param s Pointer to state
+@param w Table of writes returned by MrfConfigStateDiff()
+@param n Number of writes
+*/
+void MrfConfigStateCommit(struct MrfConfigState *s,
+			  const struct MrfConfigWrite *w, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (w[i].offset > (u32) s->size - 4 || (w[i].offset & 3))
+	continue;
+      *((u32 *) (s->applied + w[i].offset)) = w[i].value;
+    }
+  s->valid = 1;
+}
+
+/**
+Write list of registers.
+
+@param regs Pointer to device registers
+@param w Table of writes
+@param n Number of writes
+@return Returns n.
+*/
+int MrfConfigWriteList(volatile void *regs, const struct MrfConfigWrite *w,
+		       int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    *((volatile u32 *) ((volatile char *) regs + w[i].offset)) = w[i].value;
+
+  return n;
+}
+
+/**
+Write changed configuration registers to device.
+
+@param s Pointer to state
+@param regs Pointer to device registers, pEr or pEg
+@param verify Read back written registers after all writes
+@return Returns number of registers written, -1 on error or if read
+back failed. Registers that did not read back are written again on the
+next apply.
+*/
+int MrfConfigStateApply(struct MrfConfigState *s, volatile void *regs,
+			int verify)
+{
+  struct MrfConfigWrite *w;
+  u32 *rb = NULL, mask, keep;
+  int i, n, bad = 0;
+
+  w = malloc(MrfConfigStateWords(s) * sizeof(struct MrfConfigWrite));
+  if (!w)
+    return -1;
+  n = MrfConfigStateDiff(s, w, MrfConfigStateWords(s));
+  if (verify && n > 0)
+    {
+      rb = malloc(n * sizeof(u32));
+      if (!rb)
+	{
+	  free(w);
+	  return -1;
+	}
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      keep = MrfConfigKeep(s->type, w[i].offset);
+      if (keep)
+	w[i].value |= *((volatile u32 *) ((volatile char *) regs +
+					  w[i].offset)) & keep;
+    }
+  MrfConfigWriteList(regs, w, n);
+  MrfConfigStateCommit(s, w, n);
+
+  if (rb)
+    {
+      for (i = 0; i < n; i++)
+	rb[i] = *((volatile u32 *) ((volatile char *) regs + w[i].offset));
+      for (i = 0; i < n; i++)
+	{
+	  mask = ~MrfConfigVolatile(s->type, w[i].offset);
+	  if ((rb[i] ^ w[i].value) & mask)
+	    {
+	      *((u32 *) (s->applied + w[i].offset)) = ~w[i].value;
+	      bad++;
+	    }
+	}
+#ifdef DEBUG
+      DEBUG_PRINTF("MrfConfigStateApply: %d of %d registers failed\n", bad,
+		   n);
+#endif
+      free(rb);
+    }
+  free(w);
+
+  return bad ? -1 : n;
+}
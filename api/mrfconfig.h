@@ -0,0 +1,84 @@
+/*
+  mrfconfig.h -- Binary configuration images of Micro-Research
+                 Event System devices
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+
+  Image layout, all fields big-endian:
+
+    header  magic, version, type, size, crc, chunks
+    chunk   offset, words, data[words]
+    ...
+
+  Chunks are non-zero runs of configuration registers in address order,
+  registers of a region not covered by a chunk are zero. The crc is
+  CRC-32 of everything after the header.
+ */
+
+struct MrfErRegs;
+struct MrfEgRegs;
+
+#define MRFCONFIG_MAGIC        0x4d524643    /* "MRFC" */
+#define MRFCONFIG_VERSION      1
+#define MRFCONFIG_TYPE_EVR     1
+#define MRFCONFIG_TYPE_EVG     2
+
+struct MrfConfigHeader {
+  u32 magic;
+  u16 version;
+  u16 type;
+  u32 size;                       /* Image size including header */
+  u32 crc;
+  u32 chunks;
+};
+
+struct MrfConfigRegion {
+  int   offset;                   /* Byte offset in register map */
+  int   size;                     /* Size in bytes, multiple of four */
+  char *name;
+};
+
+struct MrfConfigWrite {
+  u32 offset;                     /* Byte offset in register map */
+  u32 value;                      /* Big-endian as in register */
+};
+
+/* Desired configuration and configuration last written to device */
+struct MrfConfigState {
+  int                           type;
+  const struct MrfConfigRegion *regions;
+  int                           size;       /* Size of register images */
+  char                         *desired;
+  char                         *applied;
+  int                           valid;      /* applied matches device */
+};
+
+int EvrConfigImageSize(void);
+int EvrConfigSave(volatile struct MrfErRegs *pEr, void *image, int size);
+int EvrConfigRestore(volatile struct MrfErRegs *pEr, const void *image,
+		     int size);
+int EvrConfigVerify(volatile struct MrfErRegs *pEr, const void *image,
+		    int size);
+int MrfConfigCheck(const void *image, int size, int type);
+u32 MrfConfigCrc(const void *data, int size);
+struct MrfConfigState *EvrConfigStateCreate(void);
+struct MrfConfigState *EvgConfigStateCreate(void);
+void MrfConfigStateFree(struct MrfConfigState *s);
+struct MrfErRegs *EvrConfigDesired(struct MrfConfigState *s);
+struct MrfEgRegs *EvgConfigDesired(struct MrfConfigState *s);
+int MrfConfigStateLoad(struct MrfConfigState *s, volatile void *regs);
+void MrfConfigStateInvalidate(struct MrfConfigState *s);
+int MrfConfigStateWords(struct MrfConfigState *s);
+int MrfConfigStateDiff(struct MrfConfigState *s, struct MrfConfigWrite *w,
+		       int max);
+void MrfConfigStateCommit(struct MrfConfigState *s,
+			  const struct MrfConfigWrite *w, int n);
+int MrfConfigWriteList(volatile void *regs, const struct MrfConfigWrite *w,
+		       int n);
+int MrfConfigStateApply(struct MrfConfigState *s, volatile void *regs,
+			int verify);
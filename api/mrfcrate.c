@@ -0,0 +1,99 @@
+/*
+  mrfcrate.c -- Micro-Research Event System
+                List and configure all devices of a host
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Opens all /dev/er*3 and /dev/eg*3 devices, or the devices given on
+  the command line, and lists type, form factor and firmware version.
+  With -c the configuration files <dir>/<device>.conf are applied to
+  all devices in parallel and the time taken per device is listed.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <byteswap.h>
+#include "erapi.h"
+#include "egapi.h"
+#include "mrfdev.h"
+
+int main(int argc, char *argv[])
+{
+  struct MrfDevList list;
+  struct MrfDev *dev;
+  struct timespec start, end;
+  char *confdir = NULL;
+  int threads = 0, failed = 0;
+  int i, opt;
+
+  while ((opt = getopt(argc, argv, "c:j:")) != -1)
+    switch (opt)
+      {
+      case 'c':
+	confdir = optarg;
+	break;
+      case 'j':
+	threads = atoi(optarg);
+	break;
+      default:
+	printf("Usage: %s [-c confdir] [-j threads] [/dev/era3 ...]\n",
+	       argv[0]);
+	return -1;
+      }
+
+  if (optind < argc)
+    {
+      list.n = 0;
+      for (i = optind; i < argc; i++)
+	if (MrfDevAdd(&list, argv[i]) < 0)
+	  printf("Could not open %s, errno %d\n", argv[i], errno);
+    }
+  else
+    MrfDevScan(&list);
+
+  if (!list.n)
+    {
+      printf("No devices found.\n");
+      return -1;
+    }
+
+  if (confdir)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      failed = MrfDevRun(&list, MrfDevApplyConfig, confdir, threads);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+    }
+
+  printf("%-20s %-4s %-14s %-9s", "Device", "Type", "Form factor",
+	 "Version");
+  if (confdir)
+    printf(" %7s %10s", "Stores", "ms");
+  printf("\n");
+  for (i = 0; i < list.n; i++)
+    {
+      dev = &list.dev[i];
+      printf("%-20s %-4s %-14s %08x", dev->name, MrfDevTypeName(dev->type),
+	     MrfDevFormName(dev->form), dev->version);
+      if (confdir && dev->result < 0)
+	printf(" %7s %10.3f", "error", dev->ns / 1000000.0);
+      else if (confdir)
+	printf(" %7d %10.3f", dev->result, dev->ns / 1000000.0);
+      printf("\n");
+    }
+  if (confdir)
+    printf("%d devices configured in %.3f ms, %d failed\n", list.n,
+	   ((end.tv_sec - start.tv_sec) * 1000000000LL +
+	    (end.tv_nsec - start.tv_nsec)) / 1000000.0, failed);
+
+  MrfDevCloseAll(&list);
+
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,391 @@
+/**
+@file mrfdev.c
+@brief Discovery and parallel configuration of all Micro-Research Event
+       System devices of a host.
+
+Devices are opened once by MrfDevScan() or MrfDevAdd() and stay mapped
+until MrfDevCloseAll(). MrfDevRun() hands the devices to a pool of
+threads, so bringing up a crate takes about as long as the slowest
+device instead of the sum of all devices.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <glob.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "erapi.h"
+#include "egapi.h"
+#include "mrfprog.h"
+#include "mrfdev.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+struct MrfDevPool {
+  struct MrfDevList *list;
+  MrfDevFunc         func;
+  void              *arg;
+  int                next;
+  pthread_mutex_t    lock;
+};
+
+/** @private */
+static const char *MrfDevBaseName(const char *name)
+{
+  const char *p = strrchr(name, '/');
+
+  return p ? p + 1 : name;
+}
+
+/** @private */
+static struct MrfDev *MrfDevNew(struct MrfDevList *list, const char *name,
+				const char *suffix)
+{
+  struct MrfDev *dev;
+
+  if (list->n >= MRFDEV_MAX_DEVICES ||
+      strlen(name) + strlen(suffix) >= MRFDEV_NAME_LEN)
+    return NULL;
+
+  dev = &list->dev[list->n];
+  memset(dev, 0, sizeof(struct MrfDev));
+  strcpy(dev->name, name);
+  strcat(dev->name, suffix);
+  dev->fd = -1;
+  dev->parent = -1;
+
+  return dev;
+}
+
+/** @private */
+static void MrfDevClassify(struct MrfDev *dev, volatile u32 *version)
+{
+  dev->version = be32_to_cpu(*version);
+  dev->type = (dev->version >> 28) & 0x0f;
+  dev->form = (dev->version >> 24) & 0x0f;
+  if (dev->type != MRFDEV_TYPE_EVR && dev->type != MRFDEV_TYPE_EVG)
+    dev->type = MRFDEV_TYPE_UNKNOWN;
+}
+
+/** @private */
+static void MrfDevAddEvmEvr(struct MrfDevList *list, int parent,
+			    const char *suffix, volatile u32 *regs)
+{
+  struct MrfDev *dev;
+  volatile struct MrfErRegs *pEr = (volatile struct MrfErRegs *) regs;
+
+  dev = MrfDevNew(list, list->dev[parent].name, suffix);
+  if (dev == NULL)
+    return;
+  MrfDevClassify(dev, &pEr->FPGAVersion);
+  if (dev->type != MRFDEV_TYPE_EVR)
+    return;
+  dev->parent = parent;
+  dev->pEr = pEr;
+  list->n++;
+}
+
+/**
+Open a device node and add it to the device list. Event Generator
+nodes are recognized by a name starting with "eg". The internal Event
+Receivers of an EVM are added as sub-devices; given by name, e.g.
+/dev/ega3.evrd, they are opened as Event Receivers.
+
+@param list Device list
+@param name Device node, e.g. /dev/era3
+@return Returns index of device in list, -1 on error.
+*/
+int MrfDevAdd(struct MrfDevList *list, const char *name)
+{
+  struct MrfDev *dev;
+  struct MrfErRegs *pEr;
+  struct MrfEgRegs *pEg;
+  char devname[MRFDEV_NAME_LEN];
+  int index = list->n;
+
+  dev = MrfDevNew(list, name, "");
+  if (dev == NULL)
+    return -1;
+  /* EvgOpen() and EvrOpen() take a non-const name */
+  strcpy(devname, name);
+
+  if (!strncmp(MrfDevBaseName(name), "eg", 2) && !strstr(name, ".evr"))
+    {
+      dev->fd = EvgOpen(&pEg, devname);
+      if (dev->fd == -1)
+	return -1;
+      dev->pEg = pEg;
+      MrfDevClassify(dev, &pEg->FPGAVersion);
+    }
+  else
+    {
+      dev->fd = EvrOpen(&pEr, devname);
+      if (dev->fd == -1)
+	return -1;
+      dev->pEr = pEr;
+      MrfDevClassify(dev, &pEr->FPGAVersion);
+    }
+#ifdef DEBUG
+  DEBUG_PRINTF("MrfDevAdd: %s FPGAVersion %08x\n", dev->name, dev->version);
+#endif
+
+  /* Registers of another device type, no device or firmware loading */
+  if (dev->type != (dev->pEg ? MRFDEV_TYPE_EVG : MRFDEV_TYPE_EVR))
+    {
+      if (dev->pEg)
+	EvgClose(dev->fd);
+      else
+	EvrClose(dev->fd);
+      return -1;
+    }
+  list->n++;
+
+  if (dev->pEg)
+    {
+      MrfDevAddEvmEvr(list, index, ".evrd", dev->pEg->EvrD);
+      MrfDevAddEvmEvr(list, index, ".evru", dev->pEg->EvrU);
+    }
+
+  return index;
+}
+
+/**
+Open all Event Receiver and Event Generator device nodes.
+
+@param list Device list, cleared first
+@return Returns number of devices found.
+*/
+int MrfDevScan(struct MrfDevList *list)
+{
+  char *patterns[] = {"/dev/er*3", "/dev/eg*3"};
+  glob_t g;
+  size_t i;
+  int p;
+
+  list->n = 0;
+  for (p = 0; p < 2; p++)
+    {
+      if (glob(patterns[p], 0, NULL, &g))
+	continue;
+      for (i = 0; i < g.gl_pathc; i++)
+	MrfDevAdd(list, g.gl_pathv[i]);
+      globfree(&g);
+    }
+
+  return list->n;
+}
+
+/**
+Close all devices of device list.
+
+@param list Device list
+*/
+void MrfDevCloseAll(struct MrfDevList *list)
+{
+  int i;
+
+  for (i = 0; i < list->n; i++)
+    {
+      if (list->dev[i].fd == -1)
+	continue;
+      if (list->dev[i].pEg)
+	EvgClose(list->dev[i].fd);
+      else
+	EvrClose(list->dev[i].fd);
+    }
+  list->n = 0;
+}
+
+/**
+Find device by name.
+
+@param list Device list
+@param name Device name, with or without /dev/
+@return Returns pointer to device, NULL if not found.
+*/
+struct MrfDev *MrfDevFind(struct MrfDevList *list, const char *name)
+{
+  int i;
+
+  for (i = 0; i < list->n; i++)
+    if (!strcmp(list->dev[i].name, name) ||
+	!strcmp(MrfDevBaseName(list->dev[i].name), name))
+      return &list->dev[i];
+
+  return NULL;
+}
+
+/**
+Get name of device type.
+
+@param type MRFDEV_TYPE_EVR or MRFDEV_TYPE_EVG
+@return Returns name of type.
+*/
+const char *MrfDevTypeName(int type)
+{
+  switch (type)
+    {
+    case MRFDEV_TYPE_EVR:
+      return "EVR";
+    case MRFDEV_TYPE_EVG:
+      return "EVG";
+    default:
+      return "unknown";
+    }
+}
+
+/**
+Get name of form factor.
+
+@param form Form factor, see EvrGetFormFactor()
+@return Returns name of form factor.
+*/
+const char *MrfDevFormName(int form)
+{
+  switch (form)
+    {
+    case 0:
+      return "CompactPCI 3U";
+    case 1:
+      return "PMC";
+    case 2:
+      return "VME64x";
+    case 4:
+      return "CompactPCI 6U";
+    case 6:
+      return "PXIe 3U";
+    case 7:
+      return "PCIe";
+    case 8:
+      return "mTCA.4";
+    default:
+      return "unknown";
+    }
+}
+
+/** @private */
+static void *MrfDevWorker(void *arg)
+{
+  struct MrfDevPool *pool = (struct MrfDevPool *) arg;
+  struct MrfDev *dev;
+  struct timespec start, end;
+  int i;
+
+  for (;;)
+    {
+      pthread_mutex_lock(&pool->lock);
+      i = pool->next++;
+      pthread_mutex_unlock(&pool->lock);
+      if (i >= pool->list->n)
+	break;
+
+      dev = &pool->list->dev[i];
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      dev->result = pool->func(dev, pool->arg);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      dev->ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+	(end.tv_nsec - start.tv_nsec);
+    }
+
+  return NULL;
+}
+
+/**
+Call function for all devices in parallel. The result and duration of
+each call are stored in the device entry.
+
+@param list Device list
+@param func Function to call, returns negative value on error
+@param arg Argument passed to func
+@param threads Number of threads, 0 for one per device, negative to
+call func for all devices in the calling thread
+@return Returns number of devices for which func failed.
+*/
+int MrfDevRun(struct MrfDevList *list, MrfDevFunc func, void *arg,
+	      int threads)
+{
+  struct MrfDevPool pool;
+  pthread_t tid[MRFDEV_MAX_THREADS];
+  int i, started, failed = 0;
+
+  if (threads == 0 || threads > list->n)
+    threads = list->n;
+  if (threads > MRFDEV_MAX_THREADS)
+    threads = MRFDEV_MAX_THREADS;
+
+  pool.list = list;
+  pool.func = func;
+  pool.arg = arg;
+  pool.next = 0;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  for (started = 0; started < threads; started++)
+    if (pthread_create(&tid[started], NULL, MrfDevWorker, &pool))
+      break;
+  /* Without any thread the caller does the work */
+  if (!started && list->n)
+    MrfDevWorker(&pool);
+  for (i = 0; i < started; i++)
+    pthread_join(tid[i], NULL);
+  pthread_mutex_destroy(&pool.lock);
+
+  for (i = 0; i < list->n; i++)
+    if (list->dev[i].result < 0)
+      failed++;
+
+  return failed;
+}
+
+/**
+Apply configuration file <confdir>/<device>.conf to device, e.g.
+era3.conf or ega3.evrd.conf, see mrfprog.h. Compiled configurations
+are cached in the same directory. Can be passed to MrfDevRun().
+
+@param dev Device
+@param confdir Configuration directory (char *)
+@return Returns number of register stores, 0 if there is no
+configuration for the device, -1 on error.
+*/
+int MrfDevApplyConfig(struct MrfDev *dev, void *confdir)
+{
+  char filename[1024];
+  struct MrfProg *prog;
+  int result, line;
+
+  snprintf(filename, sizeof(filename), "%s/%s.conf", (char *) confdir,
+	   MrfDevBaseName(dev->name));
+  if (access(filename, R_OK))
+    return 0;
+
+  if (dev->type == MRFDEV_TYPE_EVR)
+    result = EvrProgLoadConfig(filename, (char *) confdir, &prog, &line);
+  else if (dev->type == MRFDEV_TYPE_EVG)
+    result = EvgProgLoadConfig(filename, (char *) confdir, &prog, &line);
+  else
+    return -1;
+  if (result < 0)
+    {
+      if (line)
+	printf("%s:%d: error\n", filename, line);
+      return -1;
+    }
+  if (dev->type == MRFDEV_TYPE_EVR)
+    result = EvrProgApply(dev->pEr, prog);
+  else
+    result = EvgProgApply(dev->pEg, prog);
+  MrfProgFree(prog);
+
+  return result;
+}
@@ -0,0 +1,65 @@
+/*
+  mrfdev.h -- Discovery and parallel configuration of all
+              Micro-Research Event System devices of a host
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+
+  MrfDevScan() opens every /dev/er*3 and /dev/eg*3 node once and
+  classifies it by the type and form factor fields of FPGAVersion. The
+  Event Receivers of an EVM are added as sub-devices <name>.evrd and
+  <name>.evru sharing the mapping of the EVM.
+
+  MrfDevRun() calls a function for every device from a pool of threads
+  and records result and duration per device. Each device is handled by
+  one thread at a time, so the functions need no register locking
+  unless they touch the parent of an EVM sub-device.
+  With a negative thread count all calls are made in the calling
+  thread, as needed on the simulator.
+ */
+
+#define MRFDEV_MAX_DEVICES   32
+#define MRFDEV_MAX_THREADS   16
+#define MRFDEV_NAME_LEN      64
+
+/* FPGAVersion bits 31-28 */
+#define MRFDEV_TYPE_UNKNOWN  0
+#define MRFDEV_TYPE_EVR      1
+#define MRFDEV_TYPE_EVG      2
+
+struct MrfErRegs;
+struct MrfEgRegs;
+
+struct MrfDev {
+  char                        name[MRFDEV_NAME_LEN];
+  int                         type;     /* MRFDEV_TYPE_* */
+  int                         form;     /* See EvrGetFormFactor() */
+  u32                         version;  /* FPGAVersion register */
+  int                         fd;       /* -1 for EVM sub-devices */
+  int                         parent;   /* Index of EVM, -1 if none */
+  volatile struct MrfErRegs  *pEr;      /* Event Receiver or NULL */
+  volatile struct MrfEgRegs  *pEg;      /* Event Generator or NULL */
+  int                         result;   /* Of last MrfDevRun() */
+  long long                   ns;       /* Duration of last MrfDevRun() */
+};
+
+struct MrfDevList {
+  int           n;
+  struct MrfDev dev[MRFDEV_MAX_DEVICES];
+};
+
+typedef int (*MrfDevFunc)(struct MrfDev *dev, void *arg);
+
+int MrfDevAdd(struct MrfDevList *list, const char *name);
+int MrfDevScan(struct MrfDevList *list);
+void MrfDevCloseAll(struct MrfDevList *list);
+struct MrfDev *MrfDevFind(struct MrfDevList *list, const char *name);
+const char *MrfDevTypeName(int type);
+const char *MrfDevFormName(int form);
+int MrfDevRun(struct MrfDevList *list, MrfDevFunc func, void *arg,
+	      int threads);
+int MrfDevApplyConfig(struct MrfDev *dev, void *confdir);
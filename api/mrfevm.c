@@ -0,0 +1,208 @@
+/**
+@file mrfevm.c
+@brief Micro-Research Event Master handle covering the Event Generator,
+       Fan-Out/Concentrator and both internal Event Receivers.
+
+One open and one mapping per EVM, see mrfevm.h.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <endian.h>
+#include <byteswap.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "egapi.h"
+#include "erapi.h"
+#include "fctapi.h"
+#include "mrfevm.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/* FPGAVersion type field */
+#define EVM_TYPE_EVR   1
+#define EVM_TYPE_EVG   2
+
+#ifdef __unix__
+/**
+@private
+Type field of FPGAVersion, read in either byte order as the part may
+still be in little endian mode.
+*/
+static int EvmPartType(volatile u32 *version)
+{
+  u32 v = be32_to_cpu(*version);
+
+  if ((v >> 28) != EVM_TYPE_EVR && (v >> 28) != EVM_TYPE_EVG)
+    v = bswap_32(v);
+
+  return v >> 28;
+}
+
+/**
+Open EVM and map its registers once.
+
+@param evm Returns EVM handle with views of all parts
+@param device_name Name of device e.g. /dev/ega3
+@return Returns file descriptor of opened file, -1 on error or if the
+device is not an EVM.
+*/
+int EvmOpen(struct MrfEvm *evm, const char *device_name)
+{
+  struct MrfEgRegs *pEg;
+  void *map;
+  int fd;
+
+  memset(evm, 0, sizeof(struct MrfEvm));
+  evm->fd = -1;
+
+  fd = open(device_name, O_RDWR);
+  if (fd == -1)
+    return -1;
+
+  map = mmap(0, EVG_MEM_WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#ifdef DEBUG
+  DEBUG_PRINTF("EvmOpen: %s mapped at %p, errno %d\n", device_name, map,
+	       errno);
+#endif
+  if (map == MAP_FAILED)
+    {
+      close(fd);
+      return -1;
+    }
+
+  pEg = (struct MrfEgRegs *) map;
+  if (EvmPartType(&pEg->FPGAVersion) != EVM_TYPE_EVG ||
+      EvmPartType(&((struct MrfErRegs *) pEg->EvrD)->FPGAVersion) !=
+      EVM_TYPE_EVR ||
+      EvmPartType(&((struct MrfErRegs *) pEg->EvrU)->FPGAVersion) !=
+      EVM_TYPE_EVR)
+    {
+#ifdef DEBUG
+      DEBUG_PRINTF("EvmOpen: %s is not an EVM\n", device_name);
+#endif
+      munmap(map, EVG_MEM_WINDOW);
+      close(fd);
+      return -1;
+    }
+
+  evm->fd = fd;
+  evm->map = map;
+  evm->size = EVG_MEM_WINDOW;
+  evm->pEg = pEg;
+  evm->pFct = (struct MrfFctRegs *) pEg->Fct;
+  evm->pEvrD = (struct MrfErRegs *) pEg->EvrD;
+  evm->pEvrU = (struct MrfErRegs *) pEg->EvrU;
+
+  /* Put all parts in BE mode, as EvgOpen() and EvrOpen() */
+  pEg->Control = pEg->Control &
+    ~((1 << C_EVG_CTRL_LE_SWAPPED) | (1 << C_EVG_CTRL_LE_MODE));
+  evm->pEvrD->Control = evm->pEvrD->Control &
+    ~((1 << C_EVR_CTRL_LE_SWAPPED) | (1 << C_EVR_CTRL_LE_MODE));
+  evm->pEvrU->Control = evm->pEvrU->Control &
+    ~((1 << C_EVR_CTRL_LE_SWAPPED) | (1 << C_EVR_CTRL_LE_MODE));
+
+  return fd;
+}
+
+/**
+Remove interrupt handler, unmap registers and close EVM. All views of
+the handle are invalid afterwards.
+
+@param evm EVM handle
+@return Returns 0 on successful completion, -1 on error.
+*/
+int EvmClose(struct MrfEvm *evm)
+{
+  int result = 0;
+
+  if (evm->fd == -1)
+    return -1;
+
+  /* Other devices may still deliver SIGIO, restore what was there */
+  if (evm->irq)
+    {
+      fcntl(evm->fd, F_SETFL, fcntl(evm->fd, F_GETFL) & ~FASYNC);
+      sigaction(SIGIO, &evm->oldact, NULL);
+    }
+
+  if (munmap(evm->map, evm->size))
+    result = -1;
+  if (close(evm->fd))
+    result = -1;
+  memset(evm, 0, sizeof(struct MrfEvm));
+  evm->fd = -1;
+
+  return result;
+}
+
+/**
+Assign one interrupt handler for the whole EVM. The handler has to
+check the interrupt flags of the Event Generator and of both Event
+Receivers and call EvmIrqHandled() when done.
+
+@param evm EVM handle
+@param handler Signal handler called on SIGIO
+@return Returns 0 on success, -1 on error.
+*/
+int EvmIrqAssignHandler(struct MrfEvm *evm, void (*handler)(int))
+{
+  if (evm->fd == -1)
+    return -1;
+
+  if (!evm->irq && sigaction(SIGIO, NULL, &evm->oldact))
+    return -1;
+  EvgIrqAssignHandler(evm->pEg, evm->fd, handler);
+  evm->irq = 1;
+
+  return 0;
+}
+
+/**
+Re-enable EVM interrupts after handling.
+
+@param evm EVM handle
+@return Returns 0 on success, -1 on error.
+*/
+int EvmIrqHandled(struct MrfEvm *evm)
+{
+  if (evm->fd == -1)
+    return -1;
+
+  EvgIrqHandled(evm->fd);
+
+  return 0;
+}
+#else
+int EvmOpen(struct MrfEvm *evm, const char *device_name)
+{
+  return -1;
+}
+
+int EvmClose(struct MrfEvm *evm)
+{
+  return -1;
+}
+
+int EvmIrqAssignHandler(struct MrfEvm *evm, void (*handler)(int))
+{
+  return -1;
+}
+
+int EvmIrqHandled(struct MrfEvm *evm)
+{
+  return -1;
+}
+#endif
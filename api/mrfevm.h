@@ -0,0 +1,49 @@
+/*
+  mrfevm.h -- Micro-Research Event Master (EVM) handle with the
+              Event Generator, Fan-Out/Concentrator and both internal
+              Event Receivers of one board
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include signal.h and egapi.h before this file.
+
+  The register map of an EVM holds the Event Generator, the
+  Fan-Out/Concentrator at 0x10000 and the downstream and upstream
+  Event Receivers at 0x20000 and 0x30000. EvmOpen() opens the device
+  once, maps the whole window once and returns typed views into the
+  mapping. The views share the file descriptor and the interrupt
+  registration and are valid until EvmClose(), which unmaps the window.
+
+  EvmOpen() fails unless the FPGAVersion registers show an Event
+  Generator and two Event Receivers, a plain Event Generator has no
+  Event Receiver register blocks at these offsets.
+
+  The views can be used with all functions of egapi.h, fctapi.h and
+  erapi.h. Use EvmIrqAssignHandler() instead of EvgIrqAssignHandler()
+  or EvrIrqAssignHandler() on the views, the handler is called for
+  interrupts of all parts of the EVM. EvmClose() restores the SIGIO
+  action that was installed before EvmIrqAssignHandler().
+ */
+
+struct MrfFctRegs;
+struct MrfErRegs;
+
+struct MrfEvm {
+  int                fd;
+  void              *map;       /* Start of mapping */
+  int                size;      /* Size of mapping */
+  struct MrfEgRegs  *pEg;
+  struct MrfFctRegs *pFct;
+  struct MrfErRegs  *pEvrD;     /* Downstream Event Receiver */
+  struct MrfErRegs  *pEvrU;     /* Upstream Event Receiver */
+  int                irq;       /* Interrupt handler assigned */
+  struct sigaction   oldact;    /* SIGIO action before handler */
+};
+
+int EvmOpen(struct MrfEvm *evm, const char *device_name);
+int EvmClose(struct MrfEvm *evm);
+int EvmIrqAssignHandler(struct MrfEvm *evm, void (*handler)(int));
+int EvmIrqHandled(struct MrfEvm *evm);
@@ -0,0 +1,158 @@
+/**
+@file mrflock.c
+@brief Register access locking for Micro-Research Event System devices
+       shared between threads.
+
+Read-modify-write sequences like setting a bit in the EVR Control
+register are not atomic. When two threads share one mapping, e.g. a
+FIFO reader calling EvrClearFIFO() and a configuration thread calling
+EvrMapRamEnable(), one of the updates may be lost.
+
+The API functions take the lock of the register they modify for the
+duration of the read-modify-write sequence. Locks are striped: the
+register address selects one of MRFLOCK_STRIPES recursive mutexes, so
+threads working on different registers rarely contend and there is no
+global lock. A multi-access sequence on one register, e.g. bit-banging
+GPIOOut, holds the lock of that register for the whole sequence. Only
+one register lock is held at a time.
+
+Locking is opt-in per mapping with MrfLockRegister(). Register windows
+before sharing the handle between threads; registering or unregistering
+while other threads access the window is not supported.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "mrflock.h"
+
+volatile int MrfLockWindows = 0;
+
+static struct {
+  volatile char *base;
+  int size;
+} MrfLockWindow[MRFLOCK_MAX_WINDOWS];
+
+static pthread_mutex_t MrfLockStripe[MRFLOCK_STRIPES];
+static pthread_mutex_t MrfLockTable = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t MrfLockOnce = PTHREAD_ONCE_INIT;
+
+/** @private */
+static void MrfLockInit(void)
+{
+  pthread_mutexattr_t attr;
+  int i;
+
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  for (i = 0; i < MRFLOCK_STRIPES; i++)
+    pthread_mutex_init(&MrfLockStripe[i], &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+/**
+Enable register locking for memory mapped window.
+
+@param base Start of register window
+@param size Size of register window in bytes
+@return Returns 0 on success, -1 if window table is full.
+*/
+int MrfLockRegister(volatile void *base, int size)
+{
+  int i, result = -1;
+
+  pthread_once(&MrfLockOnce, MrfLockInit);
+
+  pthread_mutex_lock(&MrfLockTable);
+  for (i = 0; i < MRFLOCK_MAX_WINDOWS; i++)
+    if (MrfLockWindow[i].base == base)
+      {
+	MrfLockWindow[i].size = size;
+	result = 0;
+	break;
+      }
+  if (result)
+    for (i = 0; i < MRFLOCK_MAX_WINDOWS; i++)
+      if (!MrfLockWindow[i].base)
+	{
+	  MrfLockWindow[i].base = (volatile char *) base;
+	  MrfLockWindow[i].size = size;
+	  MrfLockWindows++;
+	  result = 0;
+	  break;
+	}
+  pthread_mutex_unlock(&MrfLockTable);
+
+  return result;
+}
+
+/**
+Disable register locking for memory mapped window.
+
+@param base Start of register window
+@return Returns 0 on success, -1 if window was not registered.
+*/
+int MrfLockUnregister(volatile void *base)
+{
+  int i, result = -1;
+
+  pthread_mutex_lock(&MrfLockTable);
+  for (i = 0; i < MRFLOCK_MAX_WINDOWS; i++)
+    if (MrfLockWindow[i].base == base)
+      {
+	MrfLockWindow[i].base = 0;
+	MrfLockWindow[i].size = 0;
+	MrfLockWindows--;
+	result = 0;
+	break;
+      }
+  pthread_mutex_unlock(&MrfLockTable);
+
+  return result;
+}
+
+/** @private */
+static pthread_mutex_t *MrfLockFind(volatile void *reg)
+{
+  volatile char *p = (volatile char *) reg;
+  uintptr_t h;
+  int i;
+
+  for (i = 0; i < MRFLOCK_MAX_WINDOWS; i++)
+    if (MrfLockWindow[i].base && p >= MrfLockWindow[i].base &&
+	p < MrfLockWindow[i].base + MrfLockWindow[i].size)
+      {
+	h = ((uintptr_t) reg >> 2) * 0x9E3779B1u;
+	return &MrfLockStripe[(h >> 16) % MRFLOCK_STRIPES];
+      }
+
+  return NULL;
+}
+
+/**
+Lock register. Use through MRF_LOCK().
+
+@param reg Address of register
+*/
+void MrfRegLock(volatile void *reg)
+{
+  pthread_mutex_t *m = MrfLockFind(reg);
+
+  if (m)
+    pthread_mutex_lock(m);
+}
+
+/**
+Unlock register. Use through MRF_UNLOCK().
+
+@param reg Address of register
+*/
+void MrfRegUnlock(volatile void *reg)
+{
+  pthread_mutex_t *m = MrfLockFind(reg);
+
+  if (m)
+    pthread_mutex_unlock(m);
+}
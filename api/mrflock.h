@@ -0,0 +1,35 @@
+/*
+  mrflock.h -- Register access locking for Micro-Research
+               Event System devices shared between threads
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Read-modify-write sequences on a register are protected by a lock
+  selected by hashing the register address. Locking is only done for
+  register windows registered with MrfLockRegister(), e.g. through
+  EvrSetThreadSafe() or EvgSetThreadSafe(). Without registered windows
+  the lock macros reduce to a test of one global variable.
+ */
+
+#define MRFLOCK_STRIPES      64
+#define MRFLOCK_MAX_WINDOWS  16
+
+#ifdef __unix__
+extern volatile int MrfLockWindows;
+
+int MrfLockRegister(volatile void *base, int size);
+int MrfLockUnregister(volatile void *base);
+void MrfRegLock(volatile void *reg);
+void MrfRegUnlock(volatile void *reg);
+
+#define MRF_LOCK(reg) do { if (MrfLockWindows) \
+      MrfRegLock((volatile void *) &(reg)); } while (0)
+#define MRF_UNLOCK(reg) do { if (MrfLockWindows) \
+      MrfRegUnlock((volatile void *) &(reg)); } while (0)
+#else
+#define MRF_LOCK(reg)
+#define MRF_UNLOCK(reg)
+#endif
@@ -0,0 +1,362 @@
+/**
+@file mrfmmio.c
+@brief Bulk copy to and from memory mapped registers of
+       Micro-Research Event System devices.
+
+All device accesses are aligned and of one fixed width per copy: 32 or
+64 bits, or 128 (SSE2) or 256 bits (AVX) on x86_64. The host side
+buffer is accessed with unaligned loads and stores.
+
+Stores through MrfMmioWrite() go through the write-combining window of
+the destination if one is registered, followed by a store fence.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "erapi.h"
+#include "mrfwc.h"
+#include "mrfmmio.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/* Selected widths, MRFMMIO_WIDTH_AUTO until first used */
+static int MrfMmioWidth[3];
+
+/**
+Check if the CPU can do device accesses of a given width.
+
+@param width Access width in bytes, 4, 8, 16 or 32
+@return Returns 1 if supported, 0 if not.
+*/
+int MrfMmioWidthSupported(int width)
+{
+  switch (width)
+    {
+    case 4:
+      return 1;
+    case 8:
+      return sizeof(long) == 8;
+#if defined(__x86_64__)
+    case 16:
+      return 1;
+    case 32:
+      return __builtin_cpu_supports("avx") ? 1 : 0;
+#endif
+    default:
+      return 0;
+    }
+}
+
+/** @private */
+static int MrfMmioAutoWidth(int access)
+{
+  int width;
+
+  if (access != MRFMMIO_WRITE_WC)
+    return MrfMmioWidthSupported(8) ? 8 : 4;
+
+  for (width = 32; width > 4; width /= 2)
+    if (MrfMmioWidthSupported(width))
+      break;
+
+  return width;
+}
+
+/**
+Select width of device accesses.
+
+@param access MRFMMIO_READ, MRFMMIO_WRITE or MRFMMIO_WRITE_WC
+@param width Access width in bytes, 4, 8, 16, 32 or MRFMMIO_WIDTH_AUTO
+@return Returns width selected, -1 on error.
+*/
+int MrfMmioSetWidth(int access, int width)
+{
+  if (access < MRFMMIO_READ || access > MRFMMIO_WRITE_WC)
+    return -1;
+  if (width == MRFMMIO_WIDTH_AUTO)
+    width = MrfMmioAutoWidth(access);
+  if (!MrfMmioWidthSupported(width))
+    return -1;
+
+  MrfMmioWidth[access] = width;
+#ifdef DEBUG
+  DEBUG_PRINTF("MrfMmioSetWidth: access %d width %d\n", access, width);
+#endif
+
+  return width;
+}
+
+/**
+Get width of device accesses.
+
+@param access MRFMMIO_READ, MRFMMIO_WRITE or MRFMMIO_WRITE_WC
+@return Returns access width in bytes, -1 on error.
+*/
+int MrfMmioGetWidth(int access)
+{
+  if (access < MRFMMIO_READ || access > MRFMMIO_WRITE_WC)
+    return -1;
+  if (!MrfMmioWidth[access])
+    MrfMmioWidth[access] = MrfMmioAutoWidth(access);
+
+  return MrfMmioWidth[access];
+}
+
+/** @private */
+static void MrfMmioIn32(char *d, volatile char *s, int n)
+{
+  u32 v;
+
+  for (; n > 0; n -= 4, d += 4, s += 4)
+    {
+      v = *((volatile u32 *) s);
+      memcpy(d, &v, 4);
+    }
+}
+
+/** @private */
+static void MrfMmioOut32(volatile char *d, const char *s, int n)
+{
+  u32 v;
+
+  for (; n > 0; n -= 4, d += 4, s += 4)
+    {
+      memcpy(&v, s, 4);
+      *((volatile u32 *) d) = v;
+    }
+}
+
+/** @private */
+static void MrfMmioIn64(char *d, volatile char *s, int n)
+{
+  uint64_t v;
+
+  for (; n > 0; n -= 8, d += 8, s += 8)
+    {
+      v = *((volatile uint64_t *) s);
+      memcpy(d, &v, 8);
+    }
+}
+
+/** @private */
+static void MrfMmioOut64(volatile char *d, const char *s, int n)
+{
+  uint64_t v;
+
+  for (; n > 0; n -= 8, d += 8, s += 8)
+    {
+      memcpy(&v, s, 8);
+      *((volatile uint64_t *) d) = v;
+    }
+}
+
+#if defined(__x86_64__)
+/** @private */
+static void MrfMmioIn128(char *d, volatile char *s, int n)
+{
+  __m128i v;
+
+  for (; n > 0; n -= 16, d += 16, s += 16)
+    {
+      v = *((volatile __m128i *) s);
+      _mm_storeu_si128((__m128i *) d, v);
+    }
+}
+
+/** @private */
+static void MrfMmioOut128(volatile char *d, const char *s, int n)
+{
+  __m128i v;
+
+  for (; n > 0; n -= 16, d += 16, s += 16)
+    {
+      v = _mm_loadu_si128((const __m128i *) s);
+      *((volatile __m128i *) d) = v;
+    }
+}
+
+/** @private */
+__attribute__((target("avx")))
+static void MrfMmioIn256(char *d, volatile char *s, int n)
+{
+  __m256i v;
+
+  for (; n > 0; n -= 32, d += 32, s += 32)
+    {
+      v = *((volatile __m256i *) s);
+      _mm256_storeu_si256((__m256i *) d, v);
+    }
+}
+
+/** @private */
+__attribute__((target("avx")))
+static void MrfMmioOut256(volatile char *d, const char *s, int n)
+{
+  __m256i v;
+
+  for (; n > 0; n -= 32, d += 32, s += 32)
+    {
+      v = _mm256_loadu_si256((const __m256i *) s);
+      *((volatile __m256i *) d) = v;
+    }
+}
+#endif
+
+/**
+Copy from device memory with accesses of fixed width.
+
+@param dst Host buffer, any alignment
+@param src Device address, multiple of four
+@param size Number of bytes to copy
+@param width Access width in bytes, unsupported widths use 4
+*/
+void MrfMmioCopyIn(void *dst, volatile void *src, int size, int width)
+{
+  volatile char *s = (volatile char *) src;
+  char *d = (char *) dst;
+  u32 v;
+  int n;
+
+  if (size <= 0)
+    return;
+  if (!MrfMmioWidthSupported(width))
+    width = 4;
+
+  /* Up to first address aligned to width */
+  for (; size >= 4 && ((unsigned long) s & (width - 1));
+       size -= 4, d += 4, s += 4)
+    MrfMmioIn32(d, s, 4);
+
+  n = size & ~(width - 1);
+  switch (width)
+    {
+    case 8:
+      MrfMmioIn64(d, s, n);
+      break;
+#if defined(__x86_64__)
+    case 16:
+      MrfMmioIn128(d, s, n);
+      break;
+    case 32:
+      MrfMmioIn256(d, s, n);
+      break;
+#endif
+    default:
+      MrfMmioIn32(d, s, n);
+    }
+  size -= n;
+  d += n;
+  s += n;
+
+  MrfMmioIn32(d, s, size & ~3);
+  d += size & ~3;
+  s += size & ~3;
+  if (size & 3)
+    {
+      v = *((volatile u32 *) s);
+      memcpy(d, &v, size & 3);
+    }
+}
+
+/**
+Copy to device memory with accesses of fixed width.
+
+@param dst Device address, multiple of four
+@param src Host buffer, any alignment
+@param size Number of bytes to copy
+@param width Access width in bytes, unsupported widths use 4
+*/
+void MrfMmioCopyOut(volatile void *dst, const void *src, int size, int width)
+{
+  volatile char *d = (volatile char *) dst;
+  const char *s = (const char *) src;
+  u32 v;
+  int n;
+
+  if (size <= 0)
+    return;
+  if (!MrfMmioWidthSupported(width))
+    width = 4;
+
+  for (; size >= 4 && ((unsigned long) d & (width - 1));
+       size -= 4, d += 4, s += 4)
+    MrfMmioOut32(d, s, 4);
+
+  n = size & ~(width - 1);
+  switch (width)
+    {
+    case 8:
+      MrfMmioOut64(d, s, n);
+      break;
+#if defined(__x86_64__)
+    case 16:
+      MrfMmioOut128(d, s, n);
+      break;
+    case 32:
+      MrfMmioOut256(d, s, n);
+      break;
+#endif
+    default:
+      MrfMmioOut32(d, s, n);
+    }
+  size -= n;
+  d += n;
+  s += n;
+
+  MrfMmioOut32(d, s, size & ~3);
+  d += size & ~3;
+  s += size & ~3;
+  if (size & 3)
+    {
+      v = 0;
+      memcpy(&v, s, size & 3);
+      *((volatile u32 *) d) = v;
+    }
+}
+
+/**
+Copy from device memory with the selected read width.
+
+@param dst Host buffer, any alignment
+@param src Device address, multiple of four
+@param size Number of bytes to copy
+*/
+void MrfMmioRead(void *dst, volatile void *src, int size)
+{
+  MrfMmioCopyIn(dst, src, size, MrfMmioGetWidth(MRFMMIO_READ));
+}
+
+/**
+Copy to device memory with the selected write width. The copy goes
+through the write-combining window of dst if there is one and is
+completed by a store fence.
+
+@param dst Device address in uncached register mapping, multiple of four
+@param src Host buffer, any alignment
+@param size Number of bytes to copy
+*/
+void MrfMmioWrite(volatile void *dst, const void *src, int size)
+{
+  volatile void *wc;
+
+  wc = MRF_WC(dst, (size + 3) & ~3);
+  if (wc != dst)
+    {
+      MrfMmioCopyOut(wc, src, size, MrfMmioGetWidth(MRFMMIO_WRITE_WC));
+      MrfWcFlush();
+    }
+  else
+    MrfMmioCopyOut(dst, src, size, MrfMmioGetWidth(MRFMMIO_WRITE));
+}
@@ -0,0 +1,42 @@
+/*
+  mrfmmio.h -- Bulk copy to and from memory mapped registers of
+               Micro-Research Event System devices
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  libc memcpy() picks its access sizes by length and alignment and may
+  use byte or unaligned accesses or rep movsb, which is undefined on
+  device memory. These routines access the device only with aligned
+  loads and stores of one fixed width; the host side buffer may have
+  any alignment.
+
+  The device address and the size must be multiples of four. Accesses
+  up to the first address aligned to the width and after the last one
+  are done 32 bits wide. A size that is not a multiple of four reads
+  the last word completely and, when writing, pads it with zeros.
+
+  The width is selected for each kind of access: reads, stores to the
+  uncached mapping and stores to a write-combining window (mrfwc.h).
+  With MRFMMIO_WIDTH_AUTO reads and uncached stores are 64 bits wide
+  on 64-bit CPUs, the same as the kernel memcpy_fromio(), and stores
+  to write-combining windows use the widest vector the CPU supports.
+  Wider reads can be selected after measuring them on the bridge in
+  use, see the copy cases of mrfbench.
+ */
+
+#define MRFMMIO_READ         0
+#define MRFMMIO_WRITE        1
+#define MRFMMIO_WRITE_WC     2
+
+#define MRFMMIO_WIDTH_AUTO   0
+
+int MrfMmioSetWidth(int access, int width);
+int MrfMmioGetWidth(int access);
+int MrfMmioWidthSupported(int width);
+void MrfMmioCopyIn(void *dst, volatile void *src, int size, int width);
+void MrfMmioCopyOut(volatile void *dst, const void *src, int size, int width);
+void MrfMmioRead(void *dst, volatile void *src, int size);
+void MrfMmioWrite(volatile void *dst, const void *src, int size);
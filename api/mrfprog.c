@@ -0,0 +1,913 @@
+/**
+@file mrfprog.c
+@brief Text configuration of Micro-Research Event System devices
+       compiled into register write programs.
+
+EvrProgCompile() and EvgProgCompile() run every statement of a
+configuration through the regular API setters twice, on a register
+image cleared to zeros and on one set to ones. Bits that differ from
+the initial value in either image are the bits set by the
+configuration, which gives both the values and the registers to write
+without knowing the register layout of each setter. The result is a
+flat list of 16 and 32-bit stores that EvrProgApply() or EvgProgApply()
+executes without parsing or range checks.
+
+The cache key covers the compiler version and build, so programs
+compiled by another build of the library are compiled again.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "erapi.h"
+#include "egcpci.h"
+#include "egapi.h"
+#include "mrflock.h"
+#include "mrfconfig.h"
+#include "mrfprog.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define MRFPROG_MAX_ARGS     7
+
+/* Bump when the same text compiles to a different program */
+#define MRFPROG_COMPILER_VERSION 2
+#define MRFPROG_STR(x)  MRFPROG_STR2(x)
+#define MRFPROG_STR2(x) #x
+#define MRFPROG_COMPILER "mrfprog " MRFPROG_STR(MRFPROG_COMPILER_VERSION) \
+  " " __DATE__ " " __TIME__
+
+/* Control bits that are strobes or select little endian mode */
+#define EVRPROG_CTRL_VOLATILE ((1 << C_EVR_CTRL_RESET_TIMESTAMP) | \
+			       (1 << C_EVR_CTRL_LATCH_TIMESTAMP) | \
+			       (1 << C_EVR_CTRL_LOG_RESET) | \
+			       (1 << C_EVR_CTRL_LOG_ENABLE) | \
+			       (1 << C_EVR_CTRL_LOG_DISABLE) | \
+			       (1 << C_EVR_CTRL_RESET_EVENTFIFO) | \
+			       (1 << C_EVR_CTRL_LE_SWAPPED) | \
+			       (1 << C_EVR_CTRL_LE_MODE))
+
+/* EVG Control strobes and little endian mode bits */
+#define EVGPROG_CTRL_VOLATILE ((1 << C_EVG_CTRL_MXC_RESET) | \
+			       (1 << C_EVG_CTRL_LE_SWAPPED) | \
+			       (1 << C_EVG_CTRL_LE_MODE))
+
+enum EvrProgStatement {
+  EVRPROG_ENABLE, EVRPROG_OUTPUT_ENABLE, EVRPROG_DC_ENABLE,
+  EVRPROG_DC_TARGET, EVRPROG_FRACDIV, EVRPROG_PRESCALER, EVRPROG_PULSE,
+  EVRPROG_PULSE_PROPS, EVRPROG_UNIVOUT, EVRPROG_FPOUT, EVRPROG_TBOUT,
+  EVRPROG_BPOUT, EVRPROG_EXTIN, EVRPROG_CML, EVRPROG_MAPRAM, EVRPROG_MAP,
+  EVRPROG_LED, EVRPROG_FIFO, EVRPROG_LATCH, EVRPROG_LOG, EVRPROG_LOGSTOP,
+  EVRPROG_FORWARD, EVRPROG_SEQRAM, EVRPROG_SEQRAM_CONTROL
+};
+
+enum EvgProgStatement {
+  EVGPROG_ENABLE, EVGPROG_RF_INPUT, EVGPROG_FRACDIV, EVGPROG_MXC_PRESCALER,
+  EVGPROG_MXC_TRIGGER, EVGPROG_DBUS_MAP, EVGPROG_AC_INPUT,
+  EVGPROG_AC_TRIGGER, EVGPROG_TRIGGER_EVENT, EVGPROG_UNIVIN, EVGPROG_FPIN,
+  EVGPROG_TBIN, EVGPROG_UNIVOUT, EVGPROG_FPOUT, EVGPROG_TBOUT,
+  EVGPROG_BPOUT, EVGPROG_SEQRAM, EVGPROG_SEQRAM_CONTROL,
+  EVGPROG_SEQRAM_REPEAT
+};
+
+struct MrfProgKeyword {
+  char      *name;
+  int        statement;
+  int        args;
+  long long  min[MRFPROG_MAX_ARGS];
+  long long  max[MRFPROG_MAX_ARGS];
+};
+
+/* Register modified bit by bit, without its volatile bits */
+struct MrfProgMasked {
+  int        offset;
+  u32        volatile_bits;
+};
+
+struct MrfProgDevice {
+  int                                 type;
+  int                                 size;     /* Size of register map */
+  const struct MrfProgKeyword        *keywords;
+  const struct MrfConfigRegion       *regions16;
+  const struct MrfProgMasked         *masked;   /* Written last, in order */
+  int (*execute)(volatile void *regs, int statement, long long *a);
+};
+
+/* Registers narrower than 32 bits, written with 16-bit stores */
+static const struct MrfConfigRegion EvrProg16BitRegions[] = {
+  {offsetof(struct MrfErRegs, FPOutMap),
+   offsetof(struct MrfErRegs, ExtinMap) -
+   offsetof(struct MrfErRegs, FPOutMap), "OutMap"},
+  {offsetof(struct MrfErRegs, CML),
+   sizeof(((struct MrfErRegs *) 0)->CML), "CML"},
+  {0, 0, NULL}
+};
+
+#define RAM_CODE {0, 1}, {EVR_MAPRAMS - 1, EVR_MAX_EVENT_CODE}
+
+static const struct MrfProgKeyword EvrProgKeywords[] = {
+  {"enable", EVRPROG_ENABLE, 1, {0}, {1}},
+  {"output_enable", EVRPROG_OUTPUT_ENABLE, 1, {0}, {1}},
+  {"dc_enable", EVRPROG_DC_ENABLE, 1, {0}, {1}},
+  {"dc_target", EVRPROG_DC_TARGET, 1, {0}, {UINT_MAX}},
+  {"fracdiv", EVRPROG_FRACDIV, 1, {0}, {UINT_MAX}},
+  {"prescaler", EVRPROG_PRESCALER, 2, {0, 0},
+   {EVR_MAX_PRESCALERS - 1, UINT_MAX}},
+  {"pulse", EVRPROG_PULSE, 4, {0, 0, 0, 0},
+   {EVR_MAX_PULSES - 1, UINT_MAX, UINT_MAX, UINT_MAX}},
+  {"pulse_props", EVRPROG_PULSE_PROPS, 6, {0, 0, 0, 0, 0, 0},
+   {EVR_MAX_PULSES - 1, 1, 1, 1, 1, 1}},
+  {"univout", EVRPROG_UNIVOUT, 2, {0, 0}, {EVR_MAX_UNIVOUT_MAP - 1, 0xffff}},
+  {"fpout", EVRPROG_FPOUT, 2, {0, 0}, {EVR_MAX_FPOUT_MAP - 1, 0xffff}},
+  {"tbout", EVRPROG_TBOUT, 2, {0, 0}, {EVR_MAX_TBOUT_MAP - 1, 0xffff}},
+  {"bpout", EVRPROG_BPOUT, 2, {0, 0}, {EVR_MAX_BPOUT_MAP - 1, 0xffff}},
+  {"extin", EVRPROG_EXTIN, 4, {0, 0, 0, 0},
+   {EVR_MAX_EXTIN_MAP - 1, EVR_MAX_EVENT_CODE, 1, 1}},
+  {"cml", EVRPROG_CML, 2, {0, 0}, {EVR_MAX_CML_OUTPUTS - 1, 1}},
+  {"mapram", EVRPROG_MAPRAM, 2, {0, 0}, {EVR_MAPRAMS - 1, 1}},
+  {"map", EVRPROG_MAP, 5, {0, 1, -1, -1, -1},
+   {EVR_MAPRAMS - 1, EVR_MAX_EVENT_CODE, EVR_MAX_PULSES - 1,
+    EVR_MAX_PULSES - 1, EVR_MAX_PULSES - 1}},
+  {"led", EVRPROG_LED, 2, RAM_CODE},
+  {"fifo", EVRPROG_FIFO, 2, RAM_CODE},
+  {"latch", EVRPROG_LATCH, 2, RAM_CODE},
+  {"log", EVRPROG_LOG, 2, RAM_CODE},
+  {"logstop", EVRPROG_LOGSTOP, 2, RAM_CODE},
+  {"forward", EVRPROG_FORWARD, 2, RAM_CODE},
+  {"seqram", EVRPROG_SEQRAM, 4, {0, 0, 0, 0},
+   {EVR_SEQRAMS - 1, EVR_MAX_SEQRAMEV - 1, UINT_MAX, EVR_MAX_EVENT_CODE}},
+  {"seqram_control", EVRPROG_SEQRAM_CONTROL, 5, {0, 0, 0, 0, 0},
+   {EVR_SEQRAMS - 1, 1, 1, 1, 0xff}},
+  {NULL, 0, 0, {0}, {0}}
+};
+
+static const struct MrfProgMasked EvrProgMasked[] = {
+  {offsetof(struct MrfErRegs, Control), EVRPROG_CTRL_VOLATILE},
+  {-1, 0}
+};
+
+static const struct MrfConfigRegion EvgProg16BitRegions[] = {
+  {offsetof(struct MrfEgRegs, FPOutMap),
+   offsetof(struct MrfEgRegs, FPInMap) -
+   offsetof(struct MrfEgRegs, FPOutMap), "OutMap"},
+  {0, 0, NULL}
+};
+
+#define INMAP_MAX(n) {n - 1, EVG_MAX_TRIGGERS - 1, EVG_DBUS_BITS - 1, 1, \
+    EVG_SEQRAMS - 1, 0xff}
+
+static const struct MrfProgKeyword EvgProgKeywords[] = {
+  {"enable", EVGPROG_ENABLE, 1, {0}, {1}},
+  {"rf_input", EVGPROG_RF_INPUT, 2, {0, 0},
+   {C_EVG_CLKCTRL_MAX_RFSEL, C_EVG_RFDIV_MASK}},
+  {"fracdiv", EVGPROG_FRACDIV, 1, {1}, {INT_MAX}},
+  {"mxc_prescaler", EVGPROG_MXC_PRESCALER, 2, {0, 0},
+   {EVG_MAX_MXCS - 1, UINT_MAX}},
+  {"mxc_trigger", EVGPROG_MXC_TRIGGER, 2, {0, -1},
+   {EVG_MAX_MXCS - 1, EVG_MAX_TRIGGERS - 1}},
+  {"dbus_map", EVGPROG_DBUS_MAP, 2, {0, 0},
+   {EVG_DBUS_BITS - 1, C_EVG_DBUS_SEL_MASK}},
+  {"ac_input", EVGPROG_AC_INPUT, 4, {0, 0, 0, 0},
+   {1, 7, (2 << (C_EVG_ACCTRL_DIV_HIGH - C_EVG_ACCTRL_DIV_LOW)) - 1,
+    (2 << (C_EVG_ACCTRL_DELAY_HIGH - C_EVG_ACCTRL_DELAY_LOW)) - 1}},
+  {"ac_trigger", EVGPROG_AC_TRIGGER, 1, {-1}, {EVG_MAX_TRIGGERS - 1}},
+  {"trigger_event", EVGPROG_TRIGGER_EVENT, 3, {0, 0, 0},
+   {EVG_TRIGGERS - 1, EVG_MAX_EVENT_CODE, 1}},
+  {"univin", EVGPROG_UNIVIN, 6, {0, -1, -1, 0, -1, 0},
+   INMAP_MAX(EVG_MAX_UNIVIN_MAP)},
+  {"fpin", EVGPROG_FPIN, 7, {0, -1, -1, 0, -1, -1, 0},
+   {EVG_MAX_FPIN_MAP - 1, EVG_MAX_TRIGGERS - 1, EVG_DBUS_BITS - 1, 1,
+    EVG_SEQRAMS - 1, EVG_SEQRAMS - 1, 0xff}},
+  {"tbin", EVGPROG_TBIN, 6, {0, -1, -1, 0, -1, 0},
+   INMAP_MAX(EVG_MAX_TBIN_MAP)},
+  {"univout", EVGPROG_UNIVOUT, 2, {0, 0}, {EVG_MAX_UNIVOUT_MAP - 1, 0xffff}},
+  {"fpout", EVGPROG_FPOUT, 2, {0, 0}, {EVG_MAX_FPOUT_MAP - 1, 0xffff}},
+  {"tbout", EVGPROG_TBOUT, 2, {0, 0}, {EVG_MAX_TBOUT_MAP - 1, 0xffff}},
+  {"bpout", EVGPROG_BPOUT, 2, {0, 0}, {EVG_MAX_BPOUT_MAP - 1, 0xffff}},
+  {"seqram", EVGPROG_SEQRAM, 4, {0, 0, 0, 0},
+   {EVG_SEQRAMS - 1, EVG_MAX_SEQRAMEV - 1, UINT_MAX, EVG_MAX_EVENT_CODE}},
+  {"seqram_control", EVGPROG_SEQRAM_CONTROL, 5, {0, 0, 0, 0, 0},
+   {EVG_SEQRAMS - 1, 1, 1, 1, C_EVG_SEQTRIG_MAX}},
+  {"seqram_repeat", EVGPROG_SEQRAM_REPEAT, 2, {0, 0},
+   {EVG_SEQRAMS - 1, UINT_MAX}},
+  {NULL, 0, 0, {0}, {0}}
+};
+
+/* Statements only set the RF input bits of ClockControl */
+static const struct MrfProgMasked EvgProgMasked[] = {
+  {offsetof(struct MrfEgRegs, ClockControl), 0},
+  {offsetof(struct MrfEgRegs, Control), EVGPROG_CTRL_VOLATILE},
+  {-1, 0}
+};
+
+/** @private */
+static unsigned long long MrfProgFnv(unsigned long long h, const void *data,
+				     int size)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  int i;
+
+  for (i = 0; i < size; i++)
+    {
+      h ^= p[i];
+      h *= 0x100000001b3ULL;
+    }
+
+  return h;
+}
+
+/**
+FNV-1a hash of configuration text.
+
+@param data Data
+@param size Size of data in bytes
+@return Returns 64-bit hash.
+*/
+unsigned long long MrfProgHash(const void *data, int size)
+{
+  return MrfProgFnv(0xcbf29ce484222325ULL, data, size);
+}
+
+/**
+@private
+Cache key of configuration text, the hash of compiler, device type and
+text.
+*/
+static unsigned long long MrfProgKey(int type, const char *text, int size)
+{
+  unsigned long long h;
+  unsigned char t = type;
+
+  h = MrfProgHash(MRFPROG_COMPILER, sizeof(MRFPROG_COMPILER));
+  h = MrfProgFnv(h, &t, 1);
+
+  return MrfProgFnv(h, text, size);
+}
+
+/** @private */
+static int MrfProg16Bit(const struct MrfProgDevice *dev, int offset)
+{
+  const struct MrfConfigRegion *r;
+
+  for (r = dev->regions16; r->size; r++)
+    if (offset >= r->offset && offset < r->offset + r->size)
+      return 1;
+
+  return 0;
+}
+
+/** @private */
+static int EvrProgExecute(volatile void *regs, int statement, long long *a)
+{
+  volatile struct MrfErRegs *pEr = (volatile struct MrfErRegs *) regs;
+
+  switch (statement)
+    {
+    case EVRPROG_ENABLE:
+      EvrEnable(pEr, a[0]);
+      return 0;
+    case EVRPROG_OUTPUT_ENABLE:
+      EvrOutputEnable(pEr, a[0]);
+      return 0;
+    case EVRPROG_DC_ENABLE:
+      EvrDCEnable(pEr, a[0]);
+      return 0;
+    case EVRPROG_DC_TARGET:
+      EvrSetTargetDelay(pEr, a[0]);
+      return 0;
+    case EVRPROG_FRACDIV:
+      EvrSetFracDiv(pEr, a[0]);
+      return 0;
+    case EVRPROG_PRESCALER:
+      EvrSetPrescaler(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_PULSE:
+      return EvrSetPulseParams(pEr, a[0], a[1], a[2], a[3]);
+    case EVRPROG_PULSE_PROPS:
+      return EvrSetPulseProperties(pEr, a[0], a[1], a[2], a[3], a[4], a[5]);
+    case EVRPROG_UNIVOUT:
+      EvrSetUnivOutMap(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_FPOUT:
+      EvrSetFPOutMap(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_TBOUT:
+      EvrSetTBOutMap(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_BPOUT:
+      EvrSetBPOutMap(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_EXTIN:
+      EvrSetExtEvent(pEr, a[0], a[1], a[2], a[3]);
+      return 0;
+    case EVRPROG_CML:
+      EvrCMLEnable(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_MAPRAM:
+      EvrMapRamEnable(pEr, a[0], a[1]);
+      return 0;
+    case EVRPROG_MAP:
+      return EvrSetPulseMap(pEr, a[0], a[1], a[2], a[3], a[4]);
+    case EVRPROG_LED:
+      return EvrSetLedEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_FIFO:
+      return EvrSetFIFOEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_LATCH:
+      return EvrSetLatchEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_LOG:
+      return EvrSetLogEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_LOGSTOP:
+      return EvrSetLogStopEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_FORWARD:
+      return EvrSetForwardEvent(pEr, a[0], a[1], 1);
+    case EVRPROG_SEQRAM:
+      return EvrSetSeqRamEvent(pEr, a[0], a[1], a[2], a[3]);
+    case EVRPROG_SEQRAM_CONTROL:
+      return EvrSeqRamControl(pEr, a[0], a[1], a[2], a[3], 0, a[4]);
+    }
+
+  return -1;
+}
+
+/** @private */
+static int EvgProgExecute(volatile void *regs, int statement, long long *a)
+{
+  volatile struct MrfEgRegs *pEg = (volatile struct MrfEgRegs *) regs;
+
+  switch (statement)
+    {
+    case EVGPROG_ENABLE:
+      EvgEnable(pEg, a[0]);
+      return 0;
+    case EVGPROG_RF_INPUT:
+      return EvgSetRFInput(pEg, a[0], a[1]);
+    case EVGPROG_FRACDIV:
+      EvgSetFracDiv(pEg, a[0]);
+      return 0;
+    case EVGPROG_MXC_PRESCALER:
+      return EvgSetMXCPrescaler(pEg, a[0], a[1]);
+    case EVGPROG_MXC_TRIGGER:
+      return EvgSetMxcTrigMap(pEg, a[0], a[1]) < 0 ? -1 : 0;
+    case EVGPROG_DBUS_MAP:
+      return EvgSetDBusMap(pEg, a[0], a[1]);
+    case EVGPROG_AC_INPUT:
+      return EvgSetACInput(pEg, a[0], a[1], a[2], a[3]);
+    case EVGPROG_AC_TRIGGER:
+      return EvgSetACMap(pEg, a[0]);
+    case EVGPROG_TRIGGER_EVENT:
+      return EvgSetTriggerEvent(pEg, a[0], a[1], a[2]);
+    case EVGPROG_UNIVIN:
+      return EvgSetUnivinMap(pEg, a[0], a[1], a[2], a[3], a[4], a[5]);
+    case EVGPROG_FPIN:
+      return EvgSetFPinMap(pEg, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+    case EVGPROG_TBIN:
+      return EvgSetTBinMap(pEg, a[0], a[1], a[2], a[3], a[4], a[5]);
+    case EVGPROG_UNIVOUT:
+      EvgSetUnivOutMap(pEg, a[0], a[1]);
+      return 0;
+    case EVGPROG_FPOUT:
+      EvgSetFPOutMap(pEg, a[0], a[1]);
+      return 0;
+    case EVGPROG_TBOUT:
+      EvgSetTBOutMap(pEg, a[0], a[1]);
+      return 0;
+    case EVGPROG_BPOUT:
+      EvgSetBPOutMap(pEg, a[0], a[1]);
+      return 0;
+    case EVGPROG_SEQRAM:
+      return EvgSetSeqRamEvent(pEg, a[0], a[1], a[2], a[3], 0);
+    case EVGPROG_SEQRAM_CONTROL:
+      return EvgSeqRamControl(pEg, a[0], a[1], a[2], a[3], 0, a[4], -1);
+    case EVGPROG_SEQRAM_REPEAT:
+      return EvgSeqRamSetRepeat(pEg, a[0], a[1]);
+    }
+
+  return -1;
+}
+
+static const struct MrfProgDevice EvrProgDevice = {
+  MRFPROG_TYPE_EVR, sizeof(struct MrfErRegs), EvrProgKeywords,
+  EvrProg16BitRegions, EvrProgMasked, EvrProgExecute
+};
+
+static const struct MrfProgDevice EvgProgDevice = {
+  MRFPROG_TYPE_EVG, sizeof(struct MrfEgRegs), EvgProgKeywords,
+  EvgProg16BitRegions, EvgProgMasked, EvgProgExecute
+};
+
+/** @private */
+static const struct MrfProgDevice *MrfProgFindDevice(int type)
+{
+  if (type == MRFPROG_TYPE_EVR)
+    return &EvrProgDevice;
+  if (type == MRFPROG_TYPE_EVG)
+    return &EvgProgDevice;
+
+  return NULL;
+}
+
+/** @private */
+static int MrfProgParse(const struct MrfProgDevice *dev, char *s,
+			volatile void *zero, volatile void *ones)
+{
+  const struct MrfProgKeyword *kw;
+  long long a[MRFPROG_MAX_ARGS];
+  char *tok, *end, *save;
+  int i;
+
+  tok = strtok_r(s, " \t\r", &save);
+  if (tok == NULL)
+    return 0;
+
+  for (kw = dev->keywords; kw->name; kw++)
+    if (!strcmp(kw->name, tok))
+      break;
+  if (kw->name == NULL)
+    return -1;
+
+  for (i = 0; i < kw->args; i++)
+    {
+      tok = strtok_r(NULL, " \t\r", &save);
+      if (tok == NULL)
+	return -1;
+      errno = 0;
+      a[i] = strtoll(tok, &end, 0);
+      if (errno || *end || a[i] < kw->min[i] || a[i] > kw->max[i])
+	return -1;
+    }
+  if (strtok_r(NULL, " \t\r", &save) != NULL)
+    return -1;
+
+  if (dev->execute(zero, kw->statement, a) < 0 ||
+      dev->execute(ones, kw->statement, a) < 0)
+    return -1;
+
+  return 0;
+}
+
+/** @private */
+static int MrfProgCompile(const struct MrfProgDevice *dev, const char *text,
+			  int size, struct MrfProg **prog, int *line)
+{
+  u32 *zero, *ones, t, mask;
+  u16 *th;
+  char *buf, *s, *next, *c;
+  struct MrfProg *p;
+  struct MrfProgOp *op;
+  const struct MrfProgMasked *m;
+  int words = dev->size / 4;
+  int i, n, ln = 0;
+
+  if (line)
+    *line = 0;
+  zero = calloc(1, dev->size);
+  ones = malloc(dev->size);
+  buf = malloc(size + 1);
+  p = calloc(1, sizeof(struct MrfProg));
+  if (!zero || !ones || !buf || !p)
+    {
+      free(zero);
+      free(ones);
+      free(buf);
+      free(p);
+      return -1;
+    }
+  memset(ones, 0xff, dev->size);
+  memcpy(buf, text, size);
+  buf[size] = 0;
+
+  for (s = buf; s; s = next)
+    {
+      ln++;
+      next = strchr(s, '\n');
+      if (next)
+	*next++ = 0;
+      c = strchr(s, '#');
+      if (c)
+	*c = 0;
+      if (MrfProgParse(dev, s, (volatile void *) zero,
+		       (volatile void *) ones) < 0)
+	{
+#ifdef DEBUG
+	  DEBUG_PRINTF("MrfProgCompile: error on line %d\n", ln);
+#endif
+	  if (line)
+	    *line = ln;
+	  free(zero);
+	  free(ones);
+	  free(buf);
+	  free(p);
+	  return -1;
+	}
+    }
+  free(buf);
+
+  /* zero[] holds the values, ones[] gets the bits set by the configuration */
+  n = 0;
+  for (i = 0; i < words; i++)
+    {
+      ones[i] = zero[i] | ~ones[i];
+      if (ones[i])
+	n++;
+    }
+
+  p->op = malloc((n + 1) * sizeof(struct MrfProgOp));
+  if (!p->op)
+    {
+      free(zero);
+      free(ones);
+      free(p);
+      return -1;
+    }
+  p->type = dev->type;
+  p->hash = MrfProgKey(dev->type, text, size);
+
+  op = p->op;
+  for (i = 0; i < words; i++)
+    {
+      t = ones[i];
+      if (!t)
+	continue;
+      for (m = dev->masked; m->offset >= 0; m++)
+	if (m->offset == i * 4)
+	  break;
+      if (m->offset >= 0)
+	continue;
+      th = (u16 *) &t;
+      op->offset = i * 4;
+      op->size = 4;
+      op->value = zero[i];
+      op->mask = 0;
+      if ((!th[0] || !th[1]) && MrfProg16Bit(dev, op->offset))
+	{
+	  op->size = 2;
+	  if (!th[0])
+	    op->offset += 2;
+	  op->value = ((u16 *) &zero[i])[th[0] ? 0 : 1];
+	}
+      op++;
+    }
+  for (m = dev->masked; m->offset >= 0; m++)
+    {
+      i = m->offset / 4;
+      mask = ones[i] & ~be32_to_cpu(m->volatile_bits);
+      if (!mask)
+	continue;
+      op->offset = m->offset;
+      op->size = 4;
+      op->value = zero[i] & mask;
+      op->mask = mask;
+      op++;
+    }
+  p->ops = op - p->op;
+
+  free(zero);
+  free(ones);
+  *prog = p;
+
+  return p->ops;
+}
+
+/**
+Compile Event Receiver configuration text into a register write
+program.
+
+@param text Configuration text
+@param size Size of text in bytes
+@param prog Returns pointer to program, free with MrfProgFree()
+@param line Returns line number of first error, may be NULL
+@return Returns number of register stores, -1 on error.
+*/
+int EvrProgCompile(const char *text, int size, struct MrfProg **prog,
+		   int *line)
+{
+  return MrfProgCompile(&EvrProgDevice, text, size, prog, line);
+}
+
+/**
+Compile Event Generator configuration text into a register write
+program.
+
+@param text Configuration text
+@param size Size of text in bytes
+@param prog Returns pointer to program, free with MrfProgFree()
+@param line Returns line number of first error, may be NULL
+@return Returns number of register stores, -1 on error.
+*/
+int EvgProgCompile(const char *text, int size, struct MrfProg **prog,
+		   int *line)
+{
+  return MrfProgCompile(&EvgProgDevice, text, size, prog, line);
+}
+
+/** @private */
+static int MrfProgRun(volatile void *regs, const struct MrfProg *prog)
+{
+  const struct MrfProgOp *op, *end = prog->op + prog->ops;
+  volatile char *base = (volatile char *) regs;
+  volatile u32 *reg;
+
+  for (op = prog->op; op < end; op++)
+    {
+      if (op->size == 2)
+	*((volatile u16 *) (base + op->offset)) = op->value;
+      else if (!op->mask)
+	*((volatile u32 *) (base + op->offset)) = op->value;
+      else
+	{
+	  reg = (volatile u32 *) (base + op->offset);
+	  MRF_LOCK(*reg);
+	  *reg = (*reg & ~op->mask) | op->value;
+	  MRF_UNLOCK(*reg);
+	}
+    }
+
+  return prog->ops;
+}
+
+/**
+Execute Event Receiver register write program.
+
+@param pEr Pointer to MrfErRegs structure
+@param prog Program
+@return Returns number of register stores, -1 if not an EVR program.
+*/
+int EvrProgApply(volatile struct MrfErRegs *pEr, const struct MrfProg *prog)
+{
+  if (prog->type != MRFPROG_TYPE_EVR)
+    return -1;
+
+  return MrfProgRun(pEr, prog);
+}
+
+/**
+Execute Event Generator register write program.
+
+@param pEg Pointer to MrfEgRegs structure
+@param prog Program
+@return Returns number of register stores, -1 if not an EVG program.
+*/
+int EvgProgApply(volatile struct MrfEgRegs *pEg, const struct MrfProg *prog)
+{
+  if (prog->type != MRFPROG_TYPE_EVG)
+    return -1;
+
+  return MrfProgRun(pEg, prog);
+}
+
+/**
+Write program to file.
+
+@param prog Program
+@param filename File name
+@return Returns 0 on success, -1 on error.
+*/
+int MrfProgSave(const struct MrfProg *prog, const char *filename)
+{
+  struct MrfProgHeader hdr;
+  struct MrfProgOp *ops;
+  char tmp[1024];
+  FILE *fp;
+  int i, ok, fd;
+
+  ops = malloc(prog->ops * sizeof(struct MrfProgOp) + 1);
+  if (!ops)
+    return -1;
+  /* Offset and size big-endian, value and mask in register byte order */
+  for (i = 0; i < prog->ops; i++)
+    {
+      ops[i].offset = be32_to_cpu(prog->op[i].offset);
+      ops[i].size = be32_to_cpu(prog->op[i].size);
+      ops[i].value = prog->op[i].value;
+      ops[i].mask = prog->op[i].mask;
+    }
+
+  hdr.magic = be32_to_cpu(MRFPROG_MAGIC);
+  hdr.version = be16_to_cpu(MRFPROG_VERSION);
+  hdr.type = be16_to_cpu(prog->type);
+  hdr.hash_high = be32_to_cpu((u32) (prog->hash >> 32));
+  hdr.hash_low = be32_to_cpu((u32) prog->hash);
+  hdr.ops = be32_to_cpu(prog->ops);
+  hdr.crc = be32_to_cpu(MrfConfigCrc(ops, prog->ops *
+				     sizeof(struct MrfProgOp)));
+
+  /* Write to a temporary file and rename, devices configured in
+     parallel may save the same program at the same time */
+  snprintf(tmp, sizeof(tmp), "%s.XXXXXX", filename);
+  fd = mkstemp(tmp);
+  if (fd != -1)
+    fchmod(fd, 0644);
+  fp = (fd == -1) ? NULL : fdopen(fd, "wb");
+  if (fp == NULL)
+    {
+      if (fd != -1)
+	{
+	  close(fd);
+	  remove(tmp);
+	}
+      free(ops);
+      return -1;
+    }
+  ok = (fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+	fwrite(ops, sizeof(struct MrfProgOp), prog->ops, fp) ==
+	(size_t) prog->ops);
+  free(ops);
+  if (fclose(fp) || !ok || rename(tmp, filename))
+    {
+      remove(tmp);
+      return -1;
+    }
+
+  return 0;
+}
+
+/**
+Read program from file. EvrProgApply() and EvgProgApply() do no range
+checks, so every store of the program is checked to lie within the
+register map of the device type.
+
+@param filename File name
+@param hash Expected configuration hash
+@param prog Returns pointer to program, free with MrfProgFree()
+@return Returns 0 on success, -1 if file not valid for hash.
+*/
+int MrfProgLoad(const char *filename, unsigned long long hash,
+		struct MrfProg **prog)
+{
+  struct MrfProgHeader hdr;
+  struct MrfProg *p;
+  struct MrfProgOp *op;
+  const struct MrfProgDevice *dev;
+  FILE *fp;
+  int i, ops;
+
+  fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return -1;
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      be32_to_cpu(hdr.magic) != MRFPROG_MAGIC ||
+      be16_to_cpu(hdr.version) != MRFPROG_VERSION ||
+      be32_to_cpu(hdr.hash_high) != (u32) (hash >> 32) ||
+      be32_to_cpu(hdr.hash_low) != (u32) hash ||
+      (dev = MrfProgFindDevice(be16_to_cpu(hdr.type))) == NULL ||
+      be32_to_cpu(hdr.ops) > (u32) dev->size / 4)
+    {
+      fclose(fp);
+      return -1;
+    }
+
+  ops = be32_to_cpu(hdr.ops);
+  p = calloc(1, sizeof(struct MrfProg));
+  if (p)
+    p->op = malloc(ops * sizeof(struct MrfProgOp) + 1);
+  if (!p || !p->op ||
+      fread(p->op, sizeof(struct MrfProgOp), ops, fp) != (size_t) ops ||
+      MrfConfigCrc(p->op, ops * sizeof(struct MrfProgOp)) !=
+      be32_to_cpu(hdr.crc))
+    {
+      fclose(fp);
+      if (p)
+	MrfProgFree(p);
+      return -1;
+    }
+  fclose(fp);
+
+  for (i = 0; i < ops; i++)
+    {
+      op = &p->op[i];
+      op->offset = be32_to_cpu(op->offset);
+      op->size = be32_to_cpu(op->size);
+      if ((op->size != 2 && op->size != 4) ||
+	  op->offset > (u32) dev->size - op->size ||
+	  (op->offset & (op->size - 1)))
+	{
+#ifdef DEBUG
+	  DEBUG_PRINTF("MrfProgLoad: %s op %d out of range\n", filename, i);
+#endif
+	  MrfProgFree(p);
+	  return -1;
+	}
+    }
+  p->hash = hash;
+  p->type = be16_to_cpu(hdr.type);
+  p->ops = ops;
+  *prog = p;
+
+  return 0;
+}
+
+/** @private */
+static int MrfProgLoadConfig(const struct MrfProgDevice *dev,
+			     const char *filename, const char *cachedir,
+			     struct MrfProg **prog, int *line)
+{
+  char cache[1024];
+  char *text;
+  unsigned long long hash;
+  FILE *fp;
+  long size;
+  int i;
+
+  if (line)
+    *line = 0;
+  fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return -1;
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  text = malloc(size + 1);
+  if (!text || fread(text, 1, size, fp) != (size_t) size)
+    {
+      fclose(fp);
+      free(text);
+      return -1;
+    }
+  fclose(fp);
+
+  hash = MrfProgKey(dev->type, text, size);
+  if (cachedir)
+    {
+      snprintf(cache, sizeof(cache), "%s/%016llx.mrfp", cachedir, hash);
+      if (!MrfProgLoad(cache, hash, prog))
+	{
+	  if ((*prog)->type == dev->type)
+	    {
+	      free(text);
+	      return 1;
+	    }
+	  MrfProgFree(*prog);
+	}
+    }
+
+  i = MrfProgCompile(dev, text, size, prog, line);
+  free(text);
+  if (i < 0)
+    return -1;
+
+  /* A cache that cannot be written only costs the next compile */
+  if (cachedir)
+    MrfProgSave(*prog, cache);
+
+  return 0;
+}
+
+/**
+Get Event Receiver program for configuration file, from the cache if
+the configuration has been compiled before by this build.
+
+@param filename Configuration file name
+@param cachedir Cache directory, NULL to always compile
+@param prog Returns pointer to program, free with MrfProgFree()
+@param line Returns line number of first error, may be NULL
+@return Returns 1 if program was found in cache, 0 if compiled, -1 on
+error.
+*/
+int EvrProgLoadConfig(const char *filename, const char *cachedir,
+		      struct MrfProg **prog, int *line)
+{
+  return MrfProgLoadConfig(&EvrProgDevice, filename, cachedir, prog, line);
+}
+
+/**
+Get Event Generator program for configuration file, from the cache if
+the configuration has been compiled before by this build.
+
+@param filename Configuration file name
+@param cachedir Cache directory, NULL to always compile
+@param prog Returns pointer to program, free with MrfProgFree()
+@param line Returns line number of first error, may be NULL
+@return Returns 1 if program was found in cache, 0 if compiled, -1 on
+error.
+*/
+int EvgProgLoadConfig(const char *filename, const char *cachedir,
+		      struct MrfProg **prog, int *line)
+{
+  return MrfProgLoadConfig(&EvgProgDevice, filename, cachedir, prog, line);
+}
+
+/**
+Free program.
+
+@param prog Program
+*/
+void MrfProgFree(struct MrfProg *prog)
+{
+  free(prog->op);
+  free(prog);
+}
@@ -0,0 +1,119 @@
+/*
+  mrfprog.h -- Text configuration of Micro-Research Event System
+               devices compiled into register write programs
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+
+  Configuration file, one statement per line, '#' starts a comment,
+  numbers are decimal, hex (0x) or octal (0). Event Receiver:
+
+    enable          <0|1>
+    output_enable   <0|1>
+    dc_enable       <0|1>
+    dc_target       <delay>
+    fracdiv         <cw>
+    prescaler       <prescaler> <divider>
+    pulse           <pulse> <prescaler> <delay> <width>
+    pulse_props     <pulse> <polarity> <reset> <set> <trigger> <enable>
+    univout         <output> <map>
+    fpout           <output> <map>
+    tbout           <output> <map>
+    bpout           <output> <map>
+    extin           <input> <code> <edge> <level>
+    cml             <output> <0|1>
+    mapram          <ram> <0|1>
+    map             <ram> <code> <trigger> <set> <clear>   (-1 for none)
+    led             <ram> <code>
+    fifo            <ram> <code>
+    latch           <ram> <code>
+    log             <ram> <code>
+    logstop         <ram> <code>
+    forward         <ram> <code>
+    seqram          <ram> <pos> <timestamp> <code>
+    seqram_control  <ram> <enable> <single> <recycle> <trigsel>
+
+  Event Generator:
+
+    enable          <0|1>
+    rf_input        <rfsel> <divider>
+    fracdiv         <cw>
+    mxc_prescaler   <mxc> <prescaler>
+    mxc_trigger     <mxc> <trigger>                        (-1 for none)
+    dbus_map        <bit> <map>
+    ac_input        <bypass> <sync> <divider> <delay>
+    ac_trigger      <trigger>                              (-1 for none)
+    trigger_event   <trigger> <code> <enable>
+    univin          <input> <trigger> <dbus> <irq> <seqtrig> <mask>
+    fpin            <input> <trigger> <dbus> <irq> <seqtrig> <seqena> <mask>
+    tbin            <input> <trigger> <dbus> <irq> <seqtrig> <mask>
+    univout         <output> <map>
+    fpout           <output> <map>
+    tbout           <output> <map>
+    bpout           <output> <map>
+    seqram          <ram> <pos> <timestamp> <code>
+    seqram_control  <ram> <enable> <single> <recycle> <trigsel>
+    seqram_repeat   <ram> <count>
+
+  The input map trigger, dbus, seqtrig and seqena take -1 for none.
+
+  The compiler validates all arguments against the limits of erapi.h
+  and egapi.h and produces a list of register stores. Registers named
+  in the configuration are written completely, bits the configuration
+  does not set are cleared; only Control, and the EVG ClockControl, are
+  modified bit by bit and Control is written last. Registers not named
+  are left unchanged.
+
+  Compiled programs can be cached in a directory, keyed by a hash of
+  the compiler version and build, the device type and the configuration
+  text.
+ */
+
+#define MRFPROG_MAGIC        0x4d524650    /* "MRFP" */
+#define MRFPROG_VERSION      1
+#define MRFPROG_TYPE_EVR     1
+#define MRFPROG_TYPE_EVG     2
+
+struct MrfProgOp {
+  u32 offset;                     /* Byte offset in register map */
+  u32 size;                       /* Store size, 2 or 4 */
+  u32 value;                      /* In register byte order */
+  u32 mask;                       /* Non-zero: modify only these bits */
+};
+
+struct MrfProg {
+  unsigned long long hash;
+  int                type;
+  int                ops;
+  struct MrfProgOp  *op;
+};
+
+struct MrfProgHeader {
+  u32 magic;
+  u16 version;
+  u16 type;
+  u32 hash_high;
+  u32 hash_low;
+  u32 ops;
+  u32 crc;                        /* CRC-32 of ops */
+};
+
+unsigned long long MrfProgHash(const void *data, int size);
+int EvrProgCompile(const char *text, int size, struct MrfProg **prog,
+		   int *line);
+int EvgProgCompile(const char *text, int size, struct MrfProg **prog,
+		   int *line);
+int EvrProgApply(volatile struct MrfErRegs *pEr, const struct MrfProg *prog);
+int EvgProgApply(volatile struct MrfEgRegs *pEg, const struct MrfProg *prog);
+int MrfProgSave(const struct MrfProg *prog, const char *filename);
+int MrfProgLoad(const char *filename, unsigned long long hash,
+		struct MrfProg **prog);
+int EvrProgLoadConfig(const char *filename, const char *cachedir,
+		      struct MrfProg **prog, int *line);
+int EvgProgLoadConfig(const char *filename, const char *cachedir,
+		      struct MrfProg **prog, int *line);
+void MrfProgFree(struct MrfProg *prog);
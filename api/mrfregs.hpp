@@ -0,0 +1,787 @@
+/*
+  mrfregs.hpp -- Typed register and bit field descriptors for C++
+                 users of the Micro-Research Event System API
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file, e.g.
+
+    #include <stdint.h>
+    #include <endian.h>
+    #include <byteswap.h>
+    #include "erapi.h"
+    #include "egapi.h"
+    #include "mrfregs.hpp"
+
+  Bit positions and widths are taken from the C_EVR_* and C_EVG_*
+  definitions and the register offsets are checked against struct
+  MrfErRegs and struct MrfEgRegs at compile time, so this file cannot
+  drift from erapi.h and egapi.h unnoticed.
+
+  Field masks and constant values are converted to register byte order
+  at compile time: test, set, clear and constant writes of a field are
+  a single and/or with a constant on the raw register, only reading or
+  writing a variable multi-bit value costs a byte swap.
+
+    using namespace mrf;
+
+    set<evr::Control::MasterEnable>(pEr);
+    if (test<evr::Status::LogStopped>(pEr))
+      ...
+    put<evr::PulseControl::Polarity>(pEr, 1, pulse);
+    put<evr::SeqRamControl::TrigSel, 61>(pEr, 0);
+    code = get<evg::SWEvent::Code>(pEg);
+    write<evr::Prescaler>(pEr, 125, 0);
+
+  Register arrays take the element index as the last argument. The map
+  RAM registers are indexed by ram * (EVR_MAX_EVENT_CODE + 1) + code.
+
+  Read-modify-write accessors are not locked, wrap them in MRF_LOCK()
+  and MRF_UNLOCK() like the C API does when a handle is shared between
+  threads.
+ */
+
+#include <cstddef>
+
+namespace mrf {
+
+/* Byte swaps usable in constant expressions */
+constexpr u32 swap(u32 v)
+{
+  return ((v & 0x000000ffU) << 24) | ((v & 0x0000ff00U) << 8) |
+    ((v & 0x00ff0000U) >> 8) | ((v & 0xff000000U) >> 24);
+}
+
+constexpr u16 swap(u16 v)
+{
+  return static_cast<u16>(((v & 0x00ffU) << 8) | ((v & 0xff00U) >> 8));
+}
+
+/* Host to register byte order, registers are big-endian */
+template <typename Word> constexpr Word to_reg(Word v)
+{
+  return __BYTE_ORDER == __LITTLE_ENDIAN ? swap(v) : v;
+}
+
+/* Run time conversions use the byte swap instructions of erapi.h */
+inline u32 from_reg(u32 v) { return be32_to_cpu(v); }
+inline u16 from_reg(u16 v) { return be16_to_cpu(v); }
+inline u32 to_reg_rt(u32 v) { return be32_to_cpu(v); }
+inline u16 to_reg_rt(u16 v) { return be16_to_cpu(v); }
+
+/* Number of bits needed for values up to max */
+constexpr unsigned bits(unsigned long max)
+{
+  return max ? 1 + bits(max >> 1) : 0;
+}
+
+/*
+  Register of a device, Count registers Stride bytes apart starting at
+  byte Offset.
+ */
+template <typename Device, typename Word, std::size_t Offset,
+	  std::size_t Count = 1, std::size_t Stride = sizeof(Word)>
+struct Register {
+  typedef Device device;
+  typedef Word   word;
+  static const std::size_t offset = Offset;
+  static const std::size_t count = Count;
+  static const std::size_t stride = Stride;
+
+  static volatile Word &at(volatile Device *dev, std::size_t i)
+  {
+    return *reinterpret_cast<volatile Word *>
+      (reinterpret_cast<volatile char *>(dev) + Offset + i * Stride);
+  }
+};
+
+/* Bit field of Width bits starting at bit Lsb of register Reg */
+template <typename Reg, unsigned Lsb, unsigned Width = 1>
+struct Field {
+  typedef Reg                    reg;
+  typedef typename Reg::word     word;
+  typedef typename Reg::device   device;
+
+  static_assert(Width > 0 && Lsb + Width <= 8 * sizeof(word),
+		"field does not fit in register");
+
+  static const unsigned lsb = Lsb;
+  static const unsigned width = Width;
+  static constexpr word mask = word((~0ULL >> (64 - Width)) << Lsb);
+  static constexpr word raw_mask = to_reg(mask);
+
+  /* Field value in host byte order, for combining fields */
+  static constexpr word value(word v)
+  {
+    return word((v << Lsb) & mask);
+  }
+};
+
+/* Whole register as a field */
+template <typename Reg>
+struct Whole : Field<Reg, 0, 8 * sizeof(typename Reg::word)> {
+};
+
+template <typename F>
+inline typename F::word get(volatile typename F::device *dev,
+			    std::size_t i = 0)
+{
+  return (from_reg(F::reg::at(dev, i)) & F::mask) >> F::lsb;
+}
+
+template <typename F>
+inline bool test(volatile typename F::device *dev, std::size_t i = 0)
+{
+  return (F::reg::at(dev, i) & F::raw_mask) != 0;
+}
+
+template <typename F>
+inline void set(volatile typename F::device *dev, std::size_t i = 0)
+{
+  F::reg::at(dev, i) |= F::raw_mask;
+}
+
+template <typename F>
+inline void clear(volatile typename F::device *dev, std::size_t i = 0)
+{
+  F::reg::at(dev, i) &= typename F::word(~F::raw_mask);
+}
+
+template <typename F>
+inline void put(volatile typename F::device *dev, typename F::word v,
+		std::size_t i = 0)
+{
+  volatile typename F::word &r = F::reg::at(dev, i);
+
+  r = typename F::word((r & ~F::raw_mask) | to_reg_rt(F::value(v)));
+}
+
+/* Constant field value, checked against the field width */
+template <typename F, unsigned long long V>
+inline void put(volatile typename F::device *dev, std::size_t i = 0)
+{
+  static_assert(V <= (F::mask >> F::lsb), "value does not fit in field");
+  volatile typename F::word &r = F::reg::at(dev, i);
+
+  r = typename F::word((r & ~F::raw_mask) |
+		       to_reg(F::value(typename F::word(V))));
+}
+
+template <typename Reg>
+inline typename Reg::word read(volatile typename Reg::device *dev,
+			       std::size_t i = 0)
+{
+  return from_reg(Reg::at(dev, i));
+}
+
+template <typename Reg>
+inline void write(volatile typename Reg::device *dev, typename Reg::word v,
+		  std::size_t i = 0)
+{
+  Reg::at(dev, i) = to_reg_rt(v);
+}
+
+/* Checks a register descriptor against the C structure */
+#define MRFREGS_CHECK(reg, member)					\
+  static_assert(offsetof(reg::device, member) == reg::offset,		\
+		#reg " offset differs from " #member)
+
+namespace evr {
+
+template <typename Word, std::size_t Offset, std::size_t Count = 1,
+	  std::size_t Stride = sizeof(Word)>
+struct Reg : Register<MrfErRegs, Word, Offset, Count, Stride> {
+};
+
+struct Status : Reg<u32, 0x0000> {
+  typedef Field<Status, C_EVR_STATUS_DBUS_HIGH - 7, 8> DBus;
+  typedef Field<Status, C_EVR_STATUS_LEGACY_VIO>      LegacyVio;
+  typedef Field<Status, C_EVR_STATUS_LOG_STOPPED>     LogStopped;
+};
+
+struct Control : Reg<u32, 0x0004> {
+  typedef Field<Control, C_EVR_CTRL_MASTER_ENABLE>   MasterEnable;
+  typedef Field<Control, C_EVR_CTRL_EVENT_FWD_ENA>   EventFwdEna;
+  typedef Field<Control, C_EVR_CTRL_TXLOOPBACK>      TxLoopback;
+  typedef Field<Control, C_EVR_CTRL_RXLOOPBACK>      RxLoopback;
+  typedef Field<Control, C_EVR_CTRL_OUTEN>           OutEn;
+  typedef Field<Control, C_EVR_CTRL_GUNTX_INH_OVRDE> GunTxInhOvrde;
+  typedef Field<Control, C_EVR_CTRL_DC_ENABLE>       DCEnable;
+  typedef Field<Control, C_EVR_CTRL_PRESC_POLARITY>  PrescPolarity;
+  typedef Field<Control, C_EVR_CTRL_TS_CLOCK_DBUS>   TsClockDBus;
+  typedef Field<Control, C_EVR_CTRL_RESET_TIMESTAMP> ResetTimestamp;
+  typedef Field<Control, C_EVR_CTRL_LATCH_TIMESTAMP> LatchTimestamp;
+  typedef Field<Control, C_EVR_CTRL_MAP_RAM_ENABLE>  MapRamEnable;
+  typedef Field<Control, C_EVR_CTRL_MAP_RAM_SELECT>  MapRamSelect;
+  typedef Field<Control, C_EVR_CTRL_LOG_RESET>       LogReset;
+  typedef Field<Control, C_EVR_CTRL_LOG_ENABLE>      LogEnable;
+  typedef Field<Control, C_EVR_CTRL_LOG_DISABLE>     LogDisable;
+  typedef Field<Control, C_EVR_CTRL_LOG_STOP_EV_EN>  LogStopEvEn;
+  typedef Field<Control, C_EVR_CTRL_RESET_EVENTFIFO> ResetEventFifo;
+};
+
+template <typename Self>
+struct IrqFields {
+  typedef Field<Self, C_EVR_IRQFLAG_SEGBUF>    SegBuf;
+  typedef Field<Self, C_EVR_IRQFLAG_LINKCHG>   LinkChg;
+  typedef Field<Self, C_EVR_IRQFLAG_DATABUF>   DataBuf;
+  typedef Field<Self, C_EVR_IRQFLAG_PULSE>     Pulse;
+  typedef Field<Self, C_EVR_IRQFLAG_EVENT>     Event;
+  typedef Field<Self, C_EVR_IRQFLAG_HEARTBEAT> Heartbeat;
+  typedef Field<Self, C_EVR_IRQFLAG_FIFOFULL>  FifoFull;
+  typedef Field<Self, C_EVR_IRQFLAG_VIOLATION> Violation;
+};
+
+struct IrqFlag : Reg<u32, 0x0008>, IrqFields<IrqFlag> {
+};
+
+struct IrqEnable : Reg<u32, 0x000C>, IrqFields<IrqEnable> {
+  typedef Field<IrqEnable, C_EVR_IRQ_MASTER_ENABLE>  MasterEnable;
+  typedef Field<IrqEnable, C_EVR_IRQ_PCICORE_ENABLE> PciCoreEnable;
+};
+
+struct SWEvent : Reg<u32, 0x0018> {
+  typedef Field<SWEvent, C_EVR_SWEVENT_PENDING> Pending;
+  typedef Field<SWEvent, C_EVR_SWEVENT_ENABLE>  Enable;
+  typedef Field<SWEvent, C_EVR_SWEVENT_CODE_LOW,
+		C_EVR_SWEVENT_CODE_HIGH - C_EVR_SWEVENT_CODE_LOW + 1> Code;
+};
+
+struct DataBufControl : Reg<u32, 0x0020> {
+  typedef Field<DataBufControl, C_EVR_DATABUF_LOAD>      Load;
+  typedef Field<DataBufControl, C_EVR_DATABUF_RECEIVING> Receiving;
+  typedef Field<DataBufControl, C_EVR_DATABUF_STOP>      Stop;
+  typedef Field<DataBufControl, C_EVR_DATABUF_RXREADY>   RxReady;
+  typedef Field<DataBufControl, C_EVR_DATABUF_CHECKSUM>  Checksum;
+  typedef Field<DataBufControl, C_EVR_DATABUF_MODE>      Mode;
+  typedef Field<DataBufControl, C_EVR_DATABUF_SIZELOW,
+		C_EVR_DATABUF_SIZEHIGH - C_EVR_DATABUF_SIZELOW + 1> Size;
+};
+
+struct TxDataBufControl : Reg<u32, 0x0024> {
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_SEGSHIFT,
+		bits(EVR_MAX_BUF_SEGMENT)>                   Segment;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_COMPLETE> Complete;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_RUNNING>  Running;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_TRIGGER>  Trigger;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_ENA>      Ena;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_MODE>     Mode;
+  typedef Field<TxDataBufControl, C_EVR_TXDATABUF_SIZELOW,
+		C_EVR_TXDATABUF_SIZEHIGH - C_EVR_TXDATABUF_SIZELOW + 1> Size;
+};
+
+struct FPGAVersion : Reg<u32, 0x002C> {
+  typedef Field<FPGAVersion, 28, 4> Type;
+  typedef Field<FPGAVersion, 24, 4> FormFactor;
+};
+
+struct UsecDiv : Reg<u32, 0x004C> {
+};
+
+struct ClockControl : Reg<u32, 0x0050> {
+  typedef Field<ClockControl, C_EVR_CLKCTRL_PLLL>          Plll;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_BWSEL, 3>      BwSel;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_INT_CLK_MODE>  IntClkMode;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_RUN>    RecDcmRun;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_INITD>  RecDcmInitd;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_PSDONE> RecDcmPsDone;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_STOPPED> EvDcmStopped;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_LOCKED>  EvDcmLocked;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_PSDONE>  EvDcmPsDone;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_CGLOCK>        CgLock;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_PSDEC>  RecDcmPsDec;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_PSINC>  RecDcmPsInc;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_RECDCM_RESET>  RecDcmReset;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_PSDEC>   EvDcmPsDec;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_PSINC>   EvDcmPsInc;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_SRUN>    EvDcmSRun;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_SRES>    EvDcmSRes;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_EVDCM_RES>     EvDcmRes;
+  typedef Field<ClockControl, C_EVR_CLKCTRL_USE_RXRECCLK>  UseRxRecClk;
+};
+
+struct FracDiv : Reg<u32, 0x0080> {
+};
+
+struct DCTarget : Reg<u32, 0x00B0> {
+};
+
+struct SeqRamControl : Reg<u32, 0x00E0, EVR_MAX_SEQRAMS> {
+  typedef Field<SeqRamControl, C_EVR_SQRC_RUNNING>   Running;
+  typedef Field<SeqRamControl, C_EVR_SQRC_ENABLED>   Enabled;
+  typedef Field<SeqRamControl, C_EVR_SQRC_SWTRIGGER> SWTrigger;
+  typedef Field<SeqRamControl, C_EVR_SQRC_SINGLE>    Single;
+  typedef Field<SeqRamControl, C_EVR_SQRC_RECYCLE>   Recycle;
+  typedef Field<SeqRamControl, C_EVR_SQRC_RESET>     Reset;
+  typedef Field<SeqRamControl, C_EVR_SQRC_DISABLE>   Disable;
+  typedef Field<SeqRamControl, C_EVR_SQRC_ENABLE>    Enable;
+  typedef Field<SeqRamControl, C_EVR_SQRC_TRIGSEL_LOW,
+		bits(C_EVR_SEQTRIG_MAX)>             TrigSel;
+};
+
+struct Prescaler : Reg<u32, 0x0100, EVR_MAX_PRESCALERS> {
+};
+
+struct PrescalerPhase : Reg<u32, 0x0120, EVR_MAX_PRESCALERS> {
+};
+
+struct PrescalerTrig : Reg<u32, 0x0140, EVR_MAX_PRESCALERS> {
+};
+
+struct DBusTrig : Reg<u32, 0x0180, 8> {
+};
+
+struct PulseControl : Reg<u32, 0x0200, EVR_MAX_PULSES,
+			  sizeof(struct PulseStruct)> {
+  typedef Field<PulseControl, C_EVR_PULSE_OUT>           Out;
+  typedef Field<PulseControl, C_EVR_PULSE_SW_SET>        SWSet;
+  typedef Field<PulseControl, C_EVR_PULSE_SW_RESET>      SWReset;
+  typedef Field<PulseControl, C_EVR_PULSE_POLARITY>      Polarity;
+  typedef Field<PulseControl, C_EVR_PULSE_MAP_RESET_ENA> MapResetEna;
+  typedef Field<PulseControl, C_EVR_PULSE_MAP_SET_ENA>   MapSetEna;
+  typedef Field<PulseControl, C_EVR_PULSE_MAP_TRIG_ENA>  MapTrigEna;
+  typedef Field<PulseControl, C_EVR_PULSE_ENA>           Ena;
+};
+
+struct PulsePrescaler : Reg<u32, 0x0204, EVR_MAX_PULSES,
+			    sizeof(struct PulseStruct)> {
+};
+
+struct PulseDelay : Reg<u32, 0x0208, EVR_MAX_PULSES,
+			sizeof(struct PulseStruct)> {
+};
+
+struct PulseWidth : Reg<u32, 0x020C, EVR_MAX_PULSES,
+			sizeof(struct PulseStruct)> {
+};
+
+/* Output maps select up to two signals */
+template <typename Self>
+struct OutMapFields {
+  typedef Field<Self, 0, C_EVR_SIGNAL_MAP_BITS> Signal0;
+  typedef Field<Self, 8, C_EVR_SIGNAL_MAP_BITS> Signal1;
+};
+
+struct FPOutMap : Reg<u16, 0x0400, EVR_MAX_FPOUT_MAP + EVR_MAX_CMLOUT_MAP>,
+		  OutMapFields<FPOutMap> {
+};
+
+struct UnivOutMap : Reg<u16, 0x0440, EVR_MAX_UNIVOUT_MAP>,
+		    OutMapFields<UnivOutMap> {
+};
+
+struct TBOutMap : Reg<u16, 0x0480, EVR_MAX_TBOUT_MAP>,
+		  OutMapFields<TBOutMap> {
+};
+
+struct BPOutMap : Reg<u16, 0x04C0, EVR_MAX_BPOUT_MAP>,
+		  OutMapFields<BPOutMap> {
+};
+
+struct ExtinMap : Reg<u32, 0x0500, EVR_MAX_EXTIN_MAP> {
+  typedef Field<ExtinMap, C_EVR_EXTIN_EXTEVENT_BASE,
+		bits(EVR_MAX_EVENT_CODE)>               ExtEvent;
+  typedef Field<ExtinMap, C_EVR_EXTIN_BACKEVENT_BASE,
+		bits(EVR_MAX_EVENT_CODE)>               BackEvent;
+  typedef Field<ExtinMap, C_EVR_EXTIN_BACKDBUS_BASE, 8> BackDBus;
+  typedef Field<ExtinMap, C_EVR_EXTIN_EXT_ENABLE>       ExtEnable;
+  typedef Field<ExtinMap, C_EVR_EXTIN_BACKEV_ENABLE>    BackEvEnable;
+  typedef Field<ExtinMap, C_EVR_EXTIN_EXT_EDGE>         ExtEdge;
+  typedef Field<ExtinMap, C_EVR_EXTIN_EXTLEV_ENABLE>    ExtLevEnable;
+  typedef Field<ExtinMap, C_EVR_EXTIN_BACKLEV_ENABLE>   BackLevEnable;
+  typedef Field<ExtinMap, C_EVR_EXTIN_EXTLEV_ACT>       ExtLevAct;
+  typedef Field<ExtinMap, C_EVR_EXTIN_STATUS>           Status;
+};
+
+struct CMLControl : Reg<u16, 0x0612, EVR_MAX_CML_OUTPUTS,
+			sizeof(struct CMLStruct)> {
+  typedef Field<CMLControl, C_EVR_CMLCTRL_REFCLKSEL> RefClkSel;
+  typedef Field<CMLControl, C_EVR_CMLCTRL_RESET>     Reset;
+  typedef Field<CMLControl, C_EVR_CMLCTRL_POWERDOWN> PowerDown;
+  typedef Field<CMLControl, C_EVR_CMLCTRL_ENABLE>    Enable;
+};
+
+struct MapRamIntEvent : Reg<u32, 0x4000,
+			    EVR_MAPRAMS * (EVR_MAX_EVENT_CODE + 1),
+			    sizeof(struct MapRamItemStruct)> {
+  typedef Field<MapRamIntEvent, C_EVR_MAP_SAVE_EVENT>        SaveEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_LATCH_TIMESTAMP>   LatchTimestamp;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_LED_EVENT>         LedEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_FORWARD_EVENT>     ForwardEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_STOP_LOG>          StopLog;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_LOG_EVENT>         LogEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_HEARTBEAT_EVENT>   HeartbeatEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_RESETPRESC_EVENT>  ResetPrescEvent;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_TIMESTAMP_RESET>   TimestampReset;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_TIMESTAMP_CLK>     TimestampClk;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_SECONDS_1>         Seconds1;
+  typedef Field<MapRamIntEvent, C_EVR_MAP_SECONDS_0>         Seconds0;
+};
+
+struct MapRamPulseTrigger : Reg<u32, 0x4004,
+				EVR_MAPRAMS * (EVR_MAX_EVENT_CODE + 1),
+				sizeof(struct MapRamItemStruct)> {
+};
+
+struct MapRamPulseSet : Reg<u32, 0x4008,
+			    EVR_MAPRAMS * (EVR_MAX_EVENT_CODE + 1),
+			    sizeof(struct MapRamItemStruct)> {
+};
+
+struct MapRamPulseClear : Reg<u32, 0x400C,
+			      EVR_MAPRAMS * (EVR_MAX_EVENT_CODE + 1),
+			      sizeof(struct MapRamItemStruct)> {
+};
+
+struct SeqRamTimestamp : Reg<u32, 0xC000, EVR_SEQRAMS * EVR_MAX_SEQRAMEV,
+			     sizeof(struct SeqRamItemStruct)> {
+};
+
+struct SeqRamEventCode : Reg<u32, 0xC004, EVR_SEQRAMS * EVR_MAX_SEQRAMEV,
+			     sizeof(struct SeqRamItemStruct)> {
+};
+
+/* Documented addresses */
+static_assert(sizeof(struct PulseStruct) == 0x10, "PulseStruct size");
+static_assert(sizeof(struct CMLStruct) == 0x20, "CMLStruct size");
+static_assert(sizeof(struct MapRamItemStruct) == 0x10, "MapRam item size");
+static_assert(sizeof(struct MrfErRegs) == 0x40000, "MrfErRegs size");
+static_assert(offsetof(MrfErRegs, Databuf) == 0x0800, "Databuf offset");
+static_assert(offsetof(MrfErRegs, DiagIn) == 0x1000, "DiagIn offset");
+static_assert(offsetof(MrfErRegs, DiagCounter) == 0x1080,
+	      "DiagCounter offset");
+static_assert(offsetof(MrfErRegs, TxDatabuf) == 0x1800, "TxDatabuf offset");
+static_assert(offsetof(MrfErRegs, Log) == 0x2000, "Log offset");
+static_assert(offsetof(MrfErRegs, EventCounters) == 0x6000,
+	      "EventCounters offset");
+static_assert(offsetof(MrfErRegs, PulseCounters) == 0x6400,
+	      "PulseCounters offset");
+static_assert(offsetof(MrfErRegs, ConfigROM) == 0x8000, "ConfigROM offset");
+static_assert(offsetof(MrfErRegs, SFPEEPROM) == 0x8200, "SFPEEPROM offset");
+static_assert(offsetof(MrfErRegs, SFPDiag) == 0x8300, "SFPDiag offset");
+static_assert(offsetof(MrfErRegs, RTMDelay) == 0x8400, "RTMDelay offset");
+static_assert(offsetof(MrfErRegs, SegBufSize) == 0x8800, "SegBufSize offset");
+static_assert(offsetof(MrfErRegs, SegIrqReg) == 0x8F80, "SegIrqReg offset");
+static_assert(offsetof(MrfErRegs, SegBuf) == 0x9000, "SegBuf offset");
+static_assert(offsetof(MrfErRegs, TxSegBuf) == 0xA000, "TxSegBuf offset");
+static_assert(offsetof(MrfErRegs, GTXMem) == 0x20000, "GTXMem offset");
+
+MRFREGS_CHECK(Status, Status);
+MRFREGS_CHECK(Control, Control);
+MRFREGS_CHECK(IrqFlag, IrqFlag);
+MRFREGS_CHECK(IrqEnable, IrqEnable);
+MRFREGS_CHECK(SWEvent, SWEvent);
+MRFREGS_CHECK(DataBufControl, DataBufControl);
+MRFREGS_CHECK(TxDataBufControl, TxDataBufControl);
+MRFREGS_CHECK(FPGAVersion, FPGAVersion);
+MRFREGS_CHECK(UsecDiv, UsecDiv);
+MRFREGS_CHECK(ClockControl, ClockControl);
+MRFREGS_CHECK(FracDiv, FracDiv);
+MRFREGS_CHECK(DCTarget, dc_target);
+MRFREGS_CHECK(SeqRamControl, SeqRamControl);
+MRFREGS_CHECK(Prescaler, Prescaler);
+MRFREGS_CHECK(PrescalerPhase, PrescalerPhase);
+MRFREGS_CHECK(PrescalerTrig, PrescalerTrig);
+MRFREGS_CHECK(DBusTrig, DBusTrig);
+MRFREGS_CHECK(PulseControl, Pulse[0].Control);
+MRFREGS_CHECK(PulsePrescaler, Pulse[0].Prescaler);
+MRFREGS_CHECK(PulseDelay, Pulse[0].Delay);
+MRFREGS_CHECK(PulseWidth, Pulse[0].Width);
+MRFREGS_CHECK(FPOutMap, FPOutMap);
+MRFREGS_CHECK(UnivOutMap, UnivOutMap);
+MRFREGS_CHECK(TBOutMap, TBOutMap);
+MRFREGS_CHECK(BPOutMap, BPOutMap);
+MRFREGS_CHECK(ExtinMap, ExtinMap);
+MRFREGS_CHECK(CMLControl, CML[0].Control);
+MRFREGS_CHECK(MapRamIntEvent, MapRam[0][0].IntEvent);
+MRFREGS_CHECK(MapRamPulseTrigger, MapRam[0][0].PulseTrigger);
+MRFREGS_CHECK(MapRamPulseSet, MapRam[0][0].PulseSet);
+MRFREGS_CHECK(MapRamPulseClear, MapRam[0][0].PulseClear);
+MRFREGS_CHECK(SeqRamTimestamp, SeqRam[0][0].Timestamp);
+MRFREGS_CHECK(SeqRamEventCode, SeqRam[0][0].EventCode);
+
+} /* namespace evr */
+
+namespace evg {
+
+template <typename Word, std::size_t Offset, std::size_t Count = 1,
+	  std::size_t Stride = sizeof(Word)>
+struct Reg : Register<MrfEgRegs, Word, Offset, Count, Stride> {
+};
+
+struct Status : Reg<u32, 0x0000> {
+  typedef Field<Status, C_EVG_STATUS_RXDBUS_LOW,
+		C_EVG_STATUS_RXDBUS_HIGH - C_EVG_STATUS_RXDBUS_LOW + 1> RxDBus;
+  typedef Field<Status, C_EVG_STATUS_TXDBUS_LOW,
+		C_EVG_STATUS_TXDBUS_HIGH - C_EVG_STATUS_TXDBUS_LOW + 1> TxDBus;
+};
+
+struct Control : Reg<u32, 0x0004> {
+  typedef Field<Control, C_EVG_CTRL_MASTER_ENABLE>   MasterEnable;
+  typedef Field<Control, C_EVG_CTRL_RX_DISABLE>      RxDisable;
+  typedef Field<Control, C_EVG_CTRL_RX_PWRDOWN>      RxPwrDown;
+  typedef Field<Control, C_EVG_CTRL_MXC_RESET>       MxcReset;
+  typedef Field<Control, C_EVG_CTRL_BEACON_ENABLE>   BeaconEnable;
+  typedef Field<Control, C_EVG_CTRL_DCMASTER_ENABLE> DCMasterEnable;
+  typedef Field<Control, C_EVG_CTRL_SEQRAM_ALT>      SeqRamAlt;
+};
+
+template <typename Self>
+struct IrqFields {
+  typedef Field<Self, C_EVG_IRQFLAG_SEQSTOP, EVG_MAX_SEQRAMS>  SeqStop;
+  typedef Field<Self, C_EVG_IRQFLAG_SEQSTART, EVG_MAX_SEQRAMS> SeqStart;
+  typedef Field<Self, C_EVG_IRQFLAG_EXTERNAL>   External;
+  typedef Field<Self, C_EVG_IRQFLAG_DATABUF>    DataBuf;
+  typedef Field<Self, C_EVG_IRQFLAG_RXFIFOFULL> RxFifoFull;
+  typedef Field<Self, C_EVG_IRQFLAG_VIOLATION>  Violation;
+};
+
+struct IrqFlag : Reg<u32, 0x0008>, IrqFields<IrqFlag> {
+};
+
+struct IrqEnable : Reg<u32, 0x000C>, IrqFields<IrqEnable> {
+  typedef Field<IrqEnable, C_EVG_IRQ_MASTER_ENABLE>  MasterEnable;
+  typedef Field<IrqEnable, C_EVG_IRQ_PCICORE_ENABLE> PciCoreEnable;
+};
+
+struct ACControl : Reg<u32, 0x0010> {
+  typedef Field<ACControl, C_EVG_ACCTRL_ACSYNC_2> ACSync2;
+  typedef Field<ACControl, C_EVG_ACCTRL_ACSYNC_1> ACSync1;
+  typedef Field<ACControl, C_EVG_ACCTRL_BYPASS>   Bypass;
+  typedef Field<ACControl, C_EVG_ACCTRL_ACSYNC>   ACSync;
+  typedef Field<ACControl, C_EVG_ACCTRL_DIV_LOW,
+		C_EVG_ACCTRL_DIV_HIGH - C_EVG_ACCTRL_DIV_LOW + 1>     Div;
+  typedef Field<ACControl, C_EVG_ACCTRL_DELAY_LOW,
+		C_EVG_ACCTRL_DELAY_HIGH - C_EVG_ACCTRL_DELAY_LOW + 1> Delay;
+};
+
+struct ACMap : Reg<u32, 0x0014> {
+  typedef Field<ACMap, C_EVG_ACMAP_TRIG_BASE, EVG_MAX_TRIGGERS> Trig;
+};
+
+struct SWEvent : Reg<u32, 0x0018> {
+  typedef Field<SWEvent, C_EVG_SWEVENT_PENDING> Pending;
+  typedef Field<SWEvent, C_EVG_SWEVENT_ENABLE>  Enable;
+  typedef Field<SWEvent, C_EVG_SWEVENT_CODE_LOW,
+		C_EVG_SWEVENT_CODE_HIGH - C_EVG_SWEVENT_CODE_LOW + 1> Code;
+};
+
+struct DataBufControl : Reg<u32, 0x0020> {
+  typedef Field<DataBufControl, C_EVG_DATABUF_SEGSHIFT,
+		bits(EVG_MAX_BUF_SEGMENT)>                Segment;
+  typedef Field<DataBufControl, C_EVG_DATABUF_COMPLETE> Complete;
+  typedef Field<DataBufControl, C_EVG_DATABUF_RUNNING>  Running;
+  typedef Field<DataBufControl, C_EVG_DATABUF_TRIGGER>  Trigger;
+  typedef Field<DataBufControl, C_EVG_DATABUF_ENA>      Ena;
+  typedef Field<DataBufControl, C_EVG_DATABUF_MODE>     Mode;
+  typedef Field<DataBufControl, C_EVG_DATABUF_SIZELOW,
+		C_EVG_DATABUF_SIZEHIGH - C_EVG_DATABUF_SIZELOW + 1> Size;
+};
+
+/* Distributed bus bit n source is DBusMap::Sel<n> */
+struct DBusMap : Reg<u32, 0x0024> {
+  template <unsigned N>
+  struct Sel : Field<DBusMap, N * C_EVG_DBUS_SEL_BITS, C_EVG_DBUS_SEL_BITS> {
+  };
+};
+
+struct DBusEvent : Reg<u32, 0x0028> {
+};
+
+struct FPGAVersion : Reg<u32, 0x002C> {
+  typedef Field<FPGAVersion, 28, 4> Type;
+  typedef Field<FPGAVersion, 24, 4> FormFactor;
+};
+
+struct TimestampCtrl : Reg<u32, 0x0034> {
+  typedef Field<TimestampCtrl, C_EVG_TSCTRL_LOAD>   Load;
+  typedef Field<TimestampCtrl, C_EVG_TSCTRL_ENABLE> Enable;
+};
+
+struct TimestampValue : Reg<u32, 0x0038> {
+};
+
+struct UsecDiv : Reg<u32, 0x004C> {
+};
+
+struct ClockControl : Reg<u32, 0x0050> {
+  typedef Field<ClockControl, C_EVG_CLKCTRL_PLLL>          Plll;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_BWSEL, 3>      BwSel;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RFSEL,
+		bits(C_EVG_CLKCTRL_MAX_RFSEL)>             RFSel;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_PHTOGG>        PhTogg;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_DIV_LOW,
+		C_EVG_CLKCTRL_DIV_HIGH - C_EVG_CLKCTRL_DIV_LOW + 1> Div;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_RUN>    RecDcmRun;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_INITD>  RecDcmInitd;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_PSDONE> RecDcmPsDone;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_STOPPED> EvDcmStopped;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_LOCKED>  EvDcmLocked;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_PSDONE>  EvDcmPsDone;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_CGLOCK>        CgLock;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_PSDEC>  RecDcmPsDec;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_PSINC>  RecDcmPsInc;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_RECDCM_RESET>  RecDcmReset;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_PSDEC>   EvDcmPsDec;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_PSINC>   EvDcmPsInc;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_SRUN>    EvDcmSRun;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_SRES>    EvDcmSRes;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_EVDCM_RES>     EvDcmRes;
+  typedef Field<ClockControl, C_EVG_CLKCTRL_USE_RXRECCLK>  UseRxRecClk;
+};
+
+/* Status bits share positions with the command bits */
+struct EvanControl : Reg<u32, 0x0060> {
+  typedef Field<EvanControl, C_EVG_EVANCTRL_RESET>       Reset;
+  typedef Field<EvanControl, C_EVG_EVANCTRL_NOTEMPTY>    NotEmpty;
+  typedef Field<EvanControl, C_EVG_EVANCTRL_CLROVERFLOW> ClrOverflow;
+  typedef Field<EvanControl, C_EVG_EVANCTRL_OVERFLOW>    Overflow;
+  typedef Field<EvanControl, C_EVG_EVANCTRL_ENABLE>      Enable;
+  typedef Field<EvanControl, C_EVG_EVANCTRL_COUNTRES>    CountRes;
+};
+
+struct SeqRamControl : Reg<u32, 0x0070, EVG_MAX_SEQRAMS> {
+  typedef Field<SeqRamControl, C_EVG_SQRC_RUNNING>   Running;
+  typedef Field<SeqRamControl, C_EVG_SQRC_ENABLED>   Enabled;
+  typedef Field<SeqRamControl, C_EVG_SQRC_SWTRIGGER> SWTrigger;
+  typedef Field<SeqRamControl, C_EVG_SQRC_SINGLE>    Single;
+  typedef Field<SeqRamControl, C_EVG_SQRC_RECYCLE>   Recycle;
+  typedef Field<SeqRamControl, C_EVG_SQRC_RESET>     Reset;
+  typedef Field<SeqRamControl, C_EVG_SQRC_DISABLE>   Disable;
+  typedef Field<SeqRamControl, C_EVG_SQRC_ENABLE>    Enable;
+  typedef Field<SeqRamControl, C_EVG_SQRC_TRIGSEL_LOW,
+		bits(C_EVG_SEQTRIG_MAX)>             TrigSel;
+};
+
+struct FracDiv : Reg<u32, 0x0080> {
+};
+
+struct EventTrigger : Reg<u32, 0x0100, EVG_MAX_TRIGGERS> {
+  typedef Field<EventTrigger, C_EVG_EVENTTRIG_ENABLE> Enable;
+  typedef Field<EventTrigger, C_EVG_EVENTTRIG_CODE_LOW,
+		C_EVG_EVENTTRIG_CODE_HIGH - C_EVG_EVENTTRIG_CODE_LOW + 1> Code;
+};
+
+struct SeqRamStartCnt : Reg<u32, 0x0140, EVG_MAX_SEQRAMS> {
+};
+
+struct SeqRamEndCnt : Reg<u32, 0x0150, EVG_MAX_SEQRAMS> {
+};
+
+struct SeqRamRepeatLow : Reg<u32, 0x0160, EVG_MAX_SEQRAMS> {
+};
+
+struct SeqRamRepeatHigh : Reg<u32, 0x0170, EVG_MAX_SEQRAMS> {
+};
+
+struct MXCControl : Reg<u32, 0x0180, EVG_MAX_MXCS,
+			sizeof(struct MXCStruct)> {
+  typedef Field<MXCControl, C_EVG_MXC_READ>                           Read;
+  typedef Field<MXCControl, C_EVG_MXCMAP_TRIG_BASE, EVG_MAX_TRIGGERS> Trig;
+};
+
+struct MXCPrescaler : Reg<u32, 0x0184, EVG_MAX_MXCS,
+			  sizeof(struct MXCStruct)> {
+};
+
+struct FPOutMap : Reg<u16, 0x0400, EVG_MAX_FPOUT_MAP> {
+};
+
+struct BPOutMap : Reg<u16, 0x0420, EVG_MAX_BPOUT_MAP> {
+};
+
+struct UnivOutMap : Reg<u16, 0x0440, EVG_MAX_UNIVOUT_MAP> {
+};
+
+struct TBOutMap : Reg<u16, 0x0480, EVG_MAX_TBOUT_MAP> {
+};
+
+/* Input maps, fields end where the next one starts */
+template <typename Self>
+struct InMapFields {
+  typedef Field<Self, C_EVG_INMAP_TRIG_BASE,
+		C_EVG_INMAP_SEQTRIG_BASE - C_EVG_INMAP_TRIG_BASE>  Trig;
+  typedef Field<Self, C_EVG_INMAP_SEQTRIG_BASE,
+		C_EVG_INMAP_SEQENA_BASE - C_EVG_INMAP_SEQTRIG_BASE> SeqTrig;
+  typedef Field<Self, C_EVG_INMAP_SEQENA_BASE,
+		C_EVG_INMAP_DBUS_BASE - C_EVG_INMAP_SEQENA_BASE>   SeqEna;
+  typedef Field<Self, C_EVG_INMAP_DBUS_BASE,
+		C_EVG_INMAP_IRQ - C_EVG_INMAP_DBUS_BASE>           DBus;
+  typedef Field<Self, C_EVG_INMAP_IRQ>                             Irq;
+};
+
+struct FPInMap : Reg<u32, 0x0500, EVG_MAX_FPIN_MAP>, InMapFields<FPInMap> {
+};
+
+struct UnivInMap : Reg<u32, 0x0540, EVG_MAX_UNIVIN_MAP>,
+		   InMapFields<UnivInMap> {
+};
+
+struct BPInMap : Reg<u32, 0x0580, EVG_MAX_BPIN_MAP>, InMapFields<BPInMap> {
+};
+
+struct TBInMap : Reg<u32, 0x0600, EVG_MAX_TBIN_MAP>, InMapFields<TBInMap> {
+};
+
+struct SeqRamTimestamp : Reg<u32, 0x8000, EVG_SEQRAMS * EVG_MAX_SEQRAMEV,
+			     sizeof(struct SeqRamItemStruct)> {
+};
+
+struct SeqRamEventCode : Reg<u32, 0x8004, EVG_SEQRAMS * EVG_MAX_SEQRAMEV,
+			     sizeof(struct SeqRamItemStruct)> {
+};
+
+/* Documented addresses */
+static_assert(sizeof(struct MXCStruct) == 0x08, "MXCStruct size");
+static_assert(sizeof(struct MrfEgRegs) == 0x40000, "MrfEgRegs size");
+static_assert(offsetof(MrfEgRegs, EvanCode) == 0x0064, "EvanCode offset");
+static_assert(offsetof(MrfEgRegs, Databuf) == 0x0800, "Databuf offset");
+static_assert(offsetof(MrfEgRegs, Segbuf) == 0x2000, "Segbuf offset");
+static_assert(offsetof(MrfEgRegs, Fct) == 0x10000, "Fct offset");
+static_assert(offsetof(MrfEgRegs, EvrD) == 0x20000, "EvrD offset");
+static_assert(offsetof(MrfEgRegs, EvrU) == 0x30000, "EvrU offset");
+
+MRFREGS_CHECK(Status, Status);
+MRFREGS_CHECK(Control, Control);
+MRFREGS_CHECK(IrqFlag, IrqFlag);
+MRFREGS_CHECK(IrqEnable, IrqEnable);
+MRFREGS_CHECK(ACControl, ACControl);
+MRFREGS_CHECK(ACMap, ACMap);
+MRFREGS_CHECK(SWEvent, SWEvent);
+MRFREGS_CHECK(DataBufControl, DataBufControl);
+MRFREGS_CHECK(DBusMap, DBusMap);
+MRFREGS_CHECK(DBusEvent, DBusEvent);
+MRFREGS_CHECK(FPGAVersion, FPGAVersion);
+MRFREGS_CHECK(TimestampCtrl, TimestampCtrl);
+MRFREGS_CHECK(TimestampValue, TimestampValue);
+MRFREGS_CHECK(UsecDiv, UsecDiv);
+MRFREGS_CHECK(ClockControl, ClockControl);
+MRFREGS_CHECK(EvanControl, EvanControl);
+MRFREGS_CHECK(SeqRamControl, SeqRamControl);
+MRFREGS_CHECK(FracDiv, FracDiv);
+MRFREGS_CHECK(EventTrigger, EventTrigger);
+MRFREGS_CHECK(SeqRamStartCnt, SeqRamStartCnt);
+MRFREGS_CHECK(SeqRamEndCnt, SeqRamEndCnt);
+MRFREGS_CHECK(SeqRamRepeatLow, SeqRamRepeatLow);
+MRFREGS_CHECK(SeqRamRepeatHigh, SeqRamRepeatHigh);
+MRFREGS_CHECK(MXCControl, MXC[0].Control);
+MRFREGS_CHECK(MXCPrescaler, MXC[0].Prescaler);
+MRFREGS_CHECK(FPOutMap, FPOutMap);
+MRFREGS_CHECK(BPOutMap, BPOutMap);
+MRFREGS_CHECK(UnivOutMap, UnivOutMap);
+MRFREGS_CHECK(TBOutMap, TBOutMap);
+MRFREGS_CHECK(FPInMap, FPInMap);
+MRFREGS_CHECK(UnivInMap, UnivInMap);
+MRFREGS_CHECK(BPInMap, BPInMap);
+MRFREGS_CHECK(TBInMap, TBInMap);
+MRFREGS_CHECK(SeqRamTimestamp, SeqRam[0][0].Timestamp);
+MRFREGS_CHECK(SeqRamEventCode, SeqRam[0][0].EventCode);
+
+} /* namespace evg */
+
+#undef MRFREGS_CHECK
+
+} /* namespace mrf */
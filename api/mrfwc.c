@@ -0,0 +1,400 @@
+/**
+@file mrfwc.c
+@brief Write-combining mappings for bulk register areas of
+       Micro-Research Event System devices.
+
+The register mapping of the device driver is uncached, every 32-bit
+store to a data buffer or sequence RAM becomes a PCIe transaction of
+its own. The same BAR mapped through the sysfs resourceN_wc file lets
+the CPU merge consecutive stores into full write-combining buffer
+bursts.
+
+A write-combining window is registered for the uncached register
+mapping it aliases. Bulk writers translate the uncached address of the
+area they write with MRF_WC(), store in ascending address order and
+issue MrfWcFlush() before touching a control register, since stores
+through a write-combining mapping are not ordered with respect to the
+uncached mapping. Without a registered window MRF_WC() returns the
+uncached address and the flush is a plain fence.
+
+Like register locking, windows are opened before the handle is shared
+between threads and closed after the threads are done with it.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sysmacros.h>
+#endif
+
+#include "erapi.h"
+#include "egapi.h"
+#include "mrfwc.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#ifdef __unix__
+volatile int MrfWcWindows = 0;
+
+static struct {
+  volatile char *base;
+  volatile char *wc;
+  int size;
+  void *map;                      /* Page aligned start of wc mapping */
+  int map_size;
+} MrfWcWindow[MRFWC_MAX_WINDOWS];
+
+static pthread_mutex_t MrfWcTable = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+@private
+Find the offset in the device file of an address of a mapping of the
+device, e.g. of an EVM sub-device view.
+
+@return Returns offset, -1 if the address is not in such a mapping.
+*/
+static long long MrfWcMapOffset(const struct stat *st, volatile void *base)
+{
+  char line[512];
+  unsigned long long start, end, offset, inode;
+  unsigned int dmaj, dmin;
+  long long result = -1;
+  FILE *fp;
+
+  fp = fopen("/proc/self/maps", "r");
+  if (fp == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), fp))
+    {
+      if (sscanf(line, "%llx-%llx %*s %llx %x:%x %llu", &start, &end,
+		 &offset, &dmaj, &dmin, &inode) != 6)
+	continue;
+      if ((uintptr_t) base < start || (uintptr_t) base >= end)
+	continue;
+      if (inode == st->st_ino && makedev(dmaj, dmin) == st->st_dev)
+	result = offset + ((uintptr_t) base - start);
+      break;
+    }
+  fclose(fp);
+
+  return result;
+}
+
+/**
+Map the PCI resource behind a register mapping with write-combining
+and register it as alias of the mapping. The device driver maps BAR 0
+of the device from offset 0; the offset of base in BAR 0 is taken
+from the mapping it lies in, so base may also be a sub-device view,
+e.g. from EvrOpen() on /dev/egaN.evrd or EvmOpen().
+
+@param fd File descriptor of the device, as returned by EvrOpen()
+@param base Start of uncached register area in a mapping of fd
+@param size Size of area to alias, limited to the end of BAR 0
+@return Returns size of write-combining window, -1 on error.
+*/
+int MrfWcOpen(int fd, volatile void *base, int size)
+{
+  char path[256], line[256];
+  unsigned long long start, end, flags;
+  long long bar, off;
+  struct stat st;
+  FILE *fp;
+  void *wc;
+  int wcfd, i, result = -1;
+
+  if (fstat(fd, &st) || !S_ISCHR(st.st_mode))
+    return -1;
+
+  bar = MrfWcMapOffset(&st, base);
+  if (bar < 0)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  /* First line of the resource file is BAR 0 */
+  snprintf(path, sizeof(path), "/sys/dev/char/%u:%u/device/resource",
+	   major(st.st_rdev), minor(st.st_rdev));
+  fp = fopen(path, "r");
+  if (fp == NULL)
+    return -1;
+  if (fgets(line, sizeof(line), fp) == NULL ||
+      sscanf(line, "%llx %llx %llx", &start, &end, &flags) != 3)
+    start = end = 0;
+  fclose(fp);
+  if (!start || end < start || (unsigned long long) bar > end - start)
+    return -1;
+  if ((unsigned long long) size > end + 1 - start - bar)
+    size = end + 1 - start - bar;
+
+  /* Map from the page holding base */
+  off = bar & ~((long long) sysconf(_SC_PAGESIZE) - 1);
+
+  snprintf(path, sizeof(path), "/sys/dev/char/%u:%u/device/resource0_wc",
+	   major(st.st_rdev), minor(st.st_rdev));
+  wcfd = open(path, O_RDWR | O_SYNC);
+  if (wcfd == -1)
+    return -1;
+  wc = mmap(0, size + (bar - off), PROT_READ | PROT_WRITE, MAP_SHARED, wcfd,
+	    off);
+  close(wcfd);
+#ifdef DEBUG
+  DEBUG_PRINTF("MrfWcOpen: %s BAR 0 at %llx offset %llx size %x mapped "
+	       "at %p\n", path, start, bar, size, wc);
+#endif
+  if (wc == MAP_FAILED)
+    return -1;
+
+  pthread_mutex_lock(&MrfWcTable);
+  for (i = 0; i < MRFWC_MAX_WINDOWS; i++)
+    if (!MrfWcWindow[i].base)
+      {
+	MrfWcWindow[i].map = wc;
+	MrfWcWindow[i].map_size = size + (bar - off);
+	MrfWcWindow[i].wc = (volatile char *) wc + (bar - off);
+	MrfWcWindow[i].size = size;
+	MrfWcWindow[i].base = (volatile char *) base;
+	MrfWcWindows++;
+	result = size;
+	break;
+      }
+  pthread_mutex_unlock(&MrfWcTable);
+  if (result < 0)
+    munmap(wc, size + (bar - off));
+
+  return result;
+}
+
+/**
+Unmap write-combining window of register mapping.
+
+@param base Start of uncached register mapping
+@return Returns 0 on success, -1 if there is no window.
+*/
+int MrfWcClose(volatile void *base)
+{
+  int i, result = -1;
+
+  pthread_mutex_lock(&MrfWcTable);
+  for (i = 0; i < MRFWC_MAX_WINDOWS; i++)
+    if (MrfWcWindow[i].base == base)
+      {
+	MrfWcFlush();
+	munmap(MrfWcWindow[i].map, MrfWcWindow[i].map_size);
+	MrfWcWindow[i].base = NULL;
+	MrfWcWindows--;
+	result = 0;
+	break;
+      }
+  pthread_mutex_unlock(&MrfWcTable);
+
+  return result;
+}
+
+/**
+Get write-combining alias of a register area.
+
+@param reg Address of area in uncached register mapping
+@param size Size of area in bytes
+@return Returns alias of reg, reg if no window covers the whole area.
+*/
+volatile void *MrfWcLookup(volatile void *reg, int size)
+{
+  volatile char *p = (volatile char *) reg;
+  int i;
+
+  for (i = 0; i < MRFWC_MAX_WINDOWS; i++)
+    if (MrfWcWindow[i].base && p >= MrfWcWindow[i].base &&
+	p + size <= MrfWcWindow[i].base + MrfWcWindow[i].size)
+      return MrfWcWindow[i].wc + (p - MrfWcWindow[i].base);
+
+  return reg;
+}
+
+#endif
+
+/**
+Drain write-combining buffers. Call after bulk stores and before the
+control register write that makes the device use the data.
+*/
+void MrfWcFlush(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__ ("sfence" ::: "memory");
+#else
+  __sync_synchronize();
+#endif
+}
+
+/**
+Map Event Receiver register area with write-combining for the bulk
+loaders.
+
+@param pEr Pointer to MrfErRegs structure
+@param fd File descriptor returned by EvrOpen()
+@return Returns size of write-combining window, -1 on error.
+*/
+int EvrWcOpen(volatile struct MrfErRegs *pEr, int fd)
+{
+#ifdef __unix__
+  return MrfWcOpen(fd, pEr, sizeof(struct MrfErRegs));
+#else
+  return -1;
+#endif
+}
+
+/**
+Map Event Generator register area with write-combining for the bulk
+loaders.
+
+@param pEg Pointer to MrfEgRegs structure
+@param fd File descriptor returned by EvgOpen()
+@return Returns size of write-combining window, -1 on error.
+*/
+int EvgWcOpen(volatile struct MrfEgRegs *pEg, int fd)
+{
+#ifdef __unix__
+  return MrfWcOpen(fd, pEg, sizeof(struct MrfEgRegs));
+#else
+  return -1;
+#endif
+}
+
+/** @private */
+static void MrfLoadSeqRam(volatile struct SeqRamItemStruct *ram,
+			  const struct SeqRamItemStruct *items, int n)
+{
+  volatile struct SeqRamItemStruct *dst;
+  int i;
+
+  dst = (volatile struct SeqRamItemStruct *)
+    MRF_WC(ram, n * sizeof(struct SeqRamItemStruct));
+  for (i = 0; i < n; i++)
+    {
+      dst[i].Timestamp = be32_to_cpu(items[i].Timestamp);
+      dst[i].EventCode = be32_to_cpu(items[i].EventCode);
+    }
+  MrfWcFlush();
+}
+
+/**
+Write block of Event Receiver sequence RAM entries.
+
+@param pEr Pointer to MrfErRegs structure
+@param ram Sequence RAM number
+@param pos First position to write
+@param items Entries in host byte order
+@param n Number of entries
+@return Returns number of entries written, -1 on error.
+*/
+int EvrLoadSeqRam(volatile struct MrfErRegs *pEr, int ram, int pos,
+		  const struct SeqRamItemStruct *items, int n)
+{
+  if (ram < 0 || ram >= EVR_SEQRAMS || pos < 0 || n < 0 ||
+      pos + n > EVR_MAX_SEQRAMEV)
+    return -1;
+
+  MrfLoadSeqRam(&pEr->SeqRam[ram][pos], items, n);
+
+  return n;
+}
+
+/**
+Write block of Event Receiver mapping RAM entries.
+
+@param pEr Pointer to MrfErRegs structure
+@param ram Mapping RAM number
+@param code First event code to write
+@param items Entries in host byte order
+@param n Number of entries
+@return Returns number of entries written, -1 on error.
+*/
+int EvrLoadMapRam(volatile struct MrfErRegs *pEr, int ram, int code,
+		  const struct MapRamItemStruct *items, int n)
+{
+  volatile struct MapRamItemStruct *dst;
+  int i;
+
+  if (ram < 0 || ram >= EVR_MAPRAMS || code < 0 || n < 0 ||
+      code + n > EVR_MAX_EVENT_CODE + 1)
+    return -1;
+
+  dst = (volatile struct MapRamItemStruct *)
+    MRF_WC(&pEr->MapRam[ram][code], n * sizeof(struct MapRamItemStruct));
+  for (i = 0; i < n; i++)
+    {
+      dst[i].IntEvent = be32_to_cpu(items[i].IntEvent);
+      dst[i].PulseTrigger = be32_to_cpu(items[i].PulseTrigger);
+      dst[i].PulseSet = be32_to_cpu(items[i].PulseSet);
+      dst[i].PulseClear = be32_to_cpu(items[i].PulseClear);
+    }
+  MrfWcFlush();
+
+  return n;
+}
+
+/**
+Write GTX pattern memory.
+
+@param pEr Pointer to MrfErRegs structure
+@param gtx GTX output number
+@param offset Byte offset in pattern memory, multiple of four
+@param data Pattern data, copied as is
+@param size Size of data in bytes, multiple of four
+@return Returns number of bytes written, -1 on error.
+*/
+int EvrLoadGTXMem(volatile struct MrfErRegs *pEr, int gtx, int offset,
+		  const void *data, int size)
+{
+  volatile u32 *dst;
+  const u32 *src = (const u32 *) data;
+  int i;
+
+  if (gtx < 0 || gtx >= EVR_GTXS || offset < 0 || size < 0 ||
+      (offset | size) & 3 || offset + size > (int) sizeof(pEr->GTXMem[0]))
+    return -1;
+
+  dst = (volatile u32 *) MRF_WC(&pEr->GTXMem[gtx][offset], size);
+  for (i = 0; i < size / 4; i++)
+    dst[i] = src[i];
+  MrfWcFlush();
+
+  return size;
+}
+
+/**
+Write block of Event Generator sequence RAM entries.
+
+@param pEg Pointer to MrfEgRegs structure
+@param ram Sequence RAM number
+@param pos First position to write
+@param items Entries in host byte order
+@param n Number of entries
+@return Returns number of entries written, -1 on error.
+*/
+int EvgLoadSeqRam(volatile struct MrfEgRegs *pEg, int ram, int pos,
+		  const struct SeqRamItemStruct *items, int n)
+{
+  if (ram < 0 || ram >= EVG_SEQRAMS || pos < 0 || n < 0 ||
+      pos + n > EVG_MAX_SEQRAMEV)
+    return -1;
+
+  MrfLoadSeqRam(&pEg->SeqRam[ram][pos], items, n);
+
+  return n;
+}
@@ -0,0 +1,60 @@
+/*
+  mrfwc.h -- Write-combining mappings for bulk register areas of
+             Micro-Research Event System devices
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h and egapi.h before this file.
+
+  MrfWcOpen() maps the PCI resource behind a register mapping a second
+  time through the sysfs resourceN_wc file. Bulk areas (data buffers,
+  sequence RAM, mapping RAM, GTX pattern memory) are then written
+  through the write-combining alias and followed by a store fence before
+  any control register write that depends on them. Control and status
+  registers always stay on the uncached mapping.
+
+  The resource is BAR 0 of the device found through
+  /sys/dev/char/<major>:<minor>/device, which the device driver maps
+  from offset 0. The offset of the register mapping in BAR 0 is looked
+  up in /proc/self/maps, so EVM sub-device views are aliased at their
+  own registers; an address not in a mapping of the device is rejected.
+  The sysfs resource files are only accessible to root.
+  Without a write-combining window all functions fall back to the
+  uncached mapping.
+ */
+
+#define MRFWC_MAX_WINDOWS    16
+
+struct MrfErRegs;
+struct MrfEgRegs;
+struct SeqRamItemStruct;
+struct MapRamItemStruct;
+
+#ifdef __unix__
+extern volatile int MrfWcWindows;
+
+int MrfWcOpen(int fd, volatile void *base, int size);
+int MrfWcClose(volatile void *base);
+volatile void *MrfWcLookup(volatile void *reg, int size);
+
+/* Alias of reg in a write-combining window, reg if there is none */
+#define MRF_WC(reg, size) (MrfWcWindows ? MrfWcLookup((reg), (size)) : \
+			   (volatile void *) (reg))
+#else
+#define MRF_WC(reg, size) ((volatile void *) (reg))
+#endif
+
+void MrfWcFlush(void);
+int EvrWcOpen(volatile struct MrfErRegs *pEr, int fd);
+int EvgWcOpen(volatile struct MrfEgRegs *pEg, int fd);
+int EvrLoadSeqRam(volatile struct MrfErRegs *pEr, int ram, int pos,
+		  const struct SeqRamItemStruct *items, int n);
+int EvrLoadMapRam(volatile struct MrfErRegs *pEr, int ram, int code,
+		  const struct MapRamItemStruct *items, int n);
+int EvrLoadGTXMem(volatile struct MrfErRegs *pEr, int gtx, int offset,
+		  const void *data, int size);
+int EvgLoadSeqRam(volatile struct MrfEgRegs *pEg, int ram, int pos,
+		  const struct SeqRamItemStruct *items, int n);
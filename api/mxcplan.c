@@ -0,0 +1,220 @@
+/**
+@file mxcplan.c
+@brief Micro-Research Event Generator multiplexed counter frequency
+       planner.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "egapi.h"
+#include "fracdiv.h"
+#include "mxcplan.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/**
+Get event clock frequency from the fractional synthesizer control word.
+
+@param pEg Pointer to MrfEgRegs structure
+@return Event clock frequency in Hz.
+*/
+double MxcPlanEventClock(volatile struct MrfEgRegs *pEg)
+{
+  return cw_to_freq(EvgGetFracDiv(pEg)) * 1e6;
+}
+
+/**
+Initialize plan with no counters to program.
+
+@param plan Plan
+@param clock_hz Event clock frequency in Hz, see MxcPlanEventClock()
+*/
+void MxcPlanInit(struct MxcPlan *plan, double clock_hz)
+{
+  int mxc;
+
+  memset(plan, 0, sizeof(struct MxcPlan));
+  plan->clock_hz = clock_hz;
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    plan->mxc[mxc].trigmap = -1;
+}
+
+/**
+Set target frequency of multiplexed counter.
+
+@param plan Plan
+@param mxc Multiplexed counter number
+@param freq Target frequency in Hz, 0 to leave counter as it is
+@param trigmap Trigger event driven by counter, -1 for none
+@return Returns 0 on success, -1 on error.
+*/
+int MxcPlanSet(struct MxcPlan *plan, int mxc, double freq, int trigmap)
+{
+  if (mxc < 0 || mxc >= EVG_MAX_MXCS || freq < 0.0 ||
+      trigmap < -1 || trigmap >= EVG_MAX_TRIGGERS)
+    return -1;
+
+  plan->mxc[mxc].used = (freq > 0.0);
+  plan->mxc[mxc].freq = freq;
+  plan->mxc[mxc].trigmap = trigmap;
+
+  return 0;
+}
+
+/** @private */
+static unsigned long long MxcPlanGcd(unsigned long long a,
+				     unsigned long long b)
+{
+  unsigned long long t;
+
+  while (b)
+    {
+      t = a % b;
+      a = b;
+      b = t;
+    }
+
+  return a;
+}
+
+/** @private */
+static double MxcPlanAbs(double x)
+{
+  return x < 0.0 ? -x : x;
+}
+
+/**
+Compute prescalers, frequency errors and common period. Each prescaler
+is the one of the two nearest to the exact divider with the smaller
+frequency error.
+
+@param plan Plan
+@return Returns 0 on success, -1 if a frequency cannot be reached.
+*/
+int MxcPlanCompute(struct MxcPlan *plan)
+{
+  struct MxcPlanEntry *e;
+  unsigned long long lcm = 1, g, p, lo;
+  double div, err_lo, err_hi;
+  int mxc, result = 0;
+
+  plan->exact = 1;
+  plan->max_error_ppm = 0.0;
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    {
+      e = &plan->mxc[mxc];
+      if (!e->used)
+	continue;
+
+      div = plan->clock_hz / e->freq;
+      if (plan->clock_hz <= 0.0 || div < MXCPLAN_MIN_PRESCALER ||
+	  div > 4294967295.0)
+	{
+	  e->prescaler = 0;
+	  e->actual = 0.0;
+	  e->error_ppm = 0.0;
+	  result = -1;
+	  continue;
+	}
+
+      lo = (unsigned long long) div;
+      p = lo;
+      if (lo < 4294967295ULL)
+	{
+	  err_lo = MxcPlanAbs(plan->clock_hz / lo - e->freq);
+	  err_hi = MxcPlanAbs(plan->clock_hz / (lo + 1) - e->freq);
+	  if (err_hi < err_lo)
+	    p = lo + 1;
+	}
+
+      e->prescaler = p;
+      e->actual = plan->clock_hz / p;
+      e->error_ppm = (e->actual - e->freq) / e->freq * 1e6;
+      /* Allow for rounding of the frequencies given */
+      if (MxcPlanAbs(e->error_ppm) > 1e-6)
+	plan->exact = 0;
+      if (MxcPlanAbs(e->error_ppm) > plan->max_error_ppm)
+	plan->max_error_ppm = MxcPlanAbs(e->error_ppm);
+
+      if (lcm)
+	{
+	  g = MxcPlanGcd(lcm, p);
+	  if (lcm / g > ~0ULL / p)
+	    lcm = 0;
+	  else
+	    lcm = lcm / g * p;
+	}
+    }
+
+  plan->period_cycles = lcm;
+  plan->period_s = (lcm && plan->clock_hz > 0.0) ? lcm / plan->clock_hz : 0.0;
+
+  return result;
+}
+
+/**
+Program planned multiplexed counters and trigger event mappings, then
+reset all counters to start them in phase.
+
+@param pEg Pointer to MrfEgRegs structure
+@param plan Plan computed with MxcPlanCompute()
+@return Returns number of counters programmed, -1 on error.
+*/
+int MxcPlanApply(volatile struct MrfEgRegs *pEg, const struct MxcPlan *plan)
+{
+  int mxc, n = 0;
+
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    if (plan->mxc[mxc].used && plan->mxc[mxc].prescaler <
+	MXCPLAN_MIN_PRESCALER)
+      return -1;
+
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    if (plan->mxc[mxc].used)
+      {
+	EvgSetMXCPrescaler(pEg, mxc, plan->mxc[mxc].prescaler);
+	EvgSetMxcTrigMap(pEg, mxc, plan->mxc[mxc].trigmap);
+	n++;
+      }
+
+  EvgSyncMxc(pEg);
+
+  return n;
+}
+
+/**
+Show plan.
+
+@param plan Plan
+*/
+void MxcPlanDump(const struct MxcPlan *plan)
+{
+  const struct MxcPlanEntry *e;
+  int mxc;
+
+  DEBUG_PRINTF("Event clock %.6f MHz\n", plan->clock_hz * 1e-6);
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    {
+      e = &plan->mxc[mxc];
+      if (!e->used)
+	continue;
+      DEBUG_PRINTF("MXC%d target %.6f Hz prescaler %u actual %.6f Hz "
+		   "error %.3f ppm trig %d\n", mxc, e->freq, e->prescaler,
+		   e->actual, e->error_ppm, e->trigmap);
+    }
+  if (plan->period_cycles)
+    DEBUG_PRINTF("Common period %llu cycles, %.9f s%s\n",
+		 plan->period_cycles, plan->period_s,
+		 plan->exact ? "" : ", not exact");
+  else
+    DEBUG_PRINTF("No common period within 64 bits\n");
+}
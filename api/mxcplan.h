@@ -0,0 +1,47 @@
+/*
+  mxcplan.h -- Micro-Research Event Generator
+               Multiplexed counter frequency planner
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include egapi.h before this file.
+
+  Computes the prescalers of the multiplexed counters for target
+  frequencies and programs all counters with one counter reset at the
+  end, so every counter starts in phase. Counters without a target are
+  left as they are.
+
+  The common period is the least common multiple of the planned
+  prescalers, the time after which all counters are in phase again. It
+  is 0 if it does not fit in 64 bits.
+ */
+
+#define MXCPLAN_MIN_PRESCALER 2
+
+struct MxcPlanEntry {
+  int          used;
+  double       freq;       /* Target frequency in Hz */
+  int          trigmap;    /* Trigger event, -1 none */
+  unsigned int prescaler;
+  double       actual;     /* Resulting frequency in Hz */
+  double       error_ppm;  /* (actual - freq) / freq in ppm */
+};
+
+struct MxcPlan {
+  double              clock_hz;
+  struct MxcPlanEntry mxc[EVG_MAX_MXCS];
+  unsigned long long  period_cycles;  /* Common period */
+  double              period_s;
+  double              max_error_ppm;  /* Largest absolute error */
+  int                 exact;          /* All frequencies exact */
+};
+
+double MxcPlanEventClock(volatile struct MrfEgRegs *pEg);
+void MxcPlanInit(struct MxcPlan *plan, double clock_hz);
+int MxcPlanSet(struct MxcPlan *plan, int mxc, double freq, int trigmap);
+int MxcPlanCompute(struct MxcPlan *plan);
+int MxcPlanApply(volatile struct MrfEgRegs *pEg, const struct MxcPlan *plan);
+void MxcPlanDump(const struct MxcPlan *plan);
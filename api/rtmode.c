@@ -0,0 +1,305 @@
+/**
+@file rtmode.c
+@brief Realtime mode for Micro-Research Event Receiver event servicing
+       threads.
+
+On a busy host scheduler noise and page faults dominate the latency of
+the FIFO/interrupt servicing loop. RtModeEnter() pins the calling thread
+to a CPU, switches it to SCHED_FIFO, locks the process memory and
+prefaults the thread stack. The register window and the buffers used by
+the servicing loop are prefaulted with RtPrefaultWindow() and
+RtAllocBuffer() so that the hot path never page faults or allocates.
+
+EvrRtJitterTest() runs a periodic loop in the calling thread and
+measures its period against the EVR timestamp counter.
+
+@date 19.10.2026
+*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "erapi.h"
+#include "rtmode.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define RTMODE_PAGE_SIZE 4096
+
+/**
+Fill in default realtime settings: no CPU pinning, SCHED_FIFO priority
+50, memory locked and RTMODE_DEFAULT_STACK bytes of stack prefaulted.
+
+@param rt Pointer to RtMode structure
+*/
+void RtModeDefaults(struct RtMode *rt)
+{
+  rt->cpu = -1;
+  rt->priority = 50;
+  rt->lockmem = 1;
+  rt->stack = RTMODE_DEFAULT_STACK;
+}
+
+/** @private */
+static void RtPrefaultStack(int size)
+{
+  char stack[size];
+  volatile char *p = stack;
+  int i;
+
+  /* Stores through a volatile pointer are not optimized away */
+  for (i = 0; i < size; i += RTMODE_PAGE_SIZE)
+    p[i] = 0;
+}
+
+/**
+Put calling thread into realtime mode.
+
+@param rt Pointer to RtMode structure
+@return Returns 0 on success, -1 if any of the settings failed. All
+settings are attempted.
+
+SCHED_FIFO and mlockall require CAP_SYS_NICE and CAP_IPC_LOCK or
+suitable resource limits.
+*/
+int RtModeEnter(struct RtMode *rt)
+{
+  struct sched_param sp;
+  cpu_set_t set;
+  int result = 0;
+
+  if (rt->cpu >= 0)
+    {
+      CPU_ZERO(&set);
+      CPU_SET(rt->cpu, &set);
+      if (sched_setaffinity(0, sizeof(set), &set))
+	{
+#ifdef DEBUG
+	  DEBUG_PRINTF("RtModeEnter: sched_setaffinity errno %d\n", errno);
+#endif
+	  result = -1;
+	}
+    }
+
+  if (rt->priority > 0)
+    {
+      memset(&sp, 0, sizeof(sp));
+      sp.sched_priority = rt->priority;
+      if (sched_setscheduler(0, SCHED_FIFO, &sp))
+	{
+#ifdef DEBUG
+	  DEBUG_PRINTF("RtModeEnter: sched_setscheduler errno %d\n", errno);
+#endif
+	  result = -1;
+	}
+    }
+
+  if (rt->lockmem)
+    {
+      if (mlockall(MCL_CURRENT | MCL_FUTURE))
+	{
+#ifdef DEBUG
+	  DEBUG_PRINTF("RtModeEnter: mlockall errno %d\n", errno);
+#endif
+	  result = -1;
+	}
+    }
+
+  if (rt->stack > 0)
+    RtPrefaultStack(rt->stack);
+
+  return result;
+}
+
+/**
+Prefault memory mapped register window by reading the first word of
+every page.
+
+@param window Start of register window, e.g. pEr
+@param size Size of mapped window, e.g. EVR_MEM_WINDOW
+@return Returns 0.
+
+None of the EVR, EVG and FCT registers at the start of a page have read
+side effects; the FIFO and event analyzer registers are within the
+first page at non-zero offsets.
+*/
+int RtPrefaultWindow(volatile void *window, int size)
+{
+  volatile char *p = (volatile char *) window;
+  int i;
+  u32 dummy;
+
+  for (i = 0; i < size; i += RTMODE_PAGE_SIZE)
+    dummy = *((volatile u32 *) (p + i));
+  (void) dummy;
+
+  return 0;
+}
+
+/**
+Prefault buffer by writing every page.
+
+@param buf Buffer
+@param size Size of buffer in bytes
+@return Returns 0.
+*/
+int RtPrefaultBuffer(void *buf, int size)
+{
+  volatile char *p = (volatile char *) buf;
+  int i;
+
+  for (i = 0; i < size; i += RTMODE_PAGE_SIZE)
+    p[i] = 0;
+  if (size > 0)
+    p[size - 1] = 0;
+
+  return 0;
+}
+
+/**
+Allocate locked and prefaulted buffer for the servicing loop. Allocate
+all buffers before entering the hot path.
+
+@param size Size of buffer in bytes
+@return Returns pointer to zeroed buffer, NULL on error.
+*/
+void *RtAllocBuffer(int size)
+{
+  void *buf;
+
+  buf = mmap(0, size, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (buf == MAP_FAILED)
+    return NULL;
+
+  /* Locking may fail without privileges, pages are populated anyway */
+  mlock(buf, size);
+  RtPrefaultBuffer(buf, size);
+
+  return buf;
+}
+
+/**
+Free buffer allocated with RtAllocBuffer().
+
+@param buf Buffer
+@param size Size of buffer in bytes
+*/
+void RtFreeBuffer(void *buf, int size)
+{
+  munlock(buf, size);
+  munmap(buf, size);
+}
+
+/** @private */
+static void RtReadTimestamp(volatile struct MrfErRegs *pEr, u32 *sec,
+			    u32 *ts)
+{
+  u32 s;
+
+  do
+    {
+      s = be32_to_cpu(pEr->SecondsCounter);
+      *ts = be32_to_cpu(pEr->TimestampEventCounter);
+      *sec = be32_to_cpu(pEr->SecondsCounter);
+    }
+  while (s != *sec);
+}
+
+/**
+Measure jitter of a periodic servicing loop in the calling thread
+against the EVR timestamp counter. Call after RtModeEnter() to test the
+realtime settings.
+
+@param pEr Pointer to MrfErRegs structure
+@param tick_ns Timestamp counter period in ns
+@param period_us Loop period in microseconds
+@param loops Number of loop iterations to measure
+@param res Pointer to result structure
+@return Returns 0 on success, -1 on error.
+
+The timestamp counter is assumed to be reset on every seconds
+boundary.
+*/
+int EvrRtJitterTest(volatile struct MrfErRegs *pEr, double tick_ns,
+		    int period_us, int loops, struct RtJitter *res)
+{
+  struct timespec next, now;
+  u32 sec, ts, psec, pts;
+  double ticks, period, dev, late, sum = 0.0;
+  int i;
+
+  if (tick_ns <= 0.0 || period_us <= 0 || loops <= 0)
+    return -1;
+
+  memset(res, 0, sizeof(struct RtJitter));
+  res->period_ns = period_us * 1000.0;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  RtReadTimestamp(pEr, &psec, &pts);
+
+  for (i = 0; i < loops; i++)
+    {
+      next.tv_nsec += period_us * 1000L;
+      while (next.tv_nsec >= 1000000000L)
+	{
+	  next.tv_nsec -= 1000000000L;
+	  next.tv_sec++;
+	}
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL)
+	     == EINTR)
+	;
+
+      RtReadTimestamp(pEr, &sec, &ts);
+      clock_gettime(CLOCK_MONOTONIC, &now);
+
+      ticks = (double) ts - (double) pts;
+      if (sec != psec)
+	ticks += ((double) sec - (double) psec) * 1.0E9 / tick_ns;
+      period = ticks * tick_ns;
+      psec = sec;
+      pts = ts;
+
+      if (!i || period < res->min_ns)
+	res->min_ns = period;
+      if (period > res->max_ns)
+	res->max_ns = period;
+      sum += period;
+
+      dev = period - res->period_ns;
+      if (dev < 0)
+	dev = -dev;
+      if (dev > res->jitter_ns)
+	res->jitter_ns = dev;
+
+      late = (now.tv_sec - next.tv_sec) * 1.0E9 +
+	(now.tv_nsec - next.tv_nsec);
+      if (late > res->late_max_ns)
+	res->late_max_ns = late;
+      if (late > res->period_ns)
+	{
+	  /* Skip missed periods */
+	  res->overruns++;
+	  next = now;
+	}
+    }
+
+  res->loops = loops;
+  res->avg_ns = sum / loops;
+
+  return 0;
+}
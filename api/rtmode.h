@@ -0,0 +1,42 @@
+/*
+  rtmode.h -- Realtime mode for Micro-Research Event Receiver
+              event servicing threads
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include erapi.h before this file.
+ */
+
+struct MrfErRegs;
+
+#define RTMODE_DEFAULT_STACK  (64*1024)
+
+struct RtMode {
+  int cpu;                        /* CPU to pin thread to, -1 no pinning */
+  int priority;                   /* SCHED_FIFO priority, 0 keep policy */
+  int lockmem;                    /* Lock current and future pages */
+  int stack;                      /* Bytes of stack to prefault */
+};
+
+struct RtJitter {
+  int    loops;
+  int    overruns;                /* Wake-ups later than one period */
+  double period_ns;
+  double min_ns;                  /* Hardware measured loop period */
+  double max_ns;
+  double avg_ns;
+  double jitter_ns;               /* Largest deviation from period */
+  double late_max_ns;             /* Largest wake-up lateness */
+};
+
+void RtModeDefaults(struct RtMode *rt);
+int RtModeEnter(struct RtMode *rt);
+int RtPrefaultWindow(volatile void *window, int size);
+int RtPrefaultBuffer(void *buf, int size);
+void *RtAllocBuffer(int size);
+void RtFreeBuffer(void *buf, int size);
+int EvrRtJitterTest(volatile struct MrfErRegs *pEr, double tick_ns,
+		    int period_us, int loops, struct RtJitter *res);
@@ -0,0 +1,244 @@
+/**
+@file seqcomp.c
+@brief Compile periodic event streams into Micro-Research Event
+       Generator sequence RAM images.
+
+The streams of a RAM are merged with a binary heap ordered by the time
+of the next event of each stream, so compiling n entries from k
+streams takes O(n log k) time.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "egapi.h"
+#include "mrfmmio.h"
+#include "seqcomp.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+struct SeqCompNext {
+  unsigned long long time;
+  unsigned int       index;      /* Events sent by stream */
+  int                stream;
+};
+
+/** @private Heap order, earlier streams first in the same cycle */
+static int SeqCompBefore(const struct SeqCompNext *a,
+			 const struct SeqCompNext *b)
+{
+  return a->time < b->time || (a->time == b->time && a->stream < b->stream);
+}
+
+/** @private */
+static void SeqCompDown(struct SeqCompNext *heap, int n, int i)
+{
+  struct SeqCompNext tmp;
+  int c;
+
+  for (; (c = 2 * i + 1) < n; i = c)
+    {
+      if (c + 1 < n && SeqCompBefore(&heap[c + 1], &heap[c]))
+	c++;
+      if (!SeqCompBefore(&heap[c], &heap[i]))
+	break;
+      tmp = heap[i];
+      heap[i] = heap[c];
+      heap[c] = tmp;
+    }
+}
+
+/** @private */
+static void SeqCompSetError(struct SeqCompImage *img, int error, int stream)
+{
+  if (img->error == SEQCOMP_OK)
+    {
+      img->error = error;
+      img->error_stream = stream;
+    }
+}
+
+/** @private Compile streams of one RAM */
+static int SeqCompileRam(const struct SeqCompStream *streams, int n, int ram,
+			 unsigned int end, int flags, struct SeqCompImage *img,
+			 struct SeqCompNext *heap)
+{
+  const struct SeqCompStream *s;
+  unsigned long long t, last = 0;
+  int i, k = 0, code, last_code = -1, send;
+
+  for (i = 0; i < n; i++)
+    if (streams[i].ram == ram && streams[i].count)
+      {
+	heap[k].time = streams[i].offset;
+	heap[k].index = 0;
+	heap[k].stream = i;
+	k++;
+      }
+  for (i = k / 2 - 1; i >= 0; i--)
+    SeqCompDown(heap, k, i);
+
+  while (k)
+    {
+      s = &streams[heap[0].stream];
+      t = heap[0].time;
+      code = ((s->mask & 0x00ff) << 8) | s->code;
+      send = 1;
+
+      if (last_code >= 0 && t == last)
+	{
+	  if (last_code == code)
+	    {
+	      /* Same event and mask from another stream */
+	      img->duplicates++;
+	      send = 0;
+	    }
+	  else
+	    {
+	      if (!img->collisions++)
+		img->first_collision = t;
+	      if (flags & SEQCOMP_SHIFT_COLLISIONS)
+		{
+		  /* Retry in next cycle against the other streams */
+		  heap[0].time = t + 1;
+		  SeqCompDown(heap, k, 0);
+		  continue;
+		}
+	      SeqCompSetError(img, SEQCOMP_COLLISION, heap[0].stream);
+	      send = 0;
+	    }
+	}
+
+      if (send)
+	{
+	  if (t > 0xffffffffULL)
+	    {
+	      SeqCompSetError(img, SEQCOMP_RANGE, heap[0].stream);
+	      return -1;
+	    }
+	  if (img->items >= EVG_MAX_SEQRAMEV - 1)
+	    {
+	      SeqCompSetError(img, SEQCOMP_OVERFLOW, heap[0].stream);
+	      return -1;
+	    }
+	  img->item[img->items].Timestamp = be32_to_cpu((u32) t);
+	  img->item[img->items].EventCode = be32_to_cpu(code);
+	  img->items++;
+	  last = t;
+	  last_code = code;
+	}
+
+      /* Next event of stream, from its schedule even if shifted */
+      if (++heap[0].index < s->count)
+	heap[0].time = s->offset +
+	  (unsigned long long) heap[0].index * s->period;
+      else
+	heap[0] = heap[--k];
+      SeqCompDown(heap, k, 0);
+    }
+
+  if (!img->items)
+    return 0;
+
+  if (!end)
+    end = last + 1;
+  if (end <= last)
+    {
+      SeqCompSetError(img, SEQCOMP_RANGE, -1);
+      return -1;
+    }
+  img->item[img->items].Timestamp = be32_to_cpu(end);
+  img->item[img->items].EventCode = be32_to_cpu(SEQCOMP_END_CODE);
+  img->items++;
+
+  return img->error == SEQCOMP_OK ? 0 : -1;
+}
+
+/**
+Compile event streams into sequence RAM images.
+
+@param streams Event streams
+@param n Number of streams
+@param end Time of end of sequence, 0 for the cycle after the last event
+@param flags SEQCOMP_SHIFT_COLLISIONS to move colliding events
+@param img Array of EVG_SEQRAMS images, returns the image of each RAM
+and the problems found. RAMs without streams get empty images.
+@return Returns 0 on success, -1 if an image has an error.
+*/
+int SeqCompile(const struct SeqCompStream *streams, int n, unsigned int end,
+	       int flags, struct SeqCompImage *img)
+{
+  struct SeqCompNext *heap;
+  int i, ram, result = 0;
+
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    {
+      img[ram].items = 0;
+      img[ram].duplicates = 0;
+      img[ram].collisions = 0;
+      img[ram].first_collision = 0;
+      img[ram].error = SEQCOMP_OK;
+      img[ram].error_stream = -1;
+    }
+
+  for (i = 0; i < n; i++)
+    if (streams[i].ram < 0 || streams[i].ram >= EVG_SEQRAMS ||
+	streams[i].code <= 0 || streams[i].code > EVG_MAX_EVENT_CODE ||
+	streams[i].code == SEQCOMP_END_CODE ||
+	(!streams[i].period && streams[i].count > 1))
+      {
+	ram = (streams[i].ram >= 0 && streams[i].ram < EVG_SEQRAMS) ?
+	  streams[i].ram : 0;
+	SeqCompSetError(&img[ram], SEQCOMP_INVALID, i);
+	return -1;
+      }
+
+  heap = malloc((n ? n : 1) * sizeof(struct SeqCompNext));
+  if (heap == NULL)
+    return -1;
+
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    if (SeqCompileRam(streams, n, ram, end, flags, &img[ram], heap))
+      result = -1;
+
+  free(heap);
+
+#ifdef DEBUG
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    DEBUG_PRINTF("SeqCompile: RAM %d, %d items, %d collisions, error %d\n",
+		 ram, img[ram].items, img[ram].collisions, img[ram].error);
+#endif
+
+  return result;
+}
+
+/**
+Load compiled image into sequence RAM. The RAM should be disabled
+while loading.
+
+@param pEg Pointer to MrfEgRegs structure
+@param ram Sequence RAM number
+@param img Image from SeqCompile()
+@return Returns number of entries written, -1 on error.
+*/
+int SeqCompLoad(volatile struct MrfEgRegs *pEg, int ram,
+		const struct SeqCompImage *img)
+{
+  if (ram < 0 || ram >= EVG_SEQRAMS || img->error != SEQCOMP_OK ||
+      img->items < 0 || img->items > EVG_MAX_SEQRAMEV)
+    return -1;
+
+  MrfMmioWrite(pEg->SeqRam[ram], img->item,
+	       img->items * sizeof(struct SeqRamItemStruct));
+
+  return img->items;
+}
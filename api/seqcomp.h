@@ -0,0 +1,65 @@
+/*
+  seqcomp.h -- Compile periodic event streams into Micro-Research
+               Event Generator sequence RAM images
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include egapi.h before this file.
+
+  A stream sends count events of one code, the first one at offset and
+  the following ones every period event clock cycles after the start
+  of the sequence. The streams of each sequence RAM are merged in time
+  order into an image closed by the end of sequence code 0x7f.
+
+  Events of the same code and mask in the same cycle are merged into
+  one entry. Different codes, or the same code with different masks,
+  in the same cycle collide, as the sequence RAM sends one event per
+  cycle and a combined mask could suppress an event one of the streams
+  sends unmasked; with
+  SEQCOMP_SHIFT_COLLISIONS the later stream is moved to the next free
+  cycle, otherwise compiling fails. Compiling also fails if the entries
+  and the end code do not fit in EVG_MAX_SEQRAMEV entries or a
+  timestamp does not fit in 32 bits.
+
+  Images are kept in the byte order of the sequence RAM and are loaded
+  as they are with SeqCompLoad().
+ */
+
+#define SEQCOMP_END_CODE         0x7f
+
+/* Flags of SeqCompile() */
+#define SEQCOMP_SHIFT_COLLISIONS 0x0001
+
+/* Errors in SeqCompImage.error */
+#define SEQCOMP_OK               0
+#define SEQCOMP_COLLISION        1
+#define SEQCOMP_OVERFLOW         2
+#define SEQCOMP_RANGE            3
+#define SEQCOMP_INVALID          4
+
+struct SeqCompStream {
+  int                ram;
+  int                code;
+  unsigned int       period;
+  unsigned int       offset;
+  unsigned int       count;
+  int                mask;       /* Mask bits, EventCode bits 15-8 */
+};
+
+struct SeqCompImage {
+  struct SeqRamItemStruct item[EVG_MAX_SEQRAMEV];  /* Big endian */
+  int                items;      /* Including end of sequence */
+  int                duplicates; /* Merged entries */
+  int                collisions;
+  unsigned long long first_collision;
+  int                error;
+  int                error_stream; /* Stream causing error, -1 none */
+};
+
+int SeqCompile(const struct SeqCompStream *streams, int n, unsigned int end,
+	       int flags, struct SeqCompImage *img);
+int SeqCompLoad(volatile struct MrfEgRegs *pEg, int ram,
+		const struct SeqCompImage *img);
@@ -0,0 +1,465 @@
+/**
+@file seqsim.c
+@brief Offline simulation and validation of Micro-Research Event
+       Generator sequence RAM execution.
+
+The simulation is event driven: each sequence RAM and periodic source
+knows the time of its next action and the earliest one is processed
+next, so the cost is a few comparisons per event independent of the
+time between events.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "egapi.h"
+#include "seqsim.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+#define SEQSIM_NEVER     (~0ULL)
+
+/* RAM states */
+#define SEQSIM_OFF       0
+#define SEQSIM_WAIT      1
+#define SEQSIM_RUN       2
+
+struct SeqSimState {
+  int                state;
+  int                pos;
+  unsigned long long start;       /* Time of trigger */
+  unsigned long long base;        /* Counter wrap arounds */
+  unsigned long long next;        /* Time of next action */
+  unsigned long long cycles;
+};
+
+/**
+Initialize simulation with all RAMs disabled and empty.
+
+@param sim Simulation
+*/
+void SeqSimInit(struct SeqSim *sim)
+{
+  memset(sim, 0, sizeof(struct SeqSim));
+}
+
+/**
+Set sequence RAM contents and control settings, see EvgSeqRamControl().
+
+@param sim Simulation
+@param ram RAM number
+@param items Sequence entries in host byte order
+@param n Number of entries
+@param enable 0 - disabled, 1 - enabled
+@param single 1 - disable RAM after sequence end
+@param recycle 1 - restart sequence at once after end
+@param trigsel Trigger source
+@param mask Event mask, entries with these mask bits set are suppressed
+@param repeat Number of sequences, 0 for infinite
+@return Returns 0 on success, -1 on error.
+*/
+int SeqSimSetRam(struct SeqSim *sim, int ram,
+		 const struct SeqRamItemStruct *items, int n, int enable,
+		 int single, int recycle, int trigsel, int mask,
+		 unsigned long long repeat)
+{
+  struct SeqSimRam *r;
+
+  if (ram < 0 || ram >= EVG_SEQRAMS || n < 0 || n > EVG_MAX_SEQRAMEV)
+    return -1;
+
+  r = &sim->ram[ram];
+  memcpy(r->item, items, n * sizeof(struct SeqRamItemStruct));
+  r->items = n;
+  r->enable = enable;
+  r->single = single;
+  r->recycle = recycle;
+  r->trigsel = trigsel;
+  r->mask = mask & 0x00ff;
+  r->repeat = repeat;
+
+  return 0;
+}
+
+/**
+Set one sequence RAM entry, see EvgSetSeqRamEvent(). The RAM is
+extended to hold the entry.
+
+@param sim Simulation
+@param ram RAM number
+@param pos Sequence RAM position
+@param timestamp Event timestamp
+@param code Event code
+@param mask Event mask bits
+@return Returns 0 on success, -1 on error.
+*/
+int SeqSimSetEvent(struct SeqSim *sim, int ram, int pos,
+		   unsigned int timestamp, int code, int mask)
+{
+  struct SeqSimRam *r;
+
+  if (ram < 0 || ram >= EVG_SEQRAMS || pos < 0 || pos >= EVG_MAX_SEQRAMEV ||
+      code < 0 || code > EVG_MAX_EVENT_CODE)
+    return -1;
+
+  r = &sim->ram[ram];
+  r->item[pos].Timestamp = timestamp;
+  r->item[pos].EventCode = ((mask & 0x00ff) << 8) | code;
+  if (pos >= r->items)
+    r->items = pos + 1;
+
+  return 0;
+}
+
+/**
+Add periodic event source sharing the event stream.
+
+@param sim Simulation
+@param period Period in event clock cycles
+@param phase Time of first event
+@param code Event code
+@return Returns source number, -1 on error.
+*/
+int SeqSimAddSource(struct SeqSim *sim, unsigned long long period,
+		    unsigned long long phase, int code)
+{
+  if (sim->sources >= SEQSIM_MAX_SOURCES || !period)
+    return -1;
+
+  sim->source[sim->sources].period = period;
+  sim->source[sim->sources].phase = phase;
+  sim->source[sim->sources].code = code;
+
+  return sim->sources++;
+}
+
+/**
+Load sequence RAMs, their settings and the multiplexed counter
+prescalers from an Event Generator.
+
+@param sim Simulation
+@param pEg Pointer to MrfEgRegs structure
+@return Returns 0 on success.
+*/
+int SeqSimLoad(struct SeqSim *sim, volatile struct MrfEgRegs *pEg)
+{
+  struct SeqSimRam *r;
+  u32 control;
+  int ram, pos, mxc;
+
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    {
+      r = &sim->ram[ram];
+      for (pos = 0; pos < EVG_MAX_SEQRAMEV; pos++)
+	{
+	  r->item[pos].Timestamp = be32_to_cpu(pEg->SeqRam[ram][pos].Timestamp);
+	  r->item[pos].EventCode = be32_to_cpu(pEg->SeqRam[ram][pos].EventCode);
+	}
+      r->items = EVG_MAX_SEQRAMEV;
+      control = be32_to_cpu(pEg->SeqRamControl[ram]);
+      r->enable = (control >> C_EVG_SQRC_ENABLED) & 1;
+      r->single = (control >> C_EVG_SQRC_SINGLE) & 1;
+      r->recycle = (control >> C_EVG_SQRC_RECYCLE) & 1;
+      r->trigsel = (control >> C_EVG_SQRC_TRIGSEL_LOW) & C_EVG_SEQTRIG_MAX;
+      r->mask = (control >> 8) & 0x00ff;
+      r->repeat = ((unsigned long long)
+		   be32_to_cpu(pEg->SeqRamRepeatHigh[ram]) << 32) |
+	be32_to_cpu(pEg->SeqRamRepeatLow[ram]);
+    }
+
+  for (mxc = 0; mxc < EVG_MAX_MXCS; mxc++)
+    sim->prescaler[mxc] = be32_to_cpu(pEg->MXC[mxc].Prescaler);
+
+  return 0;
+}
+
+/**
+Check sequence RAM contents without simulating.
+
+@param ram Sequence RAM settings
+@param pos Returns position of the problem found, may be NULL
+@return Returns SEQSIM_OK, SEQSIM_NON_MONOTONIC for a timestamp not
+greater than the previous one or SEQSIM_NO_END if there is no end of
+sequence code.
+*/
+int SeqSimCheckRam(const struct SeqSimRam *ram, int *pos)
+{
+  int i;
+
+  for (i = 0; i < ram->items; i++)
+    {
+      if (i && ram->item[i].Timestamp <= ram->item[i - 1].Timestamp)
+	{
+	  if (pos)
+	    *pos = i;
+	  return SEQSIM_NON_MONOTONIC;
+	}
+      if ((ram->item[i].EventCode & 0x00ff) == SEQSIM_END_CODE)
+	return SEQSIM_OK;
+    }
+
+  if (pos)
+    *pos = ram->items;
+  return SEQSIM_NO_END;
+}
+
+/** @private */
+static int SeqSimHasEnd(const struct SeqSimRam *ram)
+{
+  int i;
+
+  for (i = 0; i < ram->items; i++)
+    if ((ram->item[i].EventCode & 0x00ff) == SEQSIM_END_CODE)
+      return 1;
+
+  return 0;
+}
+
+/** @private */
+static unsigned long long SeqSimPeriodic(unsigned long long period,
+					 unsigned long long after)
+{
+  if (!period)
+    return SEQSIM_NEVER;
+
+  return ((after + period - 1) / period) * period;
+}
+
+/** @private Time of first trigger at or after a time */
+static unsigned long long SeqSimTrigger(const struct SeqSim *sim, int trigsel,
+					unsigned long long after)
+{
+  int sw;
+
+  if (trigsel >= 0 && trigsel < EVG_MAX_MXCS)
+    return SeqSimPeriodic(sim->prescaler[trigsel], after);
+  if (trigsel == SEQSIM_TRIG_AC)
+    return SeqSimPeriodic(sim->ac_period, after);
+  if (trigsel == SEQSIM_TRIG_SW0 || trigsel == SEQSIM_TRIG_SW1)
+    {
+      sw = trigsel - SEQSIM_TRIG_SW0;
+      if (sim->swtrig_set[sw] && sim->swtrig[sw] >= after)
+	return sim->swtrig[sw];
+    }
+
+  return SEQSIM_NEVER;
+}
+
+/** @private Number of triggers in (from, to] */
+static unsigned long long SeqSimTriggers(const struct SeqSim *sim,
+					 int trigsel, unsigned long long from,
+					 unsigned long long to)
+{
+  unsigned long long period = 0;
+  int sw;
+
+  if (trigsel >= 0 && trigsel < EVG_MAX_MXCS)
+    period = sim->prescaler[trigsel];
+  else if (trigsel == SEQSIM_TRIG_AC)
+    period = sim->ac_period;
+  else if (trigsel == SEQSIM_TRIG_SW0 || trigsel == SEQSIM_TRIG_SW1)
+    {
+      sw = trigsel - SEQSIM_TRIG_SW0;
+      return sim->swtrig_set[sw] && sim->swtrig[sw] > from &&
+	sim->swtrig[sw] <= to;
+    }
+
+  return period ? to / period - from / period : 0;
+}
+
+/** @private Set time of next entry or stop a RAM without end */
+static void SeqSimNextItem(const struct SeqSimRam *r, struct SeqSimState *st)
+{
+  if (st->pos >= r->items)
+    {
+      st->state = SEQSIM_OFF;
+      st->next = SEQSIM_NEVER;
+      return;
+    }
+  /* The counter has passed the timestamp and has to wrap around */
+  if (st->pos && r->item[st->pos].Timestamp <= r->item[st->pos - 1].Timestamp)
+    st->base += 1ULL << 32;
+  st->next = st->start + st->base + r->item[st->pos].Timestamp;
+}
+
+/**
+Simulate sequence RAM execution.
+
+@param sim Simulation
+@param cycles Stop when every active RAM with end of sequence has run
+this many sequences, 0 for no limit
+@param until Stop at this time, 0 for no limit
+@param emit Called for every event in time order, may be NULL
+@param arg Argument passed to emit
+@param report Returns statistics and problems found
+@return Returns number of problems found: non-monotonic timestamps and
+missing end of sequence per enabled RAM, collisions and lost triggers. Returns
+-1 if there is no limit.
+*/
+int SeqSimRun(struct SeqSim *sim, unsigned long long cycles,
+	      unsigned long long until, SeqSimEmit emit, void *arg,
+	      struct SeqSimReport *report)
+{
+  struct SeqSimState st[EVG_SEQRAMS];
+  unsigned long long snext[SEQSIM_MAX_SOURCES];
+  unsigned long long t, last = SEQSIM_NEVER;
+  struct SeqSimEvent ev;
+  struct SeqSimRam *r;
+  int ram, src, best, done, code, pos;
+
+  if (!cycles && !until)
+    return -1;
+
+  memset(report, 0, sizeof(struct SeqSimReport));
+  for (ram = 0; ram < EVG_SEQRAMS; ram++)
+    {
+      r = &sim->ram[ram];
+      report->non_monotonic[ram] = -1;
+      if (r->enable && SeqSimCheckRam(r, &pos) == SEQSIM_NON_MONOTONIC)
+	{
+	  report->non_monotonic[ram] = pos;
+	  report->errors++;
+	}
+      if (r->enable && !SeqSimHasEnd(r))
+	{
+	  report->missing_end[ram] = 1;
+	  report->errors++;
+	}
+
+      memset(&st[ram], 0, sizeof(struct SeqSimState));
+      st[ram].state = (r->enable && r->items) ? SEQSIM_WAIT : SEQSIM_OFF;
+      st[ram].next = (st[ram].state == SEQSIM_WAIT) ?
+	SeqSimTrigger(sim, r->trigsel, 0) : SEQSIM_NEVER;
+    }
+  for (src = 0; src < sim->sources; src++)
+    snext[src] = sim->source[src].phase;
+
+  for (;;)
+    {
+      if (cycles)
+	{
+	  /* A RAM without end of sequence never completes one */
+	  for (done = 1, ram = 0; ram < EVG_SEQRAMS; ram++)
+	    if (st[ram].next != SEQSIM_NEVER && !report->missing_end[ram] &&
+		st[ram].cycles < cycles)
+	      done = 0;
+	  if (done)
+	    break;
+	}
+
+      /* Earliest action, RAMs first in the same cycle */
+      t = SEQSIM_NEVER;
+      best = -1;
+      for (ram = 0; ram < EVG_SEQRAMS; ram++)
+	if (st[ram].next < t)
+	  {
+	    t = st[ram].next;
+	    best = ram;
+	  }
+      for (src = 0; src < sim->sources; src++)
+	if (snext[src] < t)
+	  {
+	    t = snext[src];
+	    best = SEQSIM_SRC_PERIODIC + src;
+	  }
+      if (best < 0 || (until && t > until))
+	break;
+
+      ev.time = t;
+      ev.flags = 0;
+      ev.source = best;
+      if (best >= SEQSIM_SRC_PERIODIC)
+	{
+	  src = best - SEQSIM_SRC_PERIODIC;
+	  ev.code = sim->source[src].code;
+	  snext[src] += sim->source[src].period;
+	}
+      else
+	{
+	  r = &sim->ram[best];
+	  if (st[best].state == SEQSIM_WAIT)
+	    {
+	      /* Triggered, restart counter */
+	      st[best].state = SEQSIM_RUN;
+	      st[best].start = t;
+	      st[best].base = 0;
+	      st[best].pos = 0;
+	      SeqSimNextItem(r, &st[best]);
+	      continue;
+	    }
+
+	  code = r->item[st[best].pos].EventCode;
+	  ev.code = code & 0x00ff;
+	  st[best].pos++;
+	  if (ev.code == SEQSIM_END_CODE)
+	    {
+	      ev.flags = SEQSIM_EV_END;
+	      st[best].cycles++;
+	      report->cycles[best]++;
+	      if (!r->recycle)
+		report->lost_triggers +=
+		  SeqSimTriggers(sim, r->trigsel, st[best].start, t);
+	      if (r->single ||
+		  (r->repeat && st[best].cycles >= r->repeat))
+		{
+		  st[best].state = SEQSIM_OFF;
+		  st[best].next = SEQSIM_NEVER;
+		}
+	      else if (r->recycle)
+		{
+		  st[best].start = t;
+		  st[best].base = 0;
+		  st[best].pos = 0;
+		  SeqSimNextItem(r, &st[best]);
+		}
+	      else
+		{
+		  st[best].state = SEQSIM_WAIT;
+		  st[best].next = SeqSimTrigger(sim, r->trigsel, t + 1);
+		}
+	      if (emit && emit(&ev, arg))
+		break;
+	      continue;
+	    }
+
+	  SeqSimNextItem(r, &st[best]);
+	  if (!ev.code)
+	    continue;
+	  if ((code >> 8) & r->mask)
+	    {
+	      report->masked++;
+	      continue;
+	    }
+	}
+
+      if (t == last)
+	{
+	  ev.flags |= SEQSIM_EV_COLLISION;
+	  report->collisions++;
+	}
+      last = t;
+      report->events++;
+      report->end_time = t;
+      if (emit && emit(&ev, arg))
+	break;
+    }
+
+#ifdef DEBUG
+  DEBUG_PRINTF("SeqSimRun: %llu events, %llu collisions\n", report->events,
+	       report->collisions);
+#endif
+  if (report->collisions)
+    report->errors++;
+  if (report->lost_triggers)
+    report->errors++;
+
+  return report->errors;
+}
@@ -0,0 +1,119 @@
+/*
+  seqsim.h -- Offline simulation and validation of Micro-Research
+              Event Generator sequence RAM execution
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include egapi.h before this file.
+
+  Time is counted in event clock cycles from the common reset of the
+  multiplexed counters. A sequence RAM waits for its trigger, restarts
+  its counter and sends each event when the counter reaches the
+  timestamp of the event. Event code 0x7f ends the sequence; with
+  recycle the sequence restarts at once, in single mode the RAM is
+  disabled, otherwise the RAM waits for the next trigger. Triggers
+  while the sequence runs are lost. A repeat count other than zero
+  disables the RAM after that many sequences.
+
+  Trigger sources are the multiplexed counters (trigsel 0-15, trigger
+  every prescaler cycles), the AC input (16, every ac_period cycles)
+  and the software triggers (17, 18, once at swtrig). Code 0 entries
+  are empty, entries whose mask bits (EventCode bits 15-8) are set in
+  the RAM mask are suppressed.
+
+  Periodic sources model other users of the event stream, e.g. events
+  of the trigger event registers driven by multiplexed counters. Two
+  events in the same cycle collide.
+
+  The simulator reports, for each RAM, the first non-monotonic
+  timestamp and a missing end of sequence. A timestamp lower than the
+  previous one makes the hardware counter wrap around before the event
+  is sent, which is what the simulation does. A RAM without end of
+  sequence stops after its last entry.
+ */
+
+#define SEQSIM_MAX_SOURCES   16
+#define SEQSIM_END_CODE      0x7f
+
+#define SEQSIM_TRIG_AC       16
+#define SEQSIM_TRIG_SW0      17
+#define SEQSIM_TRIG_SW1      18
+
+/* Event sources, RAMs are 0 to EVG_SEQRAMS-1 */
+#define SEQSIM_SRC_PERIODIC  16      /* + periodic source number */
+
+/* Results of SeqSimCheckRam() */
+#define SEQSIM_OK            0
+#define SEQSIM_NON_MONOTONIC 1
+#define SEQSIM_NO_END        2
+
+/* Event flags */
+#define SEQSIM_EV_END        0x01    /* End of sequence, not sent */
+#define SEQSIM_EV_COLLISION  0x02    /* Same cycle as previous event */
+
+struct SeqSimRam {
+  struct SeqRamItemStruct item[EVG_MAX_SEQRAMEV];  /* Host byte order */
+  int                     items;
+  int                     enable;
+  int                     single;
+  int                     recycle;
+  int                     trigsel;
+  int                     mask;
+  unsigned long long      repeat;  /* 0 infinite */
+};
+
+struct SeqSimSource {
+  unsigned long long period;
+  unsigned long long phase;
+  int                code;
+};
+
+struct SeqSim {
+  struct SeqSimRam    ram[EVG_SEQRAMS];
+  unsigned int        prescaler[EVG_MAX_MXCS];
+  unsigned long long  ac_period;   /* 0 no AC trigger */
+  unsigned long long  swtrig[2];   /* Time of software trigger */
+  int                 swtrig_set[2];
+  struct SeqSimSource source[SEQSIM_MAX_SOURCES];
+  int                 sources;
+};
+
+struct SeqSimEvent {
+  unsigned long long time;
+  int                code;
+  int                source;
+  int                flags;
+};
+
+struct SeqSimReport {
+  unsigned long long events;       /* Events sent */
+  unsigned long long cycles[EVG_SEQRAMS];
+  unsigned long long collisions;
+  unsigned long long lost_triggers;
+  unsigned long long masked;
+  unsigned long long end_time;     /* Time of last event */
+  int                non_monotonic[EVG_SEQRAMS];  /* Position, -1 none */
+  int                missing_end[EVG_SEQRAMS];    /* 1 if missing */
+  int                errors;          /* Problems, see SeqSimRun() */
+};
+
+/* Return non-zero to stop the simulation */
+typedef int (*SeqSimEmit)(const struct SeqSimEvent *ev, void *arg);
+
+void SeqSimInit(struct SeqSim *sim);
+int SeqSimSetRam(struct SeqSim *sim, int ram,
+		 const struct SeqRamItemStruct *items, int n, int enable,
+		 int single, int recycle, int trigsel, int mask,
+		 unsigned long long repeat);
+int SeqSimSetEvent(struct SeqSim *sim, int ram, int pos,
+		   unsigned int timestamp, int code, int mask);
+int SeqSimAddSource(struct SeqSim *sim, unsigned long long period,
+		    unsigned long long phase, int code);
+int SeqSimLoad(struct SeqSim *sim, volatile struct MrfEgRegs *pEg);
+int SeqSimCheckRam(const struct SeqSimRam *ram, int *pos);
+int SeqSimRun(struct SeqSim *sim, unsigned long long cycles,
+	      unsigned long long until, SeqSimEmit emit, void *arg,
+	      struct SeqSimReport *report);
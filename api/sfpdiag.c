@@ -8,6 +8,7 @@
 */
 
 #ifdef __linux__
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -38,6 +39,11 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <string.h>
+#include "egapi.h"
+#include "erapi.h"
+#include "fctapi.h"
+#include "mrfmmio.h"
 #include "sfpdiag.h"
 
 #ifndef be16_to_cpu
@@ -150,3 +156,190 @@ void SFPDump(struct SFPDiag *pSFP)
   printf("Alarm Flags:                        %02x %02x\n", pSFP->alarm_flags[0], pSFP->alarm_flags[1]);
   printf("Warning Flags:                      %02x %02x\n", pSFP->warning_flags[0], pSFP->warning_flags[1]);
 }
+
+/**
+Copy SFP Transceiver EEPROM and diagnostics block from device with
+aligned 32-bit reads. The single byte and 16-bit fields can then be
+read from the copy.
+
+@param pSFP Pointer to SFPDiag structure to copy to.
+@param src Pointer to SFP window of device.
+*/
+void SFPCopy(struct SFPDiag *pSFP, volatile void *src)
+{
+  MrfMmioCopyIn(pSFP, src, sizeof(struct SFPDiag), 4);
+}
+
+/** @private */
+static void SFPCheck(int value, int h_alarm, int l_alarm, int h_warning,
+		     int l_warning, int high, int *alarm, int *warning)
+{
+  if (value > h_alarm)
+    *alarm |= high;
+  if (value < l_alarm)
+    *alarm |= high << 1;
+  if (value > h_warning)
+    *warning |= high;
+  if (value < l_warning)
+    *warning |= high << 1;
+}
+
+/**
+Decode real time diagnostics and evaluate them against the alarm and
+warning thresholds of the transceiver. The port number is not changed.
+
+@param pSFP Pointer to SFPDiag structure, usually a copy by SFPCopy().
+@param pRd Pointer to reading.
+@return Returns 0 on success, -1 if no transceiver or no internally
+calibrated diagnostics, the values are zero then.
+*/
+int SFPEvaluate(const struct SFPDiag *pSFP, struct SFPReading *pRd)
+{
+  int port = pRd->port;
+
+  memset(pRd, 0, sizeof(struct SFPReading));
+  pRd->port = port;
+  pRd->present = (pSFP->transceiver_type != 0 &&
+		  pSFP->transceiver_type != 0xff);
+  /* Diagnostic monitoring type: implemented, internally calibrated */
+  pRd->diag = (pRd->present && (pSFP->reserved_92[0] & 0x60) == 0x60);
+  if (!pRd->diag)
+    return -1;
+
+  pRd->temperature = ((signed short) be16_to_cpu(pSFP->rt_temperature))/256.0;
+  pRd->vcc = be16_to_cpu(pSFP->rt_vcc)/10000.0;
+  pRd->tx_bias = be16_to_cpu(pSFP->rt_tx_bias)*2.0;
+  pRd->tx_power = be16_to_cpu(pSFP->rt_tx_power)*0.1;
+  pRd->rx_power = be16_to_cpu(pSFP->rt_rx_power)*0.1;
+
+  SFPCheck((signed short) be16_to_cpu(pSFP->rt_temperature),
+	   (signed short) be16_to_cpu(pSFP->temp_h_alarm),
+	   (signed short) be16_to_cpu(pSFP->temp_l_alarm),
+	   (signed short) be16_to_cpu(pSFP->temp_h_warning),
+	   (signed short) be16_to_cpu(pSFP->temp_l_warning),
+	   SFP_TEMP_HIGH, &pRd->alarm, &pRd->warning);
+  SFPCheck(be16_to_cpu(pSFP->rt_vcc),
+	   be16_to_cpu(pSFP->vcc_h_alarm), be16_to_cpu(pSFP->vcc_l_alarm),
+	   be16_to_cpu(pSFP->vcc_h_warning), be16_to_cpu(pSFP->vcc_l_warning),
+	   SFP_VCC_HIGH, &pRd->alarm, &pRd->warning);
+  SFPCheck(be16_to_cpu(pSFP->rt_tx_bias),
+	   be16_to_cpu(pSFP->tx_bias_h_alarm),
+	   be16_to_cpu(pSFP->tx_bias_l_alarm),
+	   be16_to_cpu(pSFP->tx_bias_h_warning),
+	   be16_to_cpu(pSFP->tx_bias_l_warning),
+	   SFP_TX_BIAS_HIGH, &pRd->alarm, &pRd->warning);
+  SFPCheck(be16_to_cpu(pSFP->rt_tx_power),
+	   be16_to_cpu(pSFP->tx_power_h_alarm),
+	   be16_to_cpu(pSFP->tx_power_l_alarm),
+	   be16_to_cpu(pSFP->tx_power_h_warning),
+	   be16_to_cpu(pSFP->tx_power_l_warning),
+	   SFP_TX_POWER_HIGH, &pRd->alarm, &pRd->warning);
+  SFPCheck(be16_to_cpu(pSFP->rt_rx_power),
+	   be16_to_cpu(pSFP->rx_power_h_alarm),
+	   be16_to_cpu(pSFP->rx_power_l_alarm),
+	   be16_to_cpu(pSFP->rx_power_h_warning),
+	   be16_to_cpu(pSFP->rx_power_l_warning),
+	   SFP_RX_POWER_HIGH, &pRd->alarm, &pRd->warning);
+
+  return 0;
+}
+
+/**
+Read SFP Transceiver of Event Receiver.
+
+@param pEr Pointer to MrfErRegs structure.
+@param pRd Pointer to reading, port is set to 0.
+@return Returns 0 on success, -1 if no diagnostics.
+*/
+int SFPReadEvr(volatile struct MrfErRegs *pEr, struct SFPReading *pRd)
+{
+  struct SFPDiag sfp;
+
+  /* EEPROM at 0x8200 and diagnostics at 0x8300 form one SFPDiag */
+  SFPCopy(&sfp, pEr->SFPEEPROM);
+  pRd->port = 0;
+
+  return SFPEvaluate(&sfp, pRd);
+}
+
+/**
+Read SFP Transceivers of Fan-Out/Concentrator ports.
+
+@param pFct Pointer to MrfFctRegs structure.
+@param pRd Array of readings, one per port.
+@param ports Number of ports, at most 8.
+@return Returns number of ports with diagnostics.
+*/
+int SFPReadFct(volatile struct MrfFctRegs *pFct, struct SFPReading *pRd,
+	       int ports)
+{
+  struct SFPDiag sfp;
+  int i, n = 0;
+
+  if (ports > 8)
+    ports = 8;
+
+  for (i = 0; i < ports; i++)
+    {
+      SFPCopy(&sfp, pFct->SFPDiag[i]);
+      pRd[i].port = i + 1;
+      if (!SFPEvaluate(&sfp, &pRd[i]))
+	n++;
+    }
+
+  return n;
+}
+
+/**
+Read all SFP Transceivers of an Event Master. The Event Generator has
+no SFP window of its own; its upstream port is read through the
+upstream Event Receiver.
+
+@param pEg Pointer to MrfEgRegs structure.
+@param pRd Array of SFP_EVM_PORTS readings, upstream port first.
+@return Returns number of ports with diagnostics.
+*/
+int SFPReadEvm(volatile struct MrfEgRegs *pEg, struct SFPReading *pRd)
+{
+  int n = 0;
+
+  if (!SFPReadEvr((volatile struct MrfErRegs *) pEg->EvrU, pRd))
+    n++;
+
+  return n + SFPReadFct((volatile struct MrfFctRegs *) pEg->Fct, &pRd[1],
+			SFP_EVM_PORTS - 1);
+}
+
+/**
+Show SFP Transceiver readings one port per line.
+
+@param pRd Array of readings.
+@param n Number of readings.
+*/
+void SFPReadingDump(const struct SFPReading *pRd, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++, pRd++)
+    {
+      printf("Port %d: ", pRd->port);
+      if (!pRd->present)
+	{
+	  printf("no transceiver\n");
+	  continue;
+	}
+      if (!pRd->diag)
+	{
+	  printf("no diagnostics\n");
+	  continue;
+	}
+      printf("%.1f degC %.3f V %.0f uA Tx %.1f uW Rx %.1f uW",
+	     pRd->temperature, pRd->vcc, pRd->tx_bias, pRd->tx_power,
+	     pRd->rx_power);
+      if (pRd->alarm)
+	printf(" alarm %03x", pRd->alarm);
+      if (pRd->warning)
+	printf(" warning %03x", pRd->warning);
+      printf("\n");
+    }
+}
@@ -112,5 +112,51 @@ struct SFPDiag {
   u8  reserved_374[138];
 };
 
+/*
+  Readings of the real time diagnostics in engineering units evaluated
+  against the alarm and warning thresholds of the same transceiver.
+  The diagnostics block is copied once with aligned 32-bit reads, see
+  SFPCopy(). Values are valid only when diag is set, i.e. the
+  transceiver implements internally calibrated diagnostics.
+ */
+
+#define SFP_TEMP_HIGH       0x0001
+#define SFP_TEMP_LOW        0x0002
+#define SFP_VCC_HIGH        0x0004
+#define SFP_VCC_LOW         0x0008
+#define SFP_TX_BIAS_HIGH    0x0010
+#define SFP_TX_BIAS_LOW     0x0020
+#define SFP_TX_POWER_HIGH   0x0040
+#define SFP_TX_POWER_LOW    0x0080
+#define SFP_RX_POWER_HIGH   0x0100
+#define SFP_RX_POWER_LOW    0x0200
+
+/* Upstream port and Fan-Out/Concentrator ports 1-8 of an EVM */
+#define SFP_EVM_PORTS       9
+
+struct SFPReading {
+  int    port;          /* 0 upstream/EVR, 1-8 FCT port */
+  int    present;       /* Transceiver identified */
+  int    diag;          /* Internally calibrated diagnostics */
+  double temperature;   /* degC */
+  double vcc;           /* V */
+  double tx_bias;       /* uA */
+  double tx_power;      /* uW */
+  double rx_power;      /* uW */
+  int    alarm;         /* SFP_* bits outside alarm thresholds */
+  int    warning;       /* SFP_* bits outside warning thresholds */
+};
+
+struct MrfEgRegs;
+struct MrfErRegs;
+struct MrfFctRegs;
+
 void SFPSN(struct SFPDiag *pSFP);
 void SFPDump(struct SFPDiag *pSFP);
+void SFPCopy(struct SFPDiag *pSFP, volatile void *src);
+int SFPEvaluate(const struct SFPDiag *pSFP, struct SFPReading *pRd);
+int SFPReadEvr(volatile struct MrfErRegs *pEr, struct SFPReading *pRd);
+int SFPReadFct(volatile struct MrfFctRegs *pFct, struct SFPReading *pRd,
+	       int ports);
+int SFPReadEvm(volatile struct MrfEgRegs *pEg, struct SFPReading *pRd);
+void SFPReadingDump(const struct SFPReading *pRd, int n);
@@ -0,0 +1,265 @@
+/**
+@file swinject.c
+@brief Software event injection for Micro-Research Event Generators
+       and Event Receivers.
+
+Sends single events, bursts and paced streams through the SWEvent
+register without overwriting pending events, see swinject.h.
+
+@date 19.10.2026
+*/
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <endian.h>
+#include <byteswap.h>
+
+#include "egapi.h"
+#include "erapi.h"
+#include "mrflock.h"
+#include "swinject.h"
+
+/*
+#define DEBUG 1
+*/
+#define DEBUG_PRINTF printf
+
+/* Sleep only when the next event is further away, spin otherwise */
+#define SWINJECT_SPIN_NS 50000.0
+
+/** @private */
+static double SwInjectNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** @private */
+static void SwInjectInit(struct SwInject *inj, volatile u32 *reg, int enable,
+			 int pending)
+{
+  memset(inj, 0, sizeof(struct SwInject));
+  inj->reg = reg;
+  inj->enable = 1 << enable;
+  inj->pending = 1 << pending;
+  inj->timeout_us = SWINJECT_DEFAULT_TIMEOUT_US;
+}
+
+/**
+Initialize injector for Event Generator and enable software events.
+
+@param inj Injector
+@param pEg Pointer to MrfEgRegs structure
+@return Returns 0 on success, -1 if software events cannot be enabled.
+*/
+int SwInjectInitEvg(struct SwInject *inj, volatile struct MrfEgRegs *pEg)
+{
+  SwInjectInit(inj, &pEg->SWEvent, C_EVG_SWEVENT_ENABLE,
+	       C_EVG_SWEVENT_PENDING);
+
+  return EvgSWEventEnable(pEg, 1) ? 0 : -1;
+}
+
+/**
+Initialize injector for Event Receiver and enable software events.
+
+@param inj Injector
+@param pEr Pointer to MrfErRegs structure
+@return Returns 0 on success, -1 if software events cannot be enabled.
+*/
+int SwInjectInitEvr(struct SwInject *inj, volatile struct MrfErRegs *pEr)
+{
+  SwInjectInit(inj, &pEr->SWEvent, C_EVR_SWEVENT_ENABLE,
+	       C_EVR_SWEVENT_PENDING);
+
+  return EvrSWEventEnable(pEr, 1) ? 0 : -1;
+}
+
+/**
+@private
+Poll until no event is pending, also one of another writer.
+
+@return Returns 0 when no event is pending, -1 after timeout_us.
+*/
+static int SwInjectPoll(struct SwInject *inj)
+{
+  double now, deadline = 0.0;
+
+  for (;;)
+    {
+      inj->polls++;
+      if (!(be32_to_cpu(*inj->reg) & inj->pending))
+	return 0;
+      now = SwInjectNow();
+      if (deadline == 0.0)
+	deadline = now + inj->timeout_us * 1e-6;
+      else if (now > deadline)
+	return -1;
+    }
+}
+
+/**
+Send software event after the previous one has been sent and wait
+until it has left.
+
+@param inj Injector
+@param code Event code
+@return Returns 0 on success, -1 if an event is still pending after
+timeout_us; the event is not sent then.
+*/
+int SwInjectSend(struct SwInject *inj, int code)
+{
+  double now, lat;
+  int result, sent;
+
+  now = SwInjectNow();
+  MRF_LOCK(*inj->reg);
+  result = SwInjectPoll(inj);
+  if (!result)
+    {
+      *inj->reg = be32_to_cpu(inj->enable | (code & 0x00ff));
+      sent = !SwInjectPoll(inj);
+      lat = (SwInjectNow() - now) * 1e9;
+    }
+  MRF_UNLOCK(*inj->reg);
+  if (result)
+    {
+      inj->timeouts++;
+      return -1;
+    }
+
+  if (!inj->sent++)
+    inj->first_time = now;
+  inj->last_time = now;
+
+  if (!sent)
+    {
+      /* Still pending, the next send waits for it */
+      inj->late++;
+      return 0;
+    }
+  if (!inj->latencies || lat < inj->lat_min_ns)
+    inj->lat_min_ns = lat;
+  if (lat > inj->lat_max_ns)
+    inj->lat_max_ns = lat;
+  inj->lat_sum_ns += lat;
+  inj->latencies++;
+
+  return 0;
+}
+
+/**
+Send events back to back.
+
+@param inj Injector
+@param codes Event codes
+@param n Number of events
+@return Returns number of events sent.
+*/
+int SwInjectBurst(struct SwInject *inj, const int *codes, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    if (SwInjectSend(inj, codes[i]))
+      break;
+
+  return i;
+}
+
+/**
+Send events at a fixed rate. Times are absolute so that a late event
+does not delay the following ones.
+
+@param inj Injector
+@param codes Event codes
+@param n Number of events
+@param rate_hz Events per second
+@return Returns number of events sent.
+*/
+int SwInjectPaced(struct SwInject *inj, const int *codes, int n,
+		  double rate_hz)
+{
+  struct timespec t;
+  double start, due, left;
+  int i;
+
+  if (rate_hz <= 0.0)
+    return 0;
+
+  start = SwInjectNow();
+  for (i = 0; i < n; i++)
+    {
+      due = start + i / rate_hz;
+      left = due - SwInjectNow();
+      if (left * 1e9 > SWINJECT_SPIN_NS)
+	{
+	  due -= SWINJECT_SPIN_NS * 1e-9;
+	  t.tv_sec = (time_t) due;
+	  t.tv_nsec = (long) ((due - t.tv_sec) * 1e9);
+	  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) ==
+		 EINTR)
+	    ;
+	  due += SWINJECT_SPIN_NS * 1e-9;
+	}
+      while (SwInjectNow() < due)
+	;
+      if (SwInjectSend(inj, codes[i]))
+	break;
+    }
+
+  return i;
+}
+
+/**
+Wait until the last event has been sent.
+
+@param inj Injector
+@return Returns 0 on success, -1 on timeout.
+*/
+int SwInjectFlush(struct SwInject *inj)
+{
+  int result;
+
+  MRF_LOCK(*inj->reg);
+  result = SwInjectPoll(inj);
+  MRF_UNLOCK(*inj->reg);
+  if (result)
+    inj->timeouts++;
+
+  return result;
+}
+
+/**
+Get achieved injection rate.
+
+@param inj Injector
+@return Returns events per second from first to last call, 0 if fewer
+than two events were sent.
+*/
+double SwInjectRate(const struct SwInject *inj)
+{
+  if (inj->sent < 2 || inj->last_time <= inj->first_time)
+    return 0.0;
+
+  return (inj->sent - 1) / (inj->last_time - inj->first_time);
+}
+
+/**
+Get average latency from call to event sent.
+
+@param inj Injector
+@return Returns average latency in ns, 0 if none measured.
+*/
+double SwInjectLatencyAvg(const struct SwInject *inj)
+{
+  if (!inj->latencies)
+    return 0.0;
+
+  return inj->lat_sum_ns / inj->latencies;
+}
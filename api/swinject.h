@@ -0,0 +1,54 @@
+/*
+  swinject.h -- Software event injection for Micro-Research Event
+                Generators and Event Receivers
+
+  Date:   19.10.2026
+
+*/
+
+/*
+  Note: include egapi.h and erapi.h before this file.
+
+  A software event written to the SWEvent register stays pending until
+  it has been sent in a free event slot. Writing again while the
+  pending bit is set replaces the event. The injector polls the
+  pending bit before each write, only as long as it is set, so no
+  event is overwritten, not even one of another writer. After the
+  write it polls again until the event has been sent, usually a few
+  microseconds. The register is locked (mrflock.h) from the first poll
+  to the last.
+
+  Latency is the time from the call to the first read that shows the
+  event sent. An event still pending after timeout_us is counted as
+  late and has no latency; the next send waits for it.
+ */
+
+#define SWINJECT_DEFAULT_TIMEOUT_US 1000
+
+struct SwInject {
+  volatile u32       *reg;          /* SWEvent register */
+  u32                 enable;       /* Enable bit */
+  u32                 pending;      /* Pending bit */
+  int                 timeout_us;   /* Longest wait for pending event */
+  /* Statistics */
+  unsigned long long  sent;
+  unsigned long long  timeouts;
+  unsigned long long  late;         /* Sent events pending after wait */
+  unsigned long long  polls;        /* Register reads */
+  unsigned long long  latencies;    /* Latencies measured */
+  double              first_time;
+  double              last_time;
+  double              lat_min_ns;
+  double              lat_max_ns;
+  double              lat_sum_ns;
+};
+
+int SwInjectInitEvg(struct SwInject *inj, volatile struct MrfEgRegs *pEg);
+int SwInjectInitEvr(struct SwInject *inj, volatile struct MrfErRegs *pEr);
+int SwInjectSend(struct SwInject *inj, int code);
+int SwInjectBurst(struct SwInject *inj, const int *codes, int n);
+int SwInjectPaced(struct SwInject *inj, const int *codes, int n,
+		  double rate_hz);
+int SwInjectFlush(struct SwInject *inj);
+double SwInjectRate(const struct SwInject *inj);
+double SwInjectLatencyAvg(const struct SwInject *inj);
@@ -33,8 +33,8 @@ $WRAP_DIR/EvgSeqRamControl  $EVG 1    0   0      1       1     0       0
 #							dev  ram  i   time   code
 $WRAP_DIR/EvgSetSeqRamEvent $EVG 1    0   100    $CODE
 $WRAP_DIR/EvgSetSeqRamEvent $EVG 1    1   350    $CODE
-$WRAP_DIR/EvgSetSeqRamEvent $EVG 1    1   700    $CODE
-$WRAP_DIR/EvgSetSeqRamEvent $EVG 1    2   1000    127
+$WRAP_DIR/EvgSetSeqRamEvent $EVG 1    2   700    $CODE
+$WRAP_DIR/EvgSetSeqRamEvent $EVG 1    3   1000    127
 
 $WRAP_DIR/EvgSeqRamControl  $EVG 1    1   1      0       0     18      0
 
@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../api/erapi.h"
+#include "../api/mrfprog.h"
+
+int main(int argc, char *argv[])
+{
+  struct MrfErRegs *pEr;
+  struct MrfProg   *prog;
+  int              fdEr;
+  int              line;
+  int              i;
+
+  if (argc < 3)
+    {
+      printf("Usage: %s /dev/era3 <config file> [cache dir]\n", argv[0]);
+      printf("Compiled configurations are kept in cache dir.\n");
+      return -1;
+    }
+
+  i = EvrProgLoadConfig(argv[2], argc > 3 ? argv[3] : NULL, &prog, &line);
+  if (i < 0)
+    {
+      if (line)
+	printf("%s:%d: invalid statement\n", argv[2], line);
+      else
+	printf("Could not read %s, errno %d\n", argv[2], errno);
+      return -1;
+    }
+
+  fdEr = EvrOpen(&pEr, argv[1]);
+  if (fdEr == -1)
+    return errno;
+
+  EvrProgApply(pEr, prog);
+
+  EvrClose(fdEr);
+  MrfProgFree(prog);
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../api/erapi.h"
+#include "../api/mrfconfig.h"
+
+int main(int argc, char *argv[])
+{
+  struct MrfErRegs *pEr;
+  int              fdEr;
+  int              size;
+  int              i;
+  char             *image;
+  FILE             *fp;
+
+  if (argc < 3)
+    {
+      printf("Usage: %s /dev/era3 <file> [verify]\n", argv[0]);
+      printf("With verify set to 1 only compares configuration.\n");
+      return -1;
+    }
+
+  image = malloc(EvrConfigImageSize());
+  fp = fopen(argv[2], "rb");
+  if (image == NULL || fp == NULL)
+    {
+      printf("Could not read %s, errno %d\n", argv[2], errno);
+      return errno;
+    }
+  size = fread(image, 1, EvrConfigImageSize(), fp);
+  fclose(fp);
+
+  fdEr = EvrOpen(&pEr, argv[1]);
+  if (fdEr == -1)
+    return errno;
+
+  if (argc > 3 && atoi(argv[3]))
+    {
+      i = EvrConfigVerify(pEr, image, size);
+      if (i > 0)
+	printf("%d registers differ\n", i);
+    }
+  else
+    i = EvrConfigRestore(pEr, image, size);
+  if (i < 0)
+    printf("Invalid configuration image\n");
+
+  EvrClose(fdEr);
+  free(image);
+
+  return i;
+}
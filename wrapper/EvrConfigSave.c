@@ -0,0 +1,52 @@
+#include <stdint.h>
+#include <endian.h>
+#include <byteswap.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../api/erapi.h"
+#include "../api/mrfconfig.h"
+
+int main(int argc, char *argv[])
+{
+  struct MrfErRegs *pEr;
+  int              fdEr;
+  int              size;
+  char             *image;
+  FILE             *fp;
+
+  if (argc < 3)
+    {
+      printf("Usage: %s /dev/era3 <file>\n", argv[0]);
+      return -1;
+    }
+
+  fdEr = EvrOpen(&pEr, argv[1]);
+  if (fdEr == -1)
+    return errno;
+
+  image = malloc(EvrConfigImageSize());
+  size = -1;
+  if (image)
+    size = EvrConfigSave(pEr, image, EvrConfigImageSize());
+  EvrClose(fdEr);
+
+  if (size < 0)
+    {
+      printf("Could not save configuration\n");
+      return -1;
+    }
+
+  fp = fopen(argv[2], "wb");
+  if (fp == NULL || fwrite(image, size, 1, fp) != 1)
+    {
+      printf("Could not write %s, errno %d\n", argv[2], errno);
+      return errno;
+    }
+  fclose(fp);
+
+  printf("Saved %d bytes\n", size);
+  free(image);
+
+  return 0;
+}